@@ -1,4 +1,6 @@
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <unordered_map>
@@ -23,11 +25,12 @@
 
 Application* Application::sInstance = nullptr;
 
-VISetLayout CreateSetLayout(VIDevice device, const std::initializer_list<VIBinding>& list)
+VISetLayout CreateSetLayout(VIDevice device, const std::initializer_list<VIBinding>& list, VISetLayoutFlags flags)
 {
 	VISetLayoutInfo info;
 	info.binding_count = list.size();
 	info.bindings = list.begin();
+	info.flags = flags;
 
 	return vi_create_set_layout(device, &info);
 }
@@ -67,73 +70,51 @@ VIModule CreateOrLoadModule(VIDevice device, VIBackend backend, VIPipelineLayout
 	Timer timer;
 	timer.Start();
 
-	std::string glsl(vise_glsl);
-	std::string path(name);
+	std::string path_to_binary(name);
+	path_to_binary += backend == VI_BACKEND_VULKAN ? "_vk.bin" : "_gl.bin";
 
-	path += backend == VI_BACKEND_VULKAN ? "_vk" : "_gl";
-	std::string path_to_hash = path;
-	std::string path_to_binary = path;
-	std::stringstream ss;
-
-	path_to_hash += ".txt";
-	path_to_binary += ".bin";
-
-	ss << std::hash<std::string>{}(glsl);
-	std::string glsl_hash = ss.str();
-	bool use_disk_binary = false;
-
-	std::ifstream hash_file(path_to_hash.c_str(), std::ios::binary | std::ios::ate);
 	std::ifstream binary_file(path_to_binary.c_str(), std::ios::binary | std::ios::ate);
 	std::vector<char> binary;
 
-	if (hash_file && binary_file)
-	{
-		std::streampos end = hash_file.tellg();
-		hash_file.seekg(0, std::ios::beg);
-
-		size_t size = static_cast<size_t>(end - hash_file.tellg());
-		std::string disk_hash;
-
-		disk_hash.resize(size);
-		if (hash_file.read(disk_hash.data(), disk_hash.size()))
-			use_disk_binary = disk_hash == glsl_hash;
-	}
-
 	VIModuleInfo moduleI;
 	moduleI.type = type;
 	moduleI.pipeline_layout = layout;
 	moduleI.vise_glsl = nullptr;
 
 	VIModule result = VI_NULL;
+	bool use_disk_binary = false;
 
-	if (use_disk_binary)
+	// the binary header records the source hash, version and layout hash,
+	// a stale disk binary is rejected and recompiled
+	if (binary_file)
 	{
 		std::streampos end = binary_file.tellg();
 		binary_file.seekg(0, std::ios::beg);
 
 		size_t size = static_cast<size_t>(end - binary_file.tellg());
 		binary.resize(size);
-		binary_file.read(binary.data(), binary.size());
 
-		moduleI.vise_binary = binary.data();
-		result = vi_create_module(device, &moduleI);
+		if (binary_file.read(binary.data(), binary.size()) && vi_binary_check(binary.data(), (uint32_t)size, vise_glsl))
+		{
+			moduleI.vise_binary = binary.data();
+			moduleI.vise_binary_size = (uint32_t)size;
+			result = vi_create_module(device, &moduleI);
+			use_disk_binary = result != VI_NULL;
+		}
 	}
-	else
+
+	if (!use_disk_binary)
 	{
 		uint32_t binary_size;
 		char* binary = vi_compile_binary(device, type, layout, vise_glsl, &binary_size);
 
-		std::ofstream out_hash_file;
-		out_hash_file.open(path_to_hash);
-		out_hash_file.write(glsl_hash.data(), glsl_hash.size());
-		out_hash_file.close();
-
 		std::ofstream out_binary_file;
 		out_binary_file.open(path_to_binary, std::ios::out | std::ios::binary);
 		out_binary_file.write(binary, binary_size);
 		out_binary_file.close();
 
 		moduleI.vise_binary = binary;
+		moduleI.vise_binary_size = binary_size;
 		result = vi_create_module(device, &moduleI);
 		vi_free(binary);
 	}
@@ -211,6 +192,15 @@ VIImageInfo MakeImageInfo2D(VIFormat format, uint32_t width, uint32_t height, Vk
 	return imageI;
 }
 
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	for (uint32_t dim = std::max(width, height); dim > 1; dim /= 2)
+		levels++;
+
+	return levels;
+}
+
 VIImageInfo MakeImageInfoCube(VIFormat format, uint32_t dim, VkMemoryPropertyFlags properties)
 {
 	VIImageInfo imageI{};
@@ -335,8 +325,7 @@ VIImage CreateImageStaged(VIDevice device, const VIImageInfo* info, const void*
 	assert(info->usage & VI_IMAGE_USAGE_TRANSFER_DST_BIT);
 	assert(info->properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	size_t texelSize = info->format == VI_FORMAT_RGBA8 ? 4 : 16; // TODO: query
-	size_t imageSize = info->width * info->height * texelSize * info->layers;
+	size_t imageSize = vi_format_get_data_size(info->format, info->width, info->height) * info->layers;
 
 	VIBufferInfo stagingBufferI;
 	stagingBufferI.type = VI_BUFFER_TYPE_TRANSFER;
@@ -344,8 +333,16 @@ VIImage CreateImageStaged(VIDevice device, const VIImageInfo* info, const void*
 	stagingBufferI.usage = VI_BUFFER_USAGE_TRANSFER_SRC_BIT;
 	stagingBufferI.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
+	// formats that can not generate mipmaps keep only the uploaded level
+	VIImageInfo imageI = *info;
+	if (imageI.levels > 1 && !vi_device_can_generate_mipmaps(device, imageI.format))
+	{
+		std::cout << "CreateImageStaged: format can not generate mipmaps, creating a single level image" << std::endl;
+		imageI.levels = 1;
+	}
+
 	VIBuffer srcBuffer = vi_create_buffer(device, &stagingBufferI);
-	VIImage dstImage = vi_create_image(device, info);
+	VIImage dstImage = vi_create_image(device, &imageI);
 
 	vi_buffer_map(srcBuffer);
 	vi_buffer_map_write(srcBuffer, 0, imageSize, data);
@@ -362,7 +359,179 @@ VIImage CreateImageStaged(VIDevice device, const VIImageInfo* info, const void*
 		region.imageSubresource.layerCount = info->layers;
 		vi_cmd_copy_buffer_to_image(cmd, srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
-		CmdImageLayoutTransition(cmd, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image_layout, info->layers);
+		// remaining mip levels are filled from level 0
+		if (imageI.levels > 1)
+			vi_cmd_generate_mipmaps(cmd, dstImage, image_layout);
+		else
+			CmdImageLayoutTransition(cmd, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image_layout, info->layers);
+	}
+	vi_command_end(cmd);
+
+	VISubmitInfo submitI{};
+	submitI.cmds = &cmd;
+	submitI.cmd_count = 1;
+	VIQueue queue = vi_device_get_graphics_queue(device);
+	vi_queue_submit(queue, 1, &submitI, VI_NULL);
+	vi_queue_wait_idle(queue);
+	vi_free_command(device, cmd);
+	vi_destroy_command_pool(device, pool);
+
+	vi_destroy_buffer(device, srcBuffer);
+
+	return dstImage;
+}
+
+struct KTX2Header
+{
+	uint8_t Identifier[12];
+	uint32_t VkFormat;
+	uint32_t TypeSize;
+	uint32_t PixelWidth;
+	uint32_t PixelHeight;
+	uint32_t PixelDepth;
+	uint32_t LayerCount;
+	uint32_t FaceCount;
+	uint32_t LevelCount;
+	uint32_t SupercompressionScheme;
+	uint32_t DfdByteOffset;
+	uint32_t DfdByteLength;
+	uint32_t KvdByteOffset;
+	uint32_t KvdByteLength;
+	uint64_t SgdByteOffset;
+	uint64_t SgdByteLength;
+};
+
+struct KTX2LevelIndex
+{
+	uint64_t ByteOffset;
+	uint64_t ByteLength;
+	uint64_t UncompressedByteLength;
+};
+
+static bool CastFormatKTX2(uint32_t vkFormat, VIFormat* format)
+{
+	switch (vkFormat)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:       *format = VI_FORMAT_RGBA8;    return true;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:  *format = VI_FORMAT_RGBA16F;  return true;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:  *format = VI_FORMAT_RGBA32F;  return true;
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: *format = VI_FORMAT_BC1_RGBA; return true;
+	case VK_FORMAT_BC3_UNORM_BLOCK:      *format = VI_FORMAT_BC3_RGBA; return true;
+	case VK_FORMAT_BC4_UNORM_BLOCK:      *format = VI_FORMAT_BC4_R;    return true;
+	case VK_FORMAT_BC5_UNORM_BLOCK:      *format = VI_FORMAT_BC5_RG;   return true;
+	case VK_FORMAT_BC7_UNORM_BLOCK:      *format = VI_FORMAT_BC7_RGBA; return true;
+	default:
+		break;
+	}
+
+	return false;
+}
+
+VIImage CreateImageKTX2(VIDevice device, const char* path, VkImageLayout image_layout, VISamplerInfo* sampler)
+{
+	static const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "CreateImageKTX2: failed to open " << path << std::endl;
+		return VI_NULL;
+	}
+
+	std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	KTX2Header header;
+	if (content.size() >= sizeof(KTX2Header))
+		memcpy(&header, content.data(), sizeof(KTX2Header));
+
+	if (content.size() < sizeof(KTX2Header) || memcmp(header.Identifier, identifier, sizeof(identifier)) != 0)
+	{
+		std::cout << "CreateImageKTX2: not a KTX2 file " << path << std::endl;
+		return VI_NULL;
+	}
+
+	// Basis Universal and zstd payloads would need a transcoder, only raw block data is supported.
+	// files hold either 2D images or square cube maps
+	VIFormat format;
+	bool isValidFaces = header.FaceCount == 1 || (header.FaceCount == 6 && header.PixelWidth == header.PixelHeight);
+	if (header.SupercompressionScheme != 0 || header.PixelDepth > 1 || !isValidFaces || !CastFormatKTX2(header.VkFormat, &format))
+	{
+		std::cout << "CreateImageKTX2: unsupported KTX2 layout in " << path << std::endl;
+		return VI_NULL;
+	}
+
+	uint32_t levelCount = std::max(header.LevelCount, 1u);
+	uint32_t layerCount = std::max(header.LayerCount, 1u) * header.FaceCount;
+	const KTX2LevelIndex* levels = (const KTX2LevelIndex*)(content.data() + sizeof(KTX2Header));
+
+	if (content.size() < sizeof(KTX2Header) + sizeof(KTX2LevelIndex) * levelCount)
+	{
+		std::cout << "CreateImageKTX2: truncated level index in " << path << std::endl;
+		return VI_NULL;
+	}
+
+	VIImageInfo imageI = header.FaceCount == 6
+		? MakeImageInfoCube(format, header.PixelWidth, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+		: MakeImageInfo2D(format, header.PixelWidth, header.PixelHeight, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	imageI.usage = VI_IMAGE_USAGE_TRANSFER_DST_BIT | VI_IMAGE_USAGE_SAMPLED_BIT;
+	imageI.levels = levelCount;
+	if (sampler)
+		imageI.sampler = *sampler;
+	imageI.sampler.max_lod = (float)levelCount;
+
+	if (header.FaceCount != 6 && layerCount > 1)
+	{
+		imageI.type = VI_IMAGE_TYPE_2D_ARRAY;
+		imageI.layers = layerCount;
+	}
+
+	// all levels share one staging buffer, level data is stored tightly packed with
+	// layers and faces of a level adjacent to each other, so one region covers a whole level
+	uint64_t stagingSize = 0;
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		if (levels[level].ByteOffset + levels[level].ByteLength > content.size())
+		{
+			std::cout << "CreateImageKTX2: truncated level data in " << path << std::endl;
+			return VI_NULL;
+		}
+
+		stagingSize += levels[level].ByteLength;
+	}
+
+	VIBufferInfo stagingBufferI;
+	stagingBufferI.type = VI_BUFFER_TYPE_TRANSFER;
+	stagingBufferI.size = (uint32_t)stagingSize;
+	stagingBufferI.usage = VI_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	stagingBufferI.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	VIBuffer srcBuffer = vi_create_buffer(device, &stagingBufferI);
+	VIImage dstImage = vi_create_image(device, &imageI);
+	std::vector<VkBufferImageCopy> regions(levelCount);
+	uint32_t stagingOffset = 0;
+
+	vi_buffer_map(srcBuffer);
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		uint32_t levelSize = (uint32_t)levels[level].ByteLength;
+		vi_buffer_map_write(srcBuffer, stagingOffset, levelSize, content.data() + levels[level].ByteOffset);
+
+		regions[level] = MakeBufferImageCopy2D(VK_IMAGE_ASPECT_COLOR_BIT, std::max(header.PixelWidth >> level, 1u), std::max(header.PixelHeight >> level, 1u));
+		regions[level].bufferOffset = stagingOffset;
+		regions[level].imageSubresource.mipLevel = level;
+		regions[level].imageSubresource.layerCount = layerCount;
+		stagingOffset += levelSize;
+	}
+	vi_buffer_unmap(srcBuffer);
+
+	uint32_t family = vi_device_get_graphics_family_index(device);
+	VICommandPool pool = vi_create_command_pool(device, family, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	VICommand cmd = vi_allocate_primary_command(device, pool);
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+	{
+		CmdImageLayoutTransition(cmd, dstImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layerCount, levelCount);
+		vi_cmd_copy_buffer_to_image(cmd, srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, regions.data());
+		CmdImageLayoutTransition(cmd, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image_layout, layerCount, levelCount);
 	}
 	vi_command_end(cmd);
 
@@ -566,34 +735,50 @@ void VMAAllocator::BufferMapInvalidate(void* allocator, uint32_t id, VkBuffer bu
 	VK_ASSERT(vmaInvalidateAllocation(alloc->mVMA, alloc->mAllocations[id], (VkDeviceSize)offset, (VkDeviceSize)size));
 }
 
-Application::Application(const char* name, VIBackend backend, bool visible, bool resizable)
-	: mName(name), mBackend(backend)
+Application::Application(const char* name, VIBackend backend, bool visible, bool resizable, ApplicationMode mode)
+	: mName(name), mIsHeadless(mode != APP_MODE_WINDOW), mBackend(backend)
 {
 	sInstance = this;
 
-	glfwInit();
-	glfwWindowHint(GLFW_RESIZABLE, resizable);
-	glfwWindowHint(GLFW_VISIBLE, visible);
+	mWindow = nullptr;
+	mWindowWidth = APP_WINDOW_WIDTH;
+	mWindowHeight = APP_WINDOW_HEIGHT;
 
-	if (backend == VI_BACKEND_OPENGL)
+	// headless applications never touch the window system, so they also run on servers without a display
+	if (!mIsHeadless)
 	{
-		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwInit();
+		glfwWindowHint(GLFW_RESIZABLE, resizable);
+		glfwWindowHint(GLFW_VISIBLE, visible);
+
+		if (backend == VI_BACKEND_OPENGL)
+		{
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+			glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		}
+		else
+			glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // Vulkan surfaces require a window without a context
+
+		mWindow = glfwCreateWindow(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT, mName, nullptr, nullptr);
+
+		if (backend == VI_BACKEND_OPENGL)
+		{
+			glfwMakeContextCurrent(mWindow);
+			glfwSwapInterval(1);
+		}
 	}
 
-	mWindow = glfwCreateWindow(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT, mName, nullptr, nullptr);
-	mWindowWidth = APP_WINDOW_WIDTH;
-	mWindowHeight = APP_WINDOW_HEIGHT;
-	glfwMakeContextCurrent(mWindow);
-	glfwSwapInterval(1); // only relevant on OpenGL backend
-
 	std::cout << "application:  " << mName << std::endl;
 	std::cout << "current path: " << std::filesystem::current_path() << std::endl;
 
 	VIDeviceInfo deviceI{};
 	deviceI.window = (void*)mWindow;
-	deviceI.desired_swapchain_framebuffer_count = APP_DESIRED_FRAMES_IN_FLIGHT;
+	deviceI.desired_swapchain_framebuffer_count = APP_MAX_FRAMES_IN_FLIGHT;
+	deviceI.max_frames_in_flight = APP_MAX_FRAMES_IN_FLIGHT;
+	deviceI.headless = mIsHeadless;
+	deviceI.compute_only = mode == APP_MODE_COMPUTE;
+	deviceI.deferred_destruction = true;
 	deviceI.vulkan.configure_swapchain = nullptr;
 	deviceI.vulkan.select_physical_device = nullptr;
 #if !defined(NDEBUG)
@@ -619,36 +804,49 @@ Application::Application(const char* name, VIBackend backend, bool visible, bool
 		allocator.buffer_map_invalidate = &VMAAllocator::BufferMapInvalidate;
 		vi_device_set_allocator_vk(mDevice, &allocator);
 
-		ImGuiVulkanInit();
+		if (!mIsHeadless)
+			ImGuiVulkanInit();
 	}
 	else
 	{
 		mDevice = vi_create_device_gl(&deviceI, &mDeviceLimits);
-		ImGuiOpenGLInit();
+
+		if (!mIsHeadless)
+			ImGuiOpenGLInit();
 	}
 
-	// the actual hardware supported frames in flight may be different from what we asked for.
-	mFramesInFlight = mDeviceLimits.swapchain_framebuffer_count;
+	// per-frame resources are allocated for every frame slot, only some of them may be in flight
+	mFramesInFlight = mDeviceLimits.max_frames_in_flight;
+	if (mFramesInFlight > APP_DESIRED_FRAMES_IN_FLIGHT)
+		vi_device_set_frames_in_flight(mDevice, APP_DESIRED_FRAMES_IN_FLIGHT);
 
 	mCamera.aspect = APP_WINDOW_ASPECT_RATIO;
 
-	glfwSetWindowSizeCallback(mWindow, &Application::WindowSizeCallback);
+	if (!mIsHeadless)
+		glfwSetWindowSizeCallback(mWindow, &Application::WindowSizeCallback);
 }
 
 Application::~Application()
 {
+	// releases deferred destruction before the VMA allocator goes away
+	vi_device_wait_idle(mDevice);
+
 	if (mBackend == VI_BACKEND_VULKAN)
 	{
-		ImGuiVulkanShutdown();
+		if (!mIsHeadless)
+			ImGuiVulkanShutdown();
 		delete mVMAAllocator;
 	}
-	else
+	else if (!mIsHeadless)
 		ImGuiOpenGLShutdown();
 
 	vi_destroy_device(mDevice);
 
-	glfwDestroyWindow(mWindow);
-	glfwTerminate();
+	if (!mIsHeadless)
+	{
+		glfwDestroyWindow(mWindow);
+		glfwTerminate();
+	}
 }
 
 void Application::NewFrame()
@@ -662,6 +860,7 @@ void Application::NewFrame()
 	mFrameTimeThisFrame = glfwGetTime();
 	mFrameTimeDelta = mFrameTimeThisFrame - mFrameTimePrevFrame;
 	mFrameTimePrevFrame = mFrameTimeThisFrame;
+	mFrameTimeAverage = mFrameTimeAverage == 0.0 ? mFrameTimeDelta : mFrameTimeAverage * 0.95 + mFrameTimeDelta * 0.05;
 
 	glfwPollEvents();
 }
@@ -800,6 +999,62 @@ void Application::ImGuiDeviceProfile()
 	}
 }
 
+void Application::ImGuiFrameLatency()
+{
+	if (!ImGui::CollapsingHeader("Frame Latency", ImGuiTreeNodeFlags_DefaultOpen))
+		return;
+
+	int framesInFlight = (int)vi_device_get_frames_in_flight(mDevice);
+	if (ImGui::SliderInt("Frames In Flight", &framesInFlight, 1, (int)mDeviceLimits.max_frames_in_flight))
+		vi_device_set_frames_in_flight(mDevice, (uint32_t)framesInFlight);
+
+	// input is sampled when the CPU starts a frame, which is displayed at the earliest
+	// once every frame queued ahead of it has been rendered and presented
+	double frameTimeMs = mFrameTimeAverage * 1000.0;
+	ImGui::Text("- frame time: %.2f ms (%d FPS)", frameTimeMs, mFrameTimeAverage > 0.0 ? (int)(1.0 / mFrameTimeAverage) : 0);
+	ImGui::Text("- estimated input latency: %.2f ms", frameTimeMs * (framesInFlight + 1));
+}
+
+void Application::ImGuiGPUTimings(const GPUTimer& timer)
+{
+	if (!ImGui::CollapsingHeader("GPU Timings", ImGuiTreeNodeFlags_DefaultOpen))
+		return;
+
+	if (!mDeviceLimits.timestamp_queries)
+	{
+		ImGui::Text("timestamp queries not supported");
+		return;
+	}
+
+	for (const GPUTimerScope& scope : timer.GetScopes())
+	{
+		ImGui::Text("%*s- %s: %.3f ms", (int)scope.Depth * 2, "", scope.Name.c_str(), scope.Milliseconds);
+	}
+}
+
+void Application::ImGuiFrameCounters()
+{
+	if (!ImGui::CollapsingHeader("Frame Counters"))
+		return;
+
+	VIFrameCounters counters;
+	vi_device_get_frame_counters(mDevice, &counters);
+	ImGui::Text("- draws: %u", counters.draws);
+	ImGui::Text("- dispatches: %u", counters.dispatches);
+	ImGui::Text("- binds: %u", counters.binds);
+	ImGui::Text("- state changes: %u", counters.state_changes);
+	ImGui::Text("- passes: %u", counters.passes);
+	ImGui::Text("- submits: %u", counters.submits);
+
+	if (ImGui::Button("Dump CPU Trace"))
+	{
+		if (vi_trace_dump("vise_trace.json"))
+			printf("CPU trace written to vise_trace.json\n");
+		else
+			printf("CPU trace not written, build vise with VI_ENABLE_TRACE\n");
+	}
+}
+
 void Application::WindowSizeCallback(GLFWwindow* window, int width, int height)
 {
 	Application* app = Application::Get();
@@ -858,7 +1113,7 @@ void Application::ImGuiVulkanInit()
 	initI.DescriptorPoolSize = 256;
 	initI.Allocator = nullptr;
 	initI.MinImageCount = mDeviceLimits.swapchain_framebuffer_count;
-	initI.ImageCount = mDeviceLimits.swapchain_framebuffer_count;
+	initI.ImageCount = std::max(mDeviceLimits.swapchain_framebuffer_count, mDeviceLimits.max_frames_in_flight); // ImGui cycles vertex buffers per frame
 	initI.CheckVkResultFn = nullptr;
 	initI.RenderPass = vi_pass_unwrap(vi_device_get_swapchain_pass(mDevice));
 	ImGui_ImplVulkan_Init(&initI);
@@ -888,8 +1143,16 @@ void Application::PrintDeviceLimits(const VIDeviceLimits& limits)
 {
 	printf("== vise device limits (%s):\n", mBackend == VI_BACKEND_VULKAN ? "Vulkan" : "OpenGL");
 	printf(" - swapchain framebuffer count %d\n", (int)limits.swapchain_framebuffer_count);
+	printf(" - max frames in flight %d\n", (int)limits.max_frames_in_flight);
 	printf(" - max push constant size %d\n", (int)limits.max_push_constant_size);
 	printf(" - max compute workgroup count (%d, %d, %d)\n", (int)limits.max_compute_workgroup_count[0], (int)limits.max_compute_workgroup_count[1], (int)limits.max_compute_workgroup_count[2]);
 	printf(" - max compute workgroup size  (%d, %d, %d)\n", (int)limits.max_compute_workgroup_size[0], (int)limits.max_compute_workgroup_size[1], (int)limits.max_compute_workgroup_size[2]);
 	printf(" - max compute workgroup invocations %d\n", (int)limits.max_compute_workgroup_invocations);
+	printf(" - max bindless image count %d\n", (int)limits.max_bindless_image_count);
+	printf(" - min uniform buffer offset alignment %d\n", (int)limits.min_uniform_buffer_offset_alignment);
+	printf(" - min storage buffer offset alignment %d\n", (int)limits.min_storage_buffer_offset_alignment);
+	printf(" - timestamp queries %s\n", limits.timestamp_queries ? "supported" : "not supported");
+	printf(" - precise occlusion queries %s\n", limits.occlusion_query_precise ? "supported" : "not supported");
+	printf(" - pipeline statistics queries %s\n", limits.pipeline_statistics_queries ? "supported" : "not supported");
+	printf(" - conditional rendering %s\n", limits.conditional_rendering ? "supported" : "not supported");
 }
\ No newline at end of file
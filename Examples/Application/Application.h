@@ -8,8 +8,11 @@
 #include <vise.h>
 
 #include "Common.h"
+#include "GPUTimer.h"
 
 #define APP_DESIRED_FRAMES_IN_FLIGHT   2
+#define APP_MAX_FRAMES_IN_FLIGHT       3
+#define APP_GPU_TIMER_LATENCY          (APP_MAX_FRAMES_IN_FLIGHT + 1)
 #define APP_WINDOW_WIDTH               1600
 #define APP_WINDOW_HEIGHT              900
 #define APP_WINDOW_ASPECT_RATIO        ((float)APP_WINDOW_WIDTH / (float)APP_WINDOW_HEIGHT)
@@ -23,7 +26,7 @@
 #define ARRAY_LEN(A) (sizeof(A) / sizeof(*(A)))
 
 // helper to reduce set layout creation verbosity
-VISetLayout CreateSetLayout(VIDevice device, const std::initializer_list<VIBinding>& list);
+VISetLayout CreateSetLayout(VIDevice device, const std::initializer_list<VIBinding>& list, VISetLayoutFlags flags = 0);
 
 // helper to reduce set pool creation verbosity
 VISetPool CreateSetPool(VIDevice device, uint32_t max_sets, const std::initializer_list<VISetPoolResource>& list);
@@ -56,6 +59,9 @@ VkClearValue MakeClearColor(float r, float g, float b, float a);
 VIImageInfo MakeImageInfo2D(VIFormat format, uint32_t width, uint32_t height, VkMemoryPropertyFlags properties);
 VIImageInfo MakeImageInfoCube(VIFormat format, uint32_t dim, VkMemoryPropertyFlags properties);
 
+// number of mip levels in a full chain down to 1x1
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
 // helper to reduce render pass color attachment verbosity
 VIPassColorAttachment MakePassColorAttachment(VIFormat format, VkAttachmentLoadOp load_op, VkAttachmentStoreOp store_op,
 	VkImageLayout initial_layout, VkImageLayout final_layout);
@@ -73,19 +79,32 @@ VkBufferImageCopy MakeBufferImageCopy2D(VkImageAspectFlags aspect, uint32_t widt
 
 VIBuffer CreateBufferStaged(VIDevice device, const VIBufferInfo* info, const void* data);
 
+// uploads level 0, remaining mip levels are generated with vi_cmd_generate_mipmaps.
+// if the device can not generate mipmaps for the format, the image is created with a single level
 VIImage CreateImageStaged(VIDevice device, const VIImageInfo* info, const void* data, VkImageLayout image_layout);
 
+// loads a KTX2 file with its prebuilt mip chain, faces and layers, supercompressed files are rejected.
+// returns VI_NULL on failure, sampler overrides the default image sampler if not null
+VIImage CreateImageKTX2(VIDevice device, const char* path, VkImageLayout image_layout, VISamplerInfo* sampler = nullptr);
+
 // image layout transition via image memory barrier
 void CmdImageLayoutTransition(VICommand cmd, VIImage image, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t layers = 1, uint32_t levels = 1);
 
 class VMAAllocator;
 
+enum ApplicationMode
+{
+	APP_MODE_WINDOW = 0,  // window, swapchain and ImGui
+	APP_MODE_HEADLESS,    // no window, ImGui or swapchain, mWindow stays null
+	APP_MODE_COMPUTE,     // headless compute-only device
+};
+
 class Application
 {
 public:
 	Application() = delete;
 	Application(const Application&) = delete;
-	Application(const char* name, VIBackend backend, bool visible = true, bool resizable = true);
+	Application(const char* name, VIBackend backend, bool visible = true, bool resizable = true, ApplicationMode mode = APP_MODE_WINDOW);
 	virtual ~Application();
 
 	Application& operator=(const Application&) = delete;
@@ -113,16 +132,27 @@ protected:
 
 	void ImGuiDeviceProfile();
 
+	// switch between 1 and APP_MAX_FRAMES_IN_FLIGHT frames in flight, lower latency or higher throughput
+	void ImGuiFrameLatency();
+
+	// GPU time of the scopes recorded with a GPUTimer, results trail the current frame
+	void ImGuiGPUTimings(const GPUTimer& timer);
+
+	// commands submitted last frame, and a CPU trace dump if vise is built with VI_ENABLE_TRACE
+	void ImGuiFrameCounters();
+
 protected:
 	bool mIsFirstFrame = true;
-	int mFramesInFlight;
+	int mFramesInFlight; // frame slots to allocate per-frame resources for, index with vi_device_get_frame_index
 	double mFrameTimeDelta;
+	double mFrameTimeAverage = 0.0;
 	double mFrameTimeThisFrame;
 	double mFrameTimePrevFrame;
 	const char* mName;
 	int mWindowWidth;
 	int mWindowHeight;
 	bool mWindowIsMinimized = false;
+	bool mIsHeadless;
 	GLFWwindow* mWindow;
 	VIDevice mDevice;
 	VIDeviceLimits mDeviceLimits;
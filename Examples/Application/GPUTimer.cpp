@@ -0,0 +1,96 @@
+#include <cassert>
+#include "GPUTimer.h"
+
+GPUTimer::GPUTimer(VIDevice device, uint32_t frameLatency, uint32_t maxScopes)
+	: mDevice(device), mMaxScopes(maxScopes)
+{
+	assert(frameLatency > 0 && maxScopes > 0);
+
+	mFrames.resize(frameLatency);
+	mTimestamps.resize(maxScopes * 2);
+
+	if (!vi_device_get_limits(mDevice)->timestamp_queries)
+		return;
+
+	// every frame owns a range of two timestamps per scope
+	VIQueryPoolInfo poolI;
+	poolI.type = VI_QUERY_TYPE_TIMESTAMP;
+	poolI.query_count = frameLatency * maxScopes * 2;
+	mPool = vi_create_query_pool(mDevice, &poolI);
+}
+
+GPUTimer::~GPUTimer()
+{
+	if (mPool)
+		vi_destroy_query_pool(mDevice, mPool);
+}
+
+void GPUTimer::BeginFrame(VICommand cmd)
+{
+	if (!mPool)
+		return;
+
+	mFrameIndex = (mFrameIndex + 1) % (uint32_t)mFrames.size();
+
+	Frame& frame = mFrames[mFrameIndex];
+	uint32_t firstQuery = mFrameIndex * mMaxScopes * 2;
+
+	if (frame.QueryCount > 0 && vi_get_query_results(mDevice, mPool, firstQuery, frame.QueryCount, mTimestamps.data()))
+	{
+		mResults.resize(frame.Scopes.size());
+
+		for (size_t i = 0; i < frame.Scopes.size(); i++)
+		{
+			const Scope& scope = frame.Scopes[i];
+			uint64_t begin = mTimestamps[scope.BeginQuery];
+			uint64_t end = mTimestamps[scope.EndQuery];
+
+			mResults[i].Name = scope.Name;
+			mResults[i].Depth = scope.Depth;
+			mResults[i].Milliseconds = end > begin ? (double)(end - begin) / 1000000.0 : 0.0;
+		}
+	}
+
+	frame.Scopes.clear();
+	frame.Open.clear();
+	frame.QueryCount = 0;
+
+	vi_cmd_reset_queries(cmd, mPool, firstQuery, mMaxScopes * 2);
+}
+
+void GPUTimer::BeginScope(VICommand cmd, const char* name)
+{
+	if (!mPool)
+		return;
+
+	Frame& frame = mFrames[mFrameIndex];
+	assert(frame.Scopes.size() < mMaxScopes);
+
+	Scope scope;
+	scope.Name = name;
+	scope.Depth = (uint32_t)frame.Open.size();
+	scope.BeginQuery = frame.QueryCount++;
+	scope.EndQuery = 0;
+
+	frame.Open.push_back((uint32_t)frame.Scopes.size());
+	frame.Scopes.push_back(scope);
+
+	uint32_t firstQuery = mFrameIndex * mMaxScopes * 2;
+	vi_cmd_write_timestamp(cmd, mPool, firstQuery + scope.BeginQuery, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+}
+
+void GPUTimer::EndScope(VICommand cmd)
+{
+	if (!mPool)
+		return;
+
+	Frame& frame = mFrames[mFrameIndex];
+	assert(!frame.Open.empty());
+
+	Scope& scope = frame.Scopes[frame.Open.back()];
+	scope.EndQuery = frame.QueryCount++;
+	frame.Open.pop_back();
+
+	uint32_t firstQuery = mFrameIndex * mMaxScopes * 2;
+	vi_cmd_write_timestamp(cmd, mPool, firstQuery + scope.EndQuery, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+}
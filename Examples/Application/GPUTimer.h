@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <vise.h>
+
+struct GPUTimerScope
+{
+	std::string Name;
+	uint32_t Depth;      // nesting level, 0 for outermost scopes
+	double Milliseconds;
+};
+
+// measures GPU time of named scopes with timestamp queries
+// - each BeginFrame moves to the next of FrameLatency query ranges, a range is read back without
+//   blocking once the ring comes around again, so results trail the current frame by FrameLatency frames.
+//   FrameLatency must exceed the frames in flight, ranges that are still not available are dropped
+// - scopes may nest and must be closed before the command buffer ends
+// - does nothing if the device does not support timestamp queries
+class GPUTimer
+{
+public:
+	GPUTimer() = delete;
+	GPUTimer(VIDevice device, uint32_t frameLatency, uint32_t maxScopes = 32);
+	GPUTimer(const GPUTimer&) = delete;
+	~GPUTimer();
+
+	GPUTimer& operator=(const GPUTimer&) = delete;
+
+	// reads back the oldest query range and resets it, record outside of render passes
+	void BeginFrame(VICommand cmd);
+
+	void BeginScope(VICommand cmd, const char* name);
+	void EndScope(VICommand cmd);
+
+	// scopes of the latest frame with available results, in the order they were opened
+	const std::vector<GPUTimerScope>& GetScopes() const
+	{
+		return mResults;
+	}
+
+private:
+	struct Scope
+	{
+		std::string Name;
+		uint32_t Depth;
+		uint32_t BeginQuery;
+		uint32_t EndQuery;
+	};
+
+	struct Frame
+	{
+		std::vector<Scope> Scopes;
+		std::vector<uint32_t> Open; // indices of scopes not yet ended
+		uint32_t QueryCount = 0;
+	};
+
+	VIDevice mDevice;
+	VIQueryPool mPool = VI_NULL;
+	uint32_t mMaxScopes;
+	uint32_t mFrameIndex = 0;
+	std::vector<Frame> mFrames;
+	std::vector<uint64_t> mTimestamps;
+	std::vector<GPUTimerScope> mResults;
+};
@@ -1,4 +1,5 @@
 #include <string>
+#include <cstring>
 #include <cassert>
 #include <iostream>
 #include <algorithm>
@@ -8,6 +9,7 @@
 #include "Application.h"
 #include "Common.h"
 #include "Model.h"
+#include "TextureStreamer.h"
 
 MeshData::MeshData()
 	: VBO(VI_NULL)
@@ -239,7 +241,8 @@ GLTFTexture::GLTFTexture()
 
 GLTFTexture::~GLTFTexture()
 {
-	if (Image != VI_NULL)
+	// streamed images are owned by the TextureStreamer
+	if (Image != VI_NULL && !Streamer)
 		vi_destroy_image(Device, Image);
 }
 
@@ -251,20 +254,34 @@ void GLTFTexture::LoadFromImage(tinygltf::Image& gltf, VIDevice device)
 
 	uint32_t imageSize = gltf.width * gltf.height * 4;
 
+	// the full mip chain is generated on the GPU after level 0 is uploaded
 	VIImageInfo imageI = MakeImageInfo2D(VI_FORMAT_RGBA8, gltf.width, gltf.height, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	imageI.usage = VI_IMAGE_USAGE_TRANSFER_DST_BIT | VI_IMAGE_USAGE_SAMPLED_BIT;
+	imageI.usage = VI_IMAGE_USAGE_TRANSFER_SRC_BIT | VI_IMAGE_USAGE_TRANSFER_DST_BIT | VI_IMAGE_USAGE_SAMPLED_BIT;
+	imageI.levels = GetMipLevelCount(gltf.width, gltf.height);
 	imageI.sampler.address_mode = VI_SAMPLER_ADDRESS_MODE_REPEAT; // TODO: respect glTF samplers
+	imageI.sampler.max_lod = (float)imageI.levels;
 	Image = CreateImageStaged(device, &imageI, gltf.image.data(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
+void GLTFTexture::StreamFromImage(tinygltf::Image& gltf, VIDevice device, TextureStreamer* streamer)
+{
+	Device = device;
+	Streamer = streamer;
+
+	assert(gltf.component == 4);
+
+	VISamplerInfo samplerI;
+	samplerI.address_mode = VI_SAMPLER_ADDRESS_MODE_REPEAT; // TODO: respect glTF samplers
+	StreamIndex = streamer->AddTexture(gltf.image.data(), gltf.width, gltf.height, samplerI);
+	Image = streamer->GetImage(StreamIndex);
+}
+
 GLTFMaterial::GLTFMaterial()
 {
 }
 
 GLTFMaterial::~GLTFMaterial()
 {
-	if (UBO)
-		vi_destroy_buffer(Device, UBO);
 }
 
 GLTFModel::GLTFModel(VIDevice device)
@@ -282,6 +299,9 @@ GLTFModel::~GLTFModel()
 	if (mSetPool)
 		FreeSets();
 
+	if (mMaterialBuffer)
+		vi_destroy_buffer(mDevice, mMaterialBuffer);
+
 	if (mVBO)
 		vi_destroy_buffer(mDevice, mVBO);
 
@@ -302,10 +322,38 @@ void GLTFModel::Draw(VICommand cmd, VIPipelineLayout layout, uint32_t materialSe
 	mMaterialSetIndex = materialSetIndex;
 	mDrawTransform = transform;
 
+	if (mLoadFlags & LOAD_FLAG_BINDLESS_BIT)
+		vi_cmd_bind_graphics_set(cmd, mDrawPipelineLayout, mMaterialSetIndex, mBindlessSet);
+
 	for (GLTFNode* node : mRootNodes)
 		DrawNode(cmd, node);
 }
 
+void GLTFModel::DrawConditional(VICommand cmd, VIPipelineLayout layout, uint32_t materialSetIndex, VIBuffer visibility,
+	const glm::vec3& eye, float nearPlane, const glm::mat4& transform)
+{
+	assert(mLoadFlags & LOAD_FLAG_CALCULATE_BOUNDING_BOX_BIT);
+
+	mDrawVisibility = visibility;
+	mDrawEye = glm::vec3(glm::inverse(transform) * glm::vec4(eye, 1.0f));
+	mDrawNearPlane = nearPlane;
+
+	Draw(cmd, layout, materialSetIndex, transform);
+
+	mDrawVisibility = VI_NULL;
+}
+
+void GLTFModel::DrawBounds(VICommand cmd, VIPipelineLayout layout, VIQueryPool pool, uint32_t firstQuery, const glm::mat4& transform)
+{
+	assert(mLoadFlags & LOAD_FLAG_CALCULATE_BOUNDING_BOX_BIT);
+
+	mDrawPipelineLayout = layout;
+	mDrawTransform = transform;
+
+	for (GLTFNode* node : mRootNodes)
+		DrawNodeBounds(cmd, node, pool, firstQuery);
+}
+
 void GLTFModel::GetBoundingBox(glm::vec3& minPos, glm::vec3& maxPos)
 {
 	assert(mLoadFlags & LOAD_FLAG_CALCULATE_BOUNDING_BOX_BIT);
@@ -336,7 +384,14 @@ void GLTFModel::DrawNode(VICommand cmd, GLTFNode* node)
 			if (mDrawMaterial != prim.Material)
 			{
 				mDrawMaterial = prim.Material;
-				vi_cmd_bind_graphics_set(cmd, mDrawPipelineLayout, mMaterialSetIndex, prim.Material->Set);
+
+				if (mLoadFlags & LOAD_FLAG_BINDLESS_BIT)
+				{
+					uint32_t materialIndex = (uint32_t)(prim.Material - mMaterials.data());
+					vi_cmd_push_constants(cmd, mDrawPipelineLayout, sizeof(glm::mat4), sizeof(materialIndex), &materialIndex);
+				}
+				else
+					vi_cmd_bind_graphics_set(cmd, mDrawPipelineLayout, mMaterialSetIndex, prim.Material->Set, 1, &prim.Material->UBOOffset);
 			}
 
 			glm::mat4 worldTransform = mDrawTransform;
@@ -345,12 +400,27 @@ void GLTFModel::DrawNode(VICommand cmd, GLTFNode* node)
 	
 			vi_cmd_push_constants(cmd, mDrawPipelineLayout, 0, sizeof(worldTransform), &worldTransform);
 
+			bool isConditional = mDrawVisibility != VI_NULL;
+			if (isConditional)
+			{
+				glm::vec3 minPos = prim.MinPos - mDrawNearPlane;
+				glm::vec3 maxPos = prim.MaxPos + mDrawNearPlane;
+				isConditional = mDrawEye.x < minPos.x || mDrawEye.y < minPos.y || mDrawEye.z < minPos.z ||
+				                mDrawEye.x > maxPos.x || mDrawEye.y > maxPos.y || mDrawEye.z > maxPos.z;
+			}
+
+			if (isConditional)
+				vi_cmd_begin_conditional(cmd, mDrawVisibility, prim.Index * sizeof(uint32_t));
+
 			VIDrawIndexedInfo drawI;
 			drawI.index_count = prim.IndexCount;
 			drawI.index_start = prim.IndexStart;
 			drawI.instance_count = 1;
 			drawI.instance_start = 0;
 			vi_cmd_draw_indexed(cmd, &drawI);
+
+			if (isConditional)
+				vi_cmd_end_conditional(cmd);
 		}
 	}
 
@@ -358,7 +428,36 @@ void GLTFModel::DrawNode(VICommand cmd, GLTFNode* node)
 		DrawNode(cmd, child);
 }
 
-std::shared_ptr<GLTFModel> GLTFModel::LoadFromFile(const char* path, VIDevice device, VISetLayout materialSL, int loadFlags)
+void GLTFModel::DrawNodeBounds(VICommand cmd, GLTFNode* node, VIQueryPool pool, uint32_t firstQuery)
+{
+	if (node->Mesh)
+	{
+		for (const GLTFPrimitive& prim : node->Mesh->Primitives)
+		{
+			// grown so that flat primitives keep a volume and the depth of the primitive itself does not hide its bounds
+			glm::vec3 center = (prim.MinPos + prim.MaxPos) * 0.5f;
+			glm::vec3 halfExtent = (prim.MaxPos - prim.MinPos) * 0.5f + glm::vec3(0.01f);
+			glm::mat4 boundsTransform = mDrawTransform * glm::translate(glm::mat4(1.0f), center) * glm::scale(glm::mat4(1.0f), halfExtent);
+			vi_cmd_push_constants(cmd, mDrawPipelineLayout, 0, sizeof(boundsTransform), &boundsTransform);
+
+			VIDrawInfo drawI;
+			drawI.vertex_count = 36;
+			drawI.vertex_start = 0;
+			drawI.instance_count = 1;
+			drawI.instance_start = 0;
+
+			vi_cmd_begin_query(cmd, pool, firstQuery + prim.Index);
+			vi_cmd_draw(cmd, &drawI);
+			vi_cmd_end_query(cmd, pool, firstQuery + prim.Index);
+		}
+	}
+
+	for (GLTFNode* child : node->Children)
+		DrawNodeBounds(cmd, child, pool, firstQuery);
+}
+
+std::shared_ptr<GLTFModel> GLTFModel::LoadFromFile(const char* path, VIDevice device, VISetLayout materialSL, int loadFlags,
+	TextureStreamer* streamer, VISetLayout fallbackSL)
 {
 	Timer timer;
 	timer.Start();
@@ -366,6 +465,7 @@ std::shared_ptr<GLTFModel> GLTFModel::LoadFromFile(const char* path, VIDevice de
 	std::shared_ptr<GLTFModel> model = std::make_shared<GLTFModel>(device);
 	model->mLoadFlags = loadFlags;
 	model->mMaterialSetLayout = materialSL;
+	model->mStreamer = streamer;
 
 	tinygltf::TinyGLTF loader;
 	tinygltf::Model tinyModel;
@@ -381,6 +481,19 @@ std::shared_ptr<GLTFModel> GLTFModel::LoadFromFile(const char* path, VIDevice de
 	if (!result)
 		return nullptr;
 
+	// bindless texture index 0 is reserved for the empty texture
+	if ((loadFlags & LOAD_FLAG_BINDLESS_BIT) && tinyModel.images.size() + 1 > GLTF_BINDLESS_TEXTURE_COUNT)
+	{
+		std::cout << "GLTFModel: " << path << " has " << tinyModel.images.size() << " textures, bindless material set holds "
+			<< GLTF_BINDLESS_TEXTURE_COUNT - 1 << std::endl;
+
+		if (fallbackSL == VI_NULL)
+			return nullptr;
+
+		model->mLoadFlags &= ~LOAD_FLAG_BINDLESS_BIT;
+		model->mMaterialSetLayout = fallbackSL;
+	}
+
 	model->Load(tinyModel);
 
 	timer.Stop();
@@ -406,6 +519,7 @@ void GLTFModel::Load(tinygltf::Model& tinyModel)
 	mIndices = new uint32_t[mIndexCount];
 	mVertexBase = 0;
 	mIndexBase = 0;
+	mPrimitiveCount = 0;
 
 	for (size_t i = 0; i < tinyScene.nodes.size(); i++)
 	{
@@ -440,16 +554,51 @@ void GLTFModel::LoadImages(tinygltf::Model& tinyModel)
 
 	for (size_t i = 0; i < mTextures.size(); i++)
 	{
-		mTextures[i].LoadFromImage(tinyModel.images[i], mDevice);
+		if (mStreamer)
+			mTextures[i].StreamFromImage(tinyModel.images[i], mDevice, mStreamer);
+		else
+			mTextures[i].LoadFromImage(tinyModel.images[i], mDevice);
 		mTextures[i].Index = i;
 	}
 }
 
+void GLTFModel::StreamFeedback(const glm::mat4& view, const glm::mat4& proj, float viewportHeight)
+{
+	assert(mStreamer && (mLoadFlags & LOAD_FLAG_CALCULATE_BOUNDING_BOX_BIT));
+
+	// every texture of the model is assumed to span the projected bounding sphere
+	glm::vec3 center;
+	float radius;
+	GetBoundingSphere(center, radius);
+
+	float distance = std::max(glm::length(glm::vec3(view * glm::vec4(center, 1.0f))), radius);
+	float screenSize = radius / distance * proj[1][1] * viewportHeight;
+
+	for (GLTFTexture& texture : mTextures)
+		mStreamer->Feedback(texture.StreamIndex, screenSize);
+}
+
+void GLTFModel::UpdateTextureSets()
+{
+	assert(mStreamer);
+
+	for (GLTFTexture& texture : mTextures)
+		texture.Image = mStreamer->GetImage(texture.StreamIndex);
+
+	WriteSets();
+}
+
 void GLTFModel::LoadMaterials(tinygltf::Model& tinyModel)
 {
 	Application* app = Application::Get();
 
 	mMaterials.resize(tinyModel.materials.size());
+	std::vector<GLTFMaterialUBO> materialData;
+
+	// bindless texture index 0 is reserved for the empty texture
+	auto bindlessIndex = [this](GLTFTexture* texture) -> uint32_t {
+		return texture == &mEmptyTexture ? 0 : texture->Index + 1;
+	};
 
 	for (size_t i = 0; i < mMaterials.size(); i++)
 	{
@@ -589,13 +738,43 @@ void GLTFModel::LoadMaterials(tinygltf::Model& tinyModel)
 		assert(mat.TexCoordSet.Emissive == 0);
 		assert(mat.TexCoordSet.Occlusion == 0);
 
-		VIBufferInfo bufferI;
-		bufferI.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-		bufferI.type = VI_BUFFER_TYPE_UNIFORM;
-		bufferI.size = sizeof(ubo);
-		bufferI.usage = VI_BUFFER_USAGE_TRANSFER_DST_BIT;
-		mat.UBO = CreateBufferStaged(mat.Device, &bufferI, &ubo);
+		ubo.ColorMapIndex = bindlessIndex(mat.BaseColorTexture);
+		ubo.NormalMapIndex = bindlessIndex(mat.NormalTexture);
+		ubo.MetallicRoughnessMapIndex = bindlessIndex(mat.MetallicRoughnessTexture);
+
+		materialData.push_back(ubo);
 	}
+
+	if (materialData.empty())
+		return;
+
+	VIBufferInfo bufferI;
+	bufferI.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	bufferI.usage = VI_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	// all materials are packed into a single storage buffer
+	if (mLoadFlags & LOAD_FLAG_BINDLESS_BIT)
+	{
+		bufferI.type = VI_BUFFER_TYPE_STORAGE;
+		bufferI.size = sizeof(GLTFMaterialUBO) * materialData.size();
+		mMaterialBuffer = CreateBufferStaged(mDevice, &bufferI, materialData.data());
+		return;
+	}
+
+	// materials are placed at dynamic offsets in a single uniform buffer
+	uint32_t alignment = vi_device_get_limits(mDevice)->min_uniform_buffer_offset_alignment;
+	uint32_t stride = (sizeof(GLTFMaterialUBO) + alignment - 1) / alignment * alignment;
+	std::vector<uint8_t> uniformData(stride * materialData.size());
+
+	for (size_t i = 0; i < materialData.size(); i++)
+	{
+		mMaterials[i].UBOOffset = stride * i;
+		memcpy(uniformData.data() + mMaterials[i].UBOOffset, materialData.data() + i, sizeof(GLTFMaterialUBO));
+	}
+
+	bufferI.type = VI_BUFFER_TYPE_UNIFORM;
+	bufferI.size = uniformData.size();
+	mMaterialBuffer = CreateBufferStaged(mDevice, &bufferI, uniformData.data());
 }
 
 void GLTFModel::LoadNode(tinygltf::Model& tinyModel, tinygltf::Node& tinyNode, uint32_t nodeIndex, GLTFNode* parent)
@@ -653,6 +832,8 @@ GLTFMesh* GLTFModel::LoadMesh(tinygltf::Model& tinyModel, tinygltf::Mesh& tinyMe
 		uint32_t indexBase = mIndexBase;
 		uint32_t indexCount = 0;
 		uint32_t vertexCount = 0;
+		glm::vec3 primMinPos(0.0f);
+		glm::vec3 primMaxPos(0.0f);
 
 		// load vertices
 		{
@@ -709,6 +890,12 @@ GLTFMesh* GLTFModel::LoadMesh(tinygltf::Model& tinyModel, tinygltf::Mesh& tinyMe
 					if (mVertexBase == 1)
 						mMaxPos = mMinPos = modelPos;
 
+					if (v == 0)
+						primMaxPos = primMinPos = modelPos;
+
+					primMaxPos = glm::max(primMaxPos, modelPos);
+					primMinPos = glm::min(primMinPos, modelPos);
+
 					mMaxPos.x = (std::max)(mMaxPos.x, modelPos.x);
 					mMaxPos.y = (std::max)(mMaxPos.y, modelPos.y);
 					mMaxPos.z = (std::max)(mMaxPos.z, modelPos.z);
@@ -755,10 +942,13 @@ GLTFMesh* GLTFModel::LoadMesh(tinygltf::Model& tinyModel, tinygltf::Mesh& tinyMe
 			}
 		}
 
+		mesh->Primitives[i].Index = mPrimitiveCount++;
 		mesh->Primitives[i].IndexStart = indexBase;
 		mesh->Primitives[i].IndexCount = indexCount;
 		mesh->Primitives[i].VertexCount = vertexCount;
 		mesh->Primitives[i].Material = tinyPrim.material >= 0 ? (mMaterials.data() + tinyPrim.material) : nullptr;
+		mesh->Primitives[i].MinPos = primMinPos;
+		mesh->Primitives[i].MaxPos = primMaxPos;
 	}
 
 	return mesh;
@@ -789,11 +979,30 @@ void GLTFModel::ScanNodePrimitives(tinygltf::Model& tinyModel, tinygltf::Node& t
 
 void GLTFModel::AllocateSets()
 {
+	if (mLoadFlags & LOAD_FLAG_BINDLESS_BIT)
+	{
+		std::array<VISetPoolResource, 2> resources{};
+		resources[0].type = VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER;
+		resources[0].count = GLTF_BINDLESS_TEXTURE_COUNT;
+		resources[1].type = VI_BINDING_TYPE_STORAGE_BUFFER;
+		resources[1].count = 1;
+
+		VISetPoolInfo poolI;
+		poolI.max_set_count = 1;
+		poolI.resource_count = resources.size();
+		poolI.resources = resources.data();
+		poolI.flags = VI_SET_POOL_BINDLESS_BIT;
+		mSetPool = vi_create_set_pool(mDevice, &poolI);
+		mBindlessSet = vi_allocate_set(mDevice, mSetPool, mMaterialSetLayout);
+		WriteSets();
+		return;
+	}
+
 	// Allocate Material Sets
 	std::array<VISetPoolResource, 2> resources{};
 	resources[0].type = VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER;
 	resources[0].count = 3 * mMaterials.size();
-	resources[1].type = VI_BINDING_TYPE_UNIFORM_BUFFER;
+	resources[1].type = VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	resources[1].count = mMaterials.size();
 
 	VISetPoolInfo poolI;
@@ -803,21 +1012,57 @@ void GLTFModel::AllocateSets()
 	mSetPool = vi_create_set_pool(mDevice, &poolI);
 
 	for (GLTFMaterial& mat : mMaterials)
-	{
 		mat.Set = vi_allocate_set(mDevice, mSetPool, mMaterialSetLayout);
-		std::array<VISetUpdateInfo, 4> updates{};
-		updates[0] = { 0, mat.UBO, VI_NULL };
-		updates[1] = { 1, VI_NULL, mat.BaseColorTexture->Image };
-		updates[2] = { 2, VI_NULL, mat.NormalTexture->Image };
-		updates[3] = { 3, VI_NULL, mat.MetallicRoughnessTexture->Image };
-		vi_set_update(mat.Set, updates.size(), updates.data());
+
+	WriteSets();
+}
+
+void GLTFModel::WriteSets()
+{
+	if (mLoadFlags & LOAD_FLAG_BINDLESS_BIT)
+	{
+		// unused texture slots stay partially bound
+		std::vector<VISetUpdateInfo> updates;
+		updates.push_back({ 1, VI_NULL, mEmptyTexture.Image, 0 });
+		for (GLTFTexture& texture : mTextures)
+			updates.push_back({ 1, VI_NULL, texture.Image, texture.Index + 1 });
+		if (mMaterialBuffer)
+			updates.push_back({ 0, mMaterialBuffer, VI_NULL, 0 });
+		vi_set_update(mBindlessSet, updates.size(), updates.data());
+		return;
+	}
+
+	// all material sets are written in a single batch, each set takes
+	// one resource per binding of the material set layout
+	std::vector<VISet> sets(mMaterials.size());
+	std::vector<VISetResource> setResources;
+	setResources.reserve(mMaterials.size() * 4);
+
+	for (size_t i = 0; i < mMaterials.size(); i++)
+	{
+		GLTFMaterial& mat = mMaterials[i];
+		sets[i] = mat.Set;
+
+		setResources.push_back({ mMaterialBuffer, VI_NULL, sizeof(GLTFMaterialUBO) });
+		setResources.push_back({ VI_NULL, mat.BaseColorTexture->Image });
+		setResources.push_back({ VI_NULL, mat.NormalTexture->Image });
+		setResources.push_back({ VI_NULL, mat.MetallicRoughnessTexture->Image });
 	}
+
+	if (!sets.empty())
+		vi_set_update_batch(mDevice, sets.size(), sets.data(), setResources.data());
 }
 
 void GLTFModel::FreeSets()
 {
+	if (mBindlessSet)
+		vi_free_set(mDevice, mBindlessSet);
+
 	for (GLTFMaterial& mat : mMaterials)
-		vi_free_set(mDevice, mat.Set);
+	{
+		if (mat.Set)
+			vi_free_set(mDevice, mat.Set);
+	}
 
 	vi_destroy_set_pool(mDevice, mSetPool);
 }
\ No newline at end of file
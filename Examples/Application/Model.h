@@ -28,6 +28,31 @@
 "layout(set = " STR(INDEX) ", binding = 2) uniform sampler2D uMatNormal;\n"\
 "layout(set = " STR(INDEX) ", binding = 3) uniform sampler2D uMatMR;\n"
 
+// bindless material set, every material of a model is indexed by the material_index push constant.
+// - texture index 0 is a white texture used when a material has no map
+#define GLTF_BINDLESS_TEXTURE_COUNT 16
+#define GLSL_BINDLESS_MATERIAL_SET(INDEX)\
+"struct Mat\n"\
+"{\n"\
+"    uint hasColorMap;\n"\
+"    uint hasNormalMap;\n"\
+"    uint hasMetallicRoughness_map;\n"\
+"    uint hasOcclusionMap;\n"\
+"    vec4 colorFactor;\n"\
+"    float metallicFactor;\n"\
+"    float roughnessFactor;\n"\
+"    uint colorMapIndex;\n"\
+"    uint normalMapIndex;\n"\
+"    uint metallicRoughnessMapIndex;\n"\
+"};\n"\
+"\n"\
+"layout (set = " STR(INDEX) ", binding = 0) readonly buffer Mats\n"\
+"{\n"\
+"    Mat uMats[];\n"\
+"};\n"\
+"\n"\
+"layout(set = " STR(INDEX) ", binding = 1) uniform sampler2D uMatTextures[" STR(GLTF_BINDLESS_TEXTURE_COUNT) "];\n"
+
 struct MeshVertex;
 struct MeshData;
 struct ModelData;
@@ -94,6 +119,7 @@ namespace tinygltf
 	class Texture;
 }
 
+class TextureStreamer;
 struct GLTFMaterial;
 struct GLTFTexture;
 struct GLTFMesh;
@@ -116,10 +142,13 @@ struct GLTFTexture
 	GLTFTexture& operator=(GLTFTexture&&) = default;
 
 	void LoadFromImage(tinygltf::Image& gltf, VIDevice device);
+	void StreamFromImage(tinygltf::Image& gltf, VIDevice device, TextureStreamer* streamer);
 
 	uint32_t Index;
 	VIDevice Device;
 	VIImage Image;
+	TextureStreamer* Streamer = nullptr; // owns Image if not null
+	uint32_t StreamIndex = 0;
 };
 
 enum GLTFAlphaMode
@@ -129,6 +158,7 @@ enum GLTFAlphaMode
 	GLTF_ALPHA_MODE_MASK,
 };
 
+// std140 UBO in GLSL_MATERIAL_SET, std430 array element in GLSL_BINDLESS_MATERIAL_SET
 struct GLTFMaterialUBO
 {
 	uint32_t HasColorMap;
@@ -138,6 +168,10 @@ struct GLTFMaterialUBO
 	glm::vec4 ColorFactor;
 	float MetallicFactor;
 	float RoughnessFactor;
+	uint32_t ColorMapIndex;
+	uint32_t NormalMapIndex;
+	uint32_t MetallicRoughnessMapIndex;
+	uint32_t Padding[3];
 };
 
 struct GLTFMaterial
@@ -152,7 +186,7 @@ struct GLTFMaterial
 
 	VIDevice Device;
 	VISet Set = VI_NULL;
-	VIBuffer UBO = VI_NULL;
+	uint32_t UBOOffset = 0; // dynamic offset of this material in the model material buffer
 	glm::vec4 BaseColorFactor = glm::vec4(1.0f);
 	float MetallicFactor = 1.0f;
 	float RoughnessFactor = 1.0f;
@@ -175,7 +209,7 @@ struct GLTFMaterial
 	static VISetLayout CreateSetLayout(VIDevice device)
 	{
 		std::array<VIBinding, 4> bindings;
-		bindings[0] = { VI_BINDING_TYPE_UNIFORM_BUFFER, 0, 1 };
+		bindings[0] = { VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC, 0, 1 };
 		bindings[1] = { VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 1, 1 };
 		bindings[2] = { VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 2, 1 };
 		bindings[3] = { VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 3, 1 };
@@ -185,6 +219,19 @@ struct GLTFMaterial
 		setLI.bindings = bindings.data();
 		return vi_create_set_layout(device, &setLI);
 	}
+
+	static VISetLayout CreateBindlessSetLayout(VIDevice device)
+	{
+		std::array<VIBinding, 2> bindings;
+		bindings[0] = { VI_BINDING_TYPE_STORAGE_BUFFER, 0, 1 };
+		bindings[1] = { VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 1, GLTF_BINDLESS_TEXTURE_COUNT };
+
+		VISetLayoutInfo setLI;
+		setLI.binding_count = bindings.size();
+		setLI.bindings = bindings.data();
+		setLI.flags = VI_SET_LAYOUT_BINDLESS_BIT;
+		return vi_create_set_layout(device, &setLI);
+	}
 };
 
 struct GLTFNode
@@ -207,15 +254,21 @@ struct GLTFMesh
 
 struct GLTFPrimitive
 {
+	uint32_t Index; // among all primitives of the model
 	uint32_t IndexStart;
 	uint32_t IndexCount;
 	uint32_t VertexCount;
 	GLTFMaterial* Material;
+	glm::vec3 MinPos; // model space AABB, requires LOAD_FLAG_CALCULATE_BOUNDING_BOX_BIT
+	glm::vec3 MaxPos;
 };
 
 // NOTE: currently only loads GLTF models as static meshes.
 // - per-node transform is uploaded as mat4 push constant during Draw(), make sure the PipelineLayout is compatible
 // - GLTF Alpha Mode not implemented yet
+// - all materials share one uniform buffer, the material set is bound with the dynamic offset of each material
+// - with LOAD_FLAG_BINDLESS_BIT the material set is bound once per Draw(), the material index is uploaded as uint push constant after the mat4
+// - a model with more textures than GLTF_BINDLESS_TEXTURE_COUNT falls back to per-material sets, check IsBindless() for the pipeline to draw with
 class GLTFModel
 {
 public:
@@ -228,6 +281,26 @@ public:
 
 	void Draw(VICommand cmd, VIPipelineLayout layout, uint32_t materialSetIndex, const glm::mat4& transform = glm::mat4(1.0f));
 
+	// draws each primitive in a conditional region on the uint32_t at 4 * primitive index in visibility.
+	// primitives whose bounds grown by nearPlane contain the world space eye are always drawn,
+	// the near plane clips their bounds so occlusion queries can not see them. requires LOAD_FLAG_CALCULATE_BOUNDING_BOX_BIT
+	void DrawConditional(VICommand cmd, VIPipelineLayout layout, uint32_t materialSetIndex, VIBuffer visibility,
+		const glm::vec3& eye, float nearPlane, const glm::mat4& transform = glm::mat4(1.0f));
+
+	// draws the bounds of each primitive in query firstQuery + primitive index. the bound pipeline expands
+	// 36 vertices of a [-1, 1] cube from gl_VertexIndex, the mat4 push constant maps the cube to the bounds
+	void DrawBounds(VICommand cmd, VIPipelineLayout layout, VIQueryPool pool, uint32_t firstQuery, const glm::mat4& transform = glm::mat4(1.0f));
+
+	uint32_t GetPrimitiveCount() const
+	{
+		return mPrimitiveCount;
+	}
+
+	bool IsBindless() const
+	{
+		return mLoadFlags & LOAD_FLAG_BINDLESS_BIT;
+	}
+
 	void GetBoundingBox(glm::vec3& minPos, glm::vec3& maxPos);
 	void GetBoundingSphere(glm::vec3& pos, float& radius);
 
@@ -235,12 +308,24 @@ public:
 	{
 		LOAD_FLAG_APPLY_NODE_TRANSFORM_BIT = 1,   // apply node transform to each vertex
 		LOAD_FLAG_CALCULATE_BOUNDING_BOX_BIT = 2, // calculate AABB containing all primitives
+		LOAD_FLAG_BINDLESS_BIT = 4,               // materialSL is from GLTFMaterial::CreateBindlessSetLayout
 	};
 
-	static std::shared_ptr<GLTFModel> LoadFromFile(const char* path, VIDevice device, VISetLayout materialSL, int loadFlags = 0);
+	// with a streamer, images start at their mip tail and are streamed in by TextureStreamer::Update.
+	// fallbackSL is from GLTFMaterial::CreateSetLayout and used when a LOAD_FLAG_BINDLESS_BIT model has too many textures,
+	// without it such a model fails to load
+	static std::shared_ptr<GLTFModel> LoadFromFile(const char* path, VIDevice device, VISetLayout materialSL, int loadFlags = 0,
+		TextureStreamer* streamer = nullptr, VISetLayout fallbackSL = VI_NULL);
+
+	// reports the projected bounding sphere as screen-space usage of all model textures, requires LOAD_FLAG_CALCULATE_BOUNDING_BOX_BIT
+	void StreamFeedback(const glm::mat4& view, const glm::mat4& proj, float viewportHeight);
+
+	// rewrites material sets after TextureStreamer::Update returns true
+	void UpdateTextureSets();
 
 private:
 	void DrawNode(VICommand cmd, GLTFNode* node);
+	void DrawNodeBounds(VICommand cmd, GLTFNode* node, VIQueryPool pool, uint32_t firstQuery);
 	void ScanNodePrimitives(tinygltf::Model& model, tinygltf::Node& node, uint32_t& vertexCount, uint32_t& indexCount);
 	void Load(tinygltf::Model& model);
 	void LoadImages(tinygltf::Model& model);
@@ -248,6 +333,7 @@ private:
 	void LoadNode(tinygltf::Model& tinyModel, tinygltf::Node& tinyNode, uint32_t nodeIndex, GLTFNode* parent);
 	GLTFMesh* LoadMesh(tinygltf::Model& model, tinygltf::Mesh& mesh, GLTFNode* node);
 	void AllocateSets();
+	void WriteSets();
 	void FreeSets();
 
 	int mLoadFlags;
@@ -257,15 +343,22 @@ private:
 	uint32_t mVertexBase;
 	uint32_t mIndexCount;
 	uint32_t mIndexBase;
+	uint32_t mPrimitiveCount;
 	uint32_t mMaterialSetIndex;
 	VIDevice mDevice;
 	VISetLayout mMaterialSetLayout;
+	TextureStreamer* mStreamer = nullptr;
 	VIBuffer mVBO = VI_NULL;
 	VIBuffer mIBO = VI_NULL;
 	VISetPool mSetPool = VI_NULL;
+	VISet mBindlessSet = VI_NULL;
+	VIBuffer mMaterialBuffer = VI_NULL; // storage buffer when bindless, otherwise a uniform buffer bound at dynamic offsets
 	VIPipelineLayout mDrawPipelineLayout = VI_NULL;
 	glm::mat4 mDrawTransform;
 	GLTFMaterial* mDrawMaterial;
+	VIBuffer mDrawVisibility = VI_NULL;
+	glm::vec3 mDrawEye;     // model space
+	float mDrawNearPlane;
 	GLTFVertex* mVertices;
 	GLTFTexture mEmptyTexture;
 	uint32_t* mIndices;
@@ -0,0 +1,452 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include "Application.h"
+#include "TextureStreamer.h"
+
+// 2x2 box filter, the last row or column is repeated for odd dimensions
+static void DownsampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight)
+{
+	for (uint32_t y = 0; y < dstHeight; y++)
+	{
+		uint32_t y0 = std::min(y * 2, srcHeight - 1);
+		uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+		for (uint32_t x = 0; x < dstWidth; x++)
+		{
+			uint32_t x0 = std::min(x * 2, srcWidth - 1);
+			uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				uint32_t sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c]
+					+ src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c];
+				dst[(y * dstWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+TextureStreamer::TextureStreamer(VIDevice device, const TextureStreamerInfo& info)
+	: mInfo(info), mDevice(device)
+{
+	assert(mInfo.FramesInFlight > 0 && mInfo.CommitInterval > 0);
+
+	mStagingBuffers.resize(mInfo.FramesInFlight, VI_NULL);
+	mStagingSizes.resize(mInfo.FramesInFlight, 0);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	vi_device_wait_idle(mDevice);
+
+	for (VIImage image : mRetired)
+		vi_destroy_image(mDevice, image);
+
+	for (Texture& texture : mTextures)
+	{
+		vi_destroy_image(mDevice, texture.Image);
+
+		if (texture.Pending)
+			vi_destroy_image(mDevice, texture.Pending);
+	}
+
+	for (VIBuffer buffer : mStagingBuffers)
+	{
+		if (buffer)
+			vi_destroy_buffer(mDevice, buffer);
+	}
+}
+
+uint32_t TextureStreamer::AddTexture(const void* rgba8, uint32_t width, uint32_t height, const VISamplerInfo& sampler)
+{
+	Texture texture;
+	texture.Sampler = sampler;
+	texture.Width = width;
+	texture.Height = height;
+	texture.ScreenSize = 0.0f;
+	texture.Pending = VI_NULL;
+
+	uint32_t levelCount = GetMipLevelCount(width, height);
+	texture.Levels.resize(levelCount);
+	texture.Levels[0].resize(width * height * 4);
+	memcpy(texture.Levels[0].data(), rgba8, texture.Levels[0].size());
+
+	for (uint32_t level = 1; level < levelCount; level++)
+	{
+		uint32_t srcWidth = std::max(width >> (level - 1), 1u);
+		uint32_t srcHeight = std::max(height >> (level - 1), 1u);
+		uint32_t dstWidth = std::max(width >> level, 1u);
+		uint32_t dstHeight = std::max(height >> level, 1u);
+		texture.Levels[level].resize(dstWidth * dstHeight * 4);
+		DownsampleRGBA8(texture.Levels[level - 1].data(), srcWidth, srcHeight, texture.Levels[level].data(), dstWidth, dstHeight);
+	}
+
+	texture.TailTop = 0;
+	while (texture.TailTop + 1 < levelCount && std::max(width >> texture.TailTop, height >> texture.TailTop) > mInfo.TailSize)
+		texture.TailTop++;
+
+	texture.Image = CreateImage(texture, texture.TailTop);
+	texture.ImageTop = texture.TailTop;
+	texture.VisibleTop = texture.TailTop;
+	texture.UploadedTop = texture.TailTop;
+	texture.PendingTop = texture.TailTop;
+	texture.PendingUploadedTop = levelCount;
+
+	// the mip tail is small, upload it right away so the texture is usable before the first Update
+	VIBufferInfo stagingBufferI;
+	stagingBufferI.type = VI_BUFFER_TYPE_TRANSFER;
+	stagingBufferI.size = (uint32_t)GetImageBytes(texture, texture.TailTop);
+	stagingBufferI.usage = VI_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	stagingBufferI.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VIBuffer stagingBuffer = vi_create_buffer(mDevice, &stagingBufferI);
+
+	uint32_t family = vi_device_get_graphics_family_index(mDevice);
+	VICommandPool pool = vi_create_command_pool(mDevice, family, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	VICommand cmd = vi_allocate_primary_command(mDevice, pool);
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+
+	uint32_t stagingOffset = 0;
+	vi_buffer_map(stagingBuffer);
+	for (uint32_t level = texture.TailTop; level < levelCount; level++)
+	{
+		uint32_t levelSize = (uint32_t)texture.Levels[level].size();
+		vi_buffer_map_write(stagingBuffer, stagingOffset, levelSize, texture.Levels[level].data());
+		RecordLevelUpload(cmd, texture, texture.Image, texture.ImageTop, level, stagingBuffer, stagingOffset);
+		stagingOffset += levelSize;
+	}
+	vi_buffer_unmap(stagingBuffer);
+	vi_command_end(cmd);
+
+	VISubmitInfo submitI{};
+	submitI.cmd_count = 1;
+	submitI.cmds = &cmd;
+	VIQueue queue = vi_device_get_graphics_queue(mDevice);
+	vi_queue_submit(queue, 1, &submitI, VI_NULL);
+	vi_queue_wait_idle(queue);
+	vi_free_command(mDevice, cmd);
+	vi_destroy_command_pool(mDevice, pool);
+	vi_destroy_buffer(mDevice, stagingBuffer);
+
+	mTextures.push_back(std::move(texture));
+
+	return (uint32_t)mTextures.size() - 1;
+}
+
+void TextureStreamer::Feedback(uint32_t texture, float screenSize)
+{
+	Texture& tex = mTextures[texture];
+	tex.ScreenSize = std::max(tex.ScreenSize, screenSize);
+}
+
+bool TextureStreamer::Update(VICommand cmd)
+{
+	bool changed = false;
+
+	if (mUpdateCount % mInfo.CommitInterval == 0)
+		changed = Commit();
+
+	SelectTargets();
+	RecordUploads(cmd);
+
+	// feedback decays so that textures no longer on screen fall back to their mip tail
+	for (Texture& texture : mTextures)
+		texture.ScreenSize *= 0.5f;
+
+	mUpdateCount++;
+
+	return changed;
+}
+
+bool TextureStreamer::IsIdle() const
+{
+	for (const Texture& texture : mTextures)
+	{
+		if (texture.Pending || texture.UploadedTop != texture.ImageTop || texture.VisibleTop != texture.UploadedTop)
+			return false;
+	}
+
+	return true;
+}
+
+VIImage TextureStreamer::GetImage(uint32_t texture) const
+{
+	return mTextures[texture].Image;
+}
+
+uint32_t TextureStreamer::GetVisibleLevel(uint32_t texture) const
+{
+	return mTextures[texture].VisibleTop;
+}
+
+uint64_t TextureStreamer::GetResidentBytes() const
+{
+	uint64_t bytes = mRetiredBytes;
+
+	for (const Texture& texture : mTextures)
+	{
+		bytes += GetImageBytes(texture, texture.ImageTop);
+
+		if (texture.Pending)
+			bytes += GetImageBytes(texture, texture.PendingTop);
+	}
+
+	return bytes;
+}
+
+VIImage TextureStreamer::CreateImage(const Texture& texture, uint32_t top)
+{
+	uint32_t levelCount = (uint32_t)texture.Levels.size() - top;
+
+	VIImageInfo imageI = MakeImageInfo2D(VI_FORMAT_RGBA8, std::max(texture.Width >> top, 1u), std::max(texture.Height >> top, 1u), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	imageI.usage = VI_IMAGE_USAGE_TRANSFER_DST_BIT | VI_IMAGE_USAGE_SAMPLED_BIT;
+	imageI.levels = levelCount;
+	imageI.sampler = texture.Sampler;
+	imageI.sampler.max_lod = (float)levelCount;
+
+	return vi_create_image(mDevice, &imageI);
+}
+
+uint64_t TextureStreamer::GetImageBytes(const Texture& texture, uint32_t top) const
+{
+	uint64_t bytes = 0;
+
+	for (uint32_t level = top; level < texture.Levels.size(); level++)
+		bytes += texture.Levels[level].size();
+
+	return bytes;
+}
+
+uint32_t TextureStreamer::GetDesiredTop(const Texture& texture) const
+{
+	if (texture.ScreenSize < 1.0f)
+		return texture.TailTop;
+
+	// the finest level with at most one texel per covered pixel
+	float texelsPerPixel = std::max(texture.Width, texture.Height) / texture.ScreenSize;
+	uint32_t top = texelsPerPixel > 1.0f ? (uint32_t)std::floor(std::log2(texelsPerPixel)) : 0;
+
+	return std::min(top, texture.TailTop);
+}
+
+void TextureStreamer::SelectTargets()
+{
+	// every texture keeps at least its mip tail, the remaining budget goes to the largest on screen textures first
+	std::vector<uint32_t> order(mTextures.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+		return mTextures[lhs].ScreenSize > mTextures[rhs].ScreenSize;
+	});
+
+	// a bound image stays allocated until its replacement is swapped in, and a dropped replacement until the
+	// next commit, so every image that currently exists is charged and only new replacements add to it
+	uint64_t usedBytes = GetResidentBytes();
+
+	for (uint32_t index : order)
+	{
+		Texture& texture = mTextures[index];
+		uint32_t target = texture.ImageTop;
+
+		// keeping the bound range or the current replacement is free, so a promotion that does not fit stops there
+		for (uint32_t top = GetDesiredTop(texture); top <= texture.TailTop; top++)
+		{
+			bool isAllocated = top == texture.ImageTop || (texture.Pending && top == texture.PendingTop);
+			uint64_t extraBytes = isAllocated ? 0 : GetImageBytes(texture, top);
+			if (usedBytes + extraBytes <= mInfo.BudgetBytes)
+			{
+				target = top;
+				usedBytes += extraBytes;
+				break;
+			}
+		}
+
+		uint32_t currentTop = texture.Pending ? texture.PendingTop : texture.ImageTop;
+		if (target == currentTop)
+			continue;
+
+		if (texture.Pending)
+		{
+			mRetired.push_back(texture.Pending);
+			mRetiredBytes += GetImageBytes(texture, texture.PendingTop);
+			texture.Pending = VI_NULL;
+		}
+
+		// returning to the bound mip range needs no replacement
+		if (target == texture.ImageTop)
+			continue;
+
+		texture.Pending = CreateImage(texture, target);
+		texture.PendingTop = target;
+		texture.PendingUploadedTop = (uint32_t)texture.Levels.size();
+	}
+}
+
+bool TextureStreamer::Commit()
+{
+	std::vector<uint32_t> swaps;
+	bool changed = false;
+
+	// replacements were charged against the budget when they were created, swapping only frees memory
+	for (uint32_t i = 0; i < mTextures.size(); i++)
+	{
+		const Texture& texture = mTextures[i];
+
+		// a replacement is swapped in once it is complete or at least as detailed as the bound image
+		if (texture.Pending && texture.PendingUploadedTop <= std::max(texture.VisibleTop, texture.PendingTop))
+			swaps.push_back(i);
+	}
+
+	for (const Texture& texture : mTextures)
+		changed |= texture.UploadedTop < texture.VisibleTop;
+
+	if (swaps.empty() && !changed && mRetired.empty())
+		return false;
+
+	// frames in flight still bind the sets that callers rewrite in place after a true return, and sample
+	// replaced images and hidden levels. once idle, sets can be written and retired images destroyed
+	vi_device_wait_idle(mDevice);
+
+	for (VIImage image : mRetired)
+		vi_destroy_image(mDevice, image);
+	mRetired.clear();
+	mRetiredBytes = 0;
+
+	for (uint32_t i : swaps)
+	{
+		Texture& texture = mTextures[i];
+		vi_destroy_image(mDevice, texture.Image);
+		texture.Image = texture.Pending;
+		texture.ImageTop = texture.PendingTop;
+		texture.UploadedTop = texture.PendingUploadedTop;
+		texture.VisibleTop = texture.UploadedTop;
+		texture.Pending = VI_NULL;
+		vi_image_set_base_level(texture.Image, texture.VisibleTop - texture.ImageTop);
+	}
+
+	for (Texture& texture : mTextures)
+	{
+		if (texture.UploadedTop == texture.VisibleTop)
+			continue;
+
+		texture.VisibleTop = texture.UploadedTop;
+		vi_image_set_base_level(texture.Image, texture.VisibleTop - texture.ImageTop);
+	}
+
+	return changed || !swaps.empty();
+}
+
+void TextureStreamer::RecordUploads(VICommand cmd)
+{
+	struct Upload
+	{
+		Texture* Tex;
+		VIImage Image;
+		uint32_t ImageTop;
+		uint32_t Level;
+	};
+
+	std::vector<uint32_t> order(mTextures.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+		return mTextures[lhs].ScreenSize > mTextures[rhs].ScreenSize;
+	});
+
+	// levels are uploaded coarse to fine, replacement images before refining bound images
+	std::vector<Upload> uploads;
+	uint32_t uploadBytes = 0;
+
+	for (uint32_t index : order)
+	{
+		Texture& texture = mTextures[index];
+
+		while (texture.Pending && texture.PendingUploadedTop > texture.PendingTop)
+		{
+			uint32_t level = texture.PendingUploadedTop - 1;
+			uint32_t levelSize = (uint32_t)texture.Levels[level].size();
+			if (!uploads.empty() && uploadBytes + levelSize > mInfo.UploadBytesPerUpdate)
+				break;
+
+			uploads.push_back({ &texture, texture.Pending, texture.PendingTop, level });
+			uploadBytes += levelSize;
+			texture.PendingUploadedTop = level;
+		}
+
+		while (!texture.Pending && texture.UploadedTop > texture.ImageTop)
+		{
+			uint32_t level = texture.UploadedTop - 1;
+			uint32_t levelSize = (uint32_t)texture.Levels[level].size();
+			if (!uploads.empty() && uploadBytes + levelSize > mInfo.UploadBytesPerUpdate)
+				break;
+
+			uploads.push_back({ &texture, texture.Image, texture.ImageTop, level });
+			uploadBytes += levelSize;
+			texture.UploadedTop = level;
+		}
+	}
+
+	if (uploads.empty())
+		return;
+
+	// the staging buffer of this slot was last used FramesInFlight Updates ago
+	uint32_t slot = mUpdateCount % mInfo.FramesInFlight;
+	VIBuffer& stagingBuffer = mStagingBuffers[slot];
+	if (stagingBuffer && mStagingSizes[slot] < uploadBytes)
+	{
+		vi_destroy_buffer(mDevice, stagingBuffer);
+		stagingBuffer = VI_NULL;
+	}
+
+	if (!stagingBuffer)
+	{
+		VIBufferInfo stagingBufferI;
+		stagingBufferI.type = VI_BUFFER_TYPE_TRANSFER;
+		stagingBufferI.size = std::max(uploadBytes, mInfo.UploadBytesPerUpdate);
+		stagingBufferI.usage = VI_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		stagingBufferI.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		stagingBuffer = vi_create_buffer(mDevice, &stagingBufferI);
+		mStagingSizes[slot] = stagingBufferI.size;
+	}
+
+	uint32_t stagingOffset = 0;
+	vi_buffer_map(stagingBuffer);
+	for (const Upload& upload : uploads)
+	{
+		const std::vector<uint8_t>& data = upload.Tex->Levels[upload.Level];
+		vi_buffer_map_write(stagingBuffer, stagingOffset, (uint32_t)data.size(), data.data());
+		RecordLevelUpload(cmd, *upload.Tex, upload.Image, upload.ImageTop, upload.Level, stagingBuffer, stagingOffset);
+		stagingOffset += (uint32_t)data.size();
+	}
+	vi_buffer_unmap(stagingBuffer);
+}
+
+void TextureStreamer::RecordLevelUpload(VICommand cmd, const Texture& texture, VIImage image, uint32_t imageTop, uint32_t level, VIBuffer stagingBuffer, uint32_t stagingOffset)
+{
+	// only the uploaded level changes layout, other levels of a bound image may be sampled meanwhile
+	VIImageMemoryBarrier barrier{};
+	barrier.image = image;
+	barrier.src_family_index = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dst_family_index = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresource_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresource_range.baseMipLevel = level - imageTop;
+	barrier.subresource_range.levelCount = 1;
+	barrier.subresource_range.baseArrayLayer = 0;
+	barrier.subresource_range.layerCount = 1;
+	barrier.old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.src_access = 0;
+	barrier.dst_access = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vi_cmd_pipeline_barrier_image_memory(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier);
+
+	VkBufferImageCopy region = MakeBufferImageCopy2D(VK_IMAGE_ASPECT_COLOR_BIT, std::max(texture.Width >> level, 1u), std::max(texture.Height >> level, 1u));
+	region.bufferOffset = stagingOffset;
+	region.imageSubresource.mipLevel = level - imageTop;
+	vi_cmd_copy_buffer_to_image(cmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	barrier.old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.src_access = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dst_access = VK_ACCESS_SHADER_READ_BIT;
+	vi_cmd_pipeline_barrier_image_memory(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier);
+}
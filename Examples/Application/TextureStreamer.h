@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <vise.h>
+
+struct TextureStreamerInfo
+{
+	uint64_t BudgetBytes = 64 * 1024 * 1024; // device memory for all streamed images, replacements included
+	uint32_t UploadBytesPerUpdate = 4 * 1024 * 1024; // staging bandwidth of a single Update, at least one level is uploaded
+	uint32_t TailSize = 64;       // largest dimension of the coarse mip tail that is always resident
+	uint32_t FramesInFlight = 2;  // staging buffers are reused after this many Update calls
+	uint32_t CommitInterval = 8;  // new residency becomes visible every this many Update calls
+};
+
+// streams RGBA8 textures under a device memory budget
+// - the full mip chain of every texture is kept in host memory, the device only holds a mip range
+// - Feedback() reports how many pixels a texture covers on screen, the finest useful mip is derived from it.
+//   feedback halves every Update, so textures that are no longer reported decay to their mip tail
+// - Update() fits target mip ranges into the budget, most visible textures first, and records uploads
+//   of at most UploadBytesPerUpdate into the command buffer. a texture moving to a new mip range gets
+//   a replacement image that is filled coarse to fine and swapped in once it is at least as detailed,
+//   finer levels keep streaming into the bound image and are exposed with vi_image_set_base_level
+// - residency changes are committed after a device wait idle every CommitInterval Updates, Update then
+//   returns true and sets referencing GetImage() must be written again before they are bound. no submitted
+//   command references those sets anymore, so they may be updated in place with vi_set_update
+// - Update() must be called before any set referencing a streamed image is bound in the command buffer
+class TextureStreamer
+{
+public:
+	TextureStreamer() = delete;
+	TextureStreamer(VIDevice device, const TextureStreamerInfo& info);
+	TextureStreamer(const TextureStreamer&) = delete;
+	~TextureStreamer();
+
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// copies the RGBA8 level 0 and builds the mip chain on the host, the mip tail is uploaded immediately
+	uint32_t AddTexture(const void* rgba8, uint32_t width, uint32_t height, const VISamplerInfo& sampler);
+
+	void Feedback(uint32_t texture, float screenSize);
+
+	bool Update(VICommand cmd);
+
+	// true if no uploads or replacement images are outstanding
+	bool IsIdle() const;
+
+	VIImage GetImage(uint32_t texture) const;
+
+	// finest source mip level visible through GetImage()
+	uint32_t GetVisibleLevel(uint32_t texture) const;
+
+	// bytes of all streamed images on the device: bound images, replacement images in flight
+	// and dropped replacements not yet destroyed, kept within TextureStreamerInfo::BudgetBytes
+	uint64_t GetResidentBytes() const;
+
+private:
+	struct Texture
+	{
+		std::vector<std::vector<uint8_t>> Levels;
+		VISamplerInfo Sampler;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t TailTop;        // coarsest top level, the initial residency
+		float ScreenSize;        // largest feedback since the last Update
+		VIImage Image;           // bound image holding source levels [ImageTop, level count)
+		uint32_t ImageTop;
+		uint32_t VisibleTop;     // finest level exposed through the image base level
+		uint32_t UploadedTop;    // finest level of Image with a recorded upload
+		VIImage Pending;         // replacement image, VI_NULL if none
+		uint32_t PendingTop;
+		uint32_t PendingUploadedTop;
+	};
+
+	VIImage CreateImage(const Texture& texture, uint32_t top);
+	uint64_t GetImageBytes(const Texture& texture, uint32_t top) const;
+	uint32_t GetDesiredTop(const Texture& texture) const;
+	void SelectTargets();
+	bool Commit();
+	void RecordUploads(VICommand cmd);
+	void RecordLevelUpload(VICommand cmd, const Texture& texture, VIImage image, uint32_t imageTop, uint32_t level, VIBuffer stagingBuffer, uint32_t stagingOffset);
+
+	TextureStreamerInfo mInfo;
+	VIDevice mDevice;
+	uint32_t mUpdateCount = 0;
+	std::vector<Texture> mTextures;
+	std::vector<VIBuffer> mStagingBuffers;
+	std::vector<uint32_t> mStagingSizes;
+	std::vector<VIImage> mRetired; // replaced pending images, destroyed at the next commit
+	uint64_t mRetiredBytes = 0;
+};
@@ -328,6 +328,8 @@ void ExampleCubemap::Run()
 		{
 			ImGui::Begin(mName);
 			ImGuiDeviceProfile();
+			ImGuiFrameLatency();
+			ImGuiFrameCounters();
 
 			if (ImGui::CollapsingHeader("Settings"))
 			{
@@ -355,9 +357,9 @@ void ExampleCubemap::Run()
 		VISemaphore image_acquired;
 		VISemaphore present_ready;
 		VIFence frame_complete;
-		uint32_t frame_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
-		VIFramebuffer fb = vi_device_get_swapchain_framebuffer(mDevice, frame_idx);
-		FrameData* frame = mFrames.data() + frame_idx;
+		uint32_t image_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
+		VIFramebuffer fb = vi_device_get_swapchain_framebuffer(mDevice, image_idx);
+		FrameData* frame = mFrames.data() + vi_device_get_frame_index(mDevice);
 
 		FrameUBO frameUBO;
 		frameUBO.view = mCamera.GetViewMat();
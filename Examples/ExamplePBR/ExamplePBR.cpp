@@ -1,6 +1,7 @@
 #include <array>
 #include <iostream>
 #include <vector>
+#include <string>
 #include <imgui.h>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -342,6 +343,7 @@ layout (set = 0, binding = 0) uniform uScene
 layout (push_constant) uniform uPC
 {
 	mat4 node_transform;
+	uint material_index;
 } PC;
 
 void main()
@@ -359,7 +361,8 @@ void main()
 // - Irradiance Cubemap stores diffuse lighting information
 // - Prefiltered Cubemap stores specular lighting, taking roughness into account
 // - BRDF lookup table stores specular scale and bias
-static const char pbr_fragment_glsl[] = R"(
+// - the material section between scene and main is either the per-material set or the bindless material set
+static const char pbr_fragment_scene_glsl[] = R"(
 #version 460
 #define MIN_ROUGHNESS 0.04
 
@@ -384,9 +387,31 @@ layout (set = 0, binding = 0) uniform uScene
 layout (set = 0, binding = 1) uniform sampler2D uBRDFLUT;
 layout (set = 0, binding = 2) uniform samplerCube uIrradiance;
 layout (set = 0, binding = 3) uniform samplerCube uPrefilter;
-)"
+)";
+
+static const char pbr_material_glsl[] =
 GLSL_MATERIAL_SET(1)
 R"(
+#define MAT uMat
+#define MAT_COLOR_MAP uMatColor
+#define MAT_MR_MAP uMatMR
+)";
+
+static const char pbr_bindless_material_glsl[] =
+GLSL_BINDLESS_MATERIAL_SET(1)
+R"(
+layout (push_constant) uniform uPC
+{
+	mat4 node_transform;
+	uint material_index;
+} PC;
+
+#define MAT uMats[PC.material_index]
+#define MAT_COLOR_MAP uMatTextures[MAT.colorMapIndex]
+#define MAT_MR_MAP uMatTextures[MAT.metallicRoughnessMapIndex]
+)";
+
+static const char pbr_fragment_main_glsl[] = R"(
 vec3 fresnel_schlick_IBL(float cosTheta, vec3 F0, float roughness)
 {
     return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
@@ -396,14 +421,14 @@ void main()
 {
 	// gather parameters
 	vec3 camPos = Scene.camera_pos.xyz / Scene.camera_pos.w;
-	vec3 albedo = texture(uMatColor, vUV).rgb;
+	vec3 albedo = texture(MAT_COLOR_MAP, vUV).rgb;
 	vec3 N = normalize(vNormal); // TODO: normal mapping
 	vec3 V = normalize(camPos - vPos);
     vec3 R = reflect(-V, N);   
-	vec4 MR = texture(uMatMR, vUV);
+	vec4 MR = texture(MAT_MR_MAP, vUV);
 	float NdotV = max(dot(N, V), 0.0);
-	float roughness = clamp(MR.g * uMat.roughnessFactor, 0.0, 1.0);
-	float metallic = clamp(MR.b * uMat.metallicFactor, 0.0, 1.0);
+	float roughness = clamp(MR.g * MAT.roughnessFactor, 0.0, 1.0);
+	float metallic = clamp(MR.b * MAT.metallicFactor, 0.0, 1.0);
 	
 	// overrides
 	roughness = clamp(roughness, 0.0, Scene.clamp_max_roughness);
@@ -477,7 +502,15 @@ ExamplePBR::ExamplePBR(VIBackend backend)
 		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 3, 1 }
 	});
 
+	// with bindless support materials are bound once per model and indexed with a push constant,
+	// models with too many textures still use the per-material sets
 	mSetLayoutMaterial = GLTFMaterial::CreateSetLayout(mDevice);
+	mSetLayoutBindlessMaterial = VI_NULL;
+
+	if (mDeviceLimits.max_bindless_image_count >= GLTF_BINDLESS_TEXTURE_COUNT)
+		mSetLayoutBindlessMaterial = GLTFMaterial::CreateBindlessSetLayout(mDevice);
+	else
+		std::cout << "ExamplePBR: no bindless support, using per-material sets" << std::endl;
 
 	VIPipelineLayoutInfo pipelineLayoutI;
 	pipelineLayoutI.push_constant_size = 128;
@@ -492,6 +525,13 @@ ExamplePBR::ExamplePBR(VIBackend backend)
 	pipelineLayoutI.set_layout_count = pbrSetLayouts.size();
 	pipelineLayoutI.set_layouts = pbrSetLayouts.data();
 	mPipelineLayoutPBR = vi_create_pipeline_layout(mDevice, &pipelineLayoutI);
+	mPipelineLayoutBindlessPBR = VI_NULL;
+
+	if (mSetLayoutBindlessMaterial)
+	{
+		pbrSetLayouts[1] = mSetLayoutBindlessMaterial;
+		mPipelineLayoutBindlessPBR = vi_create_pipeline_layout(mDevice, &pipelineLayoutI);
+	}
 
 	uint32_t size;
 	std::vector<VIVertexAttribute> skyboxVertexAttrs;
@@ -526,7 +566,8 @@ ExamplePBR::ExamplePBR(VIBackend backend)
 	mSkyboxPipeline = vi_create_pipeline(mDevice, &pipelineI);
 
 	mPBRVM = CreateOrLoadModule(mDevice, mBackend, mPipelineLayoutPBR, VI_MODULE_TYPE_VERTEX, pbr_vertex_glsl, "pbr_vm");
-	mPBRFM = CreateOrLoadModule(mDevice, mBackend, mPipelineLayoutPBR, VI_MODULE_TYPE_FRAGMENT, pbr_fragment_glsl, "pbr_fm");
+	std::string pbrFragment = std::string(pbr_fragment_scene_glsl) + pbr_material_glsl + pbr_fragment_main_glsl;
+	mPBRFM = CreateOrLoadModule(mDevice, mBackend, mPipelineLayoutPBR, VI_MODULE_TYPE_FRAGMENT, pbrFragment.c_str(), "pbr_fm");
 
 	VIVertexBinding pbrVertBinding;
 	std::vector<VIVertexAttribute> pbrVertAttributes;
@@ -544,6 +585,18 @@ ExamplePBR::ExamplePBR(VIBackend backend)
 	pipelineI.depth_stencil_state.depth_write_enabled = true;
 	pipelineI.depth_stencil_state.depth_compare_op = VI_COMPARE_OP_LESS;
 	mPBRPipeline = vi_create_pipeline(mDevice, &pipelineI);
+	mPBRBindlessFM = VI_NULL;
+	mPBRBindlessPipeline = VI_NULL;
+
+	if (mPipelineLayoutBindlessPBR)
+	{
+		pbrFragment = std::string(pbr_fragment_scene_glsl) + pbr_bindless_material_glsl + pbr_fragment_main_glsl;
+		mPBRBindlessFM = CreateOrLoadModule(mDevice, mBackend, mPipelineLayoutBindlessPBR, VI_MODULE_TYPE_FRAGMENT, pbrFragment.c_str(), "pbr_bindless_fm");
+
+		modules[1] = mPBRBindlessFM;
+		pipelineI.layout = mPipelineLayoutBindlessPBR;
+		mPBRBindlessPipeline = vi_create_pipeline(mDevice, &pipelineI);
+	}
 
 	// create baking resources
 	{
@@ -696,6 +749,8 @@ ExamplePBR::ExamplePBR(VIBackend backend)
 	mImGuiHDRI = ImGuiAddImage(mHDRI, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	mImGuiCubemap = ImGuiAddImage(mCubemap, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	mImGuiBRDFLUT = ImGuiAddImage(mBRDFLUT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	mGPUTimer = std::make_unique<GPUTimer>(mDevice, APP_GPU_TIMER_LATENCY);
 }
 
 ExamplePBR::~ExamplePBR()
@@ -743,6 +798,14 @@ ExamplePBR::~ExamplePBR()
 		vi_destroy_pass(mDevice, mCubemapPass);
 	}
 
+	if (mPBRBindlessPipeline)
+	{
+		vi_destroy_pipeline(mDevice, mPBRBindlessPipeline);
+		vi_destroy_module(mDevice, mPBRBindlessFM);
+		vi_destroy_pipeline_layout(mDevice, mPipelineLayoutBindlessPBR);
+		vi_destroy_set_layout(mDevice, mSetLayoutBindlessMaterial);
+	}
+
 	vi_destroy_pipeline(mDevice, mPBRPipeline);
 	vi_destroy_pipeline(mDevice, mSkyboxPipeline);
 	vi_destroy_module(mDevice, mPBRVM);
@@ -772,8 +835,17 @@ void ExamplePBR::Run()
 		APP_PATH "../../Assets/gltf/opengl_logo/scene.gltf" :
 		APP_PATH "../../Assets/gltf/vulkan_logo/scene.gltf";
 
-	mModel = GLTFModel::LoadFromFile(APP_PATH "../../Assets/gltf/hard_surface_crate/scene.gltf", mDevice, mSetLayoutMaterial);
-	mLogoModel = GLTFModel::LoadFromFile(logoModelPath, mDevice, mSetLayoutMaterial);
+	if (mSetLayoutBindlessMaterial)
+	{
+		int loadFlags = GLTFModel::LOAD_FLAG_BINDLESS_BIT;
+		mModel = GLTFModel::LoadFromFile(APP_PATH "../../Assets/gltf/hard_surface_crate/scene.gltf", mDevice, mSetLayoutBindlessMaterial, loadFlags, nullptr, mSetLayoutMaterial);
+		mLogoModel = GLTFModel::LoadFromFile(logoModelPath, mDevice, mSetLayoutBindlessMaterial, loadFlags, nullptr, mSetLayoutMaterial);
+	}
+	else
+	{
+		mModel = GLTFModel::LoadFromFile(APP_PATH "../../Assets/gltf/hard_surface_crate/scene.gltf", mDevice, mSetLayoutMaterial);
+		mLogoModel = GLTFModel::LoadFromFile(logoModelPath, mDevice, mSetLayoutMaterial);
+	}
 	
 	// These may and should be done offline instead of during application startup
 	// 1. convert HDRI (RGB32F) to regular cubemap (RGBA16F per face)
@@ -797,11 +869,13 @@ void ExamplePBR::Run()
 		VISemaphore image_acquired;
 		VISemaphore present_ready;
 		VIFence frame_complete;
-		uint32_t frame_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
-		VIFramebuffer fb = vi_device_get_swapchain_framebuffer(mDevice, frame_idx);
-		FrameData* frame = mFrames.data() + frame_idx;
+		uint32_t image_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
+		VIFramebuffer fb = vi_device_get_swapchain_framebuffer(mDevice, image_idx);
+		FrameData* frame = mFrames.data() + vi_device_get_frame_index(mDevice);
 
 		vi_command_begin(frame->cmd, 0, nullptr);
+		mGPUTimer->BeginFrame(frame->cmd);
+		mGPUTimer->BeginScope(frame->cmd, "Swapchain Pass");
 
 		VkClearValue clear[2];
 		clear[0] = MakeClearDepthStencil(1.0f, 0.0f);
@@ -820,6 +894,7 @@ void ExamplePBR::Run()
 			vi_cmd_set_scissor(frame->cmd, MakeScissor(mWindowWidth, mWindowHeight));
 
 			// draw skybox
+			mGPUTimer->BeginScope(frame->cmd, "Skybox");
 			{
 				vi_cmd_bind_graphics_set(frame->cmd, mPipelineLayoutSingleImage, 0, mConfig.show_background_skybox);
 				vi_cmd_bind_vertex_buffers(frame->cmd, 0, 1, &mSkyboxVBO);
@@ -840,23 +915,29 @@ void ExamplePBR::Run()
 				info.instance_start = 0;
 				vi_cmd_draw(frame->cmd, &info);
 			}
-
-			vi_cmd_bind_graphics_pipeline(frame->cmd, mPBRPipeline);
-			vi_cmd_set_viewport(frame->cmd, MakeViewport(mWindowWidth, mWindowHeight));
-			vi_cmd_set_scissor(frame->cmd, MakeScissor(mWindowWidth, mWindowHeight));
+			mGPUTimer->EndScope(frame->cmd);
 
 			// draw model
+			mGPUTimer->BeginScope(frame->cmd, "PBR Models");
+			for (GLTFModel* model : { mModel.get(), mLogoModel.get() })
 			{
-				vi_cmd_bind_graphics_set(frame->cmd, mPipelineLayoutPBR, 0, frame->scene_set);
+				VIPipeline pipeline = model->IsBindless() ? mPBRBindlessPipeline : mPBRPipeline;
+				VIPipelineLayout layout = model->IsBindless() ? mPipelineLayoutBindlessPBR : mPipelineLayoutPBR;
+
+				vi_cmd_bind_graphics_pipeline(frame->cmd, pipeline);
+				vi_cmd_set_viewport(frame->cmd, MakeViewport(mWindowWidth, mWindowHeight));
+				vi_cmd_set_scissor(frame->cmd, MakeScissor(mWindowWidth, mWindowHeight));
+				vi_cmd_bind_graphics_set(frame->cmd, layout, 0, frame->scene_set);
 
 				uint32_t materialSetIndex = 1;
-				mModel->Draw(frame->cmd, mPipelineLayoutPBR, materialSetIndex);
-				mLogoModel->Draw(frame->cmd, mPipelineLayoutPBR, materialSetIndex);
+				model->Draw(frame->cmd, layout, materialSetIndex);
 			}
+			mGPUTimer->EndScope(frame->cmd);
 
 			Application::ImGuiRender(frame->cmd);
 		}
 		vi_cmd_end_pass(frame->cmd);
+		mGPUTimer->EndScope(frame->cmd);
 		vi_command_end(frame->cmd);
 
 		UpdateUBO();
@@ -899,6 +980,8 @@ void ExamplePBR::ImGuiUpdate()
 	
 	ImGui::Begin(mName);
 
+	ImGuiGPUTimings(*mGPUTimer);
+
 	if (ImGui::CollapsingHeader("Intermediate Results"))
 	{
 		ImGui::Text("HDRI");
@@ -95,6 +95,7 @@ private: // runtime resources
 
 	std::shared_ptr<GLTFModel> mModel;
 	std::shared_ptr<GLTFModel> mLogoModel;
+	std::unique_ptr<GPUTimer> mGPUTimer;
 	std::vector<FrameData> mFrames;
 	VICommandPool mCmdPool;
 	VIBuffer mSkyboxVBO;
@@ -103,13 +104,17 @@ private: // runtime resources
 	VIModule mSkyboxFM;
 	VIModule mPBRVM;
 	VIModule mPBRFM;
+	VIModule mPBRBindlessFM;
 	VIPipeline mSkyboxPipeline;
 	VIPipeline mPBRPipeline;
+	VIPipeline mPBRBindlessPipeline;
 	VISetLayout mSetLayoutSingleImage;
 	VISetLayout mSetLayoutScene;
 	VISetLayout mSetLayoutMaterial;
+	VISetLayout mSetLayoutBindlessMaterial;
 	VIPipelineLayout mPipelineLayoutSingleImage;
 	VIPipelineLayout mPipelineLayoutPBR;
+	VIPipelineLayout mPipelineLayoutBindlessPBR;
 
 	uint64_t mImGuiHDRI;
 	uint64_t mImGuiCubemap;
@@ -309,6 +309,15 @@ ExamplePostProcess::ExamplePostProcess(VIBackend backend)
 	}
 
 	mMeshes = GenerateMeshSceneV1(mDevice);
+
+	if (mDeviceLimits.pipeline_statistics_queries)
+	{
+		VIQueryPoolInfo poolI;
+		poolI.type = VI_QUERY_TYPE_PIPELINE_STATISTICS;
+		poolI.query_count = APP_GPU_TIMER_LATENCY * 2;
+		poolI.pipeline_statistics = VI_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VI_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+		mStatisticsPool = vi_create_query_pool(mDevice, &poolI);
+	}
 }
 
 ExamplePostProcess::~ExamplePostProcess()
@@ -317,6 +326,9 @@ ExamplePostProcess::~ExamplePostProcess()
 
 	mMeshes.clear();
 
+	if (mStatisticsPool)
+		vi_destroy_query_pool(mDevice, mStatisticsPool);
+
 	for (size_t i = 0; i < mFrames.size(); i++)
 	{
 		vi_destroy_framebuffer(mDevice, mFrames[i].fbo);
@@ -368,16 +380,17 @@ void ExamplePostProcess::Run()
 				mConfig.postprocess_pipeline = mPipelineGrayscale;
 			if (ImGui::Button("Invert"))
 				mConfig.postprocess_pipeline = mPipelineInvert;
+			ImGuiPipelineStatistics();
 			ImGui::End();
 		}
 
 		VISemaphore image_acquired;
 		VISemaphore present_ready;
 		VIFence frame_complete;
-		uint32_t frame_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
-		VIFramebuffer swapchain_fb = vi_device_get_swapchain_framebuffer(mDevice, frame_idx);
+		uint32_t image_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
+		VIFramebuffer swapchain_fb = vi_device_get_swapchain_framebuffer(mDevice, image_idx);
 
-		FrameData* frame = mFrames.data() + frame_idx;
+		FrameData* frame = mFrames.data() + vi_device_get_frame_index(mDevice);
 
 		FrameUBO ubo;
 		ubo.ViewMat = mCamera.GetViewMat();
@@ -387,6 +400,18 @@ void ExamplePostProcess::Run()
 		vi_command_reset(frame->cmd);
 		vi_command_begin(frame->cmd, 0, nullptr);
 
+		// results of this query range were recorded APP_GPU_TIMER_LATENCY frames ago
+		uint32_t statisticsQuery = mStatisticsFrame * 2;
+		if (mStatisticsPool)
+		{
+			if (mStatisticsPending[mStatisticsFrame])
+				vi_get_query_results(mDevice, mStatisticsPool, statisticsQuery, 2, mStatistics);
+
+			vi_cmd_reset_queries(frame->cmd, mStatisticsPool, statisticsQuery, 2);
+			mStatisticsPending[mStatisticsFrame] = true;
+			mStatisticsFrame = (mStatisticsFrame + 1) % APP_GPU_TIMER_LATENCY;
+		}
+
 		VkClearValue clear = MakeClearColor(0.1f, 0.7f, 0.7f, 1.0f);
 		VkClearValue clear_depth = MakeClearDepthStencil(1.0f, 0);
 		VIPassBeginInfo beginI;
@@ -406,6 +431,9 @@ void ExamplePostProcess::Run()
 
 		vi_cmd_begin_pass(frame->cmd, &beginI);
 		{
+			if (mStatisticsPool)
+				vi_cmd_begin_query(frame->cmd, mStatisticsPool, statisticsQuery);
+
 			vi_cmd_bind_graphics_pipeline(frame->cmd, mPipelineRender);
 			vi_cmd_set_viewport(frame->cmd, MakeViewport(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
 			vi_cmd_set_scissor(frame->cmd, MakeScissor(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
@@ -428,6 +456,9 @@ void ExamplePostProcess::Run()
 				info.instance_start = 0;
 				vi_cmd_draw_indexed(frame->cmd, &info);
 			}
+
+			if (mStatisticsPool)
+				vi_cmd_end_query(frame->cmd, mStatisticsPool, statisticsQuery);
 		}
 		vi_cmd_end_pass(frame->cmd);
 		
@@ -438,6 +469,9 @@ void ExamplePostProcess::Run()
 		beginI.depth_stencil_clear_value = &clear_depth;
 		vi_cmd_begin_pass(frame->cmd, &beginI);
 		{
+			if (mStatisticsPool)
+				vi_cmd_begin_query(frame->cmd, mStatisticsPool, statisticsQuery + 1);
+
 			vi_cmd_bind_graphics_pipeline(frame->cmd, mConfig.postprocess_pipeline);
 			vi_cmd_set_viewport(frame->cmd, MakeViewport(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
 			vi_cmd_set_scissor(frame->cmd, MakeScissor(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
@@ -453,6 +487,9 @@ void ExamplePostProcess::Run()
 			info.instance_start = 0;
 			vi_cmd_draw_indexed(frame->cmd, &info);
 
+			if (mStatisticsPool)
+				vi_cmd_end_query(frame->cmd, mStatisticsPool, statisticsQuery + 1);
+
 			Application::ImGuiRender(frame->cmd);
 		}
 		vi_cmd_end_pass(frame->cmd);
@@ -475,6 +512,28 @@ void ExamplePostProcess::Run()
 	}
 }
 
+void ExamplePostProcess::ImGuiPipelineStatistics()
+{
+	if (!ImGui::CollapsingHeader("Pipeline Statistics", ImGuiTreeNodeFlags_DefaultOpen))
+		return;
+
+	if (!mStatisticsPool)
+	{
+		ImGui::Text("pipeline statistics queries not supported");
+		return;
+	}
+
+	// fragment invocations per pixel above 1.0 indicate overdraw
+	double pixelCount = (double)APP_WINDOW_WIDTH * APP_WINDOW_HEIGHT;
+	const char* passNames[2] = { "Scene Pass", "Post-Process Pass" };
+	for (int i = 0; i < 2; i++)
+	{
+		ImGui::Text("%s", passNames[i]);
+		ImGui::Text("- vertex invocations: %llu", (unsigned long long)mStatistics[i * 2]);
+		ImGui::Text("- fragment invocations: %llu (%.2f per pixel)", (unsigned long long)mStatistics[i * 2 + 1], mStatistics[i * 2 + 1] / pixelCount);
+	}
+}
+
 void ExamplePostProcess::KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	ExamplePostProcess* example = (ExamplePostProcess*)Application::Get();
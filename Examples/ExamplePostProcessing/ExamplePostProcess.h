@@ -16,6 +16,8 @@ public:
 private:
 	static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
+	void ImGuiPipelineStatistics();
+
 private:
 
 	// per-frame synchronization
@@ -48,4 +50,11 @@ private:
 	VIPipeline mPipelineNone, mPipelineGrayscale, mPipelineInvert;
 	VIBuffer mQuadVBO;
 	VIBuffer mQuadIBO;
+
+	// vertex and fragment invocations of the scene and post-process pass, read back
+	// APP_GPU_TIMER_LATENCY frames later. VI_NULL if pipeline statistics are not supported
+	VIQueryPool mStatisticsPool = VI_NULL;
+	uint32_t mStatisticsFrame = 0;
+	bool mStatisticsPending[APP_GPU_TIMER_LATENCY] = {};
+	uint64_t mStatistics[4] = {};
 };
\ No newline at end of file
@@ -202,14 +202,12 @@ void ExamplePyramid::Run()
 		VISemaphore image_acquired;
 		VISemaphore present_ready;
 		VIFence frame_complete;
-		uint32_t frame_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
-		if (frame_idx >= mFramesInFlight)
-			continue;
+		uint32_t image_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
 
 		VIPass pass = vi_device_get_swapchain_pass(mDevice);
-		VIFramebuffer fb = vi_device_get_swapchain_framebuffer(mDevice, frame_idx);
+		VIFramebuffer fb = vi_device_get_swapchain_framebuffer(mDevice, image_idx);
 
-		FrameData* frame = mFrames.data() + frame_idx;
+		FrameData* frame = mFrames.data() + vi_device_get_frame_index(mDevice);
 
 		FrameUBO uboData;
 		uboData.view = mCamera.GetViewMat();
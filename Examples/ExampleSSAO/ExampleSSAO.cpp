@@ -16,6 +16,8 @@
 #define SHOW_RESULT_NORMALS      2
 #define SHOW_RESULT_SSAO         3
 
+#define OCCLUSION_EYE_MARGIN     0.1f // camera near plane
+
 static const char geometry_vm_glsl[] = R"(
 #version 460
 
@@ -114,6 +116,58 @@ void main()
 }
 )";
 
+static const char bounds_vm_glsl[] = R"(
+#version 460
+
+// two triangles per face of a [-1, 1] cube, corner bits select the positive side of each axis
+const int corners[36] = {
+	0, 2, 6, 0, 6, 4, // -X
+	1, 5, 7, 1, 7, 3, // +X
+	0, 4, 5, 0, 5, 1, // -Y
+	2, 3, 7, 2, 7, 6, // +Y
+	0, 1, 3, 0, 3, 2, // -Z
+	4, 6, 7, 4, 7, 5, // +Z
+};
+
+layout (set = 0, binding = 0) uniform Scene
+{
+	mat4 view;
+	mat4 proj;
+} uScene;
+
+layout (push_constant) uniform PC
+{
+	mat4 bounds_transform;
+} uPC;
+
+void main()
+{
+	int corner = corners[gl_VertexIndex];
+	vec3 pos;
+	pos.x = (corner & 1) != 0 ? 1.0 : -1.0;
+	pos.y = (corner & 2) != 0 ? 1.0 : -1.0;
+	pos.z = (corner & 4) != 0 ? 1.0 : -1.0;
+
+	gl_Position = uScene.proj * uScene.view * uPC.bounds_transform * vec4(pos, 1.0);
+}
+)";
+
+// the bounds only feed occlusion queries, blending keeps the gbuffer intact
+static const char bounds_fm_glsl[] = R"(
+#version 460
+
+layout (location = 0) out vec4 fPos;
+layout (location = 1) out vec4 fNormal;
+layout (location = 2) out vec4 fDiffuse;
+
+void main()
+{
+	fPos = vec4(0.0);
+	fNormal = vec4(0.0);
+	fDiffuse = vec4(0.0);
+}
+)";
+
 static const char quad_vm_glsl[] = R"(
 #version 460
 
@@ -369,20 +423,23 @@ ExampleSSAO::ExampleSSAO(VIBackend backend)
 		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 3, 1 },
 	});
 
+	// full screen passes push their inputs instead of allocating sets per frame
 	mSetLayoutCCCC = CreateSetLayout(mDevice, {
 		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 0, 1 },
 		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 1, 1 },
 		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 2, 1 },
 		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 3, 1 },
-	});
+	}, VI_SET_LAYOUT_PUSH_BIT);
 
-	uint32_t set_count = mFramesInFlight * 4;
+	mSetLayoutMaterial = GLTFMaterial::CreateSetLayout(mDevice);
+
+	uint32_t set_count = mFramesInFlight * 2;
 	mSetPool = CreateSetPool(mDevice, set_count, {
 		{ VI_BINDING_TYPE_UNIFORM_BUFFER, set_count },
-		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 4 * set_count },
+		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 3 * set_count },
 	});
 
-	std::array<VISetLayout, 2> setLayouts = { mSetLayoutUCCC, mSetLayoutUCCC };
+	std::array<VISetLayout, 2> setLayouts = { mSetLayoutUCCC, mSetLayoutMaterial };
 
 	VIPipelineLayoutInfo pipelineLI;
 	pipelineLI.push_constant_size = 128;
@@ -400,6 +457,8 @@ ExampleSSAO::ExampleSSAO(VIBackend backend)
 	mSSAOFM = CreateOrLoadModule(mDevice, mBackend, mPipelineLayoutUCCC2, VI_MODULE_TYPE_FRAGMENT, ssao_fm_glsl, "ssao_fm");
 	mSSAOBlurFM = CreateOrLoadModule(mDevice, mBackend, mPipelineLayoutCCCC, VI_MODULE_TYPE_FRAGMENT, ssao_blur_fm_glsl, "ssao_blur_fm");
 	mCompositionFM = CreateOrLoadModule(mDevice, mBackend, mPipelineLayoutCCCC, VI_MODULE_TYPE_FRAGMENT, composition_fm_glsl, "composition_fm");
+	mBoundsVM = CreateOrLoadModule(mDevice, mBackend, mPipelineLayoutUCCC2, VI_MODULE_TYPE_VERTEX, bounds_vm_glsl, "bounds_vm");
+	mBoundsFM = CreateOrLoadModule(mDevice, mBackend, mPipelineLayoutUCCC2, VI_MODULE_TYPE_FRAGMENT, bounds_fm_glsl, "bounds_fm");
 
 	VIVertexBinding meshVertexBinding;
 	std::vector<VIVertexAttribute> meshVertexAttrs;
@@ -420,6 +479,30 @@ ExampleSSAO::ExampleSSAO(VIBackend backend)
 	pipelineI.modules = modules.data();
 	mGeometryPipeline = vi_create_pipeline(mDevice, &pipelineI);
 
+	// bounds are tested against the gbuffer depth without writing to any attachment
+	{
+		VIPipelineInfo boundsPipelineI;
+		boundsPipelineI.layout = mPipelineLayoutUCCC2;
+		boundsPipelineI.pass = mGeometryPass;
+		boundsPipelineI.vertex_attribute_count = 0;
+		boundsPipelineI.vertex_binding_count = 0;
+		boundsPipelineI.rasterization_state.cull_mode = VI_CULL_MODE_NONE;
+		boundsPipelineI.depth_stencil_state.depth_write_enabled = false;
+		boundsPipelineI.depth_stencil_state.depth_compare_op = VI_COMPARE_OP_LESS_OR_EQUAL;
+		boundsPipelineI.blend_state.enabled = true;
+		boundsPipelineI.blend_state.src_color_factor = VI_BLEND_FACTOR_ZERO;
+		boundsPipelineI.blend_state.dst_color_factor = VI_BLEND_FACTOR_ONE;
+		boundsPipelineI.blend_state.src_alpha_factor = VI_BLEND_FACTOR_ZERO;
+		boundsPipelineI.blend_state.dst_alpha_factor = VI_BLEND_FACTOR_ONE;
+		boundsPipelineI.blend_state.color_blend_op = VI_BLEND_OP_ADD;
+		boundsPipelineI.blend_state.alpha_blend_op = VI_BLEND_OP_ADD;
+
+		std::array<VIModule, 2> boundsModules = { mBoundsVM, mBoundsFM };
+		boundsPipelineI.module_count = boundsModules.size();
+		boundsPipelineI.modules = boundsModules.data();
+		mBoundsPipeline = vi_create_pipeline(mDevice, &boundsPipelineI);
+	}
+
 	VIVertexBinding quadVertexBinding;
 	quadVertexBinding.rate = VK_VERTEX_INPUT_RATE_VERTEX;
 	quadVertexBinding.stride = sizeof(float) * 4;
@@ -568,16 +651,9 @@ ExampleSSAO::ExampleSSAO(VIBackend backend)
 			{ 2, VI_NULL, mFrames[i].gbuffer_normals },
 			{ 3, VI_NULL, mNoise },
 			});
-		mFrames[i].ssao_blur_set = AllocAndUpdateSet(mDevice, mSetPool, mSetLayoutCCCC, {
-			{ 0, VI_NULL, mFrames[i].ssao },
-			});
-		mFrames[i].composition_set = AllocAndUpdateSet(mDevice, mSetPool, mSetLayoutCCCC, {
-			{ 0, VI_NULL, mFrames[i].gbuffer_positions },
-			{ 1, VI_NULL, mFrames[i].gbuffer_normals },
-			{ 2, VI_NULL, mFrames[i].gbuffer_diffuse },
-			{ 3, VI_NULL, mFrames[i].ssao_blur },
-			});
 	}
+
+	mGPUTimer = std::make_unique<GPUTimer>(mDevice, APP_GPU_TIMER_LATENCY);
 }
 
 ExampleSSAO::~ExampleSSAO()
@@ -590,9 +666,7 @@ ExampleSSAO::~ExampleSSAO()
 		vi_buffer_unmap(mFrames[i].ubo);
 		vi_destroy_buffer(mDevice, mFrames[i].ubo);
 		vi_free_set(mDevice, mFrames[i].ssao_set);
-		vi_free_set(mDevice, mFrames[i].ssao_blur_set);
 		vi_free_set(mDevice, mFrames[i].gbuffer_set);
-		vi_free_set(mDevice, mFrames[i].composition_set);
 		vi_destroy_framebuffer(mDevice, mFrames[i].ssao_fbo);
 		vi_destroy_framebuffer(mDevice, mFrames[i].ssao_blur_fbo);
 		vi_destroy_framebuffer(mDevice, mFrames[i].gbuffer);
@@ -608,10 +682,14 @@ ExampleSSAO::~ExampleSSAO()
 	vi_destroy_set_pool(mDevice, mSetPool);
 	vi_destroy_set_layout(mDevice, mSetLayoutUCCC);
 	vi_destroy_set_layout(mDevice, mSetLayoutCCCC);
+	vi_destroy_set_layout(mDevice, mSetLayoutMaterial);
 	vi_destroy_pipeline(mDevice, mSSAOBlurPipeline);
 	vi_destroy_pipeline(mDevice, mSSAOPipeline);
 	vi_destroy_pipeline(mDevice, mGeometryPipeline);
 	vi_destroy_pipeline(mDevice, mCompositionPipeline);
+	vi_destroy_pipeline(mDevice, mBoundsPipeline);
+	vi_destroy_module(mDevice, mBoundsFM);
+	vi_destroy_module(mDevice, mBoundsVM);
 	vi_destroy_module(mDevice, mGeometryFM);
 	vi_destroy_module(mDevice, mGeometryVM);
 	vi_destroy_module(mDevice, mCompositionFM);
@@ -629,7 +707,8 @@ ExampleSSAO::~ExampleSSAO()
 
 void ExampleSSAO::Run()
 {
-	mSceneModel = GLTFModel::LoadFromFile(APP_PATH "../../Assets/gltf/Sponza/glTF/Sponza.gltf", mDevice, mSetLayoutUCCC);
+	mSceneModel = GLTFModel::LoadFromFile(APP_PATH "../../Assets/gltf/Sponza/glTF/Sponza.gltf", mDevice, mSetLayoutMaterial,
+		GLTFModel::LOAD_FLAG_CALCULATE_BOUNDING_BOX_BIT);
 	mCamera.SetPosition({ 0.0f, 1.0f, 0.0f });
 	mConfig.show_result = 0;
 	mConfig.ssao_sample_count = SSAO_SAMPLE_COUNT / 2;
@@ -639,6 +718,25 @@ void ExampleSSAO::Run()
 	mConfig.blur_ssao = true;
 	mConfig.use_ssao = true;
 	mConfig.use_normal_map = true;
+	mConfig.occlusion_culling = false;
+
+	bool supportsOcclusionCulling = vi_device_get_limits(mDevice)->conditional_rendering;
+	uint32_t primitiveCount = mSceneModel->GetPrimitiveCount();
+
+	if (supportsOcclusionCulling)
+	{
+		VIQueryPoolInfo poolI;
+		poolI.type = VI_QUERY_TYPE_OCCLUSION_ANY;
+		poolI.query_count = primitiveCount * 2;
+		mOcclusion.pool = vi_create_query_pool(mDevice, &poolI);
+
+		VIBufferInfo bufferI;
+		bufferI.type = VI_BUFFER_TYPE_STORAGE;
+		bufferI.usage = VI_BUFFER_USAGE_TRANSFER_DST_BIT | VI_BUFFER_USAGE_CONDITIONAL_BIT;
+		bufferI.size = primitiveCount * sizeof(uint32_t);
+		bufferI.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		mOcclusion.visibility = vi_create_buffer(mDevice, &bufferI);
+	}
 
 	while (!glfwWindowShouldClose(mWindow))
 	{
@@ -650,14 +748,17 @@ void ExampleSSAO::Run()
 		VISemaphore present_ready;
 		VIFence frame_complete;
 
-		uint32_t index = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
-		FrameData* frame = mFrames.data() + index;
+		uint32_t image_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
+		FrameData* frame = mFrames.data() + vi_device_get_frame_index(mDevice);
 		VICommand cmd = frame->cmd;
 
 		if (!CameraIsCaptured())
 		{
 			ImGui::Begin(mName);
 			ImGui::Text("Delta Time %.4f (%d FPS)", mFrameTimeDelta, static_cast<int>(1.0f / mFrameTimeDelta));
+			ImGuiFrameLatency();
+			ImGuiGPUTimings(*mGPUTimer);
+			ImGuiFrameCounters();
 			if (ImGui::Button("Show Final Composition"))
 				mConfig.show_result = SHOW_RESULT_COMPOSITION;
 			if (ImGui::Button("Show GBuffer View Space Positions"))
@@ -669,6 +770,8 @@ void ExampleSSAO::Run()
 			ImGui::Checkbox("Blur SSAO Result", &mConfig.blur_ssao);
 			ImGui::Checkbox("Use SSAO Result in Composition", &mConfig.use_ssao);
 			ImGui::Checkbox("Use Normal Map", &mConfig.use_normal_map);
+			if (supportsOcclusionCulling)
+				ImGui::Checkbox("Occlusion Culling", &mConfig.occlusion_culling);
 			ImGui::Checkbox("SSAO Use Range Check", &mConfig.ssao_use_range_check);
 			ImGui::SliderInt("SSAO Sample Count", &mConfig.ssao_sample_count, 1, SSAO_SAMPLE_COUNT);
 			ImGui::SliderFloat("SSAO Kernel Radius", &mConfig.ssao_kernel_radius, 0.1f, 1.0f);
@@ -682,6 +785,31 @@ void ExampleSSAO::Run()
 		vi_buffer_map_write(frame->ubo, 0, sizeof(ubo), &ubo);
 
 		vi_command_begin(cmd, 0, nullptr);
+		mGPUTimer->BeginFrame(cmd);
+
+		// queries are queued before this frame, so the copy waits on the GPU without stalling the CPU
+		bool useVisibility = mConfig.occlusion_culling && mOcclusion.has_results;
+		if (useVisibility)
+		{
+			uint32_t previousRange = mOcclusion.range ^ 1;
+
+			VIBufferMemoryBarrier barrier;
+			barrier.buffer = mOcclusion.visibility;
+			barrier.src_access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			barrier.dst_access = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.src_family_index = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dst_family_index = VK_QUEUE_FAMILY_IGNORED;
+			vi_cmd_pipeline_barrier_buffer_memory(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier);
+
+			vi_cmd_copy_query_results(cmd, mOcclusion.pool, previousRange * primitiveCount, primitiveCount, mOcclusion.visibility, 0);
+
+			barrier.src_access = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dst_access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			vi_cmd_pipeline_barrier_buffer_memory(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier);
+		}
+
+		if (mConfig.occlusion_culling)
+			vi_cmd_reset_queries(cmd, mOcclusion.pool, mOcclusion.range * primitiveCount, primitiveCount);
 
 		std::array<VkClearValue, 3> colorClearValues;
 		colorClearValues[0] = MakeClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -697,6 +825,7 @@ void ExampleSSAO::Run()
 		passBI.color_clear_value_count = colorClearValues.size();
 		passBI.color_clear_values = colorClearValues.data();
 		passBI.depth_stencil_clear_value = &dpethClearValue;
+		mGPUTimer->BeginScope(cmd, "Geometry Pass");
 		vi_cmd_begin_pass(cmd, &passBI);
 		{
 			vi_cmd_bind_graphics_pipeline(cmd, mGeometryPipeline);
@@ -709,9 +838,24 @@ void ExampleSSAO::Run()
 			vi_cmd_push_constants(cmd, mPipelineLayoutUCCC2, sizeof(glm::mat4), sizeof(use_normal_map), &use_normal_map);
 
 			uint32_t materialSetIndex = 1;
-			mSceneModel->Draw(cmd, mPipelineLayoutUCCC2, materialSetIndex);
+			if (useVisibility)
+				mSceneModel->DrawConditional(cmd, mPipelineLayoutUCCC2, materialSetIndex, mOcclusion.visibility, mCamera.GetPosition(), OCCLUSION_EYE_MARGIN);
+			else
+				mSceneModel->Draw(cmd, mPipelineLayoutUCCC2, materialSetIndex);
+
+			if (mConfig.occlusion_culling)
+			{
+				vi_cmd_bind_graphics_pipeline(cmd, mBoundsPipeline);
+				vi_cmd_bind_graphics_set(cmd, mPipelineLayoutUCCC2, 0, frame->gbuffer_set);
+				mSceneModel->DrawBounds(cmd, mPipelineLayoutUCCC2, mOcclusion.pool, mOcclusion.range * primitiveCount);
+
+				mOcclusion.range ^= 1;
+			}
+
+			mOcclusion.has_results = mConfig.occlusion_culling;
 		}
 		vi_cmd_end_pass(cmd);
+		mGPUTimer->EndScope(cmd);
 
 		// SSAO Pass
 
@@ -721,6 +865,7 @@ void ExampleSSAO::Run()
 		passBI.color_clear_value_count = 1;
 		passBI.color_clear_values = &color_clear;
 		passBI.depth_stencil_clear_value = nullptr;
+		mGPUTimer->BeginScope(cmd, "SSAO Pass");
 		vi_cmd_begin_pass(cmd, &passBI);
 		{
 			vi_cmd_bind_graphics_pipeline(cmd, mSSAOPipeline);
@@ -754,17 +899,20 @@ void ExampleSSAO::Run()
 			vi_cmd_draw(cmd, &drawI);
 		}
 		vi_cmd_end_pass(cmd);
+		mGPUTimer->EndScope(cmd);
 
 		// SSAO Blur Pass
 
 		passBI.framebuffer = frame->ssao_blur_fbo;
+		mGPUTimer->BeginScope(cmd, "SSAO Blur Pass");
 		vi_cmd_begin_pass(cmd, &passBI);
 		{
 			vi_cmd_bind_graphics_pipeline(cmd, mSSAOBlurPipeline);
 			vi_cmd_set_viewport(cmd, MakeViewport(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
 			vi_cmd_set_scissor(cmd, MakeScissor(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
 
-			vi_cmd_bind_graphics_set(cmd, mPipelineLayoutCCCC, 0, frame->ssao_blur_set);
+			VISetUpdateInfo blurInput = { 0, VI_NULL, frame->ssao };
+			vi_cmd_push_graphics_set(cmd, mPipelineLayoutCCCC, 0, 1, &blurInput);
 
 			vi_cmd_bind_vertex_buffers(cmd, 0, 1, &mQuadVBO);
 
@@ -779,16 +927,18 @@ void ExampleSSAO::Run()
 			vi_cmd_draw(cmd, &drawI);
 		}
 		vi_cmd_end_pass(cmd);
+		mGPUTimer->EndScope(cmd);
 
 		// Composition Pass
 
 		VkClearValue swapchain_clear_color = MakeClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		VkClearValue swapchain_clear_depth = MakeClearDepthStencil(1.0f, 0);
 		passBI.pass = vi_device_get_swapchain_pass(mDevice);
-		passBI.framebuffer = vi_device_get_swapchain_framebuffer(mDevice, index);
+		passBI.framebuffer = vi_device_get_swapchain_framebuffer(mDevice, image_idx);
 		passBI.color_clear_value_count = 1;
 		passBI.color_clear_values = &swapchain_clear_color;
 		passBI.depth_stencil_clear_value = &swapchain_clear_depth;
+		mGPUTimer->BeginScope(cmd, "Composition Pass");
 		vi_cmd_begin_pass(cmd, &passBI);
 		{
 			// use the swapchain pass as composition pass
@@ -796,7 +946,12 @@ void ExampleSSAO::Run()
 			vi_cmd_set_viewport(cmd, MakeViewport(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
 			vi_cmd_set_scissor(cmd, MakeScissor(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
 
-			vi_cmd_bind_graphics_set(cmd, mPipelineLayoutCCCC, 0, frame->composition_set);
+			std::array<VISetUpdateInfo, 4> compositionInputs;
+			compositionInputs[0] = { 0, VI_NULL, frame->gbuffer_positions };
+			compositionInputs[1] = { 1, VI_NULL, frame->gbuffer_normals };
+			compositionInputs[2] = { 2, VI_NULL, frame->gbuffer_diffuse };
+			compositionInputs[3] = { 3, VI_NULL, frame->ssao_blur };
+			vi_cmd_push_graphics_set(cmd, mPipelineLayoutCCCC, 0, compositionInputs.size(), compositionInputs.data());
 			vi_cmd_bind_vertex_buffers(cmd, 0, 1, &mQuadVBO);
 			
 			struct CompositionPushConstant
@@ -818,6 +973,7 @@ void ExampleSSAO::Run()
 			Application::ImGuiRender(cmd);
 		}
 		vi_cmd_end_pass(cmd);
+		mGPUTimer->EndScope(cmd);
 		vi_command_end(cmd);
 
 		VkPipelineStageFlags stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -837,6 +993,13 @@ void ExampleSSAO::Run()
 	}
 
 	vi_device_wait_idle(mDevice);
+
+	if (mOcclusion.pool)
+	{
+		vi_destroy_query_pool(mDevice, mOcclusion.pool);
+		vi_destroy_buffer(mDevice, mOcclusion.visibility);
+	}
+
 	mSceneModel = nullptr;
 }
 
@@ -27,9 +27,7 @@ private:
 		VIFramebuffer ssao_fbo;
 		VIFramebuffer ssao_blur_fbo;
 		VISet ssao_set;
-		VISet ssao_blur_set;
 		VISet gbuffer_set;
-		VISet composition_set;
 		VIImage gbuffer_diffuse;
 		VIImage gbuffer_normals;
 		VIImage gbuffer_positions;
@@ -48,9 +46,21 @@ private:
 		bool blur_ssao;
 		bool use_ssao;
 		bool use_normal_map;
+		bool occlusion_culling;
 	} mConfig;
 
+	// occlusion culling, primitive bounds are queried after the geometry pass
+	// and predicate the primitive draws of the next frame
+	struct Occlusion
+	{
+		VIQueryPool pool = VI_NULL; // two ranges of queries, one per primitive, alternating each frame
+		VIBuffer visibility = VI_NULL;
+		uint32_t range = 0;       // range written by the current frame
+		bool has_results = false; // the other range holds results of the previous frame
+	} mOcclusion;
+
 	std::shared_ptr<GLTFModel> mSceneModel;
+	std::unique_ptr<GPUTimer> mGPUTimer;
 	std::vector<FrameData> mFrames;
 	VIPass mGeometryPass;
 	VIPass mColorR8Pass;
@@ -63,14 +73,18 @@ private:
 	VIModule mSSAOFM;
 	VIModule mSSAOBlurFM;
 	VIModule mCompositionFM;
+	VIModule mBoundsVM;
+	VIModule mBoundsFM;
 	VISetPool mSetPool;
 	VISetLayout mSetLayoutUCCC;
 	VISetLayout mSetLayoutCCCC;
+	VISetLayout mSetLayoutMaterial;
 	VIPipelineLayout mPipelineLayoutUCCC2;
 	VIPipelineLayout mPipelineLayoutCCCC;
 	VIPipeline mSSAOPipeline;
 	VIPipeline mSSAOBlurPipeline;
 	VIPipeline mGeometryPipeline;
 	VIPipeline mCompositionPipeline;
+	VIPipeline mBoundsPipeline;
 	VICommandPool mCmdPool;
 };
\ No newline at end of file
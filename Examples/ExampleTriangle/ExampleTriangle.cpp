@@ -98,13 +98,12 @@ ExampleTriangle::ExampleTriangle(VIBackend backend)
 	uint32_t family = vi_device_get_graphics_family_index(mDevice);
 	mCmdPool = vi_create_command_pool(mDevice, family, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 
-	mCommands.resize(mFramesInFlight);
-	for (size_t i = 0; i < mFramesInFlight; i++)
+	// one command per frame slot, next_frame waits until the slot is no longer in flight
+	mCommands.resize(mDeviceLimits.max_frames_in_flight);
+	for (size_t i = 0; i < mCommands.size(); i++)
 	{
 		mCommands[i] = vi_allocate_primary_command(mDevice, mCmdPool);
 	}
-
-	RecordCommands();
 }
 
 ExampleTriangle::~ExampleTriangle()
@@ -125,43 +124,38 @@ ExampleTriangle::~ExampleTriangle()
 }
 
 
-// Commands don't differ between frames, record once and for all.
-// The i'th command buffer renders to the i'th swapchain framebuffer.
-void ExampleTriangle::RecordCommands()
+// Commands are recorded every frame against the acquired swapchain framebuffer,
+// swapchain recreation may replace the framebuffers or change their count.
+void ExampleTriangle::RecordCommands(VICommand cmd, uint32_t image_idx)
 {
-	for (uint32_t i = 0; i < mCommands.size(); i++)
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+
+	VkClearValue color_clear = MakeClearColor(0.0f, 0.0f, 0.4f, 1.0f);
+	VkClearValue depth_clear = MakeClearDepthStencil(1.0f, 0);
+	VIPassBeginInfo beginI;
+	beginI.pass = vi_device_get_swapchain_pass(mDevice);
+	beginI.framebuffer = vi_device_get_swapchain_framebuffer(mDevice, image_idx);
+	beginI.color_clear_values = &color_clear;
+	beginI.color_clear_value_count = 1;
+	beginI.depth_stencil_clear_value = &depth_clear;
+
+	vi_cmd_begin_pass(cmd, &beginI);
 	{
-		VICommand cmd = mCommands[i];
-
-		vi_command_begin(cmd, 0, nullptr);
-
-		VkClearValue color_clear = MakeClearColor(0.0f, 0.0f, 0.4f, 1.0f);
-		VkClearValue depth_clear = MakeClearDepthStencil(1.0f, 0);
-		VIPassBeginInfo beginI;
-		beginI.pass = vi_device_get_swapchain_pass(mDevice);
-		beginI.framebuffer = vi_device_get_swapchain_framebuffer(mDevice, i);
-		beginI.color_clear_values = &color_clear;
-		beginI.color_clear_value_count = 1;
-		beginI.depth_stencil_clear_value = &depth_clear;
-
-		vi_cmd_begin_pass(cmd, &beginI);
-		{
-			vi_cmd_bind_graphics_pipeline(cmd, mPipeline);
-			vi_cmd_set_viewport(cmd, MakeViewport(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
-			vi_cmd_set_scissor(cmd, MakeScissor(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
-
-			vi_cmd_bind_vertex_buffers(cmd, 0, 1, &mVBO);
-
-			VIDrawInfo info;
-			info.vertex_count = 3;
-			info.vertex_start = 0;
-			info.instance_count = 1;
-			info.instance_start = 0;
-			vi_cmd_draw(cmd, &info);
-		}
-		vi_cmd_end_pass(cmd);
-		vi_command_end(cmd);
+		vi_cmd_bind_graphics_pipeline(cmd, mPipeline);
+		vi_cmd_set_viewport(cmd, MakeViewport(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
+		vi_cmd_set_scissor(cmd, MakeScissor(APP_WINDOW_WIDTH, APP_WINDOW_HEIGHT));
+
+		vi_cmd_bind_vertex_buffers(cmd, 0, 1, &mVBO);
+
+		VIDrawInfo info;
+		info.vertex_count = 3;
+		info.vertex_start = 0;
+		info.instance_count = 1;
+		info.instance_start = 0;
+		vi_cmd_draw(cmd, &info);
 	}
+	vi_cmd_end_pass(cmd);
+	vi_command_end(cmd);
 }
 
 void ExampleTriangle::Run()
@@ -174,8 +168,9 @@ void ExampleTriangle::Run()
 		VISemaphore present_ready;
 		VIFence frame_complete;
 
-		uint32_t index = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
-		VICommand cmd = mCommands[index];
+		uint32_t image_idx = vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
+		VICommand cmd = mCommands[vi_device_get_frame_index(mDevice)];
+		RecordCommands(cmd, image_idx);
 
 		// bare minimum synchronization:
 		// - first render command must wait for image_acquired semaphore
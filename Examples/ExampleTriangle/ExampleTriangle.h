@@ -12,7 +12,7 @@ public:
 	virtual void Run() override;
 
 private:
-	void RecordCommands();
+	void RecordCommands(VICommand cmd, uint32_t image_idx);
 
 private:
 	VIModule mVertexModule;
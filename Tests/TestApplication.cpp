@@ -3,8 +3,10 @@
 #include <stb_image_write.h>
 #include "TestApplication.h"
 
+bool TestApplication::sHasFailure = false;
+
 TestApplication::TestApplication(const char* name, VIBackend backend)
-	: Application(name, backend, false, false)
+	: Application(name, backend, false, false, APP_MODE_HEADLESS)
 {
 	// right after the screenshot pass we will copy the color attachment to host visible buffer
 	VkSubpassDependency dep;
@@ -72,6 +74,14 @@ TestApplication::~TestApplication()
 	vi_destroy_pass(mDevice, mScreenshotPass);
 }
 
+const char* TestApplication::Result(bool success)
+{
+	if (!success)
+		sHasFailure = true;
+
+	return success ? "OK" : "FAILED";
+}
+
 void TestApplication::SaveScreenshot(const char* name)
 {
 	vi_buffer_map(mScreenshotBuffer);
@@ -82,5 +92,5 @@ void TestApplication::SaveScreenshot(const char* name)
 	std::filesystem::path local_path(name);
 	std::filesystem::path current_path = std::filesystem::current_path();
 
-	printf("saved screenshot to [%s\\%s]\n", current_path.u8string().c_str(), local_path.u8string().c_str());
+	printf("saved screenshot to [%s]\n", (current_path / local_path).u8string().c_str());
 }
@@ -16,6 +16,11 @@ public:
 
 	TestApplication& operator=(const Application&) = delete;
 
+	// records the outcome of a check and returns "OK" or "FAILED" for printing,
+	// the test driver exits with a non-zero code if any check has failed
+	static const char* Result(bool success);
+	static bool HasFailure() { return sHasFailure; }
+
 protected:
 
 	void SaveScreenshot(const char* name);
@@ -25,4 +30,7 @@ protected:
 	VIFramebuffer mScreenshotFBO;
 	VIBuffer mScreenshotBuffer;
 	VIImage mScreenshotImage;
+
+private:
+	static bool sHasFailure;
 };
\ No newline at end of file
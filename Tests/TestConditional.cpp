@@ -0,0 +1,220 @@
+#include <array>
+#include "TestConditional.h"
+
+#define QUAD_COUNT 2
+
+static const char quad_vertex_src[] = R"(
+#version 460
+
+// NDC positions, CCW
+const float vertices[12] = {
+    -1.0,  1.0, // top left
+    -1.0, -1.0, // bottom left
+     1.0, -1.0, // bottom right
+     1.0, -1.0, // bottom right
+     1.0,  1.0, // top right
+    -1.0,  1.0, // top left
+};
+
+layout (push_constant) uniform uPC
+{
+	vec4 ndc_offset_scale;
+	vec4 color;
+} PC;
+
+void main()
+{
+	vec2 pos;
+	pos.x = vertices[gl_VertexIndex * 2];
+	pos.y = vertices[gl_VertexIndex * 2 + 1];
+	gl_Position = vec4(pos * PC.ndc_offset_scale.z + PC.ndc_offset_scale.xy, 0.0, 1.0);
+}
+)";
+
+static const char quad_fragment_src[] = R"(
+#version 460
+
+layout (location = 0) out vec4 fColor;
+
+layout (push_constant) uniform uPC
+{
+	vec4 ndc_offset_scale;
+	vec4 color;
+} PC;
+
+void main()
+{
+	fColor = PC.color;
+}
+)";
+
+TestConditional::TestConditional(VIBackend backend)
+	: TestApplication("TestConditional", backend)
+{
+	VIPipelineLayoutInfo layoutI;
+	layoutI.set_layout_count = 0;
+	layoutI.set_layouts = nullptr;
+	layoutI.push_constant_size = 32;
+	mPipelineLayout = vi_create_pipeline_layout(mDevice, &layoutI);
+
+	VIModuleInfo moduleI;
+	moduleI.pipeline_layout = mPipelineLayout;
+	moduleI.type = VI_MODULE_TYPE_VERTEX;
+	moduleI.vise_glsl = quad_vertex_src;
+	mVM = vi_create_module(mDevice, &moduleI);
+
+	moduleI.type = VI_MODULE_TYPE_FRAGMENT;
+	moduleI.vise_glsl = quad_fragment_src;
+	mFM = vi_create_module(mDevice, &moduleI);
+
+	std::array<VIModule, 2> modules;
+	modules[0] = mVM;
+	modules[1] = mFM;
+
+	VIPipelineInfo pipelineI;
+	pipelineI.vertex_attribute_count = 0;
+	pipelineI.vertex_binding_count = 0;
+	pipelineI.module_count = modules.size();
+	pipelineI.modules = modules.data();
+	pipelineI.pass = mScreenshotPass;
+	pipelineI.layout = mPipelineLayout;
+	mPipeline = vi_create_pipeline(mDevice, &pipelineI);
+
+	// initial predicates are the opposite of the copied ones, a missing copy or barrier inverts the image
+	const uint32_t initial_predicates[QUAD_COUNT] = { 1, 0 };
+	const uint32_t predicates[QUAD_COUNT] = { 0, 1 };
+
+	VIBufferInfo bufferI;
+	bufferI.type = VI_BUFFER_TYPE_STORAGE;
+	bufferI.usage = VI_BUFFER_USAGE_TRANSFER_DST_BIT | VI_BUFFER_USAGE_CONDITIONAL_BIT;
+	bufferI.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	bufferI.size = sizeof(predicates);
+	mPredicates = CreateBufferStaged(mDevice, &bufferI, initial_predicates);
+
+	bufferI.type = VI_BUFFER_TYPE_TRANSFER;
+	bufferI.usage = VI_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferI.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	mPredicatesStaging = vi_create_buffer(mDevice, &bufferI);
+	vi_buffer_map(mPredicatesStaging);
+	vi_buffer_map_write(mPredicatesStaging, 0, sizeof(predicates), predicates);
+	vi_buffer_unmap(mPredicatesStaging);
+
+	uint32_t graphics_family = vi_device_get_graphics_family_index(mDevice);
+	mCmdPool = vi_create_command_pool(mDevice, graphics_family, 0);
+}
+
+TestConditional::~TestConditional()
+{
+	vi_device_wait_idle(mDevice);
+
+	vi_destroy_command_pool(mDevice, mCmdPool);
+	vi_destroy_buffer(mDevice, mPredicatesStaging);
+	vi_destroy_buffer(mDevice, mPredicates);
+	vi_destroy_pipeline(mDevice, mPipeline);
+	vi_destroy_module(mDevice, mFM);
+	vi_destroy_module(mDevice, mVM);
+	vi_destroy_pipeline_layout(mDevice, mPipelineLayout);
+}
+
+void TestConditional::Run()
+{
+	// without conditional rendering the expected image is drawn directly, keeping the screenshot pair comparable
+	bool conditional = mDeviceLimits.conditional_rendering;
+
+	struct QuadPC
+	{
+		glm::vec4 ndc_offset_scale;
+		glm::vec4 color;
+	} quads[QUAD_COUNT] = {
+		{ { -0.5f, 0.0f, 0.25f, 0.0f }, { 0.9f, 0.1f, 0.1f, 1.0f } },
+		{ {  0.5f, 0.0f, 0.25f, 0.0f }, { 0.1f, 0.9f, 0.1f, 1.0f } },
+	};
+
+	VICommand cmd = vi_allocate_primary_command(mDevice, mCmdPool);
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+
+	const uint32_t expected_predicates[QUAD_COUNT] = { 0, 1 };
+
+	VkBufferCopy copy;
+	copy.srcOffset = 0;
+	copy.dstOffset = 0;
+	copy.size = sizeof(uint32_t) * QUAD_COUNT;
+	vi_cmd_copy_buffer(cmd, mPredicatesStaging, mPredicates, 1, &copy);
+
+	// the conditional rendering stage and access are implied by the indirect ones
+	VIBufferMemoryBarrier barrier;
+	barrier.buffer = mPredicates;
+	barrier.src_access = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dst_access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	barrier.src_family_index = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dst_family_index = VK_QUEUE_FAMILY_IGNORED;
+	barrier.offset = 0;
+	barrier.size = sizeof(uint32_t) * QUAD_COUNT;
+	vi_cmd_pipeline_barrier_buffer_memory(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier);
+
+	VkClearValue clear_color = MakeClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	VIPassBeginInfo passBI;
+	passBI.color_clear_value_count = 1;
+	passBI.color_clear_values = &clear_color;
+	passBI.depth_stencil_clear_value = nullptr;
+	passBI.framebuffer = mScreenshotFBO;
+	passBI.pass = mScreenshotPass;
+	vi_cmd_begin_pass(cmd, &passBI);
+	{
+		vi_cmd_bind_graphics_pipeline(cmd, mPipeline);
+		vi_cmd_set_viewport(cmd, MakeViewport(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+		vi_cmd_set_scissor(cmd, MakeScissor(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+
+		VIDrawInfo drawI;
+		drawI.vertex_count = 6;
+		drawI.vertex_start = 0;
+		drawI.instance_count = 1;
+		drawI.instance_start = 0;
+
+		for (uint32_t i = 0; i < QUAD_COUNT; i++)
+		{
+			vi_cmd_push_constants(cmd, mPipelineLayout, 0, sizeof(QuadPC), quads + i);
+
+			if (conditional)
+			{
+				vi_cmd_begin_conditional(cmd, mPredicates, sizeof(uint32_t) * i);
+				vi_cmd_draw(cmd, &drawI);
+				vi_cmd_end_conditional(cmd);
+			}
+			else if (expected_predicates[i])
+				vi_cmd_draw(cmd, &drawI);
+		}
+	}
+	vi_cmd_end_pass(cmd);
+
+	VkBufferImageCopy region = MakeBufferImageCopy2D(VK_IMAGE_ASPECT_COLOR_BIT, TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT);
+	vi_cmd_copy_image_to_buffer(cmd, mScreenshotImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mScreenshotBuffer, 1, &region);
+	vi_command_end(cmd);
+
+	VISubmitInfo submit;
+	submit.cmd_count = 1;
+	submit.cmds = &cmd;
+	submit.signal_count = 0;
+	submit.wait_count = 0;
+	submit.wait_stages = 0;
+	VIQueue queue = vi_device_get_graphics_queue(mDevice);
+	vi_queue_submit(queue, 1, &submit, VI_NULL);
+	vi_queue_wait_idle(queue);
+	vi_free_command(mDevice, cmd);
+
+	// quad centers, the discarded quad leaves the clear color
+	uint32_t row_offset = TEST_WINDOW_WIDTH * 4 * (TEST_WINDOW_HEIGHT / 2);
+	vi_buffer_map(mScreenshotBuffer);
+	const uint8_t* readback = (const uint8_t*)vi_buffer_map_read(mScreenshotBuffer, 0, TEST_WINDOW_WIDTH * TEST_WINDOW_HEIGHT * 4);
+	const uint8_t* discarded = readback + row_offset + (TEST_WINDOW_WIDTH / 4) * 4;
+	const uint8_t* drawn = readback + row_offset + (TEST_WINDOW_WIDTH * 3 / 4) * 4;
+	bool success = discarded[0] == 0 && discarded[1] == 0 && drawn[1] > 200 && drawn[0] < 50;
+	vi_buffer_unmap(mScreenshotBuffer);
+
+	if (conditional)
+		printf("TestConditional %s\n", Result(success));
+	else
+		printf("TestConditional not supported, skipped\n");
+
+	SaveScreenshot(Filename);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vise.h>
+#include "TestApplication.h"
+
+// test conditional rendering
+// - predicates are copied into the predicate buffer within the command, made visible by a barrier
+//   to VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT and VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+// - the left quad is drawn with a zero predicate and must be discarded, the right quad with a one
+class TestConditional : public TestApplication
+{
+public:
+	TestConditional(const TestConditional&) = delete;
+	TestConditional(VIBackend backend);
+	virtual ~TestConditional();
+
+	TestConditional& operator=(const TestConditional&) = delete;
+
+	virtual void Run() override;
+
+	const char* Filename = nullptr;
+
+private:
+	VIModule mVM;
+	VIModule mFM;
+	VIPipeline mPipeline;
+	VIPipelineLayout mPipelineLayout;
+	VIBuffer mPredicates;
+	VIBuffer mPredicatesStaging;
+	VICommandPool mCmdPool;
+};
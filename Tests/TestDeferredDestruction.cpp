@@ -0,0 +1,102 @@
+#include "TestDeferredDestruction.h"
+
+#define BUFFER_SIZE 1024
+
+TestDeferredDestruction::TestDeferredDestruction(VIBackend backend)
+	: TestApplication("TestDeferredDestruction", backend)
+{
+	VIBufferInfo bufferI;
+	bufferI.type = VI_BUFFER_TYPE_TRANSFER;
+	bufferI.size = BUFFER_SIZE;
+	bufferI.usage = VI_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferI.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	mDstBuffer = vi_create_buffer(mDevice, &bufferI);
+
+	uint32_t graphics_family = vi_device_get_graphics_family_index(mDevice);
+	mCmdPool = vi_create_command_pool(mDevice, graphics_family, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+	mCommands.resize(mDeviceLimits.max_frames_in_flight);
+	for (VICommand& cmd : mCommands)
+		cmd = vi_allocate_primary_command(mDevice, mCmdPool);
+}
+
+TestDeferredDestruction::~TestDeferredDestruction()
+{
+	vi_device_wait_idle(mDevice);
+
+	for (VICommand cmd : mCommands)
+		vi_free_command(mDevice, cmd);
+
+	vi_destroy_command_pool(mDevice, mCmdPool);
+	vi_destroy_buffer(mDevice, mDstBuffer);
+}
+
+void TestDeferredDestruction::Run()
+{
+	uint32_t frames_in_flight = vi_device_get_frames_in_flight(mDevice);
+	bool is_deferred = mBackend == VI_BACKEND_VULKAN;
+	bool success = true;
+	size_t usage_before, usage_after;
+
+	VIBufferInfo bufferI;
+	bufferI.type = VI_BUFFER_TYPE_TRANSFER;
+	bufferI.size = BUFFER_SIZE;
+	bufferI.usage = VI_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferI.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VIBuffer src_buffer = vi_create_buffer(mDevice, &bufferI);
+
+	VISemaphore image_acquired;
+	VISemaphore present_ready;
+	VIFence frame_complete;
+
+	// the buffer is still read by the submitted frame when it is destroyed
+	vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
+	SubmitFrame(image_acquired, frame_complete, src_buffer);
+
+	vi_device_get_host_memory(mDevice, &usage_before, nullptr);
+	vi_destroy_buffer(mDevice, src_buffer);
+	vi_device_get_host_memory(mDevice, &usage_after, nullptr);
+	success = success && (usage_after < usage_before) != is_deferred;
+
+	// the frame slot of the destroying frame comes around again after frames_in_flight - 1 other frames,
+	// only then its fence is waited on and the buffer released
+	for (uint32_t i = 0; i < frames_in_flight; i++)
+	{
+		vi_device_get_host_memory(mDevice, &usage_before, nullptr);
+		vi_device_next_frame(mDevice, &image_acquired, &present_ready, &frame_complete);
+		vi_device_get_host_memory(mDevice, &usage_after, nullptr);
+
+		bool is_released = usage_after < usage_before;
+		success = success && is_released == (is_deferred && i + 1 == frames_in_flight);
+
+		SubmitFrame(image_acquired, frame_complete, VI_NULL);
+	}
+
+	printf("TestDeferredDestruction %d frames in flight %s\n", (int)frames_in_flight, Result(success));
+}
+
+void TestDeferredDestruction::SubmitFrame(VISemaphore image_acquired, VIFence frame_complete, VIBuffer src)
+{
+	VICommand cmd = mCommands[vi_device_get_frame_index(mDevice)];
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+	if (src)
+	{
+		VkBufferCopy region;
+		region.srcOffset = 0;
+		region.dstOffset = 0;
+		region.size = BUFFER_SIZE;
+		vi_cmd_copy_buffer(cmd, src, mDstBuffer, 1, &region);
+	}
+	vi_command_end(cmd);
+
+	VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	VISubmitInfo submitI;
+	submitI.cmd_count = 1;
+	submitI.cmds = &cmd;
+	submitI.wait_count = 1;
+	submitI.waits = &image_acquired;
+	submitI.wait_stages = &wait_stage;
+	submitI.signal_count = 0;
+	submitI.signals = nullptr;
+	vi_queue_submit(vi_device_get_graphics_queue(mDevice), 1, &submitI, frame_complete);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <vise.h>
+#include "TestApplication.h"
+
+// test deferred destruction across frames in flight
+// - a buffer is destroyed right after the frame copying from it is submitted
+// - on Vulkan the buffer must be released by the vi_device_next_frame call waiting on that frame's fence, not earlier
+// - on OpenGL the buffer is released immediately, the driver defers deleting objects in use
+class TestDeferredDestruction : public TestApplication
+{
+public:
+	TestDeferredDestruction(const TestDeferredDestruction&) = delete;
+	TestDeferredDestruction(VIBackend backend);
+	virtual ~TestDeferredDestruction();
+
+	TestDeferredDestruction& operator=(const TestDeferredDestruction&) = delete;
+
+	virtual void Run() override;
+
+private:
+	void SubmitFrame(VISemaphore image_acquired, VIFence frame_complete, VIBuffer src);
+
+	VIBuffer mDstBuffer;
+	VICommandPool mCmdPool;
+	std::vector<VICommand> mCommands;
+};
@@ -0,0 +1,232 @@
+#include <array>
+#include <fstream>
+#include "TestKTX2.h"
+
+#define FIXTURE_PATH "ktx2_fixture.ktx2"
+
+static const char quad_vertex_src[] = R"(
+#version 460
+
+// NDC positions, CCW
+const float vertices[12] = {
+    -1.0,  1.0, // top left
+    -1.0, -1.0, // bottom left
+     1.0, -1.0, // bottom right
+     1.0, -1.0, // bottom right
+     1.0,  1.0, // top right
+    -1.0,  1.0, // top left
+};
+
+layout (push_constant) uniform uPC
+{
+	vec4 ndc_offset_lod;
+} PC;
+
+void main()
+{
+	vec2 pos;
+	pos.x = vertices[gl_VertexIndex * 2] * 0.5;
+	pos.y = vertices[gl_VertexIndex * 2 + 1];
+	gl_Position = vec4(pos + PC.ndc_offset_lod.xy, 0.0, 1.0);
+}
+)";
+
+static const char quad_fragment_src[] = R"(
+#version 460
+
+layout (location = 0) out vec4 fColor;
+
+layout (push_constant) uniform uPC
+{
+	vec4 ndc_offset_lod;
+} PC;
+
+layout (set = 0, binding = 0) uniform sampler2D uImage;
+
+void main()
+{
+	fColor = vec4(textureLod(uImage, vec2(0.5, 0.5), PC.ndc_offset_lod.z).rgb, 1.0);
+}
+)";
+
+// writes a minimal KTX2 file without DFD or key-value data, level data is stored smallest level first
+static void WriteFixtureBC1(const char* path)
+{
+	struct
+	{
+		uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		uint32_t vk_format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		uint32_t type_size = 1;
+		uint32_t pixel_width = 8;
+		uint32_t pixel_height = 8;
+		uint32_t pixel_depth = 0;
+		uint32_t layer_count = 0;
+		uint32_t face_count = 1;
+		uint32_t level_count = 2;
+		uint32_t supercompression_scheme = 0;
+		uint32_t dfd_byte_offset = 0;
+		uint32_t dfd_byte_length = 0;
+		uint32_t kvd_byte_offset = 0;
+		uint32_t kvd_byte_length = 0;
+		uint64_t sgd_byte_offset = 0;
+		uint64_t sgd_byte_length = 0;
+		uint64_t level_index[2][3];
+	} header;
+	static_assert(sizeof(header) == 80 + 2 * 24, "KTX2 header layout");
+
+	// BC1 blocks of [color0, color1, indices], index 0 selects color0 for all 16 texels
+	const uint16_t red_block[4] = { 0xF800, 0x0000, 0x0000, 0x0000 };
+	const uint16_t green_block[4] = { 0x07E0, 0x0000, 0x0000, 0x0000 };
+
+	uint64_t level1_offset = sizeof(header);
+	uint64_t level0_offset = level1_offset + sizeof(green_block);
+	header.level_index[0][0] = level0_offset;
+	header.level_index[0][1] = header.level_index[0][2] = sizeof(red_block) * 4;
+	header.level_index[1][0] = level1_offset;
+	header.level_index[1][1] = header.level_index[1][2] = sizeof(green_block);
+
+	std::ofstream file(path, std::ios::binary);
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)green_block, sizeof(green_block));
+	for (uint32_t i = 0; i < 4; i++)
+		file.write((const char*)red_block, sizeof(red_block));
+}
+
+TestKTX2::TestKTX2(VIBackend backend)
+	: TestApplication("TestKTX2", backend)
+{
+	mSetLayout = CreateSetLayout(mDevice, {
+		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 0, 1 },
+	});
+
+	mSetPool = CreateSetPool(mDevice, 1, {
+		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 1 },
+	});
+
+	mPipelineLayout = CreatePipelineLayout(mDevice, {
+		mSetLayout
+	}, 16);
+
+	VIModuleInfo moduleI;
+	moduleI.pipeline_layout = mPipelineLayout;
+	moduleI.type = VI_MODULE_TYPE_VERTEX;
+	moduleI.vise_glsl = quad_vertex_src;
+	mVM = vi_create_module(mDevice, &moduleI);
+
+	moduleI.type = VI_MODULE_TYPE_FRAGMENT;
+	moduleI.vise_glsl = quad_fragment_src;
+	mFM = vi_create_module(mDevice, &moduleI);
+
+	std::array<VIModule, 2> modules;
+	modules[0] = mVM;
+	modules[1] = mFM;
+
+	VIPipelineInfo pipelineI;
+	pipelineI.vertex_attribute_count = 0;
+	pipelineI.vertex_binding_count = 0;
+	pipelineI.module_count = modules.size();
+	pipelineI.modules = modules.data();
+	pipelineI.pass = mScreenshotPass;
+	pipelineI.layout = mPipelineLayout;
+	mPipeline = vi_create_pipeline(mDevice, &pipelineI);
+
+	WriteFixtureBC1(FIXTURE_PATH);
+
+	VISamplerInfo samplerI;
+	samplerI.filter = VI_FILTER_NEAREST;
+	samplerI.mipmap_filter = VI_FILTER_NEAREST;
+	mImage = CreateImageKTX2(mDevice, FIXTURE_PATH, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, &samplerI);
+
+	uint32_t graphics_family = vi_device_get_graphics_family_index(mDevice);
+	mCmdPool = vi_create_command_pool(mDevice, graphics_family, 0);
+}
+
+TestKTX2::~TestKTX2()
+{
+	vi_device_wait_idle(mDevice);
+
+	vi_destroy_command_pool(mDevice, mCmdPool);
+	if (mImage)
+		vi_destroy_image(mDevice, mImage);
+	vi_destroy_pipeline(mDevice, mPipeline);
+	vi_destroy_module(mDevice, mFM);
+	vi_destroy_module(mDevice, mVM);
+	vi_destroy_pipeline_layout(mDevice, mPipelineLayout);
+	vi_destroy_set_pool(mDevice, mSetPool);
+	vi_destroy_set_layout(mDevice, mSetLayout);
+}
+
+void TestKTX2::Run()
+{
+	if (!mImage)
+	{
+		printf("TestKTX2 failed to load %s %s\n", FIXTURE_PATH, Result(false));
+		return;
+	}
+
+	VISetUpdateInfo update{ 0, VI_NULL, mImage };
+	VISet set = vi_allocate_set(mDevice, mSetPool, mSetLayout);
+	vi_set_update(set, 1, &update);
+
+	VICommand cmd = vi_allocate_primary_command(mDevice, mCmdPool);
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+	{
+		VkClearValue clear_color = MakeClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		VIPassBeginInfo passBI;
+		passBI.color_clear_value_count = 1;
+		passBI.color_clear_values = &clear_color;
+		passBI.depth_stencil_clear_value = nullptr;
+		passBI.framebuffer = mScreenshotFBO;
+		passBI.pass = mScreenshotPass;
+		vi_cmd_begin_pass(cmd, &passBI);
+
+		vi_cmd_bind_graphics_pipeline(cmd, mPipeline);
+		vi_cmd_set_viewport(cmd, MakeViewport(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+		vi_cmd_set_scissor(cmd, MakeScissor(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+		vi_cmd_bind_graphics_set(cmd, mPipelineLayout, 0, set);
+
+		VIDrawInfo drawI;
+		drawI.vertex_count = 6;
+		drawI.vertex_start = 0;
+		drawI.instance_count = 1;
+		drawI.instance_start = 0;
+
+		for (uint32_t level = 0; level < 2; level++)
+		{
+			float ndc_offset_lod[4] = { level == 0 ? -0.5f : 0.5f, 0.0f, (float)level, 0.0f };
+			vi_cmd_push_constants(cmd, mPipelineLayout, 0, sizeof(ndc_offset_lod), ndc_offset_lod);
+			vi_cmd_draw(cmd, &drawI);
+		}
+
+		vi_cmd_end_pass(cmd);
+	}
+
+	VkBufferImageCopy region = MakeBufferImageCopy2D(VK_IMAGE_ASPECT_COLOR_BIT, TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT);
+	vi_cmd_copy_image_to_buffer(cmd, mScreenshotImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mScreenshotBuffer, 1, &region);
+	vi_command_end(cmd);
+
+	VISubmitInfo submit;
+	submit.cmd_count = 1;
+	submit.cmds = &cmd;
+	submit.signal_count = 0;
+	submit.wait_count = 0;
+	submit.wait_stages = 0;
+	VIQueue queue = vi_device_get_graphics_queue(mDevice);
+	vi_queue_submit(queue, 1, &submit, VI_NULL);
+	vi_queue_wait_idle(queue);
+	vi_free_command(mDevice, cmd);
+
+	// BC1 endpoints decode exactly, the halves are pure red and pure green
+	uint32_t row_offset = TEST_WINDOW_WIDTH * 4 * (TEST_WINDOW_HEIGHT / 2);
+	vi_buffer_map(mScreenshotBuffer);
+	const uint8_t* readback = (const uint8_t*)vi_buffer_map_read(mScreenshotBuffer, 0, TEST_WINDOW_WIDTH * TEST_WINDOW_HEIGHT * 4);
+	const uint8_t* level0 = readback + row_offset + (TEST_WINDOW_WIDTH / 4) * 4;
+	const uint8_t* level1 = readback + row_offset + (TEST_WINDOW_WIDTH * 3 / 4) * 4;
+	bool success = level0[0] > 200 && level0[1] < 50 && level1[0] < 50 && level1[1] > 200;
+	printf("TestKTX2 level 0 (%d, %d) level 1 (%d, %d) %s\n", (int)level0[0], (int)level0[1], (int)level1[0], (int)level1[1], Result(success));
+	vi_buffer_unmap(mScreenshotBuffer);
+
+	SaveScreenshot(Filename);
+
+	vi_free_set(mDevice, set);
+}
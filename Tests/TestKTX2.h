@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vise.h>
+#include "TestApplication.h"
+
+// test KTX2 loading of block compressed images
+// - an 8x8 BC1 fixture with two levels is written at runtime, level 0 is solid red and level 1 solid green
+// - the left half samples level 0 and the right half level 1, a wrong level offset or block size swaps the colors
+class TestKTX2 : public TestApplication
+{
+public:
+	TestKTX2(const TestKTX2&) = delete;
+	TestKTX2(VIBackend backend);
+	virtual ~TestKTX2();
+
+	TestKTX2& operator=(const TestKTX2&) = delete;
+
+	virtual void Run() override;
+
+	const char* Filename = nullptr;
+
+private:
+	VIModule mVM;
+	VIModule mFM;
+	VIPipeline mPipeline;
+	VIPipelineLayout mPipelineLayout;
+	VISetLayout mSetLayout;
+	VISetPool mSetPool;
+	VIImage mImage;
+	VICommandPool mCmdPool;
+};
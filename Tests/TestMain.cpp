@@ -7,6 +7,14 @@
 #include "TestTransfer.h"
 #include "TestPushConstants.h"
 #include "TestPipelineBlend.h"
+#include "TestSetUpdate.h"
+#include "TestTextureStreaming.h"
+#include "TestQueries.h"
+#include "TestDeferredDestruction.h"
+#include "TestSamplers.h"
+#include "TestMultiDevice.h"
+#include "TestConditional.h"
+#include "TestKTX2.h"
 #include "../Examples/Application/Application.h"
 
 #define TEST_MSE_THRESHOLD 0.01
@@ -37,8 +45,8 @@ private:
 	};
 
 	std::vector<MSETest> mTests;
-	uint32_t mGraphicsFamily;
-	VIQueue mGraphicsQueue;
+	uint32_t mComputeFamily;
+	VIQueue mComputeQueue;
 	VISetPool mMSESetPool;
 	VISetLayout mMSESetLayout;
 	VIPipelineLayout mMSEPipelineLayout;
@@ -74,7 +82,7 @@ void main()
 )";
 
 TestDriver::TestDriver(VIBackend backend)
-	: Application("Test Driver", backend, false)
+	: Application("Test Driver", backend, false, false, APP_MODE_COMPUTE)
 {
 	mMSESetLayout = CreateSetLayout(mDevice, {
 		{ VI_BINDING_TYPE_STORAGE_BUFFER, 0, 1 },
@@ -96,9 +104,9 @@ TestDriver::TestDriver(VIBackend backend)
 	pipelineI.layout = mMSEPipelineLayout;
 	mMSEPipeline = vi_create_compute_pipeline(mDevice, &pipelineI);
 
-	mGraphicsQueue = vi_device_get_graphics_queue(mDevice); // TODO:
-	mGraphicsFamily = vi_device_get_graphics_family_index(mDevice); // TODO:
-	mCommandPool = vi_create_command_pool(mDevice, mGraphicsFamily, 0);
+	mComputeQueue = vi_device_get_compute_queue(mDevice);
+	mComputeFamily = vi_device_get_compute_family_index(mDevice);
+	mCommandPool = vi_create_command_pool(mDevice, mComputeFamily, 0);
 }
 
 TestDriver::~TestDriver()
@@ -146,8 +154,8 @@ void TestDriver::Run()
 	submitI.cmds = &cmd;
 	submitI.signal_count = 0;
 	submitI.wait_count = 0;
-	vi_queue_submit(mGraphicsQueue, 1, &submitI, nullptr);
-	vi_queue_wait_idle(mGraphicsQueue);
+	vi_queue_submit(mComputeQueue, 1, &submitI, nullptr);
+	vi_queue_wait_idle(mComputeQueue);
 	vi_free_command(mDevice, cmd);
 
 	// calculate MSE from workgroup partial sums
@@ -166,7 +174,7 @@ void TestDriver::Run()
 		test.ResultMSE = squared_errors / (TEST_WINDOW_WIDTH * TEST_WINDOW_HEIGHT);
 
 		printf("Test [%s] [%s] ", test.Path1, test.Path2);
-		printf("MSE %.4f %s\n", test.ResultMSE, (test.ResultMSE < TEST_MSE_THRESHOLD) ? "OK" : "FAILED");
+		printf("MSE %.4f %s\n", test.ResultMSE, TestApplication::Result(test.ResultMSE < TEST_MSE_THRESHOLD));
 	}
 
 	for (MSETest& test : mTests)
@@ -291,6 +299,79 @@ int main(int argc, char** argv)
 		test_pipeline_blend.Filename = "pipeline_blend_gl.png";
 		test_pipeline_blend.Run();
 	}
+	{
+		TestSetUpdate test_set_update(VI_BACKEND_VULKAN);
+		test_set_update.Filename = "set_update_vk.png";
+		test_set_update.Run();
+	}
+	{
+		TestSetUpdate test_set_update(VI_BACKEND_OPENGL);
+		test_set_update.Filename = "set_update_gl.png";
+		test_set_update.Run();
+	}
+	{
+		TestTextureStreaming test_texture_streaming(VI_BACKEND_VULKAN);
+		test_texture_streaming.Filename = "texture_streaming_vk.png";
+		test_texture_streaming.Run();
+	}
+	{
+		TestTextureStreaming test_texture_streaming(VI_BACKEND_OPENGL);
+		test_texture_streaming.Filename = "texture_streaming_gl.png";
+		test_texture_streaming.Run();
+	}
+	{
+		TestQueries test_queries(VI_BACKEND_VULKAN);
+		test_queries.Filename = "queries_vk.png";
+		test_queries.Run();
+	}
+	{
+		TestQueries test_queries(VI_BACKEND_OPENGL);
+		test_queries.Filename = "queries_gl.png";
+		test_queries.Run();
+	}
+	{
+		TestSamplers test_samplers(VI_BACKEND_VULKAN);
+		test_samplers.Filename = "samplers_vk.png";
+		test_samplers.Run();
+	}
+	{
+		TestSamplers test_samplers(VI_BACKEND_OPENGL);
+		test_samplers.Filename = "samplers_gl.png";
+		test_samplers.Run();
+	}
+	{
+		TestConditional test_conditional(VI_BACKEND_VULKAN);
+		test_conditional.Filename = "conditional_vk.png";
+		test_conditional.Run();
+	}
+	{
+		TestConditional test_conditional(VI_BACKEND_OPENGL);
+		test_conditional.Filename = "conditional_gl.png";
+		test_conditional.Run();
+	}
+	{
+		TestKTX2 test_ktx2(VI_BACKEND_VULKAN);
+		test_ktx2.Filename = "ktx2_vk.png";
+		test_ktx2.Run();
+	}
+	{
+		TestKTX2 test_ktx2(VI_BACKEND_OPENGL);
+		test_ktx2.Filename = "ktx2_gl.png";
+		test_ktx2.Run();
+	}
+	{
+		// OpenGL devices on other threads need a context of their own, covered by Vulkan only
+		TestMultiDevice test_multi_device(VI_BACKEND_VULKAN);
+		test_multi_device.Run();
+	}
+	{
+		TestDeferredDestruction test_deferred_destruction(VI_BACKEND_VULKAN);
+		test_deferred_destruction.Run();
+	}
+	{
+		TestDeferredDestruction test_deferred_destruction(VI_BACKEND_OPENGL);
+		test_deferred_destruction.Run();
+	}
 
 	// the MSE test driver can be done in either backend
 	// NOTE: without golden images, it is possible that both backends are incorrect but identical renders
@@ -300,7 +381,13 @@ int main(int argc, char** argv)
 	testDriver.AddMSETest("transfer_vk.png", "transfer_gl.png");
 	testDriver.AddMSETest("push_constant_vk.png", "push_constant_gl.png");
 	testDriver.AddMSETest("pipeline_blend_vk.png", "pipeline_blend_gl.png");
+	testDriver.AddMSETest("set_update_vk.png", "set_update_gl.png");
+	testDriver.AddMSETest("texture_streaming_vk.png", "texture_streaming_gl.png");
+	testDriver.AddMSETest("queries_vk.png", "queries_gl.png");
+	testDriver.AddMSETest("samplers_vk.png", "samplers_gl.png");
+	testDriver.AddMSETest("conditional_vk.png", "conditional_gl.png");
+	testDriver.AddMSETest("ktx2_vk.png", "ktx2_gl.png");
 	testDriver.Run();
 
-	return 0;
+	return TestApplication::HasFailure() ? 1 : 0;
 }
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <thread>
+#include <vector>
+#include "TestMultiDevice.h"
+
+#define ROUND_TRIP_COUNT  64
+#define ROUND_TRIP_WORDS  4096
+
+// copies a seeded pattern through a device local buffer and back, returns the number of mismatched words
+static uint32_t RoundTrip(VIDevice device, uint32_t seed)
+{
+	uint32_t family = vi_device_get_compute_family_index(device);
+	VIQueue queue = vi_device_get_compute_queue(device);
+	VICommandPool pool = vi_create_command_pool(device, family, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+	VIBufferInfo bufferI;
+	bufferI.type = VI_BUFFER_TYPE_TRANSFER;
+	bufferI.size = ROUND_TRIP_WORDS * sizeof(uint32_t);
+	bufferI.usage = VI_BUFFER_USAGE_TRANSFER_SRC_BIT | VI_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferI.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VIBuffer host = vi_create_buffer(device, &bufferI);
+	bufferI.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	VIBuffer local = vi_create_buffer(device, &bufferI);
+
+	std::vector<uint32_t> words(ROUND_TRIP_WORDS);
+	uint32_t mismatch_count = 0;
+
+	for (uint32_t i = 0; i < ROUND_TRIP_COUNT; i++)
+	{
+		for (uint32_t j = 0; j < ROUND_TRIP_WORDS; j++)
+			words[j] = seed * 0x9E3779B9u + i * ROUND_TRIP_WORDS + j;
+
+		vi_buffer_map(host);
+		vi_buffer_map_write(host, 0, (uint32_t)bufferI.size, words.data());
+		vi_buffer_unmap(host);
+
+		VkBufferCopy region;
+		region.srcOffset = 0;
+		region.dstOffset = 0;
+		region.size = bufferI.size;
+
+		VICommand cmd = vi_allocate_primary_command(device, pool);
+		vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+		vi_cmd_copy_buffer(cmd, host, local, 1, &region);
+		vi_command_end(cmd);
+
+		VISubmitInfo submitI;
+		submitI.cmd_count = 1;
+		submitI.cmds = &cmd;
+		submitI.signal_count = 0;
+		submitI.wait_count = 0;
+		vi_queue_submit(queue, 1, &submitI, VI_NULL);
+		vi_queue_wait_idle(queue);
+
+		// the host buffer is cleared before the copy back, so stale data can not pass
+		std::vector<uint32_t> zeros(ROUND_TRIP_WORDS, 0);
+		vi_buffer_map(host);
+		vi_buffer_map_write(host, 0, (uint32_t)bufferI.size, zeros.data());
+		vi_buffer_unmap(host);
+
+		vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+		vi_cmd_copy_buffer(cmd, local, host, 1, &region);
+		vi_command_end(cmd);
+		vi_queue_submit(queue, 1, &submitI, VI_NULL);
+		vi_queue_wait_idle(queue);
+		vi_free_command(device, cmd);
+
+		vi_buffer_map(host);
+		const uint32_t* readback = (const uint32_t*)vi_buffer_map_read(host, 0, (uint32_t)bufferI.size);
+		for (uint32_t j = 0; j < ROUND_TRIP_WORDS; j++)
+			mismatch_count += readback[j] != words[j];
+		vi_buffer_unmap(host);
+	}
+
+	vi_destroy_buffer(device, local);
+	vi_destroy_buffer(device, host);
+	vi_destroy_command_pool(device, pool);
+
+	return mismatch_count;
+}
+
+TestMultiDevice::TestMultiDevice(VIBackend backend)
+	: TestApplication("TestMultiDevice", backend)
+{
+}
+
+TestMultiDevice::~TestMultiDevice()
+{
+}
+
+void TestMultiDevice::Run()
+{
+	uint32_t worker_mismatch_count = ROUND_TRIP_WORDS;
+	size_t worker_leaked_bytes = 0;
+
+	std::thread worker([&]() {
+		VIDeviceInfo deviceI{};
+		deviceI.headless = true;
+		deviceI.compute_only = true;
+#if !defined(NDEBUG)
+		deviceI.vulkan.enable_validation_layers = true;
+#else
+		deviceI.vulkan.enable_validation_layers = false;
+#endif
+
+		VIDeviceLimits limits;
+		VIDevice device = vi_create_device_vk(&deviceI, &limits);
+
+		size_t usage_before, usage_after;
+		vi_device_get_host_memory(device, &usage_before, nullptr);
+		worker_mismatch_count = RoundTrip(device, 2);
+		vi_device_get_host_memory(device, &usage_after, nullptr);
+		worker_leaked_bytes = usage_after - usage_before;
+
+		vi_destroy_device(device);
+	});
+
+	uint32_t mismatch_count = RoundTrip(mDevice, 1);
+	worker.join();
+
+	bool success = mismatch_count == 0 && worker_mismatch_count == 0 && worker_leaked_bytes == 0;
+	printf("TestMultiDevice mismatches %d / %d, worker leaked %d bytes %s\n", (int)mismatch_count, (int)worker_mismatch_count, (int)worker_leaked_bytes, Result(success));
+}
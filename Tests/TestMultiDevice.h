@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vise.h>
+#include "TestApplication.h"
+
+// test independent devices driven by separate threads
+// - a worker thread creates, uses and destroys its own compute-only device
+// - meanwhile the test device round trips buffers through transfers on the main thread
+// - both devices must read back exactly what they uploaded, and the worker device must not leak
+class TestMultiDevice : public TestApplication
+{
+public:
+	TestMultiDevice(const TestMultiDevice&) = delete;
+	TestMultiDevice(VIBackend backend);
+	virtual ~TestMultiDevice();
+
+	TestMultiDevice& operator=(const TestMultiDevice&) = delete;
+
+	virtual void Run() override;
+};
@@ -35,6 +35,18 @@ void main()
 }
 )";
 
+// undeclared identifier, fails to compile
+static const char test_broken_glsl[] = R"(
+#version 460
+
+layout (location = 0) out vec4 fColor;
+
+void main()
+{
+	fColor = undeclared_color;
+}
+)";
+
 TestOfflineCompile::TestOfflineCompile(VIBackend backend)
 	: TestApplication("TestOfflineCompile", backend)
 {
@@ -45,8 +57,8 @@ TestOfflineCompile::TestOfflineCompile(VIBackend backend)
 	pipelineLD.set_layouts = nullptr; // TODO: test
 	pipelineLD.set_layout_count = 0;
 
-	mTestBinaryVM = vi_compile_binary_offline(backend, VI_MODULE_TYPE_VERTEX, &pipelineLD, test_vertex_glsl, nullptr);
-	mTestBinaryFM = vi_compile_binary_offline(backend, VI_MODULE_TYPE_FRAGMENT, &pipelineLD, test_fragment_glsl, nullptr);
+	mTestBinaryVM = vi_compile_binary_offline(backend, VI_MODULE_TYPE_VERTEX, &pipelineLD, test_vertex_glsl, &mTestBinaryVMSize);
+	mTestBinaryFM = vi_compile_binary_offline(backend, VI_MODULE_TYPE_FRAGMENT, &pipelineLD, test_fragment_glsl, &mTestBinaryFMSize);
 
 	// runtime resources
 
@@ -60,10 +72,12 @@ TestOfflineCompile::TestOfflineCompile(VIBackend backend)
 	moduleI.type = VI_MODULE_TYPE_VERTEX;
 	moduleI.vise_glsl = nullptr;
 	moduleI.vise_binary = mTestBinaryVM;
+	moduleI.vise_binary_size = mTestBinaryVMSize;
 	mTestVM = vi_create_module(mDevice, &moduleI);
 
 	moduleI.type = VI_MODULE_TYPE_FRAGMENT;
 	moduleI.vise_binary = mTestBinaryFM;
+	moduleI.vise_binary_size = mTestBinaryFMSize;
 	mTestFM = vi_create_module(mDevice, &moduleI);
 
 	std::array<VIModule, 2> modules;
@@ -143,4 +157,60 @@ void TestOfflineCompile::Run()
 	vi_free_command(mDevice, cmd);
 
 	SaveScreenshot(Filename);
+
+	// batch compilation, a failing job must not affect the others and reports its error in its own result
+	VIPipelineLayoutData pipelineLD;
+	pipelineLD.push_constant_size = sizeof(glm::vec4);
+	pipelineLD.set_layouts = nullptr;
+	pipelineLD.set_layout_count = 0;
+
+	const uint32_t job_count = 8;
+	const uint32_t broken_job = 5;
+	std::array<VICompileJob, job_count> jobs;
+	std::array<VICompileJobResult, job_count> results;
+	for (uint32_t i = 0; i < job_count; i++)
+	{
+		bool is_vertex = i % 2 == 0;
+		jobs[i].backend = mBackend;
+		jobs[i].type = is_vertex ? VI_MODULE_TYPE_VERTEX : VI_MODULE_TYPE_FRAGMENT;
+		jobs[i].pipeline_layout = &pipelineLD;
+		jobs[i].vise_glsl = is_vertex ? test_vertex_glsl : test_fragment_glsl;
+	}
+	jobs[broken_job].vise_glsl = test_broken_glsl;
+
+	vi_compile_binaries(job_count, jobs.data(), results.data(), 4);
+
+	bool success = true;
+	for (uint32_t i = 0; i < job_count; i++)
+	{
+		if (i == broken_job)
+			success = success && !results[i].binary && results[i].error && results[i].error[0] != '\0';
+		else
+			success = success && results[i].binary && !results[i].error && vi_binary_check(results[i].binary, results[i].binary_size, jobs[i].vise_glsl);
+	}
+
+	printf("TestOfflineCompile batch of %d jobs with job %d failing %s\n", (int)job_count, (int)broken_job, Result(success));
+
+	// a buffer shorter than the size recorded in the binary header is rejected instead of read past its end
+	VIModuleInfo moduleI;
+	moduleI.pipeline_layout = mTestPipelineLayout;
+	moduleI.type = VI_MODULE_TYPE_FRAGMENT;
+	moduleI.vise_binary = mTestBinaryFM;
+	moduleI.vise_binary_size = mTestBinaryFMSize - 1;
+	VIModule truncated = vi_create_module(mDevice, &moduleI);
+
+	if (truncated)
+		vi_destroy_module(mDevice, truncated);
+
+	printf("TestOfflineCompile truncated binary %s\n", Result(truncated == VI_NULL));
+
+	for (VICompileJobResult& result : results)
+	{
+		if (result.binary)
+			vi_free(result.binary);
+		if (result.error)
+			vi_free(result.error);
+		if (result.dependencies)
+			vi_free(result.dependencies);
+	}
 }
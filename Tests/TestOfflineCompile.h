@@ -3,7 +3,7 @@
 #include <vise.h>
 #include "TestApplication.h"
 
-// Test offline compilation of shader modules
+// Test offline compilation of shader modules, and batch compilation with one failing job
 class TestOfflineCompile : public TestApplication
 {
 public:
@@ -20,6 +20,8 @@ public:
 private:
 	char* mTestBinaryVM;
 	char* mTestBinaryFM;
+	uint32_t mTestBinaryVMSize;
+	uint32_t mTestBinaryFMSize;
 	VIModule mTestVM;
 	VIModule mTestFM;
 	VIPipeline mTestPipeline;
@@ -0,0 +1,232 @@
+#include <array>
+#include "TestQueries.h"
+
+#define QUAD_COUNT 3
+
+static const char quad_vertex_src[] = R"(
+#version 460
+
+// NDC positions, CCW
+const float vertices[12] = {
+    -1.0,  1.0, // top left
+    -1.0, -1.0, // bottom left
+     1.0, -1.0, // bottom right
+     1.0, -1.0, // bottom right
+     1.0,  1.0, // top right
+    -1.0,  1.0, // top left
+};
+
+layout (push_constant) uniform uPC
+{
+	vec4 ndc_offset_scale;
+	vec4 color;
+} PC;
+
+void main()
+{
+	vec2 pos;
+	pos.x = vertices[gl_VertexIndex * 2];
+	pos.y = vertices[gl_VertexIndex * 2 + 1];
+	gl_Position = vec4(pos * PC.ndc_offset_scale.z + PC.ndc_offset_scale.xy, 0.0, 1.0);
+}
+)";
+
+static const char quad_fragment_src[] = R"(
+#version 460
+
+layout (location = 0) out vec4 fColor;
+
+layout (push_constant) uniform uPC
+{
+	vec4 ndc_offset_scale;
+	vec4 color;
+} PC;
+
+void main()
+{
+	fColor = PC.color;
+}
+)";
+
+TestQueries::TestQueries(VIBackend backend)
+	: TestApplication("TestQueries", backend)
+{
+	VIPipelineLayoutInfo layoutI;
+	layoutI.set_layout_count = 0;
+	layoutI.set_layouts = nullptr;
+	layoutI.push_constant_size = 32;
+	mPipelineLayout = vi_create_pipeline_layout(mDevice, &layoutI);
+
+	VIModuleInfo moduleI;
+	moduleI.pipeline_layout = mPipelineLayout;
+	moduleI.type = VI_MODULE_TYPE_VERTEX;
+	moduleI.vise_glsl = quad_vertex_src;
+	mVM = vi_create_module(mDevice, &moduleI);
+
+	moduleI.type = VI_MODULE_TYPE_FRAGMENT;
+	moduleI.vise_glsl = quad_fragment_src;
+	mFM = vi_create_module(mDevice, &moduleI);
+
+	std::array<VIModule, 2> modules;
+	modules[0] = mVM;
+	modules[1] = mFM;
+
+	VIPipelineInfo pipelineI;
+	pipelineI.vertex_attribute_count = 0;
+	pipelineI.vertex_binding_count = 0;
+	pipelineI.module_count = modules.size();
+	pipelineI.modules = modules.data();
+	pipelineI.pass = mScreenshotPass;
+	pipelineI.layout = mPipelineLayout;
+	mPipeline = vi_create_pipeline(mDevice, &pipelineI);
+
+	VIQueryPoolInfo poolI;
+	poolI.type = VI_QUERY_TYPE_OCCLUSION;
+	poolI.query_count = QUAD_COUNT;
+	mOcclusionPool = vi_create_query_pool(mDevice, &poolI);
+
+	poolI.type = VI_QUERY_TYPE_OCCLUSION_ANY;
+	mOcclusionAnyPool = vi_create_query_pool(mDevice, &poolI);
+
+	mStatisticsPool = VI_NULL;
+	if (mDeviceLimits.pipeline_statistics_queries)
+	{
+		poolI.type = VI_QUERY_TYPE_PIPELINE_STATISTICS;
+		poolI.query_count = 1;
+		poolI.pipeline_statistics = VI_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VI_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+		mStatisticsPool = vi_create_query_pool(mDevice, &poolI);
+	}
+
+	uint32_t graphics_family = vi_device_get_graphics_family_index(mDevice);
+	mCmdPool = vi_create_command_pool(mDevice, graphics_family, 0);
+}
+
+TestQueries::~TestQueries()
+{
+	vi_device_wait_idle(mDevice);
+
+	vi_destroy_command_pool(mDevice, mCmdPool);
+
+	if (mStatisticsPool)
+		vi_destroy_query_pool(mDevice, mStatisticsPool);
+
+	vi_destroy_query_pool(mDevice, mOcclusionAnyPool);
+	vi_destroy_query_pool(mDevice, mOcclusionPool);
+	vi_destroy_pipeline(mDevice, mPipeline);
+	vi_destroy_module(mDevice, mFM);
+	vi_destroy_module(mDevice, mVM);
+	vi_destroy_pipeline_layout(mDevice, mPipelineLayout);
+}
+
+void TestQueries::Run()
+{
+	// quad edges fall on pixel boundaries, the last quad is outside of the viewport
+	struct QuadPC
+	{
+		glm::vec4 ndc_offset_scale;
+		glm::vec4 color;
+	} quads[QUAD_COUNT] = {
+		{ { -0.5f,  0.5f, 0.25f,  0.0f }, { 0.9f, 0.1f, 0.1f, 1.0f } },
+		{ {  0.5f, -0.5f, 0.125f, 0.0f }, { 0.1f, 0.9f, 0.1f, 1.0f } },
+		{ {  3.0f,  3.0f, 0.25f,  0.0f }, { 0.1f, 0.1f, 0.9f, 1.0f } },
+	};
+	uint64_t expected_samples[QUAD_COUNT] = { 128 * 128, 64 * 64, 0 };
+
+	VICommand cmd = vi_allocate_primary_command(mDevice, mCmdPool);
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+	vi_cmd_reset_queries(cmd, mOcclusionPool, 0, QUAD_COUNT);
+	vi_cmd_reset_queries(cmd, mOcclusionAnyPool, 0, QUAD_COUNT);
+	if (mStatisticsPool)
+		vi_cmd_reset_queries(cmd, mStatisticsPool, 0, 1);
+
+	VkClearValue clear_color = MakeClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	VIPassBeginInfo passBI;
+	passBI.color_clear_value_count = 1;
+	passBI.color_clear_values = &clear_color;
+	passBI.depth_stencil_clear_value = nullptr;
+	passBI.framebuffer = mScreenshotFBO;
+	passBI.pass = mScreenshotPass;
+	vi_cmd_begin_pass(cmd, &passBI);
+	{
+		vi_cmd_bind_graphics_pipeline(cmd, mPipeline);
+		vi_cmd_set_viewport(cmd, MakeViewport(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+		vi_cmd_set_scissor(cmd, MakeScissor(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+
+		VIDrawInfo drawI;
+		drawI.vertex_count = 6;
+		drawI.vertex_start = 0;
+		drawI.instance_count = 1;
+		drawI.instance_start = 0;
+
+		if (mStatisticsPool)
+			vi_cmd_begin_query(cmd, mStatisticsPool, 0);
+
+		for (uint32_t i = 0; i < QUAD_COUNT; i++)
+		{
+			vi_cmd_push_constants(cmd, mPipelineLayout, 0, sizeof(QuadPC), quads + i);
+
+			vi_cmd_begin_query(cmd, mOcclusionPool, i);
+			vi_cmd_draw(cmd, &drawI);
+			vi_cmd_end_query(cmd, mOcclusionPool, i);
+
+			// redrawing the same quad does not change the image
+			vi_cmd_begin_query(cmd, mOcclusionAnyPool, i);
+			vi_cmd_draw(cmd, &drawI);
+			vi_cmd_end_query(cmd, mOcclusionAnyPool, i);
+		}
+
+		if (mStatisticsPool)
+			vi_cmd_end_query(cmd, mStatisticsPool, 0);
+	}
+	vi_cmd_end_pass(cmd);
+
+	VkBufferImageCopy region = MakeBufferImageCopy2D(VK_IMAGE_ASPECT_COLOR_BIT, TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT);
+	vi_cmd_copy_image_to_buffer(cmd, mScreenshotImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mScreenshotBuffer, 1, &region);
+	vi_command_end(cmd);
+
+	VISubmitInfo submit;
+	submit.cmd_count = 1;
+	submit.cmds = &cmd;
+	submit.signal_count = 0;
+	submit.wait_count = 0;
+	submit.wait_stages = 0;
+	VIQueue queue = vi_device_get_graphics_queue(mDevice);
+	vi_queue_submit(queue, 1, &submit, VI_NULL);
+	vi_queue_wait_idle(queue);
+	vi_free_command(mDevice, cmd);
+
+	// reading back the screenshot waits for the GPU on both backends, every query is available afterwards
+	SaveScreenshot(Filename);
+
+	uint64_t samples[QUAD_COUNT];
+	uint64_t any_samples[QUAD_COUNT];
+	bool success = vi_get_query_results(mDevice, mOcclusionPool, 0, QUAD_COUNT, samples);
+	success = vi_get_query_results(mDevice, mOcclusionAnyPool, 0, QUAD_COUNT, any_samples) && success;
+
+	for (uint32_t i = 0; success && i < QUAD_COUNT; i++)
+	{
+		bool visible = expected_samples[i] > 0;
+
+		if (mDeviceLimits.occlusion_query_precise)
+			success = samples[i] == expected_samples[i];
+		else
+			success = (samples[i] > 0) == visible;
+
+		success = success && (any_samples[i] > 0) == visible;
+	}
+
+	printf("TestQueries samples %d %d %d", (int)samples[0], (int)samples[1], (int)samples[2]);
+
+	if (mStatisticsPool)
+	{
+		// [vertex shader invocations, fragment shader invocations], invocation counts are implementation defined
+		uint64_t statistics[2];
+		bool available = vi_get_query_results(mDevice, mStatisticsPool, 0, 1, statistics);
+		success = success && available && statistics[0] > 0 && statistics[1] > 0;
+
+		if (available)
+			printf(", vertex invocations %d, fragment invocations %d", (int)statistics[0], (int)statistics[1]);
+	}
+
+	printf(" %s\n", Result(success));
+}
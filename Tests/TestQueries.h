@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vise.h>
+#include "TestApplication.h"
+
+// test occlusion and pipeline statistics queries
+// - quads of known pixel coverage are drawn inside occlusion queries, one quad lies outside the viewport
+// - precise occlusion queries must count exactly the covered samples, any-sample queries only non-zero
+// - a pipeline statistics query spans all draws
+class TestQueries : public TestApplication
+{
+public:
+	TestQueries(const TestQueries&) = delete;
+	TestQueries(VIBackend backend);
+	virtual ~TestQueries();
+
+	TestQueries& operator=(const TestQueries&) = delete;
+
+	virtual void Run() override;
+
+	const char* Filename = nullptr;
+
+private:
+	VIModule mVM;
+	VIModule mFM;
+	VIPipeline mPipeline;
+	VIPipelineLayout mPipelineLayout;
+	VIQueryPool mOcclusionPool;
+	VIQueryPool mOcclusionAnyPool;
+	VIQueryPool mStatisticsPool;
+	VICommandPool mCmdPool;
+};
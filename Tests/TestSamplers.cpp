@@ -0,0 +1,218 @@
+#include <array>
+#include "TestSamplers.h"
+
+#define SAMPLE_U 0.4f // between the texel centers, nearer to the black texel
+
+static const char quad_vertex_src[] = R"(
+#version 460
+
+// NDC positions, CCW
+const float vertices[12] = {
+    -1.0,  1.0, // top left
+    -1.0, -1.0, // bottom left
+     1.0, -1.0, // bottom right
+     1.0, -1.0, // bottom right
+     1.0,  1.0, // top right
+    -1.0,  1.0, // top left
+};
+
+layout (push_constant) uniform uPC
+{
+	vec4 ndc_offset_u;
+} PC;
+
+void main()
+{
+	vec2 pos;
+	pos.x = vertices[gl_VertexIndex * 2] * 0.5;
+	pos.y = vertices[gl_VertexIndex * 2 + 1];
+	gl_Position = vec4(pos + PC.ndc_offset_u.xy, 0.0, 1.0);
+}
+)";
+
+static const char quad_fragment_src[] = R"(
+#version 460
+
+layout (location = 0) out vec4 fColor;
+
+layout (push_constant) uniform uPC
+{
+	vec4 ndc_offset_u;
+} PC;
+
+layout (set = 0, binding = 0) uniform sampler2D uImage;
+
+void main()
+{
+	fColor = vec4(texture(uImage, vec2(PC.ndc_offset_u.z, 0.5)).rgb, 1.0);
+}
+)";
+
+TestSamplers::TestSamplers(VIBackend backend)
+	: TestApplication("TestSamplers", backend)
+{
+	mSetLayout = CreateSetLayout(mDevice, {
+		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 0, 1 },
+	});
+
+	mSetPool = CreateSetPool(mDevice, 2, {
+		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+	});
+
+	mPipelineLayout = CreatePipelineLayout(mDevice, {
+		mSetLayout
+	}, 16);
+
+	VIModuleInfo moduleI;
+	moduleI.pipeline_layout = mPipelineLayout;
+	moduleI.type = VI_MODULE_TYPE_VERTEX;
+	moduleI.vise_glsl = quad_vertex_src;
+	mVM = vi_create_module(mDevice, &moduleI);
+
+	moduleI.type = VI_MODULE_TYPE_FRAGMENT;
+	moduleI.vise_glsl = quad_fragment_src;
+	mFM = vi_create_module(mDevice, &moduleI);
+
+	std::array<VIModule, 2> modules;
+	modules[0] = mVM;
+	modules[1] = mFM;
+
+	VIPipelineInfo pipelineI;
+	pipelineI.vertex_attribute_count = 0;
+	pipelineI.vertex_binding_count = 0;
+	pipelineI.module_count = modules.size();
+	pipelineI.modules = modules.data();
+	pipelineI.pass = mScreenshotPass;
+	pipelineI.layout = mPipelineLayout;
+	mPipeline = vi_create_pipeline(mDevice, &pipelineI);
+
+	const uint32_t texels[2] = { 0xFF000000, 0xFFFFFFFF };
+	VIImageInfo imageI = MakeImageInfo2D(VI_FORMAT_RGBA8, 2, 1, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	imageI.usage = VI_IMAGE_USAGE_TRANSFER_DST_BIT | VI_IMAGE_USAGE_SAMPLED_BIT;
+	imageI.sampler.filter = VI_FILTER_NEAREST;
+	imageI.sampler.mipmap_filter = VI_FILTER_NEAREST;
+	mImage = CreateImageStaged(mDevice, &imageI, texels, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	VISamplerInfo samplerI;
+	samplerI.filter = VI_FILTER_LINEAR;
+	samplerI.mipmap_filter = VI_FILTER_NEAREST;
+	mLinearSampler = vi_create_sampler(mDevice, &samplerI);
+
+	uint32_t graphics_family = vi_device_get_graphics_family_index(mDevice);
+	mCmdPool = vi_create_command_pool(mDevice, graphics_family, 0);
+}
+
+TestSamplers::~TestSamplers()
+{
+	vi_device_wait_idle(mDevice);
+
+	vi_destroy_command_pool(mDevice, mCmdPool);
+	vi_destroy_sampler(mDevice, mLinearSampler);
+	vi_destroy_image(mDevice, mImage);
+	vi_destroy_pipeline(mDevice, mPipeline);
+	vi_destroy_module(mDevice, mFM);
+	vi_destroy_module(mDevice, mVM);
+	vi_destroy_pipeline_layout(mDevice, mPipelineLayout);
+	vi_destroy_set_pool(mDevice, mSetPool);
+	vi_destroy_set_layout(mDevice, mSetLayout);
+}
+
+void TestSamplers::Run()
+{
+	// equal infos share the cached sampler, the image default sampler is one of the cache entries too
+	VISamplerInfo nearestI;
+	nearestI.filter = VI_FILTER_NEAREST;
+	nearestI.mipmap_filter = VI_FILTER_NEAREST;
+	VISamplerInfo linearI;
+	linearI.filter = VI_FILTER_LINEAR;
+	linearI.mipmap_filter = VI_FILTER_NEAREST;
+
+	size_t usage_before, usage_after;
+	vi_device_get_host_memory(mDevice, &usage_before, nullptr);
+	VISampler nearest1 = vi_create_sampler(mDevice, &nearestI);
+	VISampler nearest2 = vi_create_sampler(mDevice, &nearestI);
+	VISampler linear = vi_create_sampler(mDevice, &linearI);
+	vi_device_get_host_memory(mDevice, &usage_after, nullptr);
+
+	bool is_deduplicated = nearest1 == nearest2 && nearest1 != linear && linear == mLinearSampler && usage_after == usage_before;
+
+	vi_destroy_sampler(mDevice, linear);
+	vi_destroy_sampler(mDevice, nearest2);
+	vi_destroy_sampler(mDevice, nearest1);
+
+	// the left half samples through the image sampler, the right half through the override
+	std::array<VISet, 2> sets;
+	for (uint32_t i = 0; i < sets.size(); i++)
+	{
+		VISetUpdateInfo update{ 0, VI_NULL, mImage };
+		update.sampler = i == 0 ? VI_NULL : mLinearSampler;
+
+		sets[i] = vi_allocate_set(mDevice, mSetPool, mSetLayout);
+		vi_set_update(sets[i], 1, &update);
+	}
+
+	VICommand cmd = vi_allocate_primary_command(mDevice, mCmdPool);
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+	{
+		VkClearValue clear_color = MakeClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		VIPassBeginInfo passBI;
+		passBI.color_clear_value_count = 1;
+		passBI.color_clear_values = &clear_color;
+		passBI.depth_stencil_clear_value = nullptr;
+		passBI.framebuffer = mScreenshotFBO;
+		passBI.pass = mScreenshotPass;
+		vi_cmd_begin_pass(cmd, &passBI);
+
+		vi_cmd_bind_graphics_pipeline(cmd, mPipeline);
+		vi_cmd_set_viewport(cmd, MakeViewport(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+		vi_cmd_set_scissor(cmd, MakeScissor(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+
+		VIDrawInfo drawI;
+		drawI.vertex_count = 6;
+		drawI.vertex_start = 0;
+		drawI.instance_count = 1;
+		drawI.instance_start = 0;
+
+		for (uint32_t i = 0; i < sets.size(); i++)
+		{
+			float ndc_offset_u[4] = { i == 0 ? -0.5f : 0.5f, 0.0f, SAMPLE_U, 0.0f };
+			vi_cmd_push_constants(cmd, mPipelineLayout, 0, sizeof(ndc_offset_u), ndc_offset_u);
+			vi_cmd_bind_graphics_set(cmd, mPipelineLayout, 0, sets[i]);
+			vi_cmd_draw(cmd, &drawI);
+		}
+
+		vi_cmd_end_pass(cmd);
+	}
+
+	VkBufferImageCopy region = MakeBufferImageCopy2D(VK_IMAGE_ASPECT_COLOR_BIT, TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT);
+	vi_cmd_copy_image_to_buffer(cmd, mScreenshotImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mScreenshotBuffer, 1, &region);
+	vi_command_end(cmd);
+
+	VISubmitInfo submit;
+	submit.cmd_count = 1;
+	submit.cmds = &cmd;
+	submit.signal_count = 0;
+	submit.wait_count = 0;
+	submit.wait_stages = 0;
+	VIQueue queue = vi_device_get_graphics_queue(mDevice);
+	vi_queue_submit(queue, 1, &submit, VI_NULL);
+	vi_queue_wait_idle(queue);
+	vi_free_command(mDevice, cmd);
+
+	// nearest picks the black texel, linear blends 30% of the white texel
+	uint32_t row_offset = TEST_WINDOW_WIDTH * 4 * (TEST_WINDOW_HEIGHT / 2);
+	vi_buffer_map(mScreenshotBuffer);
+	const uint8_t* readback = (const uint8_t*)vi_buffer_map_read(mScreenshotBuffer, 0, TEST_WINDOW_WIDTH * TEST_WINDOW_HEIGHT * 4);
+	uint8_t nearest_red = readback[row_offset + (TEST_WINDOW_WIDTH / 4) * 4];
+	uint8_t linear_red = readback[row_offset + (TEST_WINDOW_WIDTH * 3 / 4) * 4];
+	vi_buffer_unmap(mScreenshotBuffer);
+
+	bool is_overridden = nearest_red < 8 && linear_red > 60 && linear_red < 95;
+	bool success = is_deduplicated && is_overridden;
+	printf("TestSamplers dedup %s, nearest %d linear %d %s\n", is_deduplicated ? "yes" : "no", (int)nearest_red, (int)linear_red, Result(success));
+
+	SaveScreenshot(Filename);
+
+	for (VISet set : sets)
+		vi_free_set(mDevice, set);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vise.h>
+#include "TestApplication.h"
+
+// test the device sampler cache
+// - equal VISamplerInfo must return the same reference counted sampler, different infos distinct samplers
+// - a two texel black and white image with a nearest default sampler is drawn twice, once through its own sampler
+//   and once through a linear sampler override in the set update, only the override blends the texels
+class TestSamplers : public TestApplication
+{
+public:
+	TestSamplers(const TestSamplers&) = delete;
+	TestSamplers(VIBackend backend);
+	virtual ~TestSamplers();
+
+	TestSamplers& operator=(const TestSamplers&) = delete;
+
+	virtual void Run() override;
+
+	const char* Filename = nullptr;
+
+private:
+	VIModule mVM;
+	VIModule mFM;
+	VIPipeline mPipeline;
+	VIPipelineLayout mPipelineLayout;
+	VISetLayout mSetLayout;
+	VISetPool mSetPool;
+	VIImage mImage;
+	VISampler mLinearSampler;
+	VICommandPool mCmdPool;
+};
@@ -0,0 +1,243 @@
+#include <array>
+#include "TestSetUpdate.h"
+
+#define SET_COUNT   10000
+#define GRID_SIZE   4
+#define UBO_COUNT   (GRID_SIZE * GRID_SIZE)
+#define IMAGE_COUNT 4
+
+static const char quad_vertex_src[] = R"(
+#version 460
+
+// NDC positions, CCW
+const float vertices[12] = {
+	-0.5,  0.5, // top left
+	-0.5, -0.5, // bottom left
+	 0.5, -0.5, // bottom right
+	 0.5, -0.5, // bottom right
+	 0.5,  0.5, // top right
+	-0.5,  0.5, // top left
+};
+
+layout (set = 0, binding = 0) uniform uQuad
+{
+	vec4 ndc_offset;
+	vec4 tint;
+} Quad;
+
+layout (location = 0) out vec4 vTint;
+
+void main()
+{
+	vec2 pos;
+	pos.x = vertices[gl_VertexIndex * 2];
+	pos.y = vertices[gl_VertexIndex * 2 + 1];
+	gl_Position = vec4(pos * 0.4 + Quad.ndc_offset.xy, 0.0, 1.0);
+
+	vTint = Quad.tint;
+}
+)";
+
+static const char quad_fragment_src[] = R"(
+#version 460
+
+layout (location = 0) in vec4 vTint;
+layout (location = 0) out vec4 fColor;
+
+layout (set = 0, binding = 1) uniform sampler2D uImage;
+
+void main()
+{
+	fColor = vec4(texture(uImage, vec2(0.5)).rgb * vTint.rgb, 1.0);
+}
+)";
+
+TestSetUpdate::TestSetUpdate(VIBackend backend)
+	: TestApplication("TestSetUpdate", backend)
+{
+	mSetLayout = CreateSetLayout(mDevice, {
+		{ VI_BINDING_TYPE_UNIFORM_BUFFER, 0, 1 },
+		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 1, 1 },
+	});
+
+	mSetPool = CreateSetPool(mDevice, SET_COUNT, {
+		{ VI_BINDING_TYPE_UNIFORM_BUFFER, SET_COUNT },
+		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, SET_COUNT },
+	});
+
+	mPipelineLayout = CreatePipelineLayout(mDevice, {
+		mSetLayout
+	});
+
+	VIModuleInfo moduleI;
+	moduleI.pipeline_layout = mPipelineLayout;
+	moduleI.type = VI_MODULE_TYPE_VERTEX;
+	moduleI.vise_glsl = quad_vertex_src;
+	mVM = vi_create_module(mDevice, &moduleI);
+
+	moduleI.type = VI_MODULE_TYPE_FRAGMENT;
+	moduleI.vise_glsl = quad_fragment_src;
+	mFM = vi_create_module(mDevice, &moduleI);
+
+	std::array<VIModule, 2> modules;
+	modules[0] = mVM;
+	modules[1] = mFM;
+
+	VIPipelineInfo pipelineI;
+	pipelineI.vertex_attribute_count = 0;
+	pipelineI.vertex_binding_count = 0;
+	pipelineI.module_count = modules.size();
+	pipelineI.modules = modules.data();
+	pipelineI.pass = mScreenshotPass;
+	pipelineI.layout = mPipelineLayout;
+	mPipeline = vi_create_pipeline(mDevice, &pipelineI);
+
+	// one UBO per grid cell
+	mUBOs.resize(UBO_COUNT);
+	for (uint32_t i = 0; i < UBO_COUNT; i++)
+	{
+		struct
+		{
+			glm::vec4 ndc_offset;
+			glm::vec4 tint;
+		} quad;
+
+		uint32_t x = i % GRID_SIZE;
+		uint32_t y = i / GRID_SIZE;
+		quad.ndc_offset = glm::vec4(-0.75f + 0.5f * x, -0.75f + 0.5f * y, 0.0f, 0.0f);
+		quad.tint = glm::vec4(1.0f - 0.2f * x, 1.0f - 0.2f * y, 1.0f, 1.0f);
+
+		VIBufferInfo bufferI;
+		bufferI.type = VI_BUFFER_TYPE_UNIFORM;
+		bufferI.usage = VI_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferI.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		bufferI.size = sizeof(quad);
+		mUBOs[i] = CreateBufferStaged(mDevice, &bufferI, &quad);
+	}
+
+	// single texel images in distinct colors
+	const uint32_t colors[IMAGE_COUNT] = { 0xFF3030E0, 0xFF30E030, 0xFFE03030, 0xFFE0E0E0 };
+	mImages.resize(IMAGE_COUNT);
+	for (uint32_t i = 0; i < IMAGE_COUNT; i++)
+	{
+		VIImageInfo imageI = MakeImageInfo2D(VI_FORMAT_RGBA8, 1, 1, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		imageI.usage = VI_IMAGE_USAGE_TRANSFER_DST_BIT | VI_IMAGE_USAGE_SAMPLED_BIT;
+		imageI.sampler.filter = VI_FILTER_NEAREST;
+		mImages[i] = CreateImageStaged(mDevice, &imageI, colors + i, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	uint32_t graphics_family = vi_device_get_graphics_family_index(mDevice);
+	mCmdPool = vi_create_command_pool(mDevice, graphics_family, 0);
+}
+
+TestSetUpdate::~TestSetUpdate()
+{
+	vi_device_wait_idle(mDevice);
+
+	vi_destroy_command_pool(mDevice, mCmdPool);
+
+	for (VIImage image : mImages)
+		vi_destroy_image(mDevice, image);
+	for (VIBuffer ubo : mUBOs)
+		vi_destroy_buffer(mDevice, ubo);
+
+	vi_destroy_pipeline(mDevice, mPipeline);
+	vi_destroy_module(mDevice, mFM);
+	vi_destroy_module(mDevice, mVM);
+	vi_destroy_pipeline_layout(mDevice, mPipelineLayout);
+	vi_destroy_set_pool(mDevice, mSetPool);
+	vi_destroy_set_layout(mDevice, mSetLayout);
+}
+
+void TestSetUpdate::Run()
+{
+	Timer timer;
+
+	mSets.resize(SET_COUNT);
+	for (uint32_t i = 0; i < SET_COUNT; i++)
+		mSets[i] = vi_allocate_set(mDevice, mSetPool, mSetLayout);
+
+	// baseline, one call per set. every set points at the same resources
+	// so the render below only passes if the batch update took effect
+	timer.Start();
+	for (uint32_t i = 0; i < SET_COUNT; i++)
+	{
+		std::array<VISetUpdateInfo, 2> updates;
+		updates[0] = { 0, mUBOs[0], VI_NULL };
+		updates[1] = { 1, VI_NULL, mImages[0] };
+		vi_set_update(mSets[i], updates.size(), updates.data());
+	}
+	timer.Stop();
+	double update_ms = timer.GetMilliSeconds();
+
+	std::vector<VISetResource> resources(SET_COUNT * vi_set_layout_get_descriptor_count(mSetLayout));
+	for (uint32_t i = 0; i < SET_COUNT; i++)
+	{
+		resources[i * 2 + 0].buffer = mUBOs[i % UBO_COUNT];
+		resources[i * 2 + 1].image = mImages[(i / UBO_COUNT) % IMAGE_COUNT];
+	}
+
+	timer.Start();
+	vi_set_update_batch(mDevice, SET_COUNT, mSets.data(), resources.data());
+	timer.Stop();
+	double update_batch_ms = timer.GetMilliSeconds();
+
+	printf("TestSetUpdate %d sets: vi_set_update %.3f ms, vi_set_update_batch %.3f ms\n", SET_COUNT, update_ms, update_batch_ms);
+
+	VICommand cmd = vi_allocate_primary_command(mDevice, mCmdPool);
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+	{
+		VkClearValue clear_color = MakeClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		VIPassBeginInfo passBI;
+		passBI.color_clear_value_count = 1;
+		passBI.color_clear_values = &clear_color;
+		passBI.depth_stencil_clear_value = nullptr;
+		passBI.framebuffer = mScreenshotFBO;
+		passBI.pass = mScreenshotPass;
+		vi_cmd_begin_pass(cmd, &passBI);
+
+		vi_cmd_bind_graphics_pipeline(cmd, mPipeline);
+		vi_cmd_set_viewport(cmd, MakeViewport(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+		vi_cmd_set_scissor(cmd, MakeScissor(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+
+		VIDrawInfo drawI;
+		drawI.vertex_count = 6;
+		drawI.vertex_start = 0;
+		drawI.instance_count = 1;
+		drawI.instance_start = 0;
+
+		// sample sets across the whole range, set i covers grid cell (i % UBO_COUNT)
+		for (uint32_t cell = 0; cell < UBO_COUNT; cell++)
+		{
+			uint32_t set_idx = (SET_COUNT - UBO_COUNT) / (UBO_COUNT - 1) * cell;
+			set_idx -= set_idx % UBO_COUNT;
+			set_idx += cell;
+
+			vi_cmd_bind_graphics_set(cmd, mPipelineLayout, 0, mSets[set_idx]);
+			vi_cmd_draw(cmd, &drawI);
+		}
+
+		vi_cmd_end_pass(cmd);
+	}
+
+	VkBufferImageCopy region = MakeBufferImageCopy2D(VK_IMAGE_ASPECT_COLOR_BIT, TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT);
+	vi_cmd_copy_image_to_buffer(cmd, mScreenshotImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mScreenshotBuffer, 1, &region);
+	vi_command_end(cmd);
+
+	VISubmitInfo submit;
+	submit.cmd_count = 1;
+	submit.cmds = &cmd;
+	submit.signal_count = 0;
+	submit.wait_count = 0;
+	submit.wait_stages = 0;
+	VIQueue queue = vi_device_get_graphics_queue(mDevice);
+	vi_queue_submit(queue, 1, &submit, VI_NULL);
+	vi_queue_wait_idle(queue);
+	vi_free_command(mDevice, cmd);
+
+	SaveScreenshot(Filename);
+
+	for (VISet set : mSets)
+		vi_free_set(mDevice, set);
+	mSets.clear();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vise.h>
+#include "TestApplication.h"
+
+// test set updates
+// - vi_set_update on every set, timed
+// - vi_set_update_batch overwriting every set, timed
+// - render a sample of the batch updated sets
+class TestSetUpdate : public TestApplication
+{
+public:
+	TestSetUpdate(const TestSetUpdate&) = delete;
+	TestSetUpdate(VIBackend backend);
+	virtual ~TestSetUpdate();
+
+	TestSetUpdate& operator=(const TestSetUpdate&) = delete;
+
+	virtual void Run() override;
+
+	const char* Filename = nullptr;
+
+private:
+	std::vector<VISet> mSets;
+	std::vector<VIBuffer> mUBOs;
+	std::vector<VIImage> mImages;
+	VIModule mVM;
+	VIModule mFM;
+	VISetLayout mSetLayout;
+	VISetPool mSetPool;
+	VIPipeline mPipeline;
+	VIPipelineLayout mPipelineLayout;
+	VICommandPool mCmdPool;
+};
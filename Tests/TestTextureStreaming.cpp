@@ -0,0 +1,247 @@
+#include <array>
+#include <vector>
+#include "TestTextureStreaming.h"
+#include "../Examples/Application/TextureStreamer.h"
+
+#define GRID_SIZE       4
+#define TEXTURE_COUNT   (GRID_SIZE * GRID_SIZE)
+#define TEXTURE_SIZE    256
+#define STREAM_BUDGET   (1536 * 1024)
+#define MAX_UPDATES     256
+
+static const char image_vertex_src[] = R"(
+#version 460
+
+// NDC positions, Texture UV
+const float vertices[24] = {
+    -0.5,  0.5, 0.0, 0.0, // top left
+    -0.5, -0.5, 0.0, 1.0, // bottom left
+     0.5, -0.5, 1.0, 1.0, // bottom right
+     0.5, -0.5, 1.0, 1.0, // bottom right
+     0.5,  0.5, 1.0, 0.0, // top right
+    -0.5,  0.5, 0.0, 0.0, // top left
+};
+
+layout (location = 0) out vec2 vUV;
+
+layout (push_constant) uniform uPC
+{
+	vec4 ndc_offset;
+} PC;
+
+void main()
+{
+	vec2 pos;
+	pos.x = vertices[gl_VertexIndex * 4];
+	pos.y = vertices[gl_VertexIndex * 4 + 1];
+	vUV.x = vertices[gl_VertexIndex * 4 + 2];
+	vUV.y = vertices[gl_VertexIndex * 4 + 3];
+	gl_Position = vec4(pos * 0.4 + PC.ndc_offset.xy, 0.0, 1.0);
+}
+)";
+
+static const char image_fragment_src[] = R"(
+#version 460
+
+layout (location = 0) in vec2 vUV;
+layout (location = 0) out vec4 fColor;
+
+layout (set = 0, binding = 0) uniform sampler2D uImage;
+
+void main()
+{
+	fColor = vec4(texture(uImage, vUV).rgb, 1.0);
+}
+)";
+
+TestTextureStreaming::TestTextureStreaming(VIBackend backend)
+	: TestApplication("TestTextureStreaming", backend)
+{
+	mSetLayout = CreateSetLayout(mDevice, {
+		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 0, 1 },
+	});
+
+	mSetPool = CreateSetPool(mDevice, TEXTURE_COUNT, {
+		{ VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, TEXTURE_COUNT },
+	});
+
+	mPipelineLayout = CreatePipelineLayout(mDevice, {
+		mSetLayout
+	}, 16);
+
+	VIModuleInfo moduleI;
+	moduleI.pipeline_layout = mPipelineLayout;
+	moduleI.type = VI_MODULE_TYPE_VERTEX;
+	moduleI.vise_glsl = image_vertex_src;
+	mVM = vi_create_module(mDevice, &moduleI);
+
+	moduleI.type = VI_MODULE_TYPE_FRAGMENT;
+	moduleI.vise_glsl = image_fragment_src;
+	mFM = vi_create_module(mDevice, &moduleI);
+
+	std::array<VIModule, 2> modules;
+	modules[0] = mVM;
+	modules[1] = mFM;
+
+	VIPipelineInfo pipelineI;
+	pipelineI.vertex_attribute_count = 0;
+	pipelineI.vertex_binding_count = 0;
+	pipelineI.module_count = modules.size();
+	pipelineI.modules = modules.data();
+	pipelineI.pass = mScreenshotPass;
+	pipelineI.layout = mPipelineLayout;
+	mPipeline = vi_create_pipeline(mDevice, &pipelineI);
+
+	uint32_t graphics_family = vi_device_get_graphics_family_index(mDevice);
+	mCmdPool = vi_create_command_pool(mDevice, graphics_family, 0);
+}
+
+TestTextureStreaming::~TestTextureStreaming()
+{
+	vi_device_wait_idle(mDevice);
+
+	vi_destroy_command_pool(mDevice, mCmdPool);
+	vi_destroy_pipeline(mDevice, mPipeline);
+	vi_destroy_module(mDevice, mFM);
+	vi_destroy_module(mDevice, mVM);
+	vi_destroy_pipeline_layout(mDevice, mPipelineLayout);
+	vi_destroy_set_pool(mDevice, mSetPool);
+	vi_destroy_set_layout(mDevice, mSetLayout);
+}
+
+void TestTextureStreaming::Run()
+{
+	// every full mip chain takes about 341 KB, the budget holds the mip tails and the full chains of the top row,
+	// the finer levels requested for the other rows do not fit. replacement images count against the budget
+	TextureStreamerInfo streamerI;
+	streamerI.BudgetBytes = STREAM_BUDGET;
+	streamerI.UploadBytesPerUpdate = 128 * 1024;
+	streamerI.TailSize = 32;
+	streamerI.FramesInFlight = 2;
+	streamerI.CommitInterval = 4;
+	TextureStreamer streamer(mDevice, streamerI);
+
+	VISamplerInfo samplerI;
+	samplerI.filter = VI_FILTER_NEAREST;
+	samplerI.mipmap_filter = VI_FILTER_NEAREST;
+
+	// checkerboards in distinct colors, cells shrink to single texels towards the mip tail
+	std::vector<uint32_t> pixels(TEXTURE_SIZE * TEXTURE_SIZE);
+	std::array<uint32_t, TEXTURE_COUNT> textures;
+	for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+	{
+		uint32_t color = 0xFF000000 | ((40 + i * 13) & 255) | (((200 - i * 11) & 255) << 8) | (((i * 29) & 255) << 16);
+		uint32_t cell = 4 + (i % 4) * 4;
+
+		for (uint32_t y = 0; y < TEXTURE_SIZE; y++)
+			for (uint32_t x = 0; x < TEXTURE_SIZE; x++)
+				pixels[y * TEXTURE_SIZE + x] = ((x / cell + y / cell) % 2) ? color : 0xFFFFFFFF;
+
+		textures[i] = streamer.AddTexture(pixels.data(), TEXTURE_SIZE, TEXTURE_SIZE, samplerI);
+	}
+
+	std::array<VISet, TEXTURE_COUNT> sets;
+	for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+		sets[i] = vi_allocate_set(mDevice, mSetPool, mSetLayout);
+
+	auto writeSets = [&]() {
+		for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+		{
+			VISetUpdateInfo update{ 0, VI_NULL, streamer.GetImage(textures[i]) };
+			vi_set_update(sets[i], 1, &update);
+		}
+	};
+	writeSets();
+
+	// the top row is reported at full resolution, every other row at half the size of the previous
+	VIQueue queue = vi_device_get_graphics_queue(mDevice);
+	uint64_t max_resident_bytes = 0;
+	uint32_t update_count = 0;
+
+	do
+	{
+		for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+			streamer.Feedback(textures[i], (float)(TEXTURE_SIZE >> (i / GRID_SIZE)));
+
+		VICommand cmd = vi_allocate_primary_command(mDevice, mCmdPool);
+		vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+		if (streamer.Update(cmd))
+			writeSets();
+		vi_command_end(cmd);
+
+		VISubmitInfo submit;
+		submit.cmd_count = 1;
+		submit.cmds = &cmd;
+		submit.signal_count = 0;
+		submit.wait_count = 0;
+		submit.wait_stages = 0;
+		vi_queue_submit(queue, 1, &submit, VI_NULL);
+		vi_queue_wait_idle(queue);
+		vi_free_command(mDevice, cmd);
+
+		max_resident_bytes = std::max(max_resident_bytes, streamer.GetResidentBytes());
+		update_count++;
+	} while (!streamer.IsIdle() && update_count < MAX_UPDATES);
+
+	bool success = streamer.IsIdle() && max_resident_bytes <= STREAM_BUDGET;
+	for (uint32_t i = 0; i < GRID_SIZE; i++)
+		success = success && streamer.GetVisibleLevel(textures[i]) == 0;
+	printf("TestTextureStreaming %d updates, max resident %d / %d bytes, levels", (int)update_count, (int)max_resident_bytes, STREAM_BUDGET);
+	for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+		printf(" %d", (int)streamer.GetVisibleLevel(textures[i]));
+	printf(" %s\n", Result(success));
+
+	VICommand cmd = vi_allocate_primary_command(mDevice, mCmdPool);
+	vi_command_begin(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+	{
+		VkClearValue clear_color = MakeClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		VIPassBeginInfo passBI;
+		passBI.color_clear_value_count = 1;
+		passBI.color_clear_values = &clear_color;
+		passBI.depth_stencil_clear_value = nullptr;
+		passBI.framebuffer = mScreenshotFBO;
+		passBI.pass = mScreenshotPass;
+		vi_cmd_begin_pass(cmd, &passBI);
+
+		vi_cmd_bind_graphics_pipeline(cmd, mPipeline);
+		vi_cmd_set_viewport(cmd, MakeViewport(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+		vi_cmd_set_scissor(cmd, MakeScissor(TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT));
+
+		VIDrawInfo drawI;
+		drawI.vertex_count = 6;
+		drawI.vertex_start = 0;
+		drawI.instance_count = 1;
+		drawI.instance_start = 0;
+
+		for (uint32_t i = 0; i < TEXTURE_COUNT; i++)
+		{
+			uint32_t x = i % GRID_SIZE;
+			uint32_t y = i / GRID_SIZE;
+			glm::vec4 pc(-0.75f + 0.5f * x, -0.75f + 0.5f * y, 0.0f, 0.0f);
+			vi_cmd_push_constants(cmd, mPipelineLayout, 0, sizeof(pc), &pc);
+			vi_cmd_bind_graphics_set(cmd, mPipelineLayout, 0, sets[i]);
+			vi_cmd_draw(cmd, &drawI);
+		}
+
+		vi_cmd_end_pass(cmd);
+	}
+
+	VkBufferImageCopy region = MakeBufferImageCopy2D(VK_IMAGE_ASPECT_COLOR_BIT, TEST_WINDOW_WIDTH, TEST_WINDOW_HEIGHT);
+	vi_cmd_copy_image_to_buffer(cmd, mScreenshotImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mScreenshotBuffer, 1, &region);
+	vi_command_end(cmd);
+
+	VISubmitInfo submit;
+	submit.cmd_count = 1;
+	submit.cmds = &cmd;
+	submit.signal_count = 0;
+	submit.wait_count = 0;
+	submit.wait_stages = 0;
+	vi_queue_submit(queue, 1, &submit, VI_NULL);
+	vi_queue_wait_idle(queue);
+	vi_free_command(mDevice, cmd);
+
+	SaveScreenshot(Filename);
+
+	for (VISet set : sets)
+		vi_free_set(mDevice, set);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vise.h>
+#include "TestApplication.h"
+
+// test texture streaming under a memory budget
+// - stream a grid of textures whose full mip chains do not fit into the budget
+// - resident bytes, including replacement images in flight, must stay within the budget on every update
+// - the top row is requested at full resolution and must reach level 0
+// - render the grid once the streamer is idle
+class TestTextureStreaming : public TestApplication
+{
+public:
+	TestTextureStreaming(const TestTextureStreaming&) = delete;
+	TestTextureStreaming(VIBackend backend);
+	virtual ~TestTextureStreaming();
+
+	TestTextureStreaming& operator=(const TestTextureStreaming&) = delete;
+
+	virtual void Run() override;
+
+	const char* Filename = nullptr;
+
+private:
+	VIModule mVM;
+	VIModule mFM;
+	VISetLayout mSetLayout;
+	VISetPool mSetPool;
+	VIPipeline mPipeline;
+	VIPipelineLayout mPipelineLayout;
+	VICommandPool mCmdPool;
+};
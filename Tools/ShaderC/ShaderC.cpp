@@ -0,0 +1,321 @@
+// vise-shaderc: offline compiler that packs vise GLSL modules into a shader archive.
+//
+// usage: vise-shaderc <manifest> <output archive>
+//
+// each non-empty manifest line that does not begin with '#' declares one module:
+//
+//   <name> <vertex|fragment|compute> <glsl path> [pc=<push constant size>] [set=<bindings>]...
+//
+// paths are relative to the manifest. every set=... option appends a set layout
+// to the pipeline layout in order, bindings are comma separated <type><binding index>[<array count>]
+// where type is one of ubo, ssbo, image, sampler, or ubo_dynamic, ssbo_dynamic for bindings with dynamic offsets. for example:
+//
+//   pbr_fs fragment Shaders/pbr.frag pc=64 set=ubo0 set=ubo0,sampler1,sampler2,sampler3
+//
+// every module is compiled once into a binary holding sections for both backends, runtime lookup is done by name with
+// vi_shader_archive_find or vi_create_module_from_archive.
+//
+// #include directives are resolved relative to the directory of the including module or header,
+// a make style dependency file listing all sources and headers is written to <output archive>.d
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <vise.h>
+
+struct ManifestModule
+{
+	std::string Name;
+	std::string Path;
+	std::filesystem::path Dir;
+	std::string GLSL;
+	VIModuleType Type;
+	uint32_t PushConstantSize = 0;
+	std::vector<std::vector<VIBinding>> Sets;
+	std::vector<VISetLayoutInfo> SetLayouts;
+	VIPipelineLayoutData LayoutData;
+};
+
+static bool ParseModuleType(const std::string& str, VIModuleType* type)
+{
+	if (str == "vertex")
+		*type = VI_MODULE_TYPE_VERTEX;
+	else if (str == "fragment")
+		*type = VI_MODULE_TYPE_FRAGMENT;
+	else if (str == "compute")
+		*type = VI_MODULE_TYPE_COMPUTE;
+	else
+		return false;
+
+	return true;
+}
+
+static bool ParseBinding(const std::string& str, VIBinding* binding)
+{
+	static const struct
+	{
+		const char* Prefix;
+		VIBindingType Type;
+	} prefixes[] = {
+		{ "ubo_dynamic", VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC },
+		{ "ssbo_dynamic", VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC },
+		{ "ubo", VI_BINDING_TYPE_UNIFORM_BUFFER },
+		{ "ssbo", VI_BINDING_TYPE_STORAGE_BUFFER },
+		{ "image", VI_BINDING_TYPE_STORAGE_IMAGE },
+		{ "sampler", VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER },
+	};
+
+	for (const auto& prefix : prefixes)
+	{
+		size_t len = strlen(prefix.Prefix);
+		if (str.compare(0, len, prefix.Prefix) != 0)
+			continue;
+
+		unsigned int index, count = 1;
+		int matched = sscanf(str.c_str() + len, "%u[%u]", &index, &count);
+		if (matched < 1)
+			return false;
+
+		binding->type = prefix.Type;
+		binding->binding_index = index;
+		binding->array_count = count;
+		return true;
+	}
+
+	return false;
+}
+
+static bool ReadFile(const std::filesystem::path& path, std::string& content)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	std::stringstream ss;
+	ss << file.rdbuf();
+	content = ss.str();
+	return true;
+}
+
+static const char* ResolveInclude(void* user, const char* header_name, const char* includer_name, size_t* header_size)
+{
+	const ManifestModule* module = (const ManifestModule*)user;
+	std::string content;
+
+	// includer_name is relative to the module, empty for the module itself
+	std::filesystem::path includer_dir = std::filesystem::path(includer_name).parent_path();
+	if (!ReadFile(module->Dir / includer_dir / header_name, content))
+		return nullptr;
+
+	char* source = (char*)malloc(content.size());
+	memcpy(source, content.data(), content.size());
+	*header_size = content.size();
+	return source;
+}
+
+static void ReleaseInclude(void* user, const char* header_source)
+{
+	free((void*)header_source);
+}
+
+static bool ParseManifest(const char* manifest_path, std::vector<ManifestModule>& modules)
+{
+	std::ifstream manifest(manifest_path);
+	if (!manifest)
+	{
+		printf("failed to open manifest [%s]\n", manifest_path);
+		return false;
+	}
+
+	std::filesystem::path base_dir = std::filesystem::path(manifest_path).parent_path();
+	std::string line;
+	int line_number = 0;
+
+	while (std::getline(manifest, line))
+	{
+		line_number++;
+
+		std::stringstream ss(line);
+		std::string name, type, path, option;
+		if (!(ss >> name) || name[0] == '#')
+			continue;
+
+		ManifestModule module;
+		module.Name = name;
+
+		if (!(ss >> type >> path) || !ParseModuleType(type, &module.Type))
+		{
+			printf("manifest line %d: expected <name> <vertex|fragment|compute> <glsl path>\n", line_number);
+			return false;
+		}
+
+		while (ss >> option)
+		{
+			if (option.compare(0, 3, "pc=") == 0)
+			{
+				const char* size_str = option.c_str() + 3;
+				char* size_end;
+				unsigned long size = strtoul(size_str, &size_end, 10);
+				if (*size_str < '0' || *size_str > '9' || *size_end != '\0' || size > UINT32_MAX)
+				{
+					printf("manifest line %d: bad push constant size\n", line_number);
+					return false;
+				}
+				module.PushConstantSize = (uint32_t)size;
+			}
+			else if (option.compare(0, 4, "set=") == 0)
+			{
+				std::vector<VIBinding> bindings;
+				std::stringstream set_ss(option.substr(4));
+				std::string binding_str;
+
+				while (std::getline(set_ss, binding_str, ','))
+				{
+					VIBinding binding;
+					if (!ParseBinding(binding_str, &binding))
+					{
+						printf("manifest line %d: bad binding [%s]\n", line_number, binding_str.c_str());
+						return false;
+					}
+					bindings.push_back(binding);
+				}
+
+				module.Sets.push_back(std::move(bindings));
+			}
+			else
+			{
+				printf("manifest line %d: unknown option [%s]\n", line_number, option.c_str());
+				return false;
+			}
+		}
+
+		module.Path = (base_dir / path).string();
+		module.Dir = (base_dir / path).parent_path();
+		if (!ReadFile(module.Path, module.GLSL))
+		{
+			printf("manifest line %d: failed to read [%s]\n", line_number, module.Path.c_str());
+			return false;
+		}
+
+		modules.push_back(std::move(module));
+	}
+
+	// set layout pointers are resolved after all modules are in place
+	for (ManifestModule& module : modules)
+	{
+		module.SetLayouts.resize(module.Sets.size());
+		for (size_t i = 0; i < module.Sets.size(); i++)
+		{
+			module.SetLayouts[i].binding_count = (uint32_t)module.Sets[i].size();
+			module.SetLayouts[i].bindings = module.Sets[i].data();
+		}
+
+		module.LayoutData.push_constant_size = module.PushConstantSize;
+		module.LayoutData.set_layout_count = (uint32_t)module.SetLayouts.size();
+		module.LayoutData.set_layouts = module.SetLayouts.data();
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		printf("usage: vise-shaderc <manifest> <output archive>\n");
+		return 1;
+	}
+
+	std::vector<ManifestModule> modules;
+	if (!ParseManifest(argv[1], modules))
+		return 1;
+
+	std::vector<VIIncludeResolver> resolvers(modules.size());
+	std::vector<VICompileJob> jobs(modules.size());
+
+	for (size_t i = 0; i < modules.size(); i++)
+	{
+		resolvers[i].user = &modules[i];
+		resolvers[i].resolve = ResolveInclude;
+		resolvers[i].release = ReleaseInclude;
+
+		jobs[i].fat_binary = true;
+		jobs[i].type = modules[i].Type;
+		jobs[i].pipeline_layout = &modules[i].LayoutData;
+		jobs[i].vise_glsl = modules[i].GLSL.c_str();
+		jobs[i].include_resolver = resolvers.data() + i;
+	}
+
+	std::vector<VICompileJobResult> results(jobs.size());
+	vi_compile_binaries((uint32_t)jobs.size(), jobs.data(), results.data());
+
+	bool success = true;
+	std::vector<VIShaderArchiveEntry> entries(jobs.size());
+
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		const ManifestModule& module = modules[i];
+
+		if (!results[i].binary)
+		{
+			printf("failed to compile [%s]\n%s\n", module.Path.c_str(), results[i].error);
+			vi_free(results[i].error);
+			success = false;
+			continue;
+		}
+
+		entries[i].name = module.Name.c_str();
+		entries[i].binary = results[i].binary;
+		entries[i].binary_size = results[i].binary_size;
+	}
+
+	if (success)
+	{
+		uint32_t archive_size;
+		char* archive = vi_pack_shader_archive((uint32_t)entries.size(), entries.data(), &archive_size);
+
+		std::ofstream out(argv[2], std::ios::binary);
+		success = out && out.write(archive, archive_size);
+		vi_free(archive);
+
+		if (success)
+			printf("packed %d modules (%d bytes) to [%s]\n", (int)entries.size(), (int)archive_size, argv[2]);
+		else
+			printf("failed to write [%s]\n", argv[2]);
+	}
+
+	if (success)
+	{
+		std::string depfile_path(argv[2]);
+		depfile_path += ".d";
+		std::ofstream depfile(depfile_path);
+		depfile << argv[2] << ":";
+
+		for (size_t i = 0; i < modules.size(); i++)
+		{
+			depfile << " \\\n  " << modules[i].Path;
+
+			std::stringstream ss(results[i].dependencies ? results[i].dependencies : "");
+			std::string header_name;
+			while (std::getline(ss, header_name))
+				depfile << " \\\n  " << (modules[i].Dir / header_name).lexically_normal().string();
+		}
+
+		depfile << "\n";
+	}
+
+	for (VICompileJobResult& result : results)
+	{
+		if (result.binary)
+			vi_free(result.binary);
+		if (result.dependencies)
+			vi_free(result.dependencies);
+	}
+
+	return success ? 0 : 1;
+}
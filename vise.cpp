@@ -3,6 +3,11 @@
 #include <vector>
 #include <optional>
 #include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstdint>
@@ -23,16 +28,26 @@
 
 #ifdef VI_PLATFORM_WIN32
  #define GLFW_EXPOSE_NATIVE_WIN32
+ #include <windows.h>
  #include <GLFW/glfw3.h>
  #include <GLFW/glfw3native.h>
 #else
 # include <GLFW/glfw3.h>
+# include <EGL/egl.h>
+# include <EGL/eglext.h>
+# include <signal.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
 #endif
 
 #ifdef VI_BUILD_DEBUG
 # ifdef VI_PLATFORM_WIN32
 #  include <debugapi.h>
 #  define VI_DEBUG_BREAK   DebugBreak()
+# else
+#  define VI_DEBUG_BREAK   raise(SIGTRAP)
 # endif
 #else
 # define VI_DEBUG_BREAK
@@ -84,12 +99,32 @@
 } while (0)
 #endif
 
+// CPU trace scopes compile to nothing without VI_ENABLE_TRACE
+#ifdef VI_ENABLE_TRACE
+# define VI_TRACE_SCOPE(NAME)   VITraceScope trace_scope_(NAME)
+#else
+# define VI_TRACE_SCOPE(NAME)
+#endif
+
+#define VI_TRACE_FUNC VI_TRACE_SCOPE(__func__)
+
 #define VI_ARR_SIZE(ARR) (sizeof(ARR) / sizeof(*ARR))
 
 #define VI_VK_GLSLANG_VERSION         glslang::EShTargetVulkan_1_2
 #define VI_SHADER_GLSL_VERSION        460
 #define VI_SHADER_ENTRY_POINT         "main"
+#define VI_SHADER_INCLUDE_PREAMBLE    "#extension GL_GOOGLE_include_directive : require\n"
 #define VI_GL_COMMAND_LIST_CAPACITY   16
+#define VI_VK_COMMAND_SCRATCH_SIZE    4096 // bytes per chunk of indirect draw arguments
+#define VI_ARCHIVE_MAGIC              0x41534956 // "VISA"
+#define VI_ARCHIVE_VERSION            2
+#define VI_BINARY_MAGIC               0x42534956 // "VISB"
+#define VI_BINARY_VERSION             2
+#define VI_BINARY_BACKEND_BIT(B)      (1u << (uint32_t)(B))
+#define VI_FNV1A_OFFSET_BASIS         2166136261u
+#define VI_FNV1A_PRIME                16777619u
+#define VI_TRACE_RING_CAPACITY        16384 // latest events kept per thread
+#define VI_TRACE_MAX_DEPTH            64    // open vi_trace_begin scopes per thread
 
 // Normalize NDC Handedness:
 //   OpenGL NDC is left-handed while Vulkan NDC is right-handed,
@@ -107,21 +142,27 @@
 
 struct VIVulkan;
 struct VIFrame;
+struct VIRetiredSwapchain;
+struct VIGarbage;
 struct VIOpenGL;
 struct GLPushConstant;
 struct HostMalloc;
 struct VICompileResult;
 struct VIBinaryHeader;
+struct VIArchiveHeader;
+struct VIArchiveEntry;
 
 // TODO: user dependency injection
 void* vi_malloc(size_t size);
 void vi_free(void* ptr);
 
+// host allocation owned by a device, counted in its host memory statistics
+static void* vi_device_malloc(VIDevice device, size_t size);
+
 enum VIImageFlagBits
 {
 	VI_IMAGE_FLAG_CREATED_IMAGE_BIT = 1,
 	VI_IMAGE_FLAG_CREATED_IMAGE_VIEW_BIT = 2,
-	VI_IMAGE_FLAG_CREATED_SAMPLER_BIT = 4,
 };
 
 struct VIObject
@@ -136,11 +177,11 @@ struct VIObject
 	VIDevice device;
 	uint32_t id;
 
-	static uint32_t id_counter;
+	static std::atomic<uint32_t> id_counter;
 };
 
-// NOTE: not atomic, resource creation and destruction should happen on single thread only
-uint32_t VIObject::id_counter = 0;
+// NOTE: ids are unique across all devices, devices may create objects from different threads
+std::atomic<uint32_t> VIObject::id_counter = 0;
 
 struct VIPassObj : VIObject
 {
@@ -156,6 +197,15 @@ struct VIPassObj : VIObject
 	};
 };
 
+// SPIRV-Cross emits each specialization constant as an overridable
+// SPIRV_CROSS_CONSTANT_ID_<id> macro, a variant is the patched GLSL
+// compiled with those macros defined
+struct GLModuleVariant
+{
+	std::string defines;
+	GLuint shader;
+};
+
 struct VIModuleObj : VIObject
 {
 	VIModuleType type;
@@ -172,22 +222,55 @@ struct VIModuleObj : VIObject
 			uint32_t push_constant_count;
 			GLPushConstant* push_constants;
 			GLuint shader;
+			GLint glsl_size;
+			char* glsl;                              // patched GLSL, recompiled for specialized variants
+			std::vector<GLModuleVariant>* variants;  // specialized shaders, created on demand
 		} gl;
 	};
 };
 
+// variants are vise modules keyed by the bitmask of enabled keywords
+struct VIPermutationObj : VIObject
+{
+	struct Variant
+	{
+		VIModule module;
+		bool is_used;
+	};
+
+	VIModuleType type;
+	VIPipelineLayout pipeline_layout;
+	const VIIncludeResolver* include_resolver;
+	std::string vise_glsl;
+	std::vector<std::string> keywords;
+	std::unordered_map<uint64_t, Variant> variants;
+	std::vector<uint64_t> used_keys; // in order of first use
+};
+
 struct GLCommand;
 
+// host visible chunks of indirect draw arguments, rewritten once the command is recorded again
+struct VICommandScratch
+{
+	std::vector<VIBuffer> chunks;
+	uint32_t chunk_idx;
+	uint32_t chunk_offset;
+};
+
 struct VICommandObj : VIObject
 {
 	VICommandPool pool;
 	bool is_primary;
+	VIBuffer conditional_buffer; // predicate of the open conditional region, VI_NULL outside of one
+	uint32_t conditional_offset;
+	VIFrameCounters counters;    // recorded since vi_command_begin, added to the frame on every submission
 
 	union
 	{
 		struct
 		{
 			VkCommandBuffer handle;
+			VICommandScratch* scratch; // conditional draws without VK_EXT_conditional_rendering, created on first use
 		} vk;
 
 		struct
@@ -222,6 +305,28 @@ struct VIQueueObj : VIObject
 	VkQueue vk_handle;
 };
 
+struct VIQueryPoolObj : VIObject
+{
+	VIQueryType type;
+	uint32_t query_count;
+	uint32_t result_count; // results per query
+
+	union
+	{
+		struct
+		{
+			VkQueryPool handle;
+		} vk;
+
+		struct
+		{
+			GLuint* handles;   // result_count query objects per query
+			GLenum targets[7]; // target of each query object of a query
+			bool* issued;      // written since the last reset, querying other GL query objects is an error
+		} gl;
+	};
+};
+
 struct VIBufferObj : VIObject
 {
 	VIBufferType type;
@@ -253,6 +358,9 @@ struct VIImageObj : VIObject
 
 	VIImageInfo info;
 	uint32_t flags;
+	VISampler sampler = VI_NULL; // shared sampler from VIImageInfo::sampler, used unless a set update overrides it
+	uint32_t base_level = 0; // first mip level visible to set updates, see vi_image_set_base_level
+	VkImageView* vk_level_views = nullptr; // views starting at each base level, created on demand
 
 	union
 	{
@@ -260,7 +368,6 @@ struct VIImageObj : VIObject
 		{
 			VkImage handle;
 			VkImageView view_handle;
-			VkSampler sampler_handle;
 			VkDeviceMemory memory;
 		} vk;
 
@@ -275,31 +382,80 @@ struct VIImageObj : VIObject
 	};
 };
 
-struct VISetPoolObj : VIObject
+// samplers are deduplicated per device, equal VISamplerInfo share one reference counted sampler
+struct VISamplerObj : VIObject
 {
+	VISamplerInfo info;
+	uint32_t ref_count;
+
 	union
 	{
 		struct
 		{
-			VkDescriptorPool handle;
-			VkDescriptorPoolCreateFlags flags;
+			VkSampler handle;
 		} vk;
+
+		struct
+		{
+			GLuint handle;
+		} gl;
 	};
 };
 
+// sets allocated from a set pool during one frame in flight,
+// non-transient pools only use a single frame that is never reset
+struct VISetPoolFrame
+{
+	uint64_t frame_count;                  // device frame count of the last reset
+	uint32_t set_count;                    // number of recycled set objects in use
+	uint32_t pool_idx;                     // first descriptor pool that may have free space
+	std::vector<VISet> sets;               // transient set objects, recycled on reset
+	std::vector<VkDescriptorPool> vk_pools;
+};
+
+// freed set kept for the next allocation of the same layout
+struct VISetPoolFreeSet
+{
+	VkDescriptorSet handle;
+	VkDescriptorPool pool_handle; // descriptor pool the set was allocated from
+};
+
+struct VISetPoolObj : VIObject
+{
+	VISetPoolFlags flags;
+	uint32_t max_set_count;                // capacity of the next chained descriptor pool
+	uint32_t observed_set_count;           // number of sets allocated from Vulkan so far
+	uint32_t observed_resources[VI_BINDING_TYPE_ENUM_COUNT]; // descriptors allocated from Vulkan so far, indexed by VIBindingType
+	std::vector<VISetPoolResource> resources;
+	std::vector<VISetPoolFrame> frames;
+	std::unordered_map<uint32_t, std::vector<VISetPoolFreeSet>> vk_free_sets; // freed sets cached per VISetLayout id
+};
+
 struct VISetLayoutObj : VIObject
 {
+	VISetLayoutFlags flags;
 	std::vector<VIBinding> bindings;
+	std::vector<uint32_t> descriptor_offsets; // offset of each binding among all array elements in the set
+	std::vector<uint32_t> dynamic_offset_indices; // index of each dynamic binding's first offset, in binding_index order like Vulkan
+	uint32_t descriptor_count;
 
 	union
 	{
 		struct
 		{
 			VkDescriptorSetLayout handle;
+			VkDescriptorUpdateTemplate update_template; // writes all descriptors from packed VKDescriptorInfo
 		} vk;
 	};
 };
 
+// update template entry for a single descriptor
+union VKDescriptorInfo
+{
+	VkDescriptorImageInfo image;
+	VkDescriptorBufferInfo buffer;
+};
+
 struct GLRemap
 {
 	VIBindingType type;
@@ -351,11 +507,14 @@ struct VISetObj : VIObject
 		struct
 		{
 			VkDescriptorSet handle;
+			VkDescriptorPool pool_handle;
 		} vk;
 
 		struct
 		{
 			void** binding_sites;
+			uint32_t* binding_ranges;   // buffer range of each binding site, 0 for the whole buffer
+			VISampler* binding_samplers; // sampler of each combined image sampler site
 		} gl;
 	};
 };
@@ -428,6 +587,8 @@ struct VIFramebufferObj : VIObject
 
 struct VIFrame
 {
+	uint64_t frame_count; // device frame count of the last frame recorded in this slot
+
 	struct
 	{
 		VIFenceObj frame_complete;
@@ -436,7 +597,7 @@ struct VIFrame
 	struct
 	{
 		VISemaphoreObj image_acquired; // swapchain framebuffer of the current frame is ready for rendering
-		VISemaphoreObj present_ready; // swapchain texture of the current frame is ready for presentation
+		VISemaphoreObj present_ready; // offscreen frame is ready for presentation, Vulkan swapchains use one per image
 	} semaphore;
 };
 
@@ -460,6 +621,13 @@ struct VIOpenGL
 	VIFramebuffer active_framebuffer;
 	VIFrame frame;
 	std::vector<GLSubmitInfo> submits;
+#ifdef VI_PLATFORM_LINUX
+	EGLDisplay egl_display; // surfaceless context owned by a headless device, EGL_NO_DISPLAY otherwise
+	EGLContext egl_context;
+#endif
+	GLFWwindow* window; // window owning the device context, null for surfaceless contexts
+	bool owns_window;   // hidden window created for a headless device, see gl_create_hidden_context
+	GLuint indirect_buffer; // arguments of conditional draws, created on first use
 
 	struct
 	{
@@ -467,9 +635,48 @@ struct VIOpenGL
 		VIPipeline pipeline;
 		uint32_t push_constant_count;
 		GLPushConstant* push_constants;
+		VIBuffer conditional_buffer; // predicate of the conditional region being executed
+		uint32_t conditional_offset;
 	} execution;
 };
 
+// device level entry points, loaded per device
+struct VIProcTable
+{
+	PFN_vkCmdSetFrontFaceEXT vkCmdSetFrontFaceEXT;
+	PFN_vkCmdPushDescriptorSetKHR vkCmdPushDescriptorSetKHR;
+	PFN_vkCmdBeginConditionalRenderingEXT vkCmdBeginConditionalRenderingEXT;
+	PFN_vkCmdEndConditionalRenderingEXT vkCmdEndConditionalRenderingEXT;
+};
+
+// swapchain replaced by a recreation, frames in flight may still render to or present its images
+struct VIRetiredSwapchain
+{
+	uint64_t retire_frame; // destroyed once the frame with this device frame count is complete
+	VkSwapchainKHR handle;
+	VIFramebuffer framebuffers;
+	std::vector<VIImageObj> images;
+	std::vector<VIImageObj> depth_stencils;
+	std::vector<VISemaphoreObj> present_ready;
+};
+
+enum VIGarbageType
+{
+	VI_GARBAGE_TYPE_BUFFER,
+	VI_GARBAGE_TYPE_IMAGE,
+	VI_GARBAGE_TYPE_SET,
+	VI_GARBAGE_TYPE_SET_POOL,
+	VI_GARBAGE_TYPE_FRAMEBUFFER,
+};
+
+// object destroyed while frames in flight may still reference it
+struct VIGarbage
+{
+	VIGarbageType type;
+	uint64_t frame_count; // released once the frame with this device frame count is complete
+	void* object;
+};
+
 // Vise Vulkan Context
 struct VIVulkan
 {
@@ -477,7 +684,9 @@ struct VIVulkan
 	VkDevice device;
 	VIFrame* frames;
 	uint32_t frame_idx;
-	uint32_t frames_in_flight;
+	uint32_t frames_in_flight;     // active frame slots cycled by next_frame
+	uint32_t max_frames_in_flight; // allocated frame slots
+	uint64_t completed_frame_count; // every frame up to this device frame count is complete
 	uint32_t family_idx_graphics;
 	uint32_t family_idx_transfer;
 	uint32_t family_idx_present;
@@ -489,9 +698,13 @@ struct VIVulkan
 	VIAllocatorVK allocator;
 	VkInstance instance;
 	VkSurfaceKHR surface;
+	VIProcTable proc;
 	VkPhysicalDevice pdevice;
 	VICommandPoolObj cmd_pool_graphics;
+	VISetPool push_set_pool; // transient sets emulating push descriptors, created on first use
 	bool pass_uses_swapchain_framebuffer;
+	bool supports_push_descriptor;
+	bool supports_conditional_rendering;
 
 	void (*configure_swapchain)(const VIPhysicalDevice* pdevice, void* window, VISwapchainInfo* out_info);
 
@@ -504,7 +717,14 @@ struct VIVulkan
 		std::vector<VkImage> image_handles;
 		std::vector<VIImageObj> images;
 		std::vector<VIImageObj> depth_stencils;
+		std::vector<VISemaphoreObj> present_ready; // per image, presentation is not fenced by any frame slot
+		std::vector<VkFence> image_fences;         // frame_complete of the frame slot that last rendered to each image
+		bool is_outdated;                          // recreated before the next acquire
 	} swapchain;
+
+	std::vector<VIRetiredSwapchain> retired_swapchains;
+	std::vector<VIGarbage> garbage; // ordered by frame count
+	bool is_releasing_garbage;
 };
 
 struct VICompileResult
@@ -514,18 +734,136 @@ struct VICompileResult
 	std::string gl_patched;
 	std::vector<GLPushConstant> gl_push_constants;
 	std::vector<uint32_t> vk_spirv;
+	std::vector<std::string> dependencies; // header names resolved through #include, in order of first inclusion
+	uint32_t source_hash; // see VIBinaryHeader::source_hash
+};
+
+// forwards glslang #include requests to the user VIIncludeResolver,
+// each resolved header name is recorded once as a dependency if a dependency list is given
+class VIIncluder : public glslang::TShader::Includer
+{
+public:
+	VIIncluder(const VIIncludeResolver* resolver, std::vector<std::string>* dependencies)
+		: mResolver(resolver), mDependencies(dependencies)
+	{
+	}
+
+	IncludeResult* includeLocal(const char* header_name, const char* includer_name, size_t inclusion_depth) override
+	{
+		return include(header_name, includer_name);
+	}
+
+	IncludeResult* includeSystem(const char* header_name, const char* includer_name, size_t inclusion_depth) override
+	{
+		return include(header_name, includer_name);
+	}
+
+	void releaseInclude(IncludeResult* result) override
+	{
+		if (!result)
+			return;
+
+		if (mResolver->release)
+			mResolver->release(mResolver->user, result->headerData);
+
+		delete result;
+	}
+
+private:
+	IncludeResult* include(const char* header_name, const char* includer_name)
+	{
+		if (!mResolver)
+			return nullptr;
+
+		size_t header_size = 0;
+		const char* header_data = mResolver->resolve(mResolver->user, header_name, includer_name, &header_size);
+		if (!header_data)
+			return nullptr;
+
+		// glslang passes the name of this result as includer_name of nested includes
+		std::string resolved_name = get_include_name(header_name, includer_name);
+
+		if (mDependencies && std::find(mDependencies->begin(), mDependencies->end(), resolved_name) == mDependencies->end())
+			mDependencies->push_back(resolved_name);
+
+		return new IncludeResult(resolved_name, header_data, header_size, nullptr);
+	}
+
+	// header names are relative to the directory of the including header,
+	// the resolved name is relative to the top level source
+	static std::string get_include_name(const char* header_name, const char* includer_name)
+	{
+		const char* includer_dir_end = includer_name ? strrchr(includer_name, '/') : nullptr;
+		if (!includer_dir_end || header_name[0] == '/')
+			return header_name;
+
+		std::string name(includer_name, includer_dir_end + 1);
+		name += header_name;
+		return name;
+	}
+
+	const VIIncludeResolver* mResolver;
+	std::vector<std::string>* mDependencies;
 };
 
+// a vise binary holds sections for one or both backends:
+// - SPIRV words for Vulkan, placed right after the header so they stay 4 byte aligned
+// - serialized GLPushConstant entries and patched GLSL for OpenGL
 struct VIBinaryHeader
 {
-	uint32_t payload_size;  // byte size of payload, the payload is serialized as a byte stream
-	uint32_t header_size;   // byte offset from header to payload
-	uint32_t backend_type;  // VI_BACKEND_VULKAN or VI_BACKEND_OPENGL
+	uint32_t magic;         // VI_BINARY_MAGIC
+	uint32_t version;       // VI_BINARY_VERSION, binaries of any other version are rejected
+	uint32_t binary_size;   // byte size of the whole binary including this header
+	uint32_t checksum;      // FNV-1a hash of all bytes following the header
+	uint32_t source_hash;   // FNV-1a hash of the vise GLSL source, preprocessed if compiled with an include resolver
+	uint32_t layout_hash;   // hash of the pipeline layout the binary was compiled against
 	uint32_t module_type;   // VI_MODULE_TYPE_VERTEX, VI_MODULE_TYPE_FRAGMENT, or VI_MODULE_TYPE_COMPUTE
-	uint32_t glpc_count;    // number of GLPushConstant entries before payload
+	uint32_t backend_mask;  // VI_BINARY_BACKEND_BIT of each backend with a section in this binary
+	uint32_t spirv_offset;  // byte offset of SPIRV section
+	uint32_t spirv_size;    // byte size of SPIRV section
+	uint32_t glpc_offset;   // byte offset of GLPushConstant entries
+	uint32_t glpc_count;    // number of GLPushConstant entries
+	uint32_t glsl_offset;   // byte offset of patched GLSL, not null terminated
+	uint32_t glsl_size;     // byte size of patched GLSL
+};
+
+static_assert(sizeof(VIBinaryHeader) == 56);
+
+struct VIArchiveHeader
+{
+	uint32_t magic;         // VI_ARCHIVE_MAGIC
+	uint32_t version;       // VI_ARCHIVE_VERSION
+	uint32_t entry_count;   // number of VIArchiveEntry in the index following the header
+	uint32_t archive_size;  // byte size of the whole archive
+};
+
+static_assert(sizeof(VIArchiveHeader) == 16);
+
+struct VIArchiveEntry
+{
+	uint32_t name_offset;   // byte offset from archive start to entry name, not null terminated
+	uint32_t name_size;     // byte size of entry name
+	uint32_t backend_mask;  // copied from VIBinaryHeader
+	uint32_t module_type;   // copied from VIBinaryHeader
+	uint32_t binary_offset; // byte offset from archive start to vise binary, 4 byte aligned
+	uint32_t binary_size;   // byte size of vise binary
 };
 
-static_assert(sizeof(VIBinaryHeader) == 20);
+static_assert(sizeof(VIArchiveEntry) == 24);
+
+// the archive file is memory mapped read-only, vise binaries are
+// handed to module creation in place without copying
+struct VIShaderArchiveObj
+{
+	const uint8_t* data;
+	size_t size;
+	std::vector<VIArchiveEntry> entries;
+
+#ifdef VI_PLATFORM_WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
 
 enum GLCommandType
 {
@@ -536,6 +874,7 @@ enum GLCommandType
 	GL_COMMAND_TYPE_DRAW_INDEXED,
 	GL_COMMAND_TYPE_PUSH_CONSTANTS,
 	GL_COMMAND_TYPE_BIND_SET,
+	GL_COMMAND_TYPE_PUSH_SET,
 	GL_COMMAND_TYPE_BIND_PIPELINE,
 	GL_COMMAND_TYPE_BIND_COMPUTE_PIPELINE,
 	GL_COMMAND_TYPE_BIND_VERTEX_BUFFERS,
@@ -548,6 +887,14 @@ enum GLCommandType
 	GL_COMMAND_TYPE_COPY_IMAGE,
 	GL_COMMAND_TYPE_COPY_IMAGE_TO_BUFFER,
 	GL_COMMAND_TYPE_DISPATCH,
+	GL_COMMAND_TYPE_GENERATE_MIPMAPS,
+	GL_COMMAND_TYPE_RESET_QUERIES,
+	GL_COMMAND_TYPE_WRITE_TIMESTAMP,
+	GL_COMMAND_TYPE_BEGIN_QUERY,
+	GL_COMMAND_TYPE_END_QUERY,
+	GL_COMMAND_TYPE_COPY_QUERY_RESULTS,
+	GL_COMMAND_TYPE_BEGIN_CONDITIONAL,
+	GL_COMMAND_TYPE_END_CONDITIONAL,
 	GL_COMMAND_TYPE_ENUM_COUNT,
 };
 
@@ -580,6 +927,14 @@ struct GLCommandBindSet
 	VISet set;
 	uint32_t set_index;
 	VIPipelineLayout pipeline_layout;
+	std::vector<uint32_t> dynamic_offsets;
+};
+
+struct GLCommandPushSet
+{
+	uint32_t set_index;
+	VIPipelineLayout pipeline_layout;
+	std::vector<VISetUpdateInfo> updates;
 };
 
 struct GLCommandBindVertexBuffers
@@ -638,6 +993,34 @@ struct GLCommandDispatch
 	GLuint group_count_z;
 };
 
+struct GLCommandResetQueries
+{
+	VIQueryPool pool;
+	uint32_t first_query;
+	uint32_t query_count;
+};
+
+struct GLCommandQuery
+{
+	VIQueryPool pool;
+	uint32_t query;
+};
+
+struct GLCommandCopyQueryResults
+{
+	VIQueryPool pool;
+	uint32_t first_query;
+	uint32_t query_count;
+	VIBuffer buffer;
+	uint32_t offset;
+};
+
+struct GLCommandBeginConditional
+{
+	VIBuffer buffer;
+	uint32_t offset;
+};
+
 // We can only store VIObject handles when recording GLCommands
 // values such as VkClearValues must be copied and preserved until GLCommand execution
 struct GLCommand
@@ -653,6 +1036,7 @@ struct GLCommand
 		VIDrawIndexedInfo draw_indexed;
 		GLCommandPushConstants push_constants;
 		GLCommandBindSet bind_set;
+		GLCommandPushSet push_set;
 		VIPipeline bind_pipeline;
 		VIComputePipeline bind_compute_pipeline;
 		GLCommandBindVertexBuffers bind_vertex_buffers;
@@ -664,6 +1048,13 @@ struct GLCommand
 		GLCommandCopyImage copy_image;
 		GLCommandCopyImageToBuffer copy_image_to_buffer;
 		GLCommandDispatch dispatch;
+		VIImage generate_mipmaps;
+		GLCommandResetQueries reset_queries;
+		GLCommandQuery write_timestamp;
+		GLCommandQuery begin_query;
+		GLCommandQuery end_query;
+		GLCommandCopyQueryResults copy_query_results;
+		GLCommandBeginConditional begin_conditional;
 	};
 };
 
@@ -679,12 +1070,22 @@ struct VIDeviceObj
 	VIQueueObj queue_graphics;
 	VIQueueObj queue_transfer;
 	VIQueueObj queue_present;
-	VIPass swapchain_pass;
-	VIFramebuffer swapchain_framebuffers;
+	VIPass swapchain_pass;                // VI_NULL on headless devices
+	VIFramebuffer swapchain_framebuffers; // VI_NULL on headless devices
+	bool headless;     // also set for compute-only devices
+	bool compute_only;
+	bool deferred_destruction; // Vulkan only, see VIDeviceInfo
 	VIDeviceLimits limits;
-
-	// NOTE: currently the vise device encapsulates the whole backend context,
-	//       and only one device may be created.
+	uint64_t frame_count = 0; // number of vi_device_next_frame calls
+	VIFrameCounters frame_counters{};      // submitted since the last vi_device_next_frame
+	VIFrameCounters last_frame_counters{}; // see vi_device_get_frame_counters
+	std::mutex frame_counters_mutex;       // queues may be submitted to from different threads
+	std::vector<VISampler> samplers; // sampler cache, see vi_create_sampler
+	std::atomic<size_t> host_malloc_usage = 0; // see vi_device_malloc
+	std::atomic<size_t> host_malloc_peak = 0;
+
+	// NOTE: the vise device encapsulates a whole backend context, Vulkan instance
+	//       or OpenGL context, so devices are fully independent of each other.
 	union
 	{
 		VIVulkan vk;
@@ -695,31 +1096,90 @@ struct VIDeviceObj
 struct HostMalloc
 {
 	size_t size;
+	VIDevice device; // owner of a vi_device_malloc allocation, null otherwise
+};
+
+#ifdef VI_ENABLE_TRACE
+static uint64_t trace_now();
+static void trace_write(const char* name, uint64_t begin, uint64_t end);
+
+struct VITraceEvent
+{
+	const char* name;
+	uint64_t begin; // nanoseconds since trace_epoch
+	uint64_t end;
+};
+
+// written only by the owning thread, vi_trace_dump copies events concurrently
+// and drops those that may have been overwritten during the copy
+struct VITraceRing
+{
+	std::atomic<uint64_t> head;             // number of events ever written
+	uint32_t tid;
+	uint32_t depth;                         // open vi_trace_begin scopes
+	VITraceEvent open[VI_TRACE_MAX_DEPTH];
+	VITraceEvent events[VI_TRACE_RING_CAPACITY];
+};
+
+// rings outlive their threads so events of finished worker threads are still dumped,
+// the ring of an exited thread is handed to the next thread that records an event
+struct VITraceThread
+{
+	VITraceThread();
+	~VITraceThread();
+
+	VITraceRing* ring;
+};
+
+struct VITraceScope
+{
+	VITraceScope(const char* name) : name(name), begin(trace_now()) {}
+	~VITraceScope() { trace_write(name, begin, trace_now()); }
+
+	const char* name;
+	uint64_t begin;
 };
+#endif
 
-static void vk_create_instance(VIVulkan* vk, bool enable_validation);
+static void vk_create_instance(VIVulkan* vk, bool enable_validation, bool headless);
 static void vk_destroy_instance(VIVulkan* vk);
-static void vk_create_surface(VIVulkan* vk);
+static void vk_create_surface(VIVulkan* vk, void* window);
 static void vk_destroy_surface(VIVulkan* vk);
 static void vk_create_device(VIVulkan* vk, VIDevice device, const VIDeviceInfo* info);
 static void vk_destroy_device(VIVulkan* vk);
-static void vk_create_swapchain(VIVulkan* vk, const VISwapchainInfo* info, uint32_t min_image_count);
-static void vk_destroy_swapchain(VIVulkan* vk);
+static void vk_create_swapchain(VIVulkan* vk, const VISwapchainInfo* info, uint32_t min_image_count, VkSwapchainKHR old_swapchain);
+static void vk_retire_swapchain(VIVulkan* vk);
+static void vk_destroy_retired_swapchain(VIVulkan* vk, VIRetiredSwapchain* retired);
+static void vk_release_retired_swapchains(VIVulkan* vk);
 static void vk_recreate_swapchain(VIVulkan* vk);
+static bool vk_defer_destroy(VIDevice device, VIGarbageType type, void* object);
+static void vk_release_garbage(VIDevice device, uint64_t completed_frame_count);
+static void vk_create_frame_sync(VIVulkan* vk);
+static void vk_destroy_frame_sync(VIVulkan* vk);
 static void vk_create_swapchain_framebuffer(VIVulkan* vk);
-static void vk_destroy_swapchain_framebuffer(VIVulkan* vk);
 static void vk_create_buffer(VIVulkan* vk, VIBuffer buffer, const VkBufferCreateInfo* info, const VkMemoryPropertyFlags& properties);
 static void vk_destroy_buffer(VIVulkan* vk, VIBuffer buffer);
 static void vk_create_image(VIVulkan* vk, VIImage image, const VkImageCreateInfo* info, const VkMemoryPropertyFlags& properties);
 static void vk_destroy_image(VIVulkan* vk, VIImage image);
 static void vk_create_image_view(VIVulkan* vk, VIImage image, const VkImageViewCreateInfo* info);
+static VkImageView vk_image_sampled_view(VIImage image);
+static void vk_create_set_pool(VIVulkan* vk, VISetPool pool, VISetPoolFrame* frame);
+static void vk_alloc_set(VIVulkan* vk, VISetPool pool, VISetPoolFrame* frame, VISet set);
+static bool vk_release_free_sets(VIVulkan* vk, VISetPool pool);
+static void vk_set_update_writes(VISetLayout layout, VkDescriptorSet dst_set, uint32_t update_count, const VISetUpdateInfo* updates,
+	std::vector<VkWriteDescriptorSet>& writes, std::vector<VkDescriptorBufferInfo>& write_buffers, std::vector<VkDescriptorImageInfo>& write_images);
 static void vk_destroy_image_view(VIVulkan* vk, VIImage image);
-static void vk_create_sampler(VIVulkan* vk, VIImage, const VkSamplerCreateInfo* info);
-static void vk_destroy_sampler(VIVulkan* vk, VIImage);
+static void vk_cmd_push_set(VICommand cmd, VkPipelineBindPoint bind_point, VIPipelineLayout layout, uint32_t set_idx, uint32_t update_count, const VISetUpdateInfo* updates);
+static void vk_create_sampler(VIVulkan* vk, VISampler sampler);
+static void vk_destroy_sampler(VIVulkan* vk, VISampler sampler);
 static void vk_create_framebuffer(VIVulkan* vk, VIFramebuffer fb, VIPass pass, VkExtent2D extent, uint32_t atch_count, VIImage* atchs);
 static void vk_destroy_framebuffer(VIVulkan* vk, VIFramebuffer fb);
 static void vk_alloc_cmd_buffer(VIVulkan* vk, VICommand cmd, VkCommandPool pool, VkCommandBufferLevel level);
 static void vk_free_cmd_buffer(VIVulkan* vk, VICommand cmd);
+static VkBuffer vk_cmd_write_scratch(VICommand cmd, const void* data, uint32_t size, VkDeviceSize* offset);
+static void vk_free_cmd_scratch(VICommand cmd);
+static VkPipelineStageFlags vk_conditional_stages(const VIVulkan* vk, VkPipelineStageFlags stages);
+static VkAccessFlags vk_conditional_access(const VIVulkan* vk, VkAccessFlags access);
 static bool vk_has_format_features(VIVulkan* vk, VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features);
 static uint32_t vk_get_memory_type_index(const VIPhysicalDevice* pdevice, uint32_t type_bits, VkMemoryPropertyFlags properties);
 static void vk_default_configure_swapchain(const VIPhysicalDevice* device, void* window, VISwapchainInfo* out_info);
@@ -731,28 +1191,38 @@ static void vk_default_destroy_image(VIImage image);
 static void gl_device_present_frame(VIDevice device);
 static void gl_device_append_submission(VIDevice device, const VISubmitInfo* submit);
 static int gl_device_flush_submission(VIDevice device);
-static void gl_create_module(VIDevice device, VIModule module, const VIModuleInfo* info);
+static bool gl_create_module(VIDevice device, VIModule module, const VIModuleInfo* info);
 static void gl_destroy_module(VIDevice device, VIModule module);
+static GLuint gl_compile_shader(GLenum glstage, GLsizei count, const char** strings, const GLint* sizes);
+static GLuint gl_module_variant(VIModule module, const VISpecializationInfo* info);
 static void gl_create_pipeline_layout(VIDevice device, VIPipelineLayout layout, const VIPipelineLayoutInfo* info);
 static void gl_remap(std::vector<GLRemap>& remaps, uint32_t set_count, uint32_t* binding_counts, const VIBinding** bindings);
 static void gl_destroy_pipeline_layout(VIDevice device, VIPipelineLayout layout);
-static void gl_create_pipeline(VIDevice device, VIPipeline pipeline, uint32_t module_count, VIModule* modules);
+static void gl_create_pipeline(VIDevice device, VIPipeline pipeline, uint32_t module_count, VIModule* modules, const VISpecializationInfo* specialization);
 static void gl_destroy_pipeline(VIDevice device, VIPipeline pipeline);
-static void gl_create_compute_pipeline(VIDevice device, VIComputePipeline pipeline, VIModule compute_module);
+static void gl_create_compute_pipeline(VIDevice device, VIComputePipeline pipeline, VIModule compute_module, const VISpecializationInfo* specialization);
 static void gl_destroy_compute_pipeline(VIDevice device, VIComputePipeline pipeline);
 static void gl_create_buffer(VIDevice device, VIBuffer buffer, const VIBufferInfo* info);
 static void gl_destroy_buffer(VIDevice device, VIBuffer buffer);
 static void gl_create_image(VIOpenGL* gl, VIImage image, const VIImageInfo* info);
 static void gl_destroy_image(VIOpenGL* gl, VIImage image);
+static void gl_create_sampler(VIOpenGL* gl, VISampler sampler);
+static void gl_destroy_sampler(VIOpenGL* gl, VISampler sampler);
 static void gl_create_framebuffer(VIOpenGL* gl, VIFramebuffer fb, const VIFramebufferInfo* info);
 static void gl_destroy_framebuffer(VIOpenGL* gl, VIFramebuffer fb);
 static void gl_create_swapchain_framebuffer(VIOpenGL* gl, VIFramebuffer fb);
+#ifdef VI_PLATFORM_LINUX
+static void gl_create_headless_context(VIOpenGL* gl);
+static void gl_destroy_headless_context(VIOpenGL* gl);
+#endif
+static void gl_create_hidden_context(VIOpenGL* gl);
 static void gl_create_swapchain_pass(VIOpenGL* gl, VIPass pass);
 static void gl_alloc_cmd_buffer(VIDevice device, VICommand cmd);
 static void gl_free_command(VIDevice device, VICommand cmd);
 static void gl_alloc_set(VIDevice device, VISet set);
 static void gl_free_set(VIDevice device, VISet set);
 static void gl_set_update(VISet set, uint32_t update_count, const VISetUpdateInfo* updates);
+static void gl_set_update_batch(uint32_t set_count, const VISet* sets, const VISetResource* resources);
 static void gl_pipeline_layout_get_remapped_binding(VIPipelineLayout layout, uint32_t set_index, uint32_t binding_idx, uint32_t* remapped_binding);
 static void gl_copy_buffer(VIBuffer src, VIBuffer dst, uint32_t src_offset, uint32_t dst_offset, uint32_t size);
 static void gl_copy_buffer_to_image(VIBuffer buffer, VIImage image, uint32_t buffer_offset, const VkOffset3D& image_offset, const VkExtent3D& image_extent,
@@ -762,7 +1232,10 @@ static void gl_copy_image(VIImage src, VIImage dst, const VkOffset3D& src_offset
 static void gl_copy_image_to_buffer(VIImage image, VIBuffer buffer, uint32_t buffer_offset, const VkOffset3D& image_offset, const VkExtent3D& image_extent,
 	const VkImageSubresourceLayers& image_subresource);
 static GLCommand* gl_append_command(VICommand cmd, GLCommandType type);
+static void gl_cmd_push_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_idx, uint32_t update_count, const VISetUpdateInfo* updates);
+static void gl_bind_resource(VIBindingType type, uint32_t binding_point, void* resource, VISampler sampler, uint32_t buffer_offset, uint32_t buffer_range);
 static void gl_reset_command(VIDevice device, VICommand cmd);
+static void gl_bind_conditional_draw(VIDevice device, const void* args, GLsizeiptr size);
 static void gl_cmd_execute(VIDevice device, VICommand cmd);
 static void gl_cmd_execute_opengl_callback(VIDevice device, GLCommand* glcmd);
 static void gl_cmd_execute_set_viewport(VIDevice device, GLCommand* glcmd);
@@ -771,6 +1244,7 @@ static void gl_cmd_execute_draw(VIDevice device, GLCommand* glcmd);
 static void gl_cmd_execute_draw_indexed(VIDevice device, GLCommand* glcmd);
 static void gl_cmd_execute_push_constants(VIDevice device, GLCommand* glcmd);
 static void gl_cmd_execute_bind_set(VIDevice device, GLCommand* glcmd);
+static void gl_cmd_execute_push_set(VIDevice device, GLCommand* glcmd);
 static void gl_cmd_execute_bind_pipeline(VIDevice device, GLCommand* glcmd);
 static void gl_cmd_execute_bind_compute_pipeline(VIDevice device, GLCommand* glcmd);
 static void gl_cmd_execute_bind_vertex_buffers(VIDevice device, GLCommand* glcmd);
@@ -783,10 +1257,28 @@ static void gl_cmd_execute_copy_buffer_to_image(VIDevice device, GLCommand* glcm
 static void gl_cmd_execute_copy_image(VIDevice device, GLCommand* glcmd);
 static void gl_cmd_execute_copy_image_to_buffer(VIDevice device, GLCommand* glcmd);
 static void gl_cmd_execute_dispatch(VIDevice device, GLCommand* glcmd);
-
-static void compile_vk(VICompileResult& result, EShLanguage stage, const char* vise_glsl);
-static void compile_gl(VICompileResult& result, EShLanguage stage, const char* vise_glsl, uint32_t remap_count, const GLRemap* remaps);
+static void gl_cmd_execute_generate_mipmaps(VIDevice device, GLCommand* glcmd);
+static void gl_cmd_execute_reset_queries(VIDevice device, GLCommand* glcmd);
+static void gl_cmd_execute_write_timestamp(VIDevice device, GLCommand* glcmd);
+static void gl_cmd_execute_begin_query(VIDevice device, GLCommand* glcmd);
+static void gl_cmd_execute_end_query(VIDevice device, GLCommand* glcmd);
+static void gl_cmd_execute_copy_query_results(VIDevice device, GLCommand* glcmd);
+static void gl_cmd_execute_begin_conditional(VIDevice device, GLCommand* glcmd);
+static void gl_cmd_execute_end_conditional(VIDevice device, GLCommand* glcmd);
+
+static bool preprocess_glsl(EShLanguage stage, const char* vise_glsl, const VIIncludeResolver* resolver, std::vector<std::string>* dependencies, std::string* out_glsl, std::string* out_error);
+static void compile_vk(VICompileResult& result, EShLanguage stage, const char* vise_glsl, const VIIncludeResolver* resolver);
+static void compile_gl(VICompileResult& result, EShLanguage stage, const char* vise_glsl, const VIIncludeResolver* resolver, uint32_t remap_count, const GLRemap* remaps);
+static void compile_gl_spirv(VICompileResult& result, EShLanguage stage, uint32_t remap_count, const GLRemap* remaps);
+static void get_pipeline_layout_data(VIPipelineLayout layout, std::vector<VISetLayoutInfo>& set_layouts, std::vector<VIBinding>& set_bindings, VIPipelineLayoutData* out_data);
+static std::string get_permutation_source(const char* vise_glsl, uint32_t keyword_count, const std::string* keywords, uint64_t key);
+static VISetPoolFrame* get_set_pool_frame(VIDevice device, VISetPool pool);
+static bool check_module_binary(VIBackend backend, const VIModuleInfo* info, VIBinaryHeader* out_header);
+static char* compile_binary(VICompileResult& result, uint32_t backend_mask, VIModuleType type, const VIPipelineLayoutData* layout_data, const char* vise_glsl, const VIIncludeResolver* resolver, uint32_t* out_binary_size);
+static char* join_dependencies(const std::vector<std::string>& dependencies);
 static void flip_image_data(uint8_t* data, uint32_t image_width, uint32_t image_height, uint32_t texel_size);
+static void add_frame_counters(VIFrameCounters* dst, const VIFrameCounters& src);
+static void idle_transient_sets(VIDevice device);
 
 static void debug_print_compilation(const spirv_cross::CompilerGLSL& compiler, EShLanguage stage);
 
@@ -796,6 +1288,8 @@ static void cast_module_type_vk(VIModuleType in_type, VkShaderStageFlags* out_st
 static void cast_module_type_glslang(VIModuleType in_type, EShLanguage* out_type);
 static void cast_module_type_gl(VIModuleType in_type, GLenum* out_type);
 static void cast_index_type(VkIndexType in_type, GLenum* out_type, size_t* out_size);
+static void cast_query_type_vk(VIQueryType in_type, VkQueryType* out_type);
+static void cast_query_type_gl(VIQueryType in_type, GLenum* out_target);
 static void cast_buffer_usages(VIBufferType in_type, VIBufferUsageFlags in_usages, VkBufferUsageFlags* out_usages);
 static void cast_buffer_type(VIBufferType in_type, GLenum* out_type);
 static void cast_image_usages(VIImageUsageFlags in_usages, VkImageUsageFlags* out_usages);
@@ -822,6 +1316,8 @@ static void cast_format_vk(VIFormat in_format, VkFormat* out_format, VkImageAspe
 static void cast_format_vk(VkFormat in_format, VIFormat* out_format);
 static void cast_format_gl(VIFormat in_format, GLenum* out_internal_format, GLenum* out_data_format, GLenum* out_data_type, uint32_t* out_texel_size);
 static void cast_format_attachment_gl(VIFormat in_format, GLenum* out_attachment);
+static bool is_format_compressed(VIFormat format);
+static inline bool is_binding_type_dynamic(VIBindingType type);
 static void cast_set_pool_resources(uint32_t in_res_count, const VISetPoolResource* in_res, std::vector<VkDescriptorPoolSize>& out_sizes);
 static void cast_binding(const VIBinding* in_binding, VkDescriptorSetLayoutBinding* out_binding);
 static void cast_binding_type(VIBindingType in_type, VkDescriptorType* out_type);
@@ -830,6 +1326,7 @@ static void cast_glsl_type_gl(VIGLSLType in_type, GLint* out_component_count, GL
 static void cast_glsl_type_spirv(const spirv_cross::SPIRType& in_type, VIGLSLType* out_type);
 static void cast_pipeline_vertex_input(uint32_t attr_count, VIVertexAttribute* attrs, uint32_t binding_count, VIVertexBinding* bindings,
 	std::vector<VkVertexInputAttributeDescription>& out_attrs, std::vector<VkVertexInputBindingDescription>& out_bindings);
+static void cast_specialization_info_vk(const VISpecializationInfo& in_info, std::vector<VkSpecializationMapEntry>* out_entries, VkSpecializationInfo* out_info);
 static void cast_memory_barrier(const VIMemoryBarrier& in_barrier, VkMemoryBarrier* out_barrier);
 static void cast_image_memory_barrier(const VIImageMemoryBarrier& in_barrier, VkImageMemoryBarrier* out_barrier);
 static void cast_buffer_memory_barrier(const VIBufferMemoryBarrier& in_barrier, VkBufferMemoryBarrier* out_barrier);
@@ -839,9 +1336,12 @@ static void cast_subpass_info(const VIPassInfo& in_pass_info, const VISubpassInf
 static void cast_pass_color_attachment(const VIPassColorAttachment& in_atch, VkAttachmentDescription* out_atch);
 static void cast_pass_depth_stencil_attachment(const VIPassDepthStencilAttachment& in_atch, VkAttachmentDescription* out_atch);
 
-static bool has_glslang_initialized;
-static size_t host_malloc_usage;
-static size_t host_malloc_peak;
+static std::once_flag glslang_init_flag;
+static std::once_flag glad_load_flag;
+static GLADloadproc glad_load_proc; // loader of the process-wide GLAD entry points
+static int glad_load_result;
+static std::atomic<size_t> host_malloc_usage;
+static std::atomic<size_t> host_malloc_peak;
 
 static void (*gl_cmd_execute_table[GL_COMMAND_TYPE_ENUM_COUNT])(VIDevice, GLCommand*) = {
 	gl_cmd_execute_opengl_callback,
@@ -851,6 +1351,7 @@ static void (*gl_cmd_execute_table[GL_COMMAND_TYPE_ENUM_COUNT])(VIDevice, GLComm
 	gl_cmd_execute_draw_indexed,
 	gl_cmd_execute_push_constants,
 	gl_cmd_execute_bind_set,
+	gl_cmd_execute_push_set,
 	gl_cmd_execute_bind_pipeline,
 	gl_cmd_execute_bind_compute_pipeline,
 	gl_cmd_execute_bind_vertex_buffers,
@@ -863,12 +1364,49 @@ static void (*gl_cmd_execute_table[GL_COMMAND_TYPE_ENUM_COUNT])(VIDevice, GLComm
 	gl_cmd_execute_copy_image,
 	gl_cmd_execute_copy_image_to_buffer,
 	gl_cmd_execute_dispatch,
+	gl_cmd_execute_generate_mipmaps,
+	gl_cmd_execute_reset_queries,
+	gl_cmd_execute_write_timestamp,
+	gl_cmd_execute_begin_query,
+	gl_cmd_execute_end_query,
+	gl_cmd_execute_copy_query_results,
+	gl_cmd_execute_begin_conditional,
+	gl_cmd_execute_end_conditional,
 };
 
-struct VIProcTable
-{
-	PFN_vkCmdSetFrontFaceEXT vkCmdSetFrontFaceEXT;
-} vi_proc;
+#ifdef VI_ENABLE_TRACE
+// trace scope names of GLCommandType, in the same order
+static const char* gl_command_type_names[GL_COMMAND_TYPE_ENUM_COUNT] = {
+	"gl_cmd_execute_opengl_callback",
+	"gl_cmd_execute_set_viewport",
+	"gl_cmd_execute_set_scissor",
+	"gl_cmd_execute_draw",
+	"gl_cmd_execute_draw_indexed",
+	"gl_cmd_execute_push_constants",
+	"gl_cmd_execute_bind_set",
+	"gl_cmd_execute_push_set",
+	"gl_cmd_execute_bind_pipeline",
+	"gl_cmd_execute_bind_compute_pipeline",
+	"gl_cmd_execute_bind_vertex_buffers",
+	"gl_cmd_execute_bind_index_buffer",
+	"gl_cmd_execute_begin_pass",
+	"gl_cmd_execute_end_pass",
+	"gl_cmd_execute_execute_commands",
+	"gl_cmd_execute_copy_buffer",
+	"gl_cmd_execute_copy_buffer_to_image",
+	"gl_cmd_execute_copy_image",
+	"gl_cmd_execute_copy_image_to_buffer",
+	"gl_cmd_execute_dispatch",
+	"gl_cmd_execute_generate_mipmaps",
+	"gl_cmd_execute_reset_queries",
+	"gl_cmd_execute_write_timestamp",
+	"gl_cmd_execute_begin_query",
+	"gl_cmd_execute_end_query",
+	"gl_cmd_execute_copy_query_results",
+	"gl_cmd_execute_begin_conditional",
+	"gl_cmd_execute_end_conditional",
+};
+#endif
 
 struct VIModuleTypeEntry
 {
@@ -884,6 +1422,24 @@ static const VIModuleTypeEntry vi_module_type_table[3] = {
 	{ VI_MODULE_TYPE_COMPUTE,  VK_SHADER_STAGE_COMPUTE_BIT,  EShLangCompute,  GL_COMPUTE_SHADER },
 };
 
+struct VIPipelineStatisticEntry
+{
+	VIPipelineStatisticBit vi_bit;
+	VkQueryPipelineStatisticFlagBits vk_bit;
+	GLenum gl_target;
+};
+
+// ascending bit order, matching the result order of both backends
+static const VIPipelineStatisticEntry vi_pipeline_statistic_table[7] = {
+	{ VI_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT,     VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT,                GL_VERTICES_SUBMITTED },
+	{ VI_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT,   VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT,              GL_PRIMITIVES_SUBMITTED },
+	{ VI_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT,   VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT,              GL_VERTEX_SHADER_INVOCATIONS },
+	{ VI_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT,        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT,                   GL_CLIPPING_INPUT_PRIMITIVES },
+	{ VI_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT,         VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT,                    GL_CLIPPING_OUTPUT_PRIMITIVES },
+	{ VI_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT, VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT,            GL_FRAGMENT_SHADER_INVOCATIONS },
+	{ VI_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT,  VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT,             GL_COMPUTE_SHADER_INVOCATIONS },
+};
+
 struct VIGLSLTypeEntry
 {
 	VIGLSLType glsl_type;
@@ -1064,33 +1620,47 @@ enum VIImageAspectFlags : VkImageAspectFlags
 	VI_IMAGE_ASPECT_DEPTH_STENCIL = (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT),
 };
 
+// S3TC enums are not part of core OpenGL, EXT_texture_compression_s3tc is available on all desktop drivers
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 struct VIFormatEntry
 {
 	VIFormat vi_format;
 	VkImageAspectFlags vk_aspect;
 	VkFormat vk_format;
 	uint32_t texel_block_size;
+	uint32_t texel_block_extent; // 1 for uncompressed formats, 4 for BC formats
 	GLenum gl_internal_format;
 	GLenum gl_data_format;
 	GLenum gl_data_type;
 };
 
 static const VIFormatEntry vi_format_table[] = {
-	{ VI_FORMAT_UNDEFINED, (VIImageAspectFlags)0,        VK_FORMAT_UNDEFINED,           0,  GL_NONE,               GL_NONE,            GL_NONE },
-	{ VI_FORMAT_R8,       VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R8_UNORM,            1,  GL_R8,                 GL_RED,             GL_UNSIGNED_BYTE },
-	{ VI_FORMAT_RG8,      VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R8G8_UNORM,          2,  GL_RG8,                GL_RG,              GL_UNSIGNED_BYTE },
-	{ VI_FORMAT_RGB8,     VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R8G8B8_UNORM,        3,  GL_RGB8,               GL_RGB,             GL_UNSIGNED_BYTE },
-	{ VI_FORMAT_RGBA8,    VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R8G8B8A8_UNORM,      4,  GL_RGBA8,              GL_RGBA,            GL_UNSIGNED_BYTE },
-	{ VI_FORMAT_BGRA8,    VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_B8G8R8A8_UNORM,      4,  GL_RGBA8,              GL_BGRA,            GL_UNSIGNED_BYTE },
-	{ VI_FORMAT_R16F,     VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R16_SFLOAT,          2,  GL_R16F,               GL_RED,             GL_HALF_FLOAT },
-	{ VI_FORMAT_RG16F,    VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R16G16_SFLOAT,       4,  GL_RG16F,              GL_RG,              GL_HALF_FLOAT },
-	{ VI_FORMAT_RGB16F,   VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R16G16B16_SFLOAT,    6,  GL_RGB16F,             GL_RGB,             GL_HALF_FLOAT },
-	{ VI_FORMAT_RGBA16F,  VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R16G16B16A16_SFLOAT, 8,  GL_RGBA16F,            GL_RGBA,            GL_HALF_FLOAT },
-	{ VI_FORMAT_RGB32F,   VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R32G32B32_SFLOAT,    12, GL_RGB32F,             GL_RGB,             GL_FLOAT },
-	{ VI_FORMAT_RGBA32F,  VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R32G32B32A32_SFLOAT, 16, GL_RGBA32F,            GL_RGBA,            GL_FLOAT },
-	{ VI_FORMAT_D32F_S8U, VI_IMAGE_ASPECT_DEPTH_STENCIL, VK_FORMAT_D32_SFLOAT_S8_UINT,  5,  GL_DEPTH32F_STENCIL8,  GL_DEPTH_STENCIL,   GL_FLOAT_32_UNSIGNED_INT_24_8_REV },
-	{ VI_FORMAT_D24_S8U,  VI_IMAGE_ASPECT_DEPTH_STENCIL, VK_FORMAT_D24_UNORM_S8_UINT,   4,  GL_DEPTH24_STENCIL8,   GL_DEPTH_STENCIL,   GL_UNSIGNED_INT_24_8, },
-	{ VI_FORMAT_D32F,     VI_IMAGE_ASPECT_DEPTH,         VK_FORMAT_D32_SFLOAT,          4,  GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT },
+	{ VI_FORMAT_UNDEFINED, (VIImageAspectFlags)0,        VK_FORMAT_UNDEFINED,           0,  1, GL_NONE,               GL_NONE,            GL_NONE },
+	{ VI_FORMAT_R8,       VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R8_UNORM,            1,  1, GL_R8,                 GL_RED,             GL_UNSIGNED_BYTE },
+	{ VI_FORMAT_RG8,      VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R8G8_UNORM,          2,  1, GL_RG8,                GL_RG,              GL_UNSIGNED_BYTE },
+	{ VI_FORMAT_RGB8,     VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R8G8B8_UNORM,        3,  1, GL_RGB8,               GL_RGB,             GL_UNSIGNED_BYTE },
+	{ VI_FORMAT_RGBA8,    VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R8G8B8A8_UNORM,      4,  1, GL_RGBA8,              GL_RGBA,            GL_UNSIGNED_BYTE },
+	{ VI_FORMAT_BGRA8,    VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_B8G8R8A8_UNORM,      4,  1, GL_RGBA8,              GL_BGRA,            GL_UNSIGNED_BYTE },
+	{ VI_FORMAT_R16F,     VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R16_SFLOAT,          2,  1, GL_R16F,               GL_RED,             GL_HALF_FLOAT },
+	{ VI_FORMAT_RG16F,    VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R16G16_SFLOAT,       4,  1, GL_RG16F,              GL_RG,              GL_HALF_FLOAT },
+	{ VI_FORMAT_RGB16F,   VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R16G16B16_SFLOAT,    6,  1, GL_RGB16F,             GL_RGB,             GL_HALF_FLOAT },
+	{ VI_FORMAT_RGBA16F,  VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R16G16B16A16_SFLOAT, 8,  1, GL_RGBA16F,            GL_RGBA,            GL_HALF_FLOAT },
+	{ VI_FORMAT_RGB32F,   VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R32G32B32_SFLOAT,    12, 1, GL_RGB32F,             GL_RGB,             GL_FLOAT },
+	{ VI_FORMAT_RGBA32F,  VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_R32G32B32A32_SFLOAT, 16, 1, GL_RGBA32F,            GL_RGBA,            GL_FLOAT },
+	{ VI_FORMAT_D32F_S8U, VI_IMAGE_ASPECT_DEPTH_STENCIL, VK_FORMAT_D32_SFLOAT_S8_UINT,  5,  1, GL_DEPTH32F_STENCIL8,  GL_DEPTH_STENCIL,   GL_FLOAT_32_UNSIGNED_INT_24_8_REV },
+	{ VI_FORMAT_D24_S8U,  VI_IMAGE_ASPECT_DEPTH_STENCIL, VK_FORMAT_D24_UNORM_S8_UINT,   4,  1, GL_DEPTH24_STENCIL8,   GL_DEPTH_STENCIL,   GL_UNSIGNED_INT_24_8, },
+	{ VI_FORMAT_D32F,     VI_IMAGE_ASPECT_DEPTH,         VK_FORMAT_D32_SFLOAT,          4,  1, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT },
+	{ VI_FORMAT_BC1_RGBA, VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 8,  4, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_NONE, GL_NONE },
+	{ VI_FORMAT_BC3_RGBA, VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_BC3_UNORM_BLOCK,     16, 4, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_NONE, GL_NONE },
+	{ VI_FORMAT_BC4_R,    VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_BC4_UNORM_BLOCK,     8,  4, GL_COMPRESSED_RED_RGTC1,          GL_NONE, GL_NONE },
+	{ VI_FORMAT_BC5_RG,   VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_BC5_UNORM_BLOCK,     16, 4, GL_COMPRESSED_RG_RGTC2,           GL_NONE, GL_NONE },
+	{ VI_FORMAT_BC7_RGBA, VI_IMAGE_ASPECT_COLOR,         VK_FORMAT_BC7_UNORM_BLOCK,     16, 4, GL_COMPRESSED_RGBA_BPTC_UNORM,    GL_NONE, GL_NONE },
 };
 
 static inline void swrite32(uint8_t** mem, uint32_t value)
@@ -1111,11 +1681,20 @@ static inline void swrite_bytes(uint8_t** mem, size_t byte_size, const void* byt
 
 static inline void swrite_header(uint8_t** mem, const VIBinaryHeader& header)
 {
-	swrite32(mem, (uint32_t)header.payload_size);
-	swrite32(mem, (uint32_t)header.header_size);
-	swrite32(mem, (uint32_t)header.backend_type);
-	swrite32(mem, (uint32_t)header.module_type);
-	swrite32(mem, (uint32_t)header.glpc_count);
+	swrite32(mem, header.magic);
+	swrite32(mem, header.version);
+	swrite32(mem, header.binary_size);
+	swrite32(mem, header.checksum);
+	swrite32(mem, header.source_hash);
+	swrite32(mem, header.layout_hash);
+	swrite32(mem, header.module_type);
+	swrite32(mem, header.backend_mask);
+	swrite32(mem, header.spirv_offset);
+	swrite32(mem, header.spirv_size);
+	swrite32(mem, header.glpc_offset);
+	swrite32(mem, header.glpc_count);
+	swrite32(mem, header.glsl_offset);
+	swrite32(mem, header.glsl_size);
 }
 
 static inline void swrite_glpc(uint8_t** mem, const GLPushConstant& pc)
@@ -1150,11 +1729,125 @@ static inline void sread_bytes(uint8_t** mem, size_t size, void* dst)
 
 static void sread_header(uint8_t** mem, VIBinaryHeader* header)
 {
-	header->payload_size = sread32(mem);
-	header->header_size = sread32(mem);
-	header->backend_type = sread32(mem);
+	header->magic = sread32(mem);
+	header->version = sread32(mem);
+	header->binary_size = sread32(mem);
+	header->checksum = sread32(mem);
+	header->source_hash = sread32(mem);
+	header->layout_hash = sread32(mem);
 	header->module_type = sread32(mem);
+	header->backend_mask = sread32(mem);
+	header->spirv_offset = sread32(mem);
+	header->spirv_size = sread32(mem);
+	header->glpc_offset = sread32(mem);
 	header->glpc_count = sread32(mem);
+	header->glsl_offset = sread32(mem);
+	header->glsl_size = sread32(mem);
+}
+
+static inline uint32_t hash_fnv1a(uint32_t hash, const void* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * VI_FNV1A_PRIME;
+
+	return hash;
+}
+
+static uint32_t hash_pipeline_layout(const VIPipelineLayoutData& layout_data)
+{
+	uint32_t hash = hash_fnv1a(VI_FNV1A_OFFSET_BASIS, &layout_data.push_constant_size, sizeof(uint32_t));
+	hash = hash_fnv1a(hash, &layout_data.set_layout_count, sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < layout_data.set_layout_count; i++)
+	{
+		const VISetLayoutInfo& set_layout = layout_data.set_layouts[i];
+		hash = hash_fnv1a(hash, &set_layout.binding_count, sizeof(uint32_t));
+
+		for (uint32_t j = 0; j < set_layout.binding_count; j++)
+		{
+			uint32_t binding[3];
+			binding[0] = (uint32_t)set_layout.bindings[j].type;
+			binding[1] = set_layout.bindings[j].binding_index;
+			binding[2] = set_layout.bindings[j].array_count;
+			hash = hash_fnv1a(hash, binding, sizeof(binding));
+		}
+	}
+
+	return hash;
+}
+
+// walks the variable sized GL push constant entries without reading past the end of the binary
+static bool check_glpc_bounds(const char* vise_binary, const VIBinaryHeader& header)
+{
+	const size_t entry_fields_size = sizeof(uint32_t) * 5;
+	size_t offset = header.glpc_offset;
+
+	for (uint32_t i = 0; i < header.glpc_count; i++)
+	{
+		if (offset + entry_fields_size > header.binary_size)
+			return false;
+
+		uint8_t* now = (uint8_t*)vise_binary + offset + entry_fields_size - sizeof(uint32_t);
+		size_t uniform_name_size = (size_t)sread32(&now);
+		offset += entry_fields_size + uniform_name_size;
+	}
+
+	return offset <= header.binary_size;
+}
+
+// validates a vise binary of binary_size bytes before any section is accessed,
+// stale or corrupted binaries are rejected with an error message instead of being trusted
+static bool read_binary(const char* vise_binary, size_t binary_size, VIBinaryHeader* out_header, std::string* out_error)
+{
+	if (!vise_binary || binary_size < sizeof(VIBinaryHeader))
+	{
+		*out_error = "vise binary is truncated";
+		return false;
+	}
+
+	uint8_t* now = (uint8_t*)vise_binary;
+	sread_header(&now, out_header);
+	const VIBinaryHeader& header = *out_header;
+
+	if (header.magic != VI_BINARY_MAGIC)
+	{
+		*out_error = "not a vise binary";
+		return false;
+	}
+
+	if (header.version != VI_BINARY_VERSION)
+	{
+		*out_error = "stale vise binary version " + std::to_string(header.version) + ", expected " + std::to_string(VI_BINARY_VERSION);
+		return false;
+	}
+
+	if (header.binary_size > binary_size)
+	{
+		*out_error = "vise binary is truncated";
+		return false;
+	}
+
+	bool is_valid = header.binary_size >= sizeof(VIBinaryHeader) &&
+		(size_t)header.spirv_offset + header.spirv_size <= header.binary_size && (header.spirv_offset & 3) == 0 &&
+		(size_t)header.glpc_offset <= header.binary_size && check_glpc_bounds(vise_binary, header) &&
+		(size_t)header.glsl_offset + header.glsl_size <= header.binary_size;
+
+	if (!is_valid)
+	{
+		*out_error = "vise binary sections out of bounds";
+		return false;
+	}
+
+	uint32_t checksum = hash_fnv1a(VI_FNV1A_OFFSET_BASIS, vise_binary + sizeof(VIBinaryHeader), header.binary_size - sizeof(VIBinaryHeader));
+	if (checksum != header.checksum)
+	{
+		*out_error = "vise binary checksum mismatch";
+		return false;
+	}
+
+	return true;
 }
 
 static inline void sread_glpc(uint8_t** mem, GLPushConstant* pc)
@@ -1168,53 +1861,245 @@ static inline void sread_glpc(uint8_t** mem, GLPushConstant* pc)
 	sread_bytes(mem, uniform_name_size, pc->uniform_name.data());
 }
 
+static inline void swrite_archive_header(uint8_t** mem, const VIArchiveHeader& header)
+{
+	swrite32(mem, header.magic);
+	swrite32(mem, header.version);
+	swrite32(mem, header.entry_count);
+	swrite32(mem, header.archive_size);
+}
+
+static inline void swrite_archive_entry(uint8_t** mem, const VIArchiveEntry& entry)
+{
+	swrite32(mem, entry.name_offset);
+	swrite32(mem, entry.name_size);
+	swrite32(mem, entry.backend_mask);
+	swrite32(mem, entry.module_type);
+	swrite32(mem, entry.binary_offset);
+	swrite32(mem, entry.binary_size);
+}
+
+static inline void sread_archive_header(uint8_t** mem, VIArchiveHeader* header)
+{
+	header->magic = sread32(mem);
+	header->version = sread32(mem);
+	header->entry_count = sread32(mem);
+	header->archive_size = sread32(mem);
+}
+
+static inline void sread_archive_entry(uint8_t** mem, VIArchiveEntry* entry)
+{
+	entry->name_offset = sread32(mem);
+	entry->name_size = sread32(mem);
+	entry->backend_mask = sread32(mem);
+	entry->module_type = sread32(mem);
+	entry->binary_offset = sread32(mem);
+	entry->binary_size = sread32(mem);
+}
+
 void* vi_malloc(size_t size)
 {
 	HostMalloc* header = (HostMalloc*)malloc(size + sizeof(HostMalloc));
 	VI_ASSERT(header != nullptr);
 
 	header->size = size;
-	host_malloc_usage += size;
+	header->device = VI_NULL;
+	size_t usage = host_malloc_usage.fetch_add(size) + size;
+	size_t peak = host_malloc_peak.load();
 
-	if (host_malloc_usage > host_malloc_peak)
-		host_malloc_peak = host_malloc_usage;
+	// vi_malloc may be called from vi_compile_binaries worker threads
+	while (usage > peak && !host_malloc_peak.compare_exchange_weak(peak, usage))
+		;
 
 	return ((char*)header) + sizeof(HostMalloc);
 }
 
+static void* vi_device_malloc(VIDevice device, size_t size)
+{
+	void* ptr = vi_malloc(size);
+	HostMalloc* header = (HostMalloc*)((((char*)ptr) - sizeof(HostMalloc)));
+	header->device = device;
+
+	size_t usage = device->host_malloc_usage.fetch_add(size) + size;
+	size_t peak = device->host_malloc_peak.load();
+
+	// devices are independent, but a device may be handed over between threads
+	while (usage > peak && !device->host_malloc_peak.compare_exchange_weak(peak, usage))
+		;
+
+	return ptr;
+}
+
 void vi_free(void* ptr)
 {
 	VI_ASSERT(ptr != nullptr);
 
 	HostMalloc* header = (HostMalloc*)((((char*)ptr) - sizeof(HostMalloc)));
-	host_malloc_usage -= header->size;
+	host_malloc_usage.fetch_sub(header->size);
+
+	if (header->device)
+		header->device->host_malloc_usage.fetch_sub(header->size);
 
 	free(header);
 }
 
-static void vk_create_instance(VIVulkan* vk, bool enable_validation)
+#ifdef VI_ENABLE_TRACE
+static std::mutex trace_mutex; // guards trace_rings and trace_free_rings
+static std::vector<VITraceRing*> trace_rings;
+static std::vector<VITraceRing*> trace_free_rings;
+static const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+static thread_local VITraceThread trace_thread;
+
+VITraceThread::VITraceThread()
 {
-	// available layers and extensions
+	std::lock_guard<std::mutex> lock(trace_mutex);
+
+	if (!trace_free_rings.empty())
 	{
-		uint32_t layer_count;
-		VK_CHECK(vkEnumerateInstanceLayerProperties(&layer_count, NULL));
-		vk->layer_props.resize((size_t)layer_count);
-		VK_CHECK(vkEnumerateInstanceLayerProperties(&layer_count, vk->layer_props.data()));
+		ring = trace_free_rings.back();
+		trace_free_rings.pop_back();
+		return;
+	}
 
-		for (uint32_t i = 0; i < layer_count; i++)
-		{
-			VkLayerProperties* prop = vk->layer_props.data() + i;
-			//printf("layer prop: %s\n", prop->layerName);
-		}
+	ring = new VITraceRing();
+	ring->tid = (uint32_t)trace_rings.size();
+	trace_rings.push_back(ring);
+}
 
-		uint32_t ext_count;
-		VK_CHECK(vkEnumerateInstanceExtensionProperties(NULL, &ext_count, NULL));
-		vk->ext_props.resize(ext_count);
-		VK_CHECK(vkEnumerateInstanceExtensionProperties(NULL, &ext_count, vk->ext_props.data()));
+VITraceThread::~VITraceThread()
+{
+	std::lock_guard<std::mutex> lock(trace_mutex);
 
-		for (uint32_t i = 0; i < ext_count; i++)
-		{
-			VkExtensionProperties* prop = vk->ext_props.data() + i;
+	ring->depth = 0;
+	trace_free_rings.push_back(ring);
+}
+
+static uint64_t trace_now()
+{
+	auto duration = std::chrono::steady_clock::now() - trace_epoch;
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+static void trace_write(const char* name, uint64_t begin, uint64_t end)
+{
+	VITraceRing* ring = trace_thread.ring;
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+	VITraceEvent* event = ring->events + head % VI_TRACE_RING_CAPACITY;
+	event->name = name;
+	event->begin = begin;
+	event->end = end;
+
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+static void trace_dump_string(FILE* file, const char* str)
+{
+	for (; *str; str++)
+	{
+		if (*str == '"' || *str == '\\')
+			fputc('\\', file);
+
+		if ((unsigned char)*str >= 0x20)
+			fputc(*str, file);
+	}
+}
+#endif
+
+void vi_trace_begin(const char* name)
+{
+#ifdef VI_ENABLE_TRACE
+	VITraceRing* ring = trace_thread.ring;
+	VI_ASSERT(ring->depth < VI_TRACE_MAX_DEPTH);
+
+	VITraceEvent* event = ring->open + ring->depth++;
+	event->name = name;
+	event->begin = trace_now();
+#endif
+}
+
+void vi_trace_end()
+{
+#ifdef VI_ENABLE_TRACE
+	VITraceRing* ring = trace_thread.ring;
+	VI_ASSERT(ring->depth > 0 && "vi_trace_end without vi_trace_begin");
+
+	const VITraceEvent* event = ring->open + --ring->depth;
+	trace_write(event->name, event->begin, trace_now());
+#endif
+}
+
+bool vi_trace_dump(const char* path)
+{
+#ifdef VI_ENABLE_TRACE
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	std::vector<VITraceEvent> events;
+	bool is_first = true;
+
+	fputs("{\"traceEvents\":[", file);
+
+	for (VITraceRing* ring : trace_rings)
+	{
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		uint64_t first = head > VI_TRACE_RING_CAPACITY ? head - VI_TRACE_RING_CAPACITY : 0;
+
+		events.resize(head - first);
+		for (uint64_t i = first; i < head; i++)
+			events[i - first] = ring->events[i % VI_TRACE_RING_CAPACITY];
+
+		// the slot after the latest event may have been written during the copy,
+		// together with every slot the owning thread moved on to since
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t written = ring->head.load(std::memory_order_relaxed);
+		uint64_t valid = written >= VI_TRACE_RING_CAPACITY ? written - VI_TRACE_RING_CAPACITY + 1 : 0;
+
+		for (uint64_t i = std::max(first, valid); i < head; i++)
+		{
+			const VITraceEvent& event = events[i - first];
+
+			fputs(is_first ? "\n{\"name\":\"" : ",\n{\"name\":\"", file);
+			trace_dump_string(file, event.name);
+			fprintf(file, "\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				ring->tid, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+			is_first = false;
+		}
+	}
+
+	fputs("\n]}\n", file);
+
+	return fclose(file) == 0;
+#else
+	return false;
+#endif
+}
+
+static void vk_create_instance(VIVulkan* vk, bool enable_validation, bool headless)
+{
+	// available layers and extensions
+	{
+		uint32_t layer_count;
+		VK_CHECK(vkEnumerateInstanceLayerProperties(&layer_count, NULL));
+		vk->layer_props.resize((size_t)layer_count);
+		VK_CHECK(vkEnumerateInstanceLayerProperties(&layer_count, vk->layer_props.data()));
+
+		for (uint32_t i = 0; i < layer_count; i++)
+		{
+			VkLayerProperties* prop = vk->layer_props.data() + i;
+			//printf("layer prop: %s\n", prop->layerName);
+		}
+
+		uint32_t ext_count;
+		VK_CHECK(vkEnumerateInstanceExtensionProperties(NULL, &ext_count, NULL));
+		vk->ext_props.resize(ext_count);
+		VK_CHECK(vkEnumerateInstanceExtensionProperties(NULL, &ext_count, vk->ext_props.data()));
+
+		for (uint32_t i = 0; i < ext_count; i++)
+		{
+			VkExtensionProperties* prop = vk->ext_props.data() + i;
 			//printf("layer ext: %s\n", prop->extensionName);
 		}
 	}
@@ -1223,20 +2108,43 @@ static void vk_create_instance(VIVulkan* vk, bool enable_validation)
 	const char* desired_layers[] = {
 		"VK_LAYER_KHRONOS_validation",
 	};
-	
-	const char* desired_exts[] = {
-#ifdef VK_KHR_surface
-		VK_KHR_SURFACE_EXTENSION_NAME,
-#endif
-#ifdef VK_KHR_win32_surface
-		VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
+
+	// servers and CI machines often run a bare driver such as lavapipe without the SDK layers
+	bool has_validation = false;
+	for (const VkLayerProperties& prop : vk->layer_props)
+		has_validation = has_validation || !strcmp(prop.layerName, desired_layers[0]);
+
+	if (enable_validation && !has_validation)
+	{
+		printf("VISE: validation layers requested but not present\n");
+		enable_validation = false;
+	}
+
+	std::vector<const char*> desired_exts;
+
+	// headless devices never create a surface
+	if (!headless)
+	{
+#ifdef VI_PLATFORM_WIN32
+		desired_exts.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+		desired_exts.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#else
+		uint32_t glfw_ext_count;
+		const char** glfw_exts = glfwGetRequiredInstanceExtensions(&glfw_ext_count);
+		VI_ASSERT(glfw_exts && "window system does not support Vulkan surfaces");
+		desired_exts.insert(desired_exts.end(), glfw_exts, glfw_exts + glfw_ext_count);
 #endif
+	}
+
 #ifdef VK_EXT_debug_utils
-		VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+	for (const VkExtensionProperties& prop : vk->ext_props)
+	{
+		if (!strcmp(prop.extensionName, VK_EXT_DEBUG_UTILS_EXTENSION_NAME))
+			desired_exts.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+	}
 #endif
-	};
 
-	// TODO: check intersection, assert for required layers and exts
+	// TODO: check intersection, assert for required exts
 
 	// create instance
 	VkApplicationInfo appI{};
@@ -1249,8 +2157,8 @@ static void vk_create_instance(VIVulkan* vk, bool enable_validation)
 	instanceCI.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instanceCI.enabledLayerCount = enable_validation ? VI_ARR_SIZE(desired_layers) : 0;
 	instanceCI.ppEnabledLayerNames = desired_layers;
-	instanceCI.enabledExtensionCount = VI_ARR_SIZE(desired_exts);
-	instanceCI.ppEnabledExtensionNames = desired_exts;
+	instanceCI.enabledExtensionCount = (uint32_t)desired_exts.size();
+	instanceCI.ppEnabledExtensionNames = desired_exts.data();
 	instanceCI.pApplicationInfo = &appI;
 
 	VK_CHECK(vkCreateInstance(&instanceCI, NULL, &vk->instance));
@@ -1262,22 +2170,26 @@ static void vk_destroy_instance(VIVulkan* vk)
 	vk->instance = NULL;
 }
 
-static void vk_create_surface(VIVulkan* vk)
+static void vk_create_surface(VIVulkan* vk, void* window)
 {
-	GLFWwindow* window = glfwGetCurrentContext();
-
+#ifdef VI_PLATFORM_WIN32
 	VkWin32SurfaceCreateInfoKHR surfaceCI{};
 	surfaceCI.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
 	surfaceCI.hinstance = GetModuleHandle(NULL);
-	surfaceCI.hwnd = glfwGetWin32Window(window);
+	surfaceCI.hwnd = glfwGetWin32Window((GLFWwindow*)window);
 
 	VK_CHECK(vkCreateWin32SurfaceKHR(vk->instance, &surfaceCI, NULL, &vk->surface));
+#else
+	// the window must be created with GLFW_CLIENT_API set to GLFW_NO_API
+	VK_CHECK(glfwCreateWindowSurface(vk->instance, (GLFWwindow*)window, NULL, &vk->surface));
+#endif
 }
 
 static void vk_destroy_surface(VIVulkan* vk)
 {
-	vkDestroySurfaceKHR(vk->instance, vk->surface, NULL);
-	vk->surface = NULL;
+	if (vk->surface != VK_NULL_HANDLE)
+		vkDestroySurfaceKHR(vk->instance, vk->surface, NULL);
+	vk->surface = VK_NULL_HANDLE;
 }
 
 static void vk_create_device(VIVulkan* vk, VIDevice device, const VIDeviceInfo* info)
@@ -1314,35 +2226,48 @@ static void vk_create_device(VIVulkan* vk, VIDevice device, const VIDeviceInfo*
 		pdevice->ext_props.resize(ext_count);
 		VK_CHECK(vkEnumerateDeviceExtensionProperties(handles[i], NULL, &ext_count, pdevice->ext_props.data()));
 
-		// features on this physical device
-		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures;
-		extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
-		extendedDynamicStateFeatures.pNext = nullptr;
-		extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+		// features supported by this physical device, vk_create_device enables the subset vise uses
+		pdevice->features_extended_dynamic_state = {};
+		pdevice->features_extended_dynamic_state.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+		pdevice->features_extended_dynamic_state.pNext = nullptr;
+
+		pdevice->features_conditional_rendering = {};
+		pdevice->features_conditional_rendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+		pdevice->features_conditional_rendering.pNext = &pdevice->features_extended_dynamic_state;
+
+		pdevice->features_vk12 = {};
+		pdevice->features_vk12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		pdevice->features_vk12.pNext = &pdevice->features_conditional_rendering;
 
 		pdevice->features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-		pdevice->features.pNext = &extendedDynamicStateFeatures;
+		pdevice->features.pNext = &pdevice->features_vk12;
 		vkGetPhysicalDeviceFeatures2(handles[i], &pdevice->features);
 
-		// compatible surface formats on this physical device
-		uint32_t format_count;
-		vkGetPhysicalDeviceSurfaceFormatsKHR(pdevice->handle, pdevice->surface, &format_count, NULL);
-		if (format_count > 0)
+		// headless devices have no surface, surface formats, present modes and capabilities stay empty
+		if (vk->surface != VK_NULL_HANDLE)
 		{
-			pdevice->surface_formats.resize(format_count);
-			vkGetPhysicalDeviceSurfaceFormatsKHR(pdevice->handle, pdevice->surface, &format_count, pdevice->surface_formats.data());
-		}
+			// compatible surface formats on this physical device
+			uint32_t format_count;
+			vkGetPhysicalDeviceSurfaceFormatsKHR(pdevice->handle, pdevice->surface, &format_count, NULL);
+			if (format_count > 0)
+			{
+				pdevice->surface_formats.resize(format_count);
+				vkGetPhysicalDeviceSurfaceFormatsKHR(pdevice->handle, pdevice->surface, &format_count, pdevice->surface_formats.data());
+			}
 
-		// available present modes for the surface on this physical device
-		uint32_t mode_count;
-		vkGetPhysicalDeviceSurfacePresentModesKHR(pdevice->handle, pdevice->surface, &mode_count, NULL);
-		if (mode_count > 0)
-		{
-			pdevice->present_modes.resize(mode_count);
-			vkGetPhysicalDeviceSurfacePresentModesKHR(pdevice->handle, pdevice->surface, &mode_count, pdevice->present_modes.data());
-		}
+			// available present modes for the surface on this physical device
+			uint32_t mode_count;
+			vkGetPhysicalDeviceSurfacePresentModesKHR(pdevice->handle, pdevice->surface, &mode_count, NULL);
+			if (mode_count > 0)
+			{
+				pdevice->present_modes.resize(mode_count);
+				vkGetPhysicalDeviceSurfacePresentModesKHR(pdevice->handle, pdevice->surface, &mode_count, pdevice->present_modes.data());
+			}
 
-		VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(pdevice->handle, vk->surface, &pdevice->surface_caps));
+			VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(pdevice->handle, vk->surface, &pdevice->surface_caps));
+		}
+		else
+			pdevice->surface_caps = {};
 
 		VkFormatProperties format_props;
 		std::array<VkFormat, 2> depth_stencil_candidates = {
@@ -1392,33 +2317,126 @@ static void vk_create_device(VIVulkan* vk, VIDevice device, const VIDeviceInfo*
 		if (family_idx_transfer == family_count && chosen->family_props[idx].queueFlags | VK_QUEUE_TRANSFER_BIT)
 			family_idx_transfer = idx;
 
-		VkBool32 is_supported;
-		vkGetPhysicalDeviceSurfaceSupportKHR(chosen->handle, idx, vk->surface, &is_supported);
+		// headless devices "present" on the graphics queue
+		VkBool32 is_supported = VK_TRUE;
+		if (vk->surface != VK_NULL_HANDLE)
+			vkGetPhysicalDeviceSurfaceSupportKHR(chosen->handle, idx, vk->surface, &is_supported);
 		if (family_idx_present == family_count && is_supported)
 			family_idx_present = idx;
 	}
 
+	// compute-only devices create a single queue on the first compute capable family,
+	// the graphics, transfer and present queues all alias it
+	if (info->compute_only)
+	{
+		uint32_t family_idx_compute = family_count;
+		for (uint32_t idx = 0; idx < family_count && family_idx_compute == family_count; idx++)
+		{
+			if (chosen->family_props[idx].queueFlags & VK_QUEUE_COMPUTE_BIT)
+				family_idx_compute = idx;
+		}
+
+		VI_ASSERT(family_idx_compute != family_count && "compute queue family not found");
+
+		VkDeviceQueueCreateInfo computeQueueCI = queueCI[family_idx_compute];
+		queueCI = { computeQueueCI };
+		family_idx_graphics = family_idx_compute;
+		family_idx_transfer = family_idx_compute;
+		family_idx_present = family_idx_compute;
+	}
+
 	VI_ASSERT(family_idx_graphics != family_count && "graphics queue family not found");
 	VI_ASSERT(family_idx_transfer != family_count && "transfer queue family not found");
 	VI_ASSERT(family_idx_present != family_count && "present queue family not found");
 
 	// TODO: check if required extensions are present on physical device
 	const char* desired_device_exts[] = {
-#ifdef VK_KHR_swapchain
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-#endif
 #ifdef VK_EXT_extended_dynamic_state
 		VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME, // TODO: included in VK_API_VERSION_1_3, driver bug not detecting VkApplicationInfo::apiVersion?
 #endif
 	};
 
+	std::vector<const char*> device_exts(desired_device_exts, desired_device_exts + VI_ARR_SIZE(desired_device_exts));
+
+#ifdef VK_KHR_swapchain
+	if (vk->surface != VK_NULL_HANDLE)
+		device_exts.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+#endif
+
+	// optional extensions, vise falls back to an emulation if not present
+	vk->supports_push_descriptor = false;
+#ifdef VK_KHR_push_descriptor
+	for (const VkExtensionProperties& ext : chosen->ext_props)
+	{
+		if (!strcmp(ext.extensionName, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME))
+		{
+			vk->supports_push_descriptor = true;
+			device_exts.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+		}
+	}
+#endif
+
+	// without VK_EXT_conditional_rendering, conditional draws fall back to indirect draws counted by the predicate
+	vk->supports_conditional_rendering = false;
+#ifdef VK_EXT_conditional_rendering
+	for (const VkExtensionProperties& ext : chosen->ext_props)
+	{
+		if (!strcmp(ext.extensionName, VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME) && chosen->features_conditional_rendering.conditionalRendering)
+		{
+			vk->supports_conditional_rendering = true;
+			device_exts.push_back(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
+		}
+	}
+#endif
+
+	// only features vise uses are enabled, feature structs of extensions are only
+	// chained if the extension is enabled
+	const VkPhysicalDeviceFeatures& supported = chosen->features.features;
+	const VkPhysicalDeviceVulkan12Features& supported_vk12 = chosen->features_vk12;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.features.fillModeNonSolid = supported.fillModeNonSolid;                 // VI_POLYGON_MODE_LINE
+	features.features.textureCompressionBC = supported.textureCompressionBC;         // VI_FORMAT_BC*
+	features.features.occlusionQueryPrecise = supported.occlusionQueryPrecise;
+	features.features.pipelineStatisticsQuery = supported.pipelineStatisticsQuery;
+	features.features.shaderSampledImageArrayDynamicIndexing = supported.shaderSampledImageArrayDynamicIndexing; // bindless arrays
+
+	VkPhysicalDeviceVulkan12Features features_vk12{};
+	features_vk12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features_vk12.drawIndirectCount = supported_vk12.drawIndirectCount; // conditional draws without VK_EXT_conditional_rendering
+	features_vk12.descriptorBindingPartiallyBound = supported_vk12.descriptorBindingPartiallyBound;
+	features_vk12.descriptorBindingSampledImageUpdateAfterBind = supported_vk12.descriptorBindingSampledImageUpdateAfterBind;
+	features.pNext = &features_vk12;
+
+	void** features_next = &features_vk12.pNext;
+
+#ifdef VK_EXT_extended_dynamic_state
+	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT features_extended_dynamic_state{};
+	features_extended_dynamic_state.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+	features_extended_dynamic_state.extendedDynamicState = chosen->features_extended_dynamic_state.extendedDynamicState;
+	*features_next = &features_extended_dynamic_state;
+	features_next = &features_extended_dynamic_state.pNext;
+#endif
+
+#ifdef VK_EXT_conditional_rendering
+	VkPhysicalDeviceConditionalRenderingFeaturesEXT features_conditional_rendering{};
+	features_conditional_rendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+	features_conditional_rendering.conditionalRendering = VK_TRUE;
+	if (vk->supports_conditional_rendering)
+	{
+		*features_next = &features_conditional_rendering;
+		features_next = &features_conditional_rendering.pNext;
+	}
+#endif
+
 	VkDeviceCreateInfo deviceCI{};
 	deviceCI.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	deviceCI.pNext = &chosen->features;
+	deviceCI.pNext = &features;
 	deviceCI.queueCreateInfoCount = queueCI.size();
 	deviceCI.pQueueCreateInfos = queueCI.data();
-	deviceCI.enabledExtensionCount = VI_ARR_SIZE(desired_device_exts);
-	deviceCI.ppEnabledExtensionNames = desired_device_exts;
+	deviceCI.enabledExtensionCount = (uint32_t)device_exts.size();
+	deviceCI.ppEnabledExtensionNames = device_exts.data();
 	deviceCI.pEnabledFeatures = nullptr;
 	VK_CHECK(vkCreateDevice(chosen->handle, &deviceCI, NULL, &vk->device));
 
@@ -1444,7 +2462,7 @@ static void vk_destroy_device(VIVulkan* vk)
 	vk->device = NULL;
 }
 
-static void vk_create_swapchain(VIVulkan* vk, const VISwapchainInfo* info, uint32_t min_image_count)
+static void vk_create_swapchain(VIVulkan* vk, const VISwapchainInfo* info, uint32_t min_image_count, VkSwapchainKHR old_swapchain)
 {
 	VIPhysicalDevice* pdevice = vk->pdevice_chosen;
 
@@ -1460,7 +2478,7 @@ static void vk_create_swapchain(VIVulkan* vk, const VISwapchainInfo* info, uint3
 	swapchainCI.preTransform = pdevice->surface_caps.currentTransform; // TODO: parameterize
 	swapchainCI.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	swapchainCI.clipped = VK_TRUE;
-	swapchainCI.oldSwapchain = VK_NULL_HANDLE;
+	swapchainCI.oldSwapchain = old_swapchain;
 	swapchainCI.surface = vk->surface;
 
 	uint32_t family_indices[2] = { vk->family_idx_graphics, vk->family_idx_present };
@@ -1487,6 +2505,17 @@ static void vk_create_swapchain(VIVulkan* vk, const VISwapchainInfo* info, uint3
 
 	vk->swapchain.info = *info;
 	vk->swapchain.min_image_count = min_image_count;
+	vk->swapchain.is_outdated = false;
+
+	// presentation is not fenced by any frame slot, present semaphores belong to the images
+	VkSemaphoreCreateInfo semCI;
+	semCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semCI.pNext = NULL;
+	semCI.flags = 0;
+	vk->swapchain.present_ready.resize(image_count);
+	vk->swapchain.image_fences.assign(image_count, VK_NULL_HANDLE);
+	for (VISemaphoreObj& present_ready : vk->swapchain.present_ready)
+		VK_CHECK(vkCreateSemaphore(vk->device, &semCI, NULL, &present_ready.vk_handle));
 
 	if (info->depth_stencil_format != VK_FORMAT_UNDEFINED)
 	{
@@ -1545,63 +2574,182 @@ static void vk_create_swapchain(VIVulkan* vk, const VISwapchainInfo* info, uint3
 	}
 }
 
-static void vk_destroy_swapchain(VIVulkan* vk)
+static void vk_retire_swapchain(VIVulkan* vk)
+{
+	VIDevice device = vk->vi_device;
+
+	VIRetiredSwapchain retired;
+	retired.retire_frame = device->frame_count;
+	retired.handle = vk->swapchain.handle;
+	retired.framebuffers = device->swapchain_framebuffers;
+	retired.images = std::move(vk->swapchain.images);
+	retired.depth_stencils = std::move(vk->swapchain.depth_stencils);
+	retired.present_ready = std::move(vk->swapchain.present_ready);
+	vk->retired_swapchains.push_back(std::move(retired));
+
+	vk->swapchain.handle = VK_NULL_HANDLE;
+	vk->swapchain.images.clear();
+	vk->swapchain.depth_stencils.clear();
+	vk->swapchain.present_ready.clear();
+	vk->swapchain.image_handles.clear();
+	vk->swapchain.image_fences.clear();
+	device->swapchain_framebuffers = VI_NULL;
+}
+
+static void vk_destroy_retired_swapchain(VIVulkan* vk, VIRetiredSwapchain* retired)
 {
-	for (uint32_t i = 0; i < vk->swapchain.images.size(); i++)
-		vk_destroy_image_view(vk, vk->swapchain.images.data() + i);
+	for (uint32_t i = 0; i < retired->images.size(); i++)
+		vk_destroy_framebuffer(vk, retired->framebuffers + i);
+
+	vi_free(retired->framebuffers);
+
+	for (uint32_t i = 0; i < retired->images.size(); i++)
+		vk_destroy_image_view(vk, retired->images.data() + i);
 
-	for (uint32_t i = 0; i < vk->swapchain.depth_stencils.size(); i++)
+	for (uint32_t i = 0; i < retired->depth_stencils.size(); i++)
 	{
-		VIImage depthStencil = vk->swapchain.depth_stencils.data() + i;
+		VIImage depthStencil = retired->depth_stencils.data() + i;
 
 		vk_destroy_image_view(vk, depthStencil);
 		vk_default_destroy_image(depthStencil);
 		depthStencil->~VIImageObj();
 	}
 
-	vkDestroySwapchainKHR(vk->device, vk->swapchain.handle, nullptr);
-	vk->swapchain.handle = VK_NULL_HANDLE;
+	for (VISemaphoreObj& present_ready : retired->present_ready)
+		vkDestroySemaphore(vk->device, present_ready.vk_handle, nullptr);
+
+	vkDestroySwapchainKHR(vk->device, retired->handle, nullptr);
 }
 
-static void vk_recreate_swapchain(VIVulkan* vk)
+// destroys retired swapchains whose last frames are complete
+static void vk_release_retired_swapchains(VIVulkan* vk)
 {
-	vkDeviceWaitIdle(vk->device);
+	size_t kept = 0;
+
+	for (size_t i = 0; i < vk->retired_swapchains.size(); i++)
+	{
+		VIRetiredSwapchain* retired = vk->retired_swapchains.data() + i;
+
+		if (retired->retire_frame <= vk->completed_frame_count)
+		{
+			vk_destroy_retired_swapchain(vk, retired);
+			continue;
+		}
 
-	size_t old_image_count = vk->swapchain.images.size();
+		if (kept != i)
+			vk->retired_swapchains[kept] = std::move(*retired);
+		kept++;
+	}
+
+	vk->retired_swapchains.resize(kept);
+}
+
+// the old swapchain is handed over to the new one and retired instead of idling the device,
+// the image count may change with the new surface extent
+static void vk_recreate_swapchain(VIVulkan* vk)
+{
+	VIDevice device = vk->vi_device;
 	uint32_t min_image_count = vk->swapchain.min_image_count;
 	VISwapchainInfo info = vk->swapchain.info;
 
-	vk_destroy_swapchain_framebuffer(vk);
-	vk_destroy_swapchain(vk);
-
 	VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vk->pdevice_chosen->handle, vk->surface, &vk->pdevice_chosen->surface_caps));
-
 	info.image_extent = vk->pdevice_chosen->surface_caps.currentExtent;
-	vk_create_swapchain(vk, &info, min_image_count);
+
+	vk_retire_swapchain(vk);
+	vk_create_swapchain(vk, &info, min_image_count, vk->retired_swapchains.back().handle);
 	vk_create_swapchain_framebuffer(vk);
 
-	for (uint32_t i = 0; i < vk->frames_in_flight; i++)
+	device->limits.swapchain_framebuffer_count = (uint32_t)vk->swapchain.images.size();
+}
+
+// enqueues the object instead of destroying it if frames in flight may still reference it
+static bool vk_defer_destroy(VIDevice device, VIGarbageType type, void* object)
+{
+	if (device->backend != VI_BACKEND_VULKAN || !device->deferred_destruction)
+		return false;
+
+	VIVulkan* vk = &device->vk;
+	if (vk->is_releasing_garbage || vk->max_frames_in_flight == 0)
+		return false;
+
+	VIGarbage garbage;
+	garbage.type = type;
+	garbage.frame_count = device->frame_count;
+	garbage.object = object;
+	vk->garbage.push_back(garbage);
+	return true;
+}
+
+// destroys garbage of every complete frame
+static void vk_release_garbage(VIDevice device, uint64_t completed_frame_count)
+{
+	VIVulkan* vk = &device->vk;
+	size_t count = 0;
+
+	vk->is_releasing_garbage = true;
+
+	for (; count < vk->garbage.size() && vk->garbage[count].frame_count <= completed_frame_count; count++)
 	{
-		VIFrame* frame = vk->frames + i;
+		const VIGarbage& garbage = vk->garbage[count];
 
-		VkFenceCreateInfo fenceCI;
-		fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceCI.pNext = NULL;
-		fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-		vkDestroyFence(vk->device, frame->fence.frame_complete.vk_handle, nullptr);
-		VK_CHECK(vkCreateFence(vk->device, &fenceCI, NULL, &frame->fence.frame_complete.vk_handle));
+		switch (garbage.type)
+		{
+		case VI_GARBAGE_TYPE_BUFFER:
+			vi_destroy_buffer(device, (VIBuffer)garbage.object);
+			break;
+		case VI_GARBAGE_TYPE_IMAGE:
+			vi_destroy_image(device, (VIImage)garbage.object);
+			break;
+		case VI_GARBAGE_TYPE_SET:
+			vi_free_set(device, (VISet)garbage.object);
+			break;
+		case VI_GARBAGE_TYPE_SET_POOL:
+			vi_destroy_set_pool(device, (VISetPool)garbage.object);
+			break;
+		case VI_GARBAGE_TYPE_FRAMEBUFFER:
+			vi_destroy_framebuffer(device, (VIFramebuffer)garbage.object);
+			break;
+		default:
+			VI_UNREACHABLE;
+		}
+	}
 
-		VkSemaphoreCreateInfo semCI;
-		semCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-		semCI.pNext = NULL;
-		semCI.flags = 0;
-		vkDestroySemaphore(vk->device, frame->semaphore.image_acquired.vk_handle, nullptr);
-		vkDestroySemaphore(vk->device, frame->semaphore.present_ready.vk_handle, nullptr);
+	vk->is_releasing_garbage = false;
+	vk->garbage.erase(vk->garbage.begin(), vk->garbage.begin() + count);
+}
+
+// per frame slot fences and semaphores
+static void vk_create_frame_sync(VIVulkan* vk)
+{
+	VkFenceCreateInfo fenceCI;
+	fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceCI.pNext = NULL;
+	fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	VkSemaphoreCreateInfo semCI;
+	semCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semCI.pNext = NULL;
+	semCI.flags = 0;
+
+	for (uint32_t i = 0; i < vk->max_frames_in_flight; i++)
+	{
+		VIFrame* frame = vk->frames + i;
+		VK_CHECK(vkCreateFence(vk->device, &fenceCI, NULL, &frame->fence.frame_complete.vk_handle));
 		VK_CHECK(vkCreateSemaphore(vk->device, &semCI, NULL, &frame->semaphore.image_acquired.vk_handle));
 		VK_CHECK(vkCreateSemaphore(vk->device, &semCI, NULL, &frame->semaphore.present_ready.vk_handle));
+		frame->frame_count = 0;
 	}
+}
 
-	VI_ASSERT(vk->swapchain.images.size() == old_image_count);
+static void vk_destroy_frame_sync(VIVulkan* vk)
+{
+	for (uint32_t i = 0; i < vk->max_frames_in_flight; i++)
+	{
+		VIFrame* frame = vk->frames + i;
+		vkDestroySemaphore(vk->device, frame->semaphore.present_ready.vk_handle, nullptr);
+		vkDestroySemaphore(vk->device, frame->semaphore.image_acquired.vk_handle, nullptr);
+		vkDestroyFence(vk->device, frame->fence.frame_complete.vk_handle, nullptr);
+	}
 }
 
 void vk_create_swapchain_framebuffer(VIVulkan * vk)
@@ -1609,7 +2757,7 @@ void vk_create_swapchain_framebuffer(VIVulkan * vk)
 	VIDevice device = vk->vi_device;
 
 	size_t image_count = vk->swapchain.images.size();
-	device->swapchain_framebuffers = (VIFramebuffer)vi_malloc(sizeof(VIFramebufferObj) * image_count);
+	device->swapchain_framebuffers = (VIFramebuffer)vi_device_malloc(device, sizeof(VIFramebufferObj) * image_count);
 
 	for (size_t i = 0; i < image_count; i++)
 	{
@@ -1631,16 +2779,6 @@ void vk_create_swapchain_framebuffer(VIVulkan * vk)
 	}
 }
 
-static void vk_destroy_swapchain_framebuffer(VIVulkan* vk)
-{
-	VIDevice device = vk->vi_device;
-
-	for (uint32_t i = 0; i < vk->swapchain.images.size(); i++)
-		vk_destroy_framebuffer(vk, device->swapchain_framebuffers + i);
-
-	vi_free(device->swapchain_framebuffers);
-}
-
 static void vk_create_buffer(VIVulkan* vk, VIBuffer buffer, const VkBufferCreateInfo* info, const VkMemoryPropertyFlags& properties)
 {
 	if (vk->allocator.create_buffer)
@@ -1703,59 +2841,345 @@ static void vk_destroy_image_view(VIVulkan* vk, VIImage image)
 	vkDestroyImageView(vk->device, image->vk.view_handle, NULL);
 	image->vk.view_handle = VK_NULL_HANDLE;
 	image->flags &= ~VI_IMAGE_FLAG_CREATED_IMAGE_VIEW_BIT;
-}
 
-static void vk_create_sampler(VIVulkan* vk, VIImage image, const VkSamplerCreateInfo* info)
-{
-	image->flags |= VI_IMAGE_FLAG_CREATED_SAMPLER_BIT;
+	if (!image->vk_level_views)
+		return;
 
-	VK_CHECK(vkCreateSampler(vk->device, info, nullptr, &image->vk.sampler_handle));
+	for (uint32_t level = 1; level < image->info.levels; level++)
+	{
+		if (image->vk_level_views[level] != VK_NULL_HANDLE)
+			vkDestroyImageView(vk->device, image->vk_level_views[level], NULL);
+	}
+
+	vi_free(image->vk_level_views);
+	image->vk_level_views = nullptr;
 }
 
-static void vk_destroy_sampler(VIVulkan* vk, VIImage image)
+static VkImageView vk_image_sampled_view(VIImage image)
 {
-	VI_ASSERT(image->flags & VI_IMAGE_FLAG_CREATED_SAMPLER_BIT);
+	if (image->base_level == 0)
+		return image->vk.view_handle;
 
-	vkDestroySampler(vk->device, image->vk.sampler_handle, nullptr);
-	image->vk.sampler_handle = VK_NULL_HANDLE;
-	image->flags &= ~VI_IMAGE_FLAG_CREATED_SAMPLER_BIT;
+	return image->vk_level_views[image->base_level];
 }
 
-static void vk_create_framebuffer(VIVulkan* vk, VIFramebuffer fb, VIPass pass, VkExtent2D extent, uint32_t atch_count, VIImage* atchs)
+// chains a new descriptor pool to the frame, sized by the descriptor usage observed so far
+static void vk_create_set_pool(VIVulkan* vk, VISetPool pool, VISetPoolFrame* frame)
 {
-	VkImageView attachments[32];
-	VI_ASSERT(atch_count <= VI_ARR_SIZE(attachments));
-	for (uint32_t i = 0; i < atch_count; i++)
-		attachments[i] = atchs[i]->vk.view_handle;
+	uint32_t max_set_count = pool->max_set_count;
 
-	VkFramebufferCreateInfo fbI{};
-	fbI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-	fbI.width = extent.width;
-	fbI.height = extent.height;
-	fbI.layers = 1;
-	fbI.attachmentCount = atch_count;
-	fbI.pAttachments = attachments;
-	fbI.renderPass = pass->vk.handle;
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	cast_set_pool_resources((uint32_t)pool->resources.size(), pool->resources.data(), poolSizes);
 
-	VK_CHECK(vkCreateFramebuffer(vk->device, &fbI, NULL, &fb->vk.handle));
-}
+	if (pool->observed_set_count > 0)
+	{
+		for (uint32_t type = 0; type < VI_BINDING_TYPE_ENUM_COUNT; type++)
+		{
+			uint64_t observed = pool->observed_resources[type];
+			if (observed == 0)
+				continue;
 
-static void vk_destroy_framebuffer(VIVulkan* vk, VIFramebuffer fb)
-{
-	vkDestroyFramebuffer(vk->device, fb->vk.handle, NULL);
+			uint32_t count = (uint32_t)((observed * max_set_count + pool->observed_set_count - 1) / pool->observed_set_count);
+			VkDescriptorType vktype;
+			cast_binding_type((VIBindingType)type, &vktype);
 
-	fb->vk.handle = VK_NULL_HANDLE;
+			auto size = std::find_if(poolSizes.begin(), poolSizes.end(), [&](const VkDescriptorPoolSize& size) { return size.type == vktype; });
+			if (size == poolSizes.end())
+				poolSizes.push_back({ vktype, count });
+			else
+				size->descriptorCount = std::max(size->descriptorCount, count);
+		}
+	}
+
+	VkDescriptorPoolCreateInfo poolCI{};
+	poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCI.pNext = nullptr;
+	poolCI.flags = 0;
+	poolCI.maxSets = max_set_count;
+
+	if (pool->flags & VI_SET_POOL_BINDLESS_BIT)
+		poolCI.flags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	if (!(pool->flags & VI_SET_POOL_TRANSIENT_BIT))
+		poolCI.flags |= VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // see vk_release_free_sets
+	poolCI.poolSizeCount = (uint32_t)poolSizes.size();
+	poolCI.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool handle;
+	VK_CHECK(vkCreateDescriptorPool(vk->device, &poolCI, nullptr, &handle));
+	frame->vk_pools.push_back(handle);
+
+	// geometric growth keeps the number of chained pools logarithmic
+	if (pool->flags & VI_SET_POOL_GROWABLE_BIT)
+		pool->max_set_count = max_set_count * 2;
 }
 
-static void vk_alloc_cmd_buffer(VIVulkan* vk, VICommand cmd, VkCommandPool pool, VkCommandBufferLevel level)
+static void vk_alloc_set(VIVulkan* vk, VISetPool pool, VISetPoolFrame* frame, VISet set)
 {
-	VkCommandBufferAllocateInfo bufferAI{};
-	bufferAI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	// reuse a freed set of the same layout, bypassing the descriptor pools entirely
+	if (!(pool->flags & VI_SET_POOL_TRANSIENT_BIT))
+	{
+		auto ite = pool->vk_free_sets.find(set->layout->id);
+		if (ite != pool->vk_free_sets.end() && !ite->second.empty())
+		{
+			set->vk.handle = ite->second.back().handle;
+			set->vk.pool_handle = ite->second.back().pool_handle;
+			ite->second.pop_back();
+			return;
+		}
+	}
+
+	pool->observed_set_count++;
+	for (const VIBinding& binding : set->layout->bindings)
+		pool->observed_resources[binding.type] += binding.array_count;
+
+	VkDescriptorSetAllocateInfo allocI;
+	allocI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocI.pNext = nullptr;
+	allocI.descriptorSetCount = 1;
+	allocI.pSetLayouts = &set->layout->vk.handle;
+
+	bool is_released = false;
+
+	for (;;)
+	{
+		if (frame->pool_idx == frame->vk_pools.size())
+			vk_create_set_pool(vk, pool, frame);
+
+		allocI.descriptorPool = frame->vk_pools[frame->pool_idx];
+		VkResult result = vkAllocateDescriptorSets(vk->device, &allocI, &set->vk.handle);
+
+		if (result == VK_SUCCESS)
+		{
+			set->vk.pool_handle = allocI.descriptorPool;
+			return;
+		}
+
+		bool is_exhausted = result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL;
+
+		// sets cached for other layouts still hold descriptors, they are returned once before failing or growing
+		if (is_exhausted && !is_released && vk_release_free_sets(vk, pool))
+		{
+			is_released = true;
+			frame->pool_idx = 0;
+			continue;
+		}
+
+		if (!is_exhausted || !(pool->flags & VI_SET_POOL_GROWABLE_BIT))
+			VK_CHECK(result);
+
+		frame->pool_idx++;
+	}
+}
+
+// frees all cached sets back to their descriptor pools, returns false if there were none
+static bool vk_release_free_sets(VIVulkan* vk, VISetPool pool)
+{
+	bool is_released = false;
+
+	for (auto& ite : pool->vk_free_sets)
+	{
+		for (const VISetPoolFreeSet& free_set : ite.second)
+			VK_CHECK(vkFreeDescriptorSets(vk->device, free_set.pool_handle, 1, &free_set.handle));
+
+		is_released |= !ite.second.empty();
+		ite.second.clear();
+	}
+
+	return is_released;
+}
+
+// translate set updates to descriptor writes, write_buffers and write_images own the descriptor infos
+static void vk_set_update_writes(VISetLayout layout, VkDescriptorSet dst_set, uint32_t update_count, const VISetUpdateInfo* updates,
+	std::vector<VkWriteDescriptorSet>& writes, std::vector<VkDescriptorBufferInfo>& write_buffers, std::vector<VkDescriptorImageInfo>& write_images)
+{
+	for (uint32_t i = 0; i < update_count; i++)
+	{
+		uint32_t binding_idx = updates[i].binding_index;
+		uint32_t descriptor_count = 1;
+		VIBindingType binding_type = layout->bindings[binding_idx].type;
+		VkDescriptorType descriptor_type;
+		cast_binding_type(binding_type, &descriptor_type);
+		VI_ASSERT(updates[i].array_index < layout->bindings[binding_idx].array_count);
+
+		VkWriteDescriptorSet write;
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.pNext = nullptr;
+		write.dstSet = dst_set;
+		write.dstBinding = binding_idx;
+		write.dstArrayElement = updates[i].array_index;
+		write.descriptorType = descriptor_type;
+		write.descriptorCount = 1;
+		write.pImageInfo = nullptr;
+		write.pBufferInfo = nullptr;
+		write.pTexelBufferView = nullptr;
+
+		if (descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
+			descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+			descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+			descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+		{
+			VI_ASSERT(updates[i].buffer != VI_NULL);
+
+			VkDescriptorBufferInfo bufferI;
+			bufferI.buffer = updates[i].buffer->vk.handle;
+			bufferI.range = updates[i].buffer_range ? updates[i].buffer_range : updates[i].buffer->size;
+			bufferI.offset = 0;
+			write_buffers.push_back(bufferI);
+		}
+		else if (descriptor_type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+			descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+		{
+			VI_ASSERT(updates[i].image != VI_NULL);
+
+			VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			if (updates[i].image->info.usage & VI_IMAGE_USAGE_STORAGE_BIT)
+				layout = VK_IMAGE_LAYOUT_GENERAL;
+
+			VkDescriptorImageInfo imageI;
+			imageI.imageLayout = layout; // TODO: deprecate updates[i].image->vk.image_layout;
+			imageI.imageView = vk_image_sampled_view(updates[i].image);
+			imageI.sampler = (updates[i].sampler ? updates[i].sampler : updates[i].image->sampler)->vk.handle;
+			write_images.push_back(imageI);
+		}
+
+		writes.push_back(write);
+	}
+
+	uint32_t write_buffer_idx = 0;
+	uint32_t write_image_idx = 0;
+
+	// only store pointers after vector sizes are determined
+	for (uint32_t i = 0; i < update_count; i++)
+	{
+		uint32_t binding_idx = updates[i].binding_index;
+		VIBindingType binding_type = layout->bindings[binding_idx].type;
+
+		if (binding_type == VI_BINDING_TYPE_UNIFORM_BUFFER ||
+			binding_type == VI_BINDING_TYPE_STORAGE_BUFFER ||
+			binding_type == VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+			binding_type == VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC)
+		{
+			writes[i].pBufferInfo = write_buffers.data() + write_buffer_idx++;
+		}
+		else if (binding_type == VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER ||
+			binding_type == VI_BINDING_TYPE_STORAGE_IMAGE)
+		{
+			writes[i].pImageInfo = write_images.data() + write_image_idx++;
+		}
+	}
+}
+
+static void vk_cmd_push_set(VICommand cmd, VkPipelineBindPoint bind_point, VIPipelineLayout layout, uint32_t set_idx, uint32_t update_count, const VISetUpdateInfo* updates)
+{
+	VIDevice device = cmd->device;
+	VIVulkan* vk = &device->vk;
+	VISetLayout set_layout = layout->set_layouts[set_idx];
+	VI_ASSERT(set_layout->flags & VI_SET_LAYOUT_PUSH_BIT);
+
+	if (!vk->supports_push_descriptor)
+	{
+		// emulate with a set from a growable transient pool, recycled once the frame completes
+		if (!vk->push_set_pool)
+		{
+			std::array<VISetPoolResource, 4> resources;
+			resources[0] = { VI_BINDING_TYPE_UNIFORM_BUFFER, 64 };
+			resources[1] = { VI_BINDING_TYPE_STORAGE_BUFFER, 64 };
+			resources[2] = { VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER, 256 };
+			resources[3] = { VI_BINDING_TYPE_STORAGE_IMAGE, 64 };
+
+			VISetPoolInfo poolI;
+			poolI.flags = VI_SET_POOL_GROWABLE_BIT | VI_SET_POOL_TRANSIENT_BIT;
+			poolI.max_set_count = 64;
+			poolI.resource_count = (uint32_t)resources.size();
+			poolI.resources = resources.data();
+			vk->push_set_pool = vi_create_set_pool(device, &poolI);
+		}
+
+		VISet set = vi_allocate_set(device, vk->push_set_pool, set_layout);
+		vi_set_update(set, update_count, updates);
+		vkCmdBindDescriptorSets(cmd->vk.handle, bind_point, layout->vk.handle, set_idx, 1, &set->vk.handle, 0, nullptr);
+		return;
+	}
+
+	std::vector<VkDescriptorImageInfo> write_images;
+	std::vector<VkDescriptorBufferInfo> write_buffers;
+	std::vector<VkWriteDescriptorSet> writes;
+	vk_set_update_writes(set_layout, VK_NULL_HANDLE, update_count, updates, writes, write_buffers, write_images);
+
+	cmd->device->vk.proc.vkCmdPushDescriptorSetKHR(cmd->vk.handle, bind_point, layout->vk.handle, set_idx, (uint32_t)writes.size(), writes.data());
+}
+
+static void vk_create_sampler(VIVulkan* vk, VISampler sampler)
+{
+	VkSamplerAddressMode address_mode;
+	cast_sampler_address_mode_vk(sampler->info.address_mode, &address_mode);
+
+	VkFilter filter;
+	VkSamplerMipmapMode mipmap_mode;
+	cast_filter_vk(sampler->info, &filter, &mipmap_mode);
+
+	VkSamplerCreateInfo samplerCI{};
+	samplerCI.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCI.addressModeU = address_mode;
+	samplerCI.addressModeV = address_mode;
+	samplerCI.addressModeW = address_mode;
+	samplerCI.minFilter = filter;
+	samplerCI.magFilter = filter;
+	samplerCI.anisotropyEnable = VK_FALSE; // TODO:
+	samplerCI.maxAnisotropy = vk->pdevice_chosen->device_props.limits.maxSamplerAnisotropy;
+	samplerCI.borderColor;// TODO:
+	samplerCI.unnormalizedCoordinates = VK_FALSE;
+	samplerCI.compareEnable = VK_FALSE;
+	samplerCI.mipmapMode = mipmap_mode;
+	samplerCI.mipLodBias = 0.0f;
+	samplerCI.minLod = sampler->info.min_lod;
+	samplerCI.maxLod = sampler->info.max_lod;
+
+	VK_CHECK(vkCreateSampler(vk->device, &samplerCI, nullptr, &sampler->vk.handle));
+}
+
+static void vk_destroy_sampler(VIVulkan* vk, VISampler sampler)
+{
+	vkDestroySampler(vk->device, sampler->vk.handle, nullptr);
+	sampler->vk.handle = VK_NULL_HANDLE;
+}
+
+static void vk_create_framebuffer(VIVulkan* vk, VIFramebuffer fb, VIPass pass, VkExtent2D extent, uint32_t atch_count, VIImage* atchs)
+{
+	VkImageView attachments[32];
+	VI_ASSERT(atch_count <= VI_ARR_SIZE(attachments));
+	for (uint32_t i = 0; i < atch_count; i++)
+		attachments[i] = atchs[i]->vk.view_handle;
+
+	VkFramebufferCreateInfo fbI{};
+	fbI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	fbI.width = extent.width;
+	fbI.height = extent.height;
+	fbI.layers = 1;
+	fbI.attachmentCount = atch_count;
+	fbI.pAttachments = attachments;
+	fbI.renderPass = pass->vk.handle;
+
+	VK_CHECK(vkCreateFramebuffer(vk->device, &fbI, NULL, &fb->vk.handle));
+}
+
+static void vk_destroy_framebuffer(VIVulkan* vk, VIFramebuffer fb)
+{
+	vkDestroyFramebuffer(vk->device, fb->vk.handle, NULL);
+
+	fb->vk.handle = VK_NULL_HANDLE;
+}
+
+static void vk_alloc_cmd_buffer(VIVulkan* vk, VICommand cmd, VkCommandPool pool, VkCommandBufferLevel level)
+{
+	VkCommandBufferAllocateInfo bufferAI{};
+	bufferAI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	bufferAI.level = level;
 	bufferAI.commandPool = pool;
 	bufferAI.commandBufferCount = 1;
 
 	VK_CHECK(vkAllocateCommandBuffers(vk->device, &bufferAI, &cmd->vk.handle));
+	cmd->vk.scratch = nullptr;
 }
 
 static void vk_free_cmd_buffer(VIVulkan* vk, VICommand cmd)
@@ -1765,6 +3189,86 @@ static void vk_free_cmd_buffer(VIVulkan* vk, VICommand cmd)
 	vkFreeCommandBuffers(vk->device, pool->vk_handle, 1, &cmd->vk.handle);
 }
 
+// appends data to the scratch chunks of a command, the chunks are reused once the command
+// begins recording again, at which point its previous submission must have completed
+static VkBuffer vk_cmd_write_scratch(VICommand cmd, const void* data, uint32_t size, VkDeviceSize* offset)
+{
+	VI_ASSERT(size <= VI_VK_COMMAND_SCRATCH_SIZE);
+
+	VICommandScratch* scratch = cmd->vk.scratch;
+
+	if (!scratch)
+	{
+		scratch = (VICommandScratch*)vi_device_malloc(cmd->device, sizeof(VICommandScratch));
+		new (scratch) VICommandScratch();
+		scratch->chunk_idx = 0;
+		scratch->chunk_offset = 0;
+		cmd->vk.scratch = scratch;
+	}
+
+	if (scratch->chunk_idx < scratch->chunks.size() && scratch->chunk_offset + size > VI_VK_COMMAND_SCRATCH_SIZE)
+	{
+		scratch->chunk_idx++;
+		scratch->chunk_offset = 0;
+	}
+
+	if (scratch->chunk_idx == scratch->chunks.size())
+	{
+		// VI_BUFFER_USAGE_CONDITIONAL_BIT includes VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+		VIBufferInfo bufferI;
+		bufferI.type = VI_BUFFER_TYPE_STORAGE;
+		bufferI.usage = VI_BUFFER_USAGE_CONDITIONAL_BIT;
+		bufferI.size = VI_VK_COMMAND_SCRATCH_SIZE;
+		bufferI.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		VIBuffer chunk = vi_create_buffer(cmd->device, &bufferI);
+		vi_buffer_map(chunk);
+		scratch->chunks.push_back(chunk);
+	}
+
+	VIBuffer chunk = scratch->chunks[scratch->chunk_idx];
+	memcpy(chunk->map + scratch->chunk_offset, data, size);
+	*offset = (VkDeviceSize)scratch->chunk_offset;
+	scratch->chunk_offset += size;
+
+	return chunk->vk.handle;
+}
+
+static void vk_free_cmd_scratch(VICommand cmd)
+{
+	VICommandScratch* scratch = cmd->vk.scratch;
+
+	if (!scratch)
+		return;
+
+	for (VIBuffer chunk : scratch->chunks)
+	{
+		vi_buffer_unmap(chunk);
+		vi_destroy_buffer(cmd->device, chunk);
+	}
+
+	scratch->~VICommandScratch();
+	vi_free(scratch);
+	cmd->vk.scratch = nullptr;
+}
+
+// VK_EXT_conditional_rendering reads predicates in its own pipeline stage, the indirect draw fallback
+// reads them as draw count. barriers to or from the draw indirect stage cover both
+static VkPipelineStageFlags vk_conditional_stages(const VIVulkan* vk, VkPipelineStageFlags stages)
+{
+	if (vk->supports_conditional_rendering && (stages & VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT))
+		stages |= VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT;
+
+	return stages;
+}
+
+static VkAccessFlags vk_conditional_access(const VIVulkan* vk, VkAccessFlags access)
+{
+	if (vk->supports_conditional_rendering && (access & VK_ACCESS_INDIRECT_COMMAND_READ_BIT))
+		access |= VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT;
+
+	return access;
+}
+
 static bool vk_has_format_features(VIVulkan* vk, VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features)
 {
 	VkFormatProperties props;
@@ -1920,9 +3424,14 @@ static void vk_default_destroy_image(VIImage image)
 static void gl_device_present_frame(VIDevice device)
 {
 	VIOpenGL* gl = &device->gl;
-	GLFWwindow* window = glfwGetCurrentContext();
 
-	glfwSwapBuffers(window);
+	if (device->headless)
+	{
+		glFlush();
+		return;
+	}
+
+	glfwSwapBuffers(gl->window);
 }
 
 // append a submission that will later be executed once all wait semaphores are signaled
@@ -1945,6 +3454,8 @@ static void gl_device_append_submission(VIDevice device, const VISubmitInfo* sub
 // returns the number of submissions flushed in queue
 static int gl_device_flush_submission(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	int total_flush_count = 0;
 	int flush_count;
 
@@ -1996,7 +3507,7 @@ static int gl_device_flush_submission(VIDevice device)
 	return total_flush_count;
 }
 
-static void gl_create_module(VIDevice device, VIModule module, const VIModuleInfo* info)
+static bool gl_create_module(VIDevice device, VIModule module, const VIModuleInfo* info)
 {
 	VI_ASSERT(info->pipeline_layout);
 
@@ -2016,13 +3527,14 @@ static void gl_create_module(VIDevice device, VIModule module, const VIModuleInf
 	if (info->vise_binary)
 	{
 		VIBinaryHeader header;
-		uint8_t* now = (uint8_t*)info->vise_binary;
-		sread_header(&now, &header);
-		uint32_t header_size = header.header_size;
+		if (!check_module_binary(VI_BACKEND_OPENGL, info, &header))
+			return false;
+
+		uint8_t* now = (uint8_t*)info->vise_binary + header.glpc_offset;
 
 		// load GL push constant table, used during gl_cmd_execute_push_constants
 		module->gl.push_constant_count = header.glpc_count;
-		module->gl.push_constants = (GLPushConstant*)vi_malloc(sizeof(GLPushConstant) * header.glpc_count);
+		module->gl.push_constants = (GLPushConstant*)vi_device_malloc(device, sizeof(GLPushConstant) * header.glpc_count);
 		for (uint32_t i = 0; i < module->gl.push_constant_count; i++)
 		{
 			new (module->gl.push_constants + i)GLPushConstant();
@@ -2030,19 +3542,21 @@ static void gl_create_module(VIDevice device, VIModule module, const VIModuleInf
 		}
 
 		// load patched GLSL
-		glsl_size = (GLint)header.payload_size;
-		glsl_data = ((const char*)info->vise_binary) + header_size;
+		glsl_size = (GLint)header.glsl_size;
+		glsl_data = ((const char*)info->vise_binary) + header.glsl_offset;
 	}
 	else if (info->vise_glsl)
 	{
-		compile_gl(result, stage, info->vise_glsl, remap_count, remaps);
+		compile_gl(result, stage, info->vise_glsl, info->include_resolver, remap_count, remaps);
+		if (!result.success)
+			std::cout << "vise compile_gl failed\n" << result.error << std::endl;
 		VI_ASSERT(result.success && "gl_create_module: compilation failed");
 		glsl_size = (GLint)result.gl_patched.size();
 		glsl_data = (const char*)result.gl_patched.data();
 
 		// copy GL push constant table to VIModule
 		module->gl.push_constant_count = (uint32_t)result.gl_push_constants.size();
-		module->gl.push_constants = (GLPushConstant*)vi_malloc(sizeof(GLPushConstant) * module->gl.push_constant_count);
+		module->gl.push_constants = (GLPushConstant*)vi_device_malloc(device, sizeof(GLPushConstant) * module->gl.push_constant_count);
 		for (uint32_t i = 0; i < module->gl.push_constant_count; i++)
 		{
 			new (module->gl.push_constants + i)GLPushConstant();
@@ -2052,21 +3566,15 @@ static void gl_create_module(VIDevice device, VIModule module, const VIModuleInf
 	else
 		VI_UNREACHABLE;
 
-	GLuint shader = module->gl.shader = glCreateShader(glstage);
-	glShaderSource(shader, 1, &glsl_data, &glsl_size);
-	glCompileShader(shader);
+	// keep patched GLSL around for specialized variants
+	module->gl.glsl_size = glsl_size;
+	module->gl.glsl = (char*)vi_device_malloc(device, glsl_size);
+	module->gl.variants = nullptr;
+	memcpy(module->gl.glsl, glsl_data, glsl_size);
 
-	GLint success;
-	std::string infoLog;
-	infoLog.resize(512);
+	module->gl.shader = gl_compile_shader(glstage, 1, &glsl_data, &glsl_size);
 
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(shader, infoLog.size(), NULL, infoLog.data());
-		std::cout << "vise glCompileShader failed\n" << infoLog << std::endl;
-	}
-	VI_ASSERT(success);
+	return true;
 }
 
 static void gl_destroy_module(VIDevice device, VIModule module)
@@ -2078,33 +3586,137 @@ static void gl_destroy_module(VIDevice device, VIModule module)
 		vi_free(module->gl.push_constants);
 	}
 
+	if (module->gl.variants)
+	{
+		for (GLModuleVariant& variant : *module->gl.variants)
+			glDeleteShader(variant.shader);
+
+		module->gl.variants->~vector();
+		vi_free(module->gl.variants);
+	}
+
+	vi_free(module->gl.glsl);
 	glDeleteShader(module->gl.shader);
 }
 
-static void gl_create_pipeline_layout(VIDevice device, VIPipelineLayout layout, const VIPipelineLayoutInfo* info)
+static GLuint gl_compile_shader(GLenum glstage, GLsizei count, const char** strings, const GLint* sizes)
 {
-	uint32_t set_count = layout->set_layouts.size();
-	std::vector<uint32_t> binding_counts(set_count);
-	std::vector<const VIBinding*> set_bindings(set_count);
+	VI_TRACE_FUNC;
 
-	for (uint32_t i = 0; i < set_count; i++)
+	GLuint shader = glCreateShader(glstage);
+	glShaderSource(shader, count, strings, sizes);
+	glCompileShader(shader);
+
+	GLint success;
+	std::string infoLog;
+	infoLog.resize(512);
+
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success)
 	{
-		binding_counts[i] = (uint32_t)layout->set_layouts[i]->bindings.size();
-	
-		for (uint32_t j = 0; j < binding_counts[i]; j++)
-			set_bindings[i] = layout->set_layouts[i]->bindings.data();
+		glGetShaderInfoLog(shader, infoLog.size(), NULL, infoLog.data());
+		std::cout << "vise glCompileShader failed\n" << infoLog << std::endl;
 	}
+	VI_ASSERT(success);
 
-	std::vector<GLRemap> remaps;
-	gl_remap(remaps, set_count, binding_counts.data(), set_bindings.data());
+	return shader;
+}
 
-	uint32_t remap_count = (uint32_t)remaps.size();
-	layout->gl.remap_count = remap_count;
+static GLuint gl_module_variant(VIModule module, const VISpecializationInfo* info)
+{
+	VI_TRACE_FUNC;
 
-	if (remap_count > 0)
+	if (!info || info->constant_count == 0)
+		return module->gl.shader;
+
+	std::string defines;
+	char define[128];
+
+	for (uint32_t i = 0; i < info->constant_count; i++)
 	{
-		layout->gl.remaps = (GLRemap*)vi_malloc(sizeof(GLRemap) * remap_count);
-		for (uint32_t i = 0; i < remap_count; i++)
+		const VISpecializationConstant& constant = info->constants[i];
+		const uint8_t* value = (const uint8_t*)info->data + constant.offset;
+		VI_ASSERT(constant.offset + 4 <= info->data_size);
+
+		int len = snprintf(define, sizeof(define), "#define SPIRV_CROSS_CONSTANT_ID_%u ", constant.constant_id);
+
+		switch (constant.type)
+		{
+		case VI_GLSL_TYPE_BOOL:
+			snprintf(define + len, sizeof(define) - len, "%s\n", *(const uint32_t*)value ? "true" : "false");
+			break;
+		case VI_GLSL_TYPE_INT:
+			snprintf(define + len, sizeof(define) - len, "%d\n", *(const int32_t*)value);
+			break;
+		case VI_GLSL_TYPE_UINT:
+			snprintf(define + len, sizeof(define) - len, "%uu\n", *(const uint32_t*)value);
+			break;
+		case VI_GLSL_TYPE_FLOAT:
+			snprintf(define + len, sizeof(define) - len, "%.9e\n", *(const float*)value);
+			break;
+		default:
+			VI_UNREACHABLE;
+		}
+
+		defines += define;
+	}
+
+	if (!module->gl.variants)
+	{
+		module->gl.variants = (std::vector<GLModuleVariant>*)vi_device_malloc(module->device, sizeof(std::vector<GLModuleVariant>));
+		new (module->gl.variants) std::vector<GLModuleVariant>();
+	}
+
+	for (const GLModuleVariant& variant : *module->gl.variants)
+	{
+		if (variant.defines == defines)
+			return variant.shader;
+	}
+
+	// defines must be inserted after the #version directive
+	const char* glsl = module->gl.glsl;
+	const char* newline = (const char*)memchr(glsl, '\n', module->gl.glsl_size);
+	VI_ASSERT(newline != nullptr);
+
+	GLint version_size = (GLint)(newline - glsl + 1);
+	const char* strings[3] = { glsl, defines.c_str(), newline + 1 };
+	GLint sizes[3] = { version_size, (GLint)defines.size(), module->gl.glsl_size - version_size };
+
+	GLenum glstage;
+	cast_module_type_gl(module->type, &glstage);
+
+	GLModuleVariant variant;
+	variant.defines = std::move(defines);
+	variant.shader = gl_compile_shader(glstage, 3, strings, sizes);
+	module->gl.variants->push_back(variant);
+
+	return variant.shader;
+}
+
+static void gl_create_pipeline_layout(VIDevice device, VIPipelineLayout layout, const VIPipelineLayoutInfo* info)
+{
+	uint32_t set_count = layout->set_layouts.size();
+	std::vector<uint32_t> binding_counts(set_count);
+	std::vector<const VIBinding*> set_bindings(set_count);
+
+	for (uint32_t i = 0; i < set_count; i++)
+	{
+		binding_counts[i] = (uint32_t)layout->set_layouts[i]->bindings.size();
+	
+		for (uint32_t j = 0; j < binding_counts[i]; j++)
+			set_bindings[i] = layout->set_layouts[i]->bindings.data();
+	}
+
+	std::vector<GLRemap> remaps;
+	gl_remap(remaps, set_count, binding_counts.data(), set_bindings.data());
+
+	uint32_t remap_count = (uint32_t)remaps.size();
+	layout->gl.remap_count = remap_count;
+
+	if (remap_count > 0)
+	{
+		layout->gl.remaps = (GLRemap*)vi_device_malloc(device, sizeof(GLRemap) * remap_count);
+		for (uint32_t i = 0; i < remap_count; i++)
 			layout->gl.remaps[i] = remaps[i];
 	}
 	else
@@ -2134,6 +3746,8 @@ static void gl_remap(std::vector<GLRemap>& remaps, uint32_t set_count, uint32_t*
 			{
 			case VI_BINDING_TYPE_STORAGE_BUFFER:
 			case VI_BINDING_TYPE_UNIFORM_BUFFER:
+			case VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC:
+			case VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC:
 				remap.gl_binding = buffer_remap_count;
 				buffer_remap_count += binding->array_count;
 				break;
@@ -2159,12 +3773,14 @@ static void gl_destroy_pipeline_layout(VIDevice device, VIPipelineLayout layout)
 		vi_free(layout->gl.remaps);
 }
 
-static void gl_create_pipeline(VIDevice device, VIPipeline pipeline, uint32_t module_count, VIModule* modules)
+static void gl_create_pipeline(VIDevice device, VIPipeline pipeline, uint32_t module_count, VIModule* modules, const VISpecializationInfo* specialization)
 {
+	VI_TRACE_FUNC;
+
 	pipeline->gl.program = glCreateProgram();
 
 	for (uint32_t i = 0; i < module_count; i++)
-		glAttachShader(pipeline->gl.program, modules[i]->gl.shader);
+		glAttachShader(pipeline->gl.program, gl_module_variant(modules[i], specialization));
 
 	glLinkProgram(pipeline->gl.program);
 
@@ -2214,11 +3830,13 @@ static void gl_destroy_pipeline(VIDevice device, VIPipeline pipeline)
 	glDeleteProgram(pipeline->gl.program);
 }
 
-static void gl_create_compute_pipeline(VIDevice device, VIComputePipeline pipeline, VIModule compute_module)
+static void gl_create_compute_pipeline(VIDevice device, VIComputePipeline pipeline, VIModule compute_module, const VISpecializationInfo* specialization)
 {
+	VI_TRACE_FUNC;
+
 	pipeline->gl.program = glCreateProgram();
 
-	glAttachShader(pipeline->gl.program, compute_module->gl.shader);
+	glAttachShader(pipeline->gl.program, gl_module_variant(compute_module, specialization));
 	glLinkProgram(pipeline->gl.program);
 
 	GLint success;
@@ -2242,7 +3860,7 @@ static void gl_create_buffer(VIDevice device, VIBuffer buffer, const VIBufferInf
 {
 	if (info->type == VI_BUFFER_TYPE_TRANSFER)
 	{
-		buffer->map = (uint8_t*)vi_malloc(buffer->size);
+		buffer->map = (uint8_t*)vi_device_malloc(device, buffer->size);
 		buffer->gl.target = GL_NONE;
 		return;
 	}
@@ -2293,26 +3911,49 @@ static void gl_create_image(VIOpenGL* gl, VIImage image, const VIImageInfo* info
 
 	GL_CHECK();
 
-	GLenum address_mode;
-	cast_sampler_address_mode_gl(image->info.sampler.address_mode, &address_mode);
-	GL_CHECK(glTexParameteri(target, GL_TEXTURE_WRAP_S, address_mode));
-	GL_CHECK(glTexParameteri(target, GL_TEXTURE_WRAP_T, address_mode));
+	// sets bind the shared sampler object with glBindSampler, the texture parameters mirror the
+	// default sampler for code sampling the unwrapped texture without a sampler object, such as Dear ImGui
+	const VISamplerInfo& sampler = image->sampler->info;
+	GLenum address_mode, min_filter, mag_filter;
+	cast_sampler_address_mode_gl(sampler.address_mode, &address_mode);
+	cast_filter_gl(sampler, &min_filter, &mag_filter);
+
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, address_mode);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, address_mode);
+	glTexParameteri(target, GL_TEXTURE_WRAP_R, address_mode);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, min_filter);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, mag_filter);
+	glTexParameterf(target, GL_TEXTURE_MIN_LOD, sampler.min_lod);
+	glTexParameterf(target, GL_TEXTURE_MAX_LOD, sampler.max_lod);
+	GL_CHECK();
+}
+
+static void gl_destroy_image(VIOpenGL* gl, VIImage image)
+{
+	GL_CHECK(glDeleteTextures(1, &image->gl.handle));
+}
 
-	if (target == GL_TEXTURE_CUBE_MAP)
-		GL_CHECK(glTexParameteri(target, GL_TEXTURE_WRAP_R, address_mode));
+static void gl_create_sampler(VIOpenGL* gl, VISampler sampler)
+{
+	GLenum address_mode;
+	cast_sampler_address_mode_gl(sampler->info.address_mode, &address_mode);
 
 	GLenum min_filter, mag_filter;
-	cast_filter_gl(image->info.sampler, &min_filter, &mag_filter);
-	GL_CHECK(glTexParameteri(target, GL_TEXTURE_MIN_FILTER, min_filter));
-	GL_CHECK(glTexParameteri(target, GL_TEXTURE_MAG_FILTER, mag_filter));
+	cast_filter_gl(sampler->info, &min_filter, &mag_filter);
 
-	GL_CHECK(glTexParameterf(target, GL_TEXTURE_MIN_LOD, info->sampler.min_lod));
-	GL_CHECK(glTexParameterf(target, GL_TEXTURE_MAX_LOD, info->sampler.max_lod));
+	GL_CHECK(glCreateSamplers(1, &sampler->gl.handle));
+	GL_CHECK(glSamplerParameteri(sampler->gl.handle, GL_TEXTURE_WRAP_S, address_mode));
+	GL_CHECK(glSamplerParameteri(sampler->gl.handle, GL_TEXTURE_WRAP_T, address_mode));
+	GL_CHECK(glSamplerParameteri(sampler->gl.handle, GL_TEXTURE_WRAP_R, address_mode));
+	GL_CHECK(glSamplerParameteri(sampler->gl.handle, GL_TEXTURE_MIN_FILTER, min_filter));
+	GL_CHECK(glSamplerParameteri(sampler->gl.handle, GL_TEXTURE_MAG_FILTER, mag_filter));
+	GL_CHECK(glSamplerParameterf(sampler->gl.handle, GL_TEXTURE_MIN_LOD, sampler->info.min_lod));
+	GL_CHECK(glSamplerParameterf(sampler->gl.handle, GL_TEXTURE_MAX_LOD, sampler->info.max_lod));
 }
 
-static void gl_destroy_image(VIOpenGL* gl, VIImage image)
+static void gl_destroy_sampler(VIOpenGL* gl, VISampler sampler)
 {
-	GL_CHECK(glDeleteTextures(1, &image->gl.handle));
+	GL_CHECK(glDeleteSamplers(1, &sampler->gl.handle));
 }
 
 static void gl_create_framebuffer(VIOpenGL* gl, VIFramebuffer fb, const VIFramebufferInfo* info)
@@ -2352,8 +3993,7 @@ static void gl_destroy_framebuffer(VIOpenGL* gl, VIFramebuffer fb)
 static void gl_create_swapchain_framebuffer(VIOpenGL* gl, VIFramebuffer fb)
 {
 	int width, height;
-	GLFWwindow* window = glfwGetCurrentContext();
-	glfwGetFramebufferSize(window, &width, &height);
+	glfwGetFramebufferSize(gl->window, &width, &height);
 
 	fb->device = gl->vi_device;
 	fb->gl.handle = 0;
@@ -2361,6 +4001,90 @@ static void gl_create_swapchain_framebuffer(VIOpenGL* gl, VIFramebuffer fb)
 	fb->extent.height = (uint32_t)height;
 }
 
+#ifdef VI_PLATFORM_LINUX
+// OpenGL 4.6 core context without any window system, EGL_MESA_platform_surfaceless
+// lets llvmpipe and GPU drivers render on machines without a display server
+static void gl_create_headless_context(VIOpenGL* gl)
+{
+	EGLDisplay display = EGL_NO_DISPLAY;
+
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display)
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	VI_ASSERT(display != EGL_NO_DISPLAY);
+
+	EGLint major, minor;
+	EGLBoolean success = eglInitialize(display, &major, &minor);
+	VI_ASSERT(success);
+
+	success = eglBindAPI(EGL_OPENGL_API);
+	VI_ASSERT(success);
+
+	const EGLint config_attribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE,
+	};
+
+	EGLConfig config;
+	EGLint config_count = 0;
+	success = eglChooseConfig(display, config_attribs, &config, 1, &config_count);
+	VI_ASSERT(success && config_count > 0);
+
+	const EGLint context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 6,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE,
+	};
+
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+	VI_ASSERT(context != EGL_NO_CONTEXT);
+
+	// requires EGL_KHR_surfaceless_context, all rendering goes to framebuffer objects
+	success = eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+	VI_ASSERT(success);
+
+	gl->egl_display = display;
+	gl->egl_context = context;
+}
+
+static void gl_destroy_headless_context(VIOpenGL* gl)
+{
+	// the display is shared by all headless devices in the process and is never terminated
+	eglMakeCurrent(gl->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(gl->egl_display, gl->egl_context);
+
+	gl->egl_display = EGL_NO_DISPLAY;
+	gl->egl_context = EGL_NO_CONTEXT;
+}
+#endif
+
+// platforms without EGL give headless devices a hidden GLFW window that owns a 4.6 core context,
+// all rendering goes to framebuffer objects. GLFW requires this to run on the main thread
+static void gl_create_hidden_context(VIOpenGL* gl)
+{
+	int success = glfwInit();
+	VI_ASSERT(success);
+
+	glfwDefaultWindowHints();
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	gl->window = glfwCreateWindow(1, 1, "vise headless", nullptr, nullptr);
+	VI_ASSERT(gl->window);
+	gl->owns_window = true;
+
+	// GLFW stays initialized, the application or other devices may still use it
+	glfwDefaultWindowHints();
+	glfwMakeContextCurrent(gl->window);
+}
+
 static void gl_create_swapchain_pass(VIOpenGL* gl, VIPass pass)
 {
 	// TODO: single source of truth with vulkan swapchain pass
@@ -2391,7 +4115,7 @@ static void gl_alloc_cmd_buffer(VIDevice device, VICommand cmd)
 {
 	cmd->gl.list_capacity = VI_GL_COMMAND_LIST_CAPACITY;
 	cmd->gl.list_size = 0;
-	cmd->gl.list = (GLCommand*)vi_malloc(sizeof(GLCommand) * VI_GL_COMMAND_LIST_CAPACITY);
+	cmd->gl.list = (GLCommand*)vi_device_malloc(device, sizeof(GLCommand) * VI_GL_COMMAND_LIST_CAPACITY);
 }
 
 static void gl_free_command(VIDevice device, VICommand cmd)
@@ -2403,17 +4127,26 @@ static void gl_free_command(VIDevice device, VICommand cmd)
 
 static void gl_alloc_set(VIDevice device, VISet set)
 {
-	size_t binding_count = set->layout->bindings.size();
-	VI_ASSERT(binding_count > 0);
+	// one binding site per array element
+	size_t site_count = set->layout->descriptor_count;
+	VI_ASSERT(site_count > 0);
 
-	set->gl.binding_sites = (void**)vi_malloc(sizeof(void*) * binding_count);
+	set->gl.binding_sites = (void**)vi_device_malloc(device, sizeof(void*) * site_count);
+	set->gl.binding_ranges = (uint32_t*)vi_device_malloc(device, sizeof(uint32_t) * site_count);
+	set->gl.binding_samplers = (VISampler*)vi_device_malloc(device, sizeof(VISampler) * site_count);
 
-	for (uint32_t i = 0; i < binding_count; i++)
+	for (uint32_t i = 0; i < site_count; i++)
+	{
 		set->gl.binding_sites[i] = nullptr;
+		set->gl.binding_ranges[i] = 0;
+		set->gl.binding_samplers[i] = VI_NULL;
+	}
 }
 
 static void gl_free_set(VIDevice device, VISet set)
 {
+	vi_free(set->gl.binding_samplers);
+	vi_free(set->gl.binding_ranges);
 	vi_free(set->gl.binding_sites);
 }
 
@@ -2422,18 +4155,24 @@ static void gl_set_update(VISet set, uint32_t update_count, const VISetUpdateInf
 	for (uint32_t i = 0; i < update_count; i++)
 	{
 		uint32_t binding = updates[i].binding_index;
+		VI_ASSERT(updates[i].array_index < set->layout->bindings[binding].array_count);
+		uint32_t site = set->layout->descriptor_offsets[binding] + updates[i].array_index;
 
 		switch (set->layout->bindings[binding].type)
 		{
 		case VI_BINDING_TYPE_UNIFORM_BUFFER:
 		case VI_BINDING_TYPE_STORAGE_BUFFER:
+		case VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC:
 			VI_ASSERT(updates[i].buffer);
-			set->gl.binding_sites[binding] = (void*)updates[i].buffer;
+			set->gl.binding_sites[site] = (void*)updates[i].buffer;
+			set->gl.binding_ranges[site] = updates[i].buffer_range;
 			break;
 		case VI_BINDING_TYPE_STORAGE_IMAGE:
 		case VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER:
 			VI_ASSERT(updates[i].image);
-			set->gl.binding_sites[binding] = (void*)updates[i].image;
+			set->gl.binding_sites[site] = (void*)updates[i].image;
+			set->gl.binding_samplers[site] = updates[i].sampler ? updates[i].sampler : updates[i].image->sampler;
 			break;
 		default:
 			VI_UNREACHABLE;
@@ -2441,6 +4180,44 @@ static void gl_set_update(VISet set, uint32_t update_count, const VISetUpdateInf
 	}
 }
 
+static void gl_set_update_batch(uint32_t set_count, const VISet* sets, const VISetResource* resources)
+{
+	for (uint32_t i = 0; i < set_count; i++)
+	{
+		VISetLayout layout = sets[i]->layout;
+		void** sites = sets[i]->gl.binding_sites;
+		uint32_t* ranges = sets[i]->gl.binding_ranges;
+		VISampler* samplers = sets[i]->gl.binding_samplers;
+
+		// binding sites are already packed in the same order as the resources
+		for (const VIBinding& binding : layout->bindings)
+		{
+			for (uint32_t j = 0; j < binding.array_count; j++, sites++, ranges++, samplers++, resources++)
+			{
+				switch (binding.type)
+				{
+				case VI_BINDING_TYPE_UNIFORM_BUFFER:
+				case VI_BINDING_TYPE_STORAGE_BUFFER:
+				case VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC:
+				case VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC:
+					VI_ASSERT(resources->buffer);
+					*sites = (void*)resources->buffer;
+					*ranges = resources->buffer_range;
+					break;
+				case VI_BINDING_TYPE_STORAGE_IMAGE:
+				case VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER:
+					VI_ASSERT(resources->image);
+					*sites = (void*)resources->image;
+					*samplers = resources->sampler ? resources->sampler : resources->image->sampler;
+					break;
+				default:
+					VI_UNREACHABLE;
+				}
+			}
+		}
+	}
+}
+
 static void gl_pipeline_layout_get_remapped_binding(VIPipelineLayout layout,
 	uint32_t set_index, uint32_t binding_idx, uint32_t* remapped_binding)
 {
@@ -2501,13 +4278,14 @@ static void gl_copy_buffer_to_image(VIBuffer buffer, VIImage image, uint32_t buf
 	cast_format_gl(image->info.format, &internal_format, &data_format, &data_type, &texel_size);
 	uint32_t layer_start = image_subresource.baseArrayLayer;
 	uint32_t layer_count = image_subresource.layerCount;
-	uint32_t layer_size = image_extent.width * image_extent.height * image_extent.depth * texel_size;
+	uint32_t layer_size = vi_format_get_data_size(image->info.format, image_extent.width, image_extent.height) * image_extent.depth;
 	uint32_t access_size = layer_size * layer_count;
+	bool compressed = is_format_compressed(image->info.format);
 
 	VI_ASSERT(buffer_offset + access_size <= buffer->size);
 
 	if (!buffer->map)
-		buffer->map = (uint8_t*)vi_malloc(buffer->size);
+		buffer->map = (uint8_t*)vi_device_malloc(buffer->device, buffer->size);
 	void* data = buffer->map + buffer_offset;
 
 	if (buffer->type != VI_BUFFER_TYPE_TRANSFER)
@@ -2520,24 +4298,36 @@ static void gl_copy_buffer_to_image(VIBuffer buffer, VIImage image, uint32_t buf
 
 	uint32_t mip_level = image_subresource.mipLevel;
 
+	// block-compressed data is uploaded as is, the internal format describes the block layout
+
 	if (image->info.type == VI_IMAGE_TYPE_2D)
 	{
 		glBindTexture(GL_TEXTURE_2D, image->gl.handle);
-		glTexSubImage2D(GL_TEXTURE_2D, mip_level, image_offset.x, image_offset.y, image_extent.width, image_extent.height, data_format, data_type, data);
+		if (compressed)
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, mip_level, image_offset.x, image_offset.y, image_extent.width, image_extent.height, internal_format, layer_size, data);
+		else
+			glTexSubImage2D(GL_TEXTURE_2D, mip_level, image_offset.x, image_offset.y, image_extent.width, image_extent.height, data_format, data_type, data);
 	}
 	else if (image->info.type == VI_IMAGE_TYPE_2D_ARRAY)
 	{
 		glBindTexture(GL_TEXTURE_2D_ARRAY, image->gl.handle);
-		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip_level, image_offset.x, image_offset.y, layer_start, image_extent.width, image_extent.height, layer_count, data_format, data_type, data);
+		if (compressed)
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip_level, image_offset.x, image_offset.y, layer_start, image_extent.width, image_extent.height, layer_count, internal_format, access_size, data);
+		else
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip_level, image_offset.x, image_offset.y, layer_start, image_extent.width, image_extent.height, layer_count, data_format, data_type, data);
 	}
 	else if (image->info.type == VI_IMAGE_TYPE_CUBE)
 	{
 		glBindTexture(GL_TEXTURE_CUBE_MAP, image->gl.handle);
 
-		for (uint32_t i = layer_start; i < layer_count; i++)
+		for (uint32_t i = 0; i < layer_count; i++)
 		{
 			uint8_t* face_data = (uint8_t*)data + layer_size * i;
-			glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip_level, image_offset.x, image_offset.y, image_extent.width, image_extent.height,data_format, data_type, face_data);
+			GLenum face = GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer_start + i;
+			if (compressed)
+				glCompressedTexSubImage2D(face, mip_level, image_offset.x, image_offset.y, image_extent.width, image_extent.height, internal_format, layer_size, face_data);
+			else
+				glTexSubImage2D(face, mip_level, image_offset.x, image_offset.y, image_extent.width, image_extent.height, data_format, data_type, face_data);
 		}
 	}
 	else
@@ -2595,28 +4385,34 @@ static void gl_copy_image_to_buffer(VIImage image, VIBuffer buffer, uint32_t buf
 	cast_format_gl(image->info.format, &internal_format, &data_format, &data_type, &texel_size);
 	uint32_t layer_start = image_subresource.baseArrayLayer;
 	uint32_t layer_count = image_subresource.layerCount;
-	uint32_t layer_size = image_extent.width * image_extent.height * image_extent.depth * texel_size;
+	uint32_t layer_size = vi_format_get_data_size(image->info.format, image_extent.width, image_extent.height) * image_extent.depth;
 	uint32_t access_size = layer_size * layer_count;
+	bool compressed = is_format_compressed(image->info.format);
 	
 	VI_ASSERT(buffer_offset + access_size <= buffer->size);
 
 	if (!buffer->map)
-		buffer->map = (uint8_t*)vi_malloc(buffer->size);
+		buffer->map = (uint8_t*)vi_device_malloc(buffer->device, buffer->size);
 	void* data = buffer->map + buffer_offset;
 
 	uint32_t mip_level = image_subresource.mipLevel;
 
-	if (image->info.type == VI_IMAGE_TYPE_2D)
-	{
-		glGetTextureSubImage(image->gl.handle, mip_level, image_offset.x, image_offset.y, image_offset.z, image_extent.width, image_extent.height, image_extent.depth, data_format, data_type, access_size, data);
-	}
-	else if (image->info.type == VI_IMAGE_TYPE_2D_ARRAY || image->info.type == VI_IMAGE_TYPE_CUBE)
+	GLint offset_z = image_offset.z;
+	GLsizei depth = image_extent.depth;
+
+	if (image->info.type == VI_IMAGE_TYPE_2D_ARRAY || image->info.type == VI_IMAGE_TYPE_CUBE)
 	{
-		glGetTextureSubImage(image->gl.handle, mip_level, image_offset.x, image_offset.y, layer_start, image_extent.width, image_extent.height, layer_count, data_format, data_type, access_size, data);
+		offset_z = layer_start;
+		depth = layer_count;
 	}
-	else
+	else if (image->info.type != VI_IMAGE_TYPE_2D)
 		VI_UNREACHABLE;
 
+	if (compressed)
+		glGetCompressedTextureSubImage(image->gl.handle, mip_level, image_offset.x, image_offset.y, offset_z, image_extent.width, image_extent.height, depth, access_size, data);
+	else
+		glGetTextureSubImage(image->gl.handle, mip_level, image_offset.x, image_offset.y, offset_z, image_extent.width, image_extent.height, depth, data_format, data_type, access_size, data);
+
 	GL_CHECK();
 
 	if (buffer->type == VI_BUFFER_TYPE_TRANSFER)
@@ -2632,7 +4428,7 @@ static GLCommand* gl_append_command(VICommand cmd, GLCommandType type)
 	if (cmd->gl.list_size == cmd->gl.list_capacity)
 	{
 		uint32_t new_capacity = cmd->gl.list_capacity * 2;
-		GLCommand* new_list = (GLCommand*)vi_malloc(sizeof(GLCommand) * new_capacity);
+		GLCommand* new_list = (GLCommand*)vi_device_malloc(cmd->device, sizeof(GLCommand) * new_capacity);
 
 		memcpy(new_list, cmd->gl.list, sizeof(GLCommand) * cmd->gl.list_capacity);
 		vi_free(cmd->gl.list);
@@ -2647,6 +4443,69 @@ static GLCommand* gl_append_command(VICommand cmd, GLCommandType type)
 	return glcmd;
 }
 
+static void gl_cmd_push_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_idx, uint32_t update_count, const VISetUpdateInfo* updates)
+{
+	VI_ASSERT(layout->set_layouts[set_idx]->flags & VI_SET_LAYOUT_PUSH_BIT);
+
+	GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_PUSH_SET);
+	new (&glcmd->push_set) GLCommandPushSet();
+	glcmd->push_set.set_index = set_idx;
+	glcmd->push_set.pipeline_layout = layout;
+	glcmd->push_set.updates.assign(updates, updates + update_count);
+}
+
+// bind a single resource to an OpenGL binding point, null resources are left unbound
+static void gl_bind_resource(VIBindingType type, uint32_t binding_point, void* resource, VISampler sampler, uint32_t buffer_offset, uint32_t buffer_range)
+{
+	VIBuffer buffer;
+	VIImage image;
+	GLenum internal_format;
+	GLenum data_format, data_type;
+	uint32_t texel_size;
+
+	if (!resource)
+		return;
+
+	switch (type)
+	{
+	case VI_BINDING_TYPE_UNIFORM_BUFFER:
+	case VI_BINDING_TYPE_STORAGE_BUFFER:
+	case VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC:
+	case VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC:
+	{
+		GLenum target = GL_SHADER_STORAGE_BUFFER;
+		if (type == VI_BINDING_TYPE_UNIFORM_BUFFER || type == VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC)
+			target = GL_UNIFORM_BUFFER;
+
+		buffer = (VIBuffer)resource;
+		if (buffer_offset == 0 && buffer_range == 0)
+		{
+			glBindBufferBase(target, binding_point, buffer->gl.handle);
+		}
+		else
+		{
+			uint32_t range = buffer_range ? buffer_range : buffer->size - buffer_offset;
+			VI_ASSERT(buffer_offset + range <= buffer->size);
+			glBindBufferRange(target, binding_point, buffer->gl.handle, buffer_offset, range);
+		}
+		break;
+	}
+	case VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER:
+		image = (VIImage)resource;
+		glActiveTexture(GL_TEXTURE0 + binding_point);
+		glBindTexture(image->gl.target, image->gl.handle);
+		glBindSampler(binding_point, sampler ? sampler->gl.handle : image->sampler->gl.handle);
+		break;
+	case VI_BINDING_TYPE_STORAGE_IMAGE:
+		image = (VIImage)resource;
+		cast_format_gl(image->info.format, &internal_format, &data_format, &data_type, &texel_size);
+		glBindImageTexture(binding_point, image->gl.handle, 0, GL_FALSE, 0, GL_READ_ONLY /* TODO: reflect SPIRV */, internal_format);
+		break;
+	default:
+		VI_UNREACHABLE;
+	}
+}
+
 static void gl_reset_command(VIDevice device, VICommand cmd)
 {
 	for (uint32_t i = 0; i < cmd->gl.list_size; i++)
@@ -2655,6 +4514,12 @@ static void gl_reset_command(VIDevice device, VICommand cmd)
 
 		switch (glcmd->type)
 		{
+		case GL_COMMAND_TYPE_BIND_SET:
+			glcmd->bind_set.~GLCommandBindSet();
+			break;
+		case GL_COMMAND_TYPE_PUSH_SET:
+			glcmd->push_set.~GLCommandPushSet();
+			break;
 		case GL_COMMAND_TYPE_BIND_VERTEX_BUFFERS:
 			glcmd->bind_vertex_buffers.~GLCommandBindVertexBuffers();
 			break;
@@ -2687,13 +4552,34 @@ static void gl_reset_command(VIDevice device, VICommand cmd)
 	cmd->gl.list_size = 0;
 }
 
+// conditional draws are indirect draws counted by the predicate, clamped to a single draw.
+// the arguments are only known during execution and are uploaded right before the draw
+static void gl_bind_conditional_draw(VIDevice device, const void* args, GLsizeiptr size)
+{
+	VIOpenGL* gl = &device->gl;
+
+	if (gl->indirect_buffer == 0)
+	{
+		glCreateBuffers(1, &gl->indirect_buffer);
+		glNamedBufferStorage(gl->indirect_buffer, sizeof(GLuint) * 5, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	}
+
+	glNamedBufferSubData(gl->indirect_buffer, 0, size, args);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gl->indirect_buffer);
+	glBindBuffer(GL_PARAMETER_BUFFER, gl->execution.conditional_buffer->gl.handle);
+	GL_CHECK();
+}
+
 static void gl_cmd_execute(VIDevice device, VICommand cmd)
 {
+	VI_TRACE_FUNC;
+
 	for (uint32_t i = 0; i < cmd->gl.list_size; i++)
 	{
 		GLCommand* glcmd = cmd->gl.list + i;
 		VI_ASSERT(gl_cmd_execute_table[glcmd->type] != nullptr);
 
+		VI_TRACE_SCOPE(gl_command_type_names[glcmd->type]);
 		gl_cmd_execute_table[glcmd->type](device, glcmd);
 	}
 }
@@ -2748,6 +4634,15 @@ static void gl_cmd_execute_draw(VIDevice device, GLCommand* glcmd)
 	GLint location = glGetUniformLocation(device->gl.execution.program, "SPIRV_Cross_BaseInstance");
 	if (location >= 0)
 		glUniform1i(location, glcmd->draw.instance_start);
+
+	if (device->gl.execution.conditional_buffer)
+	{
+		// DrawArraysIndirectCommand
+		GLuint args[4] = { (GLuint)count, (GLuint)instance_count, (GLuint)first, base_instance };
+		gl_bind_conditional_draw(device, args, sizeof(args));
+		glMultiDrawArraysIndirectCount(mode, nullptr, (GLintptr)device->gl.execution.conditional_offset, 1, 0);
+		return;
+	}
 	
 	glDrawArraysInstancedBaseInstance(mode, first, count, instance_count, base_instance);
 }
@@ -2768,6 +4663,15 @@ static void gl_cmd_execute_draw_indexed(VIDevice device, GLCommand* glcmd)
 	if (location >= 0)
 		glUniform1i(location, glcmd->draw.instance_start);
 
+	if (device->gl.execution.conditional_buffer)
+	{
+		// DrawElementsIndirectCommand
+		GLuint args[5] = { (GLuint)index_count, (GLuint)instance_count, (GLuint)base_index, 0, base_instance };
+		gl_bind_conditional_draw(device, args, sizeof(args));
+		glMultiDrawElementsIndirectCount(mode, index_type, nullptr, (GLintptr)device->gl.execution.conditional_offset, 1, 0);
+		return;
+	}
+
 	glDrawElementsInstancedBaseVertexBaseInstance(mode, index_count, index_type, (const void*)(base_index * index_size), instance_count, 0, base_instance);
 }
 
@@ -2846,56 +4750,58 @@ static void gl_cmd_execute_bind_set(VIDevice device, GLCommand* glcmd)
 	uint32_t set_idx = glcmd->bind_set.set_index;
 	VISet set = glcmd->bind_set.set;
 	VIPipelineLayout pipeline_layout = glcmd->bind_set.pipeline_layout;
-	VIBuffer buffer;
-	VIImage image;
-	GLenum internal_format;
-	GLenum data_format, data_type;
-	uint32_t texel_size;
 	uint32_t remapped_binding;
 	uint32_t binding_count = (uint32_t)set->layout->bindings.size();
+	const std::vector<uint32_t>& dynamic_offsets = glcmd->bind_set.dynamic_offsets;
 
 	for (uint32_t binding_idx = 0; binding_idx < binding_count; binding_idx++)
 	{
 		gl_pipeline_layout_get_remapped_binding(pipeline_layout, set_idx, binding_idx, &remapped_binding);
 
-		switch (set->layout->bindings[binding_idx].type)
+		// array elements occupy consecutive binding points starting at the remapped binding,
+		// elements that were never updated are left unbound
+		const VIBinding& binding = set->layout->bindings[binding_idx];
+		void** sites = set->gl.binding_sites + set->layout->descriptor_offsets[binding_idx];
+		uint32_t* ranges = set->gl.binding_ranges + set->layout->descriptor_offsets[binding_idx];
+		VISampler* samplers = set->gl.binding_samplers + set->layout->descriptor_offsets[binding_idx];
+
+		for (uint32_t i = 0; i < binding.array_count; i++)
 		{
-		case VI_BINDING_TYPE_UNIFORM_BUFFER:
-			buffer = (VIBuffer)set->gl.binding_sites[binding_idx];
-			if (buffer)
-			{
-				glBindBufferBase(GL_UNIFORM_BUFFER, remapped_binding, buffer->gl.handle);
-			}
-			break;
-		case VI_BINDING_TYPE_STORAGE_BUFFER:
-			buffer = (VIBuffer)set->gl.binding_sites[binding_idx];
-			if (buffer)
-			{
-				glBindBufferBase(GL_SHADER_STORAGE_BUFFER, remapped_binding, buffer->gl.handle);
-			}
-			break;
-		case VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER:
-			image = (VIImage)set->gl.binding_sites[binding_idx];
-			if (image)
-			{
-				glActiveTexture(GL_TEXTURE0 + remapped_binding);
-				glBindTexture(image->gl.target, image->gl.handle);
-			}
-			break;
-		case VI_BINDING_TYPE_STORAGE_IMAGE:
-			image = (VIImage)set->gl.binding_sites[binding_idx];
-			if (image)
+			uint32_t offset = 0;
+			if (is_binding_type_dynamic(binding.type))
 			{
-				cast_format_gl(image->info.format, &internal_format, &data_format, &data_type, &texel_size);
-				glBindImageTexture(remapped_binding, image->gl.handle, 0, GL_FALSE, 0, GL_READ_ONLY /* TODO: reflect SPIRV */, internal_format);
+				size_t dynamic_offset_idx = set->layout->dynamic_offset_indices[binding_idx] + i;
+				VI_ASSERT(dynamic_offset_idx < dynamic_offsets.size());
+				offset = dynamic_offsets[dynamic_offset_idx];
 			}
-			break;
-		default:
-			VI_UNREACHABLE;
+
+			gl_bind_resource(binding.type, remapped_binding + i, sites[i], samplers[i], offset, ranges[i]);
 		}
 	}
 }
 
+static void gl_cmd_execute_push_set(VIDevice device, GLCommand* glcmd)
+{
+	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_PUSH_SET);
+
+	uint32_t set_idx = glcmd->push_set.set_index;
+	VIPipelineLayout pipeline_layout = glcmd->push_set.pipeline_layout;
+	VISetLayout set_layout = pipeline_layout->set_layouts[set_idx];
+	uint32_t remapped_binding;
+
+	// bindings that are not pushed keep whatever was bound previously
+	for (const VISetUpdateInfo& update : glcmd->push_set.updates)
+	{
+		gl_pipeline_layout_get_remapped_binding(pipeline_layout, set_idx, update.binding_index, &remapped_binding);
+
+		VIBindingType type = set_layout->bindings[update.binding_index].type;
+		void* resource = (type == VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER || type == VI_BINDING_TYPE_STORAGE_IMAGE) ? (void*)update.image : (void*)update.buffer;
+		VI_ASSERT(resource);
+
+		gl_bind_resource(type, remapped_binding + update.array_index, resource, update.sampler, 0, update.buffer_range);
+	}
+}
+
 static void gl_cmd_execute_bind_pipeline(VIDevice device, GLCommand* glcmd)
 {
 	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_BIND_PIPELINE);
@@ -3190,60 +5096,174 @@ static void gl_cmd_execute_dispatch(VIDevice device, GLCommand* glcmd)
 	glMemoryBarrier(GL_ALL_BARRIER_BITS);
 }
 
-static void compile_vk(VICompileResult& result, EShLanguage stage, const char* vise_glsl)
+static void gl_cmd_execute_generate_mipmaps(VIDevice device, GLCommand* glcmd)
+{
+	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_GENERATE_MIPMAPS);
+
+	GL_CHECK(glGenerateTextureMipmap(glcmd->generate_mipmaps->gl.handle));
+}
+
+static void gl_cmd_execute_reset_queries(VIDevice device, GLCommand* glcmd)
+{
+	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_RESET_QUERIES);
+
+	// GL query objects need no reset, forget that they were issued
+	VIQueryPool pool = glcmd->reset_queries.pool;
+	for (uint32_t i = 0; i < glcmd->reset_queries.query_count; i++)
+		pool->gl.issued[glcmd->reset_queries.first_query + i] = false;
+}
+
+static void gl_cmd_execute_write_timestamp(VIDevice device, GLCommand* glcmd)
+{
+	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_WRITE_TIMESTAMP);
+
+	// the timestamp is taken once all previous GL commands have completed on the GPU
+	VIQueryPool pool = glcmd->write_timestamp.pool;
+	uint32_t query = glcmd->write_timestamp.query;
+	GL_CHECK(glQueryCounter(pool->gl.handles[query], GL_TIMESTAMP));
+	pool->gl.issued[query] = true;
+}
+
+static void gl_cmd_execute_begin_query(VIDevice device, GLCommand* glcmd)
+{
+	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_BEGIN_QUERY);
+
+	// pipeline statistics use one query object per statistic, each on its own target
+	VIQueryPool pool = glcmd->begin_query.pool;
+	uint32_t query = glcmd->begin_query.query;
+	for (uint32_t i = 0; i < pool->result_count; i++)
+		GL_CHECK(glBeginQuery(pool->gl.targets[i], pool->gl.handles[query * pool->result_count + i]));
+
+	pool->gl.issued[query] = true;
+}
+
+static void gl_cmd_execute_end_query(VIDevice device, GLCommand* glcmd)
+{
+	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_END_QUERY);
+
+	VIQueryPool pool = glcmd->end_query.pool;
+	for (uint32_t i = 0; i < pool->result_count; i++)
+		GL_CHECK(glEndQuery(pool->gl.targets[i]));
+}
+
+static void gl_cmd_execute_copy_query_results(VIDevice device, GLCommand* glcmd)
 {
-	if (!has_glslang_initialized)
+	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_COPY_QUERY_RESULTS);
+
+	VIQueryPool pool = glcmd->copy_query_results.pool;
+	VIBuffer buffer = glcmd->copy_query_results.buffer;
+	uint32_t first_query = glcmd->copy_query_results.first_query;
+
+	for (uint32_t i = 0; i < glcmd->copy_query_results.query_count; i++)
 	{
-		glslang::InitializeProcess();
-		has_glslang_initialized = true;
+		VI_ASSERT(pool->gl.issued[first_query + i]);
+
+		for (uint32_t j = 0; j < pool->result_count; j++)
+		{
+			GLuint handle = pool->gl.handles[(first_query + i) * pool->result_count + j];
+			uint32_t dst_offset = glcmd->copy_query_results.offset + (i * pool->result_count + j) * sizeof(uint32_t);
+
+			// transfer buffers live in host memory, GL buffers receive the result without a CPU round trip
+			if (buffer->gl.target == GL_NONE)
+				GL_CHECK(glGetQueryObjectuiv(handle, GL_QUERY_RESULT, (GLuint*)(buffer->map + dst_offset)));
+			else
+				GL_CHECK(glGetQueryBufferObjectuiv(handle, buffer->gl.handle, GL_QUERY_RESULT, (GLintptr)dst_offset));
+		}
 	}
+}
 
-	result = VICompileResult{};
+static void gl_cmd_execute_begin_conditional(VIDevice device, GLCommand* glcmd)
+{
+	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_BEGIN_CONDITIONAL);
+
+	device->gl.execution.conditional_buffer = glcmd->begin_conditional.buffer;
+	device->gl.execution.conditional_offset = glcmd->begin_conditional.offset;
+}
+
+static void gl_cmd_execute_end_conditional(VIDevice device, GLCommand* glcmd)
+{
+	VI_ASSERT(glcmd->type == GL_COMMAND_TYPE_END_CONDITIONAL);
+
+	device->gl.execution.conditional_buffer = VI_NULL;
+}
+
+// expands #include directives and macros, the output is what glslang parses
+static bool preprocess_glsl(EShLanguage stage, const char* vise_glsl, const VIIncludeResolver* resolver, std::vector<std::string>* dependencies, std::string* out_glsl, std::string* out_error)
+{
+	VI_TRACE_FUNC;
+
+	// may be called concurrently from vi_compile_binaries
+	std::call_once(glslang_init_flag, []() { glslang::InitializeProcess(); });
 
 	glslang::TShader shader_tmp(stage);
 	shader_tmp.setStrings(&vise_glsl, 1);
 
 	EShMessages messages = EShMsgDefault;
-	glslang::EshTargetClientVersion client_version = VI_VK_GLSLANG_VERSION;
-	glslang::EShTargetLanguageVersion lang_version = glslang::EShTargetSpv_1_0;
 	const TBuiltInResource* resources = ::GetDefaultResources();
 
 	shader_tmp.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, VI_SHADER_GLSL_VERSION);
-	shader_tmp.setEnvClient(glslang::EShClientVulkan, client_version);
-	shader_tmp.setEnvTarget(glslang::EShTargetSpv, lang_version);
+	shader_tmp.setEnvClient(glslang::EShClientVulkan, VI_VK_GLSLANG_VERSION);
+	shader_tmp.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
 	shader_tmp.setEntryPoint(VI_SHADER_ENTRY_POINT);
 	shader_tmp.setSourceEntryPoint(VI_SHADER_ENTRY_POINT);
 
-	std::string preprocessed_glsl;
-	glslang::TShader::ForbidIncluder includer;
+	// #include directives are only recognized with an include resolver
+	if (resolver)
+		shader_tmp.setPreamble(VI_SHADER_INCLUDE_PREAMBLE);
+
+	VIIncluder includer(resolver, dependencies);
 
 	// TODO: Doing just preprocessing to obtain a correct preprocessed shader string
 	// is not an officially supported or fully working path.
-	if (!shader_tmp.preprocess(resources, VI_SHADER_GLSL_VERSION, ENoProfile, false, false, messages, &preprocessed_glsl, includer))
+	if (!shader_tmp.preprocess(resources, VI_SHADER_GLSL_VERSION, ENoProfile, false, false, messages, out_glsl, includer))
 	{
-		std::cout << "Preprocessing failed for shader: " << std::endl;
-		std::cout << vise_glsl << std::endl;
-		std::cout << shader_tmp.getInfoLog() << std::endl;
-		std::cout << shader_tmp.getInfoDebugLog() << std::endl;
-		VI_ASSERT(0 && "preprocessing failed");
-		return;
+		*out_error = "preprocessing failed\n";
+		*out_error += shader_tmp.getInfoLog();
+		*out_error += shader_tmp.getInfoDebugLog();
+		return false;
 	}
 
-	glslang::TShader shader(stage);
-	const char* preprocessed_glsl_cstr = preprocessed_glsl.c_str();
-	shader.setStrings(&preprocessed_glsl_cstr, 1);
-	shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, VI_SHADER_GLSL_VERSION);
-	shader.setEnvClient(glslang::EShClientVulkan, client_version);
+	return true;
+}
+
+static void compile_vk(VICompileResult& result, EShLanguage stage, const char* vise_glsl, const VIIncludeResolver* resolver)
+{
+	VI_TRACE_FUNC;
+
+	result = VICompileResult{};
+
+	std::string preprocessed_glsl;
+	if (!preprocess_glsl(stage, vise_glsl, resolver, &result.dependencies, &preprocessed_glsl, &result.error))
+		return;
+
+	// headers are part of the source once included, edits to any of them must invalidate binaries
+	if (resolver)
+		result.source_hash = hash_fnv1a(VI_FNV1A_OFFSET_BASIS, preprocessed_glsl.data(), preprocessed_glsl.size());
+	else
+		result.source_hash = hash_fnv1a(VI_FNV1A_OFFSET_BASIS, vise_glsl, strlen(vise_glsl));
+
+	EShMessages messages = EShMsgDefault;
+	glslang::EshTargetClientVersion client_version = VI_VK_GLSLANG_VERSION;
+	glslang::EShTargetLanguageVersion lang_version = glslang::EShTargetSpv_1_0;
+	const TBuiltInResource* resources = ::GetDefaultResources();
+	VIIncluder includer(resolver, &result.dependencies);
+
+	glslang::TShader shader(stage);
+	const char* preprocessed_glsl_cstr = preprocessed_glsl.c_str();
+	shader.setStrings(&preprocessed_glsl_cstr, 1);
+	if (resolver)
+		shader.setPreamble(VI_SHADER_INCLUDE_PREAMBLE);
+	shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, VI_SHADER_GLSL_VERSION);
+	shader.setEnvClient(glslang::EShClientVulkan, client_version);
 	shader.setEnvTarget(glslang::EShTargetSpv, lang_version);
 	shader.setEntryPoint(VI_SHADER_ENTRY_POINT);
 	shader.setSourceEntryPoint(VI_SHADER_ENTRY_POINT);
 
 	if (!shader.parse(resources, VI_SHADER_GLSL_VERSION, false, messages, includer))
 	{
-		std::cout << "Parsing failed for shader: " << std::endl;
-		std::cout << shader.getInfoLog() << std::endl;
-		std::cout << shader.getInfoDebugLog() << std::endl;
-		VI_ASSERT(0 && "parsing failed");
+		result.error = "parsing failed\n";
+		result.error += shader.getInfoLog();
+		result.error += shader.getInfoDebugLog();
 		return;
 	}
 
@@ -3251,10 +5271,9 @@ static void compile_vk(VICompileResult& result, EShLanguage stage, const char* v
 	program.addShader(&shader);
 	if (!program.link(messages))
 	{
-		std::cout << "Linking failed for shader " << std::endl;
-		std::cout << program.getInfoLog() << std::endl;
-		std::cout << program.getInfoDebugLog() << std::endl;
-		VI_ASSERT(0 && "link failed");
+		result.error = "link failed\n";
+		result.error += program.getInfoLog();
+		result.error += program.getInfoDebugLog();
 		return;
 	}
 
@@ -3271,17 +5290,27 @@ static void compile_vk(VICompileResult& result, EShLanguage stage, const char* v
 	result.success = true;
 }
 
-static void compile_gl(VICompileResult& result, EShLanguage stage, const char* vise_glsl, uint32_t remap_count, const GLRemap* remaps)
+static void compile_gl(VICompileResult& result, EShLanguage stage, const char* vise_glsl, const VIIncludeResolver* resolver, uint32_t remap_count, const GLRemap* remaps)
 {
-	result = VICompileResult{};
+	VI_TRACE_FUNC;
+
+	compile_vk(result, stage, vise_glsl, resolver);
+	if (!result.success)
+		return;
 
-	VICompileResult reflect_result;
-	compile_vk(reflect_result, stage, vise_glsl);
-	VI_ASSERT(reflect_result.success && "compile_gl failed: unable to compile spirv");
+	compile_gl_spirv(result, stage, remap_count, remaps);
+}
+
+// cross compiles result.vk_spirv to patched GLSL for OpenGL
+static void compile_gl_spirv(VICompileResult& result, EShLanguage stage, uint32_t remap_count, const GLRemap* remaps)
+{
+	VI_TRACE_FUNC;
+
+	result.success = false;
 
 	try
 	{
-		spirv_cross::CompilerGLSL compiler(reflect_result.vk_spirv);
+		spirv_cross::CompilerGLSL compiler(result.vk_spirv);
 		//debug_print_compilation(compiler, stage);
 
 		const spirv_cross::ShaderResources& resources = compiler.get_shader_resources();
@@ -3317,7 +5346,11 @@ static void compile_gl(VICompileResult& result, EShLanguage stage, const char* v
 			const std::string& instance_name = resources.push_constant_buffers[0].name;
 
 			// push_constant block name reflection not supported: https://github.com/KhronosGroup/SPIRV-Cross/issues/518
-			VI_ASSERT(!instance_name.empty() && "push_constant block must define an instance name");
+			if (instance_name.empty())
+			{
+				result.error = "push_constant block must define an instance name";
+				return;
+			}
 
 			// each member in push_constant block is an OpenGL uniform
 			size_t push_constant_count = block_type.member_types.size();
@@ -3344,7 +5377,11 @@ static void compile_gl(VICompileResult& result, EShLanguage stage, const char* v
 				
 				if (!member_type.array.empty())
 				{
-					VI_ASSERT(member_type.array.size() == 1 && "does not support array of arrays");
+					if (member_type.array.size() != 1)
+					{
+						result.error = "push_constant block does not support array of arrays";
+						return;
+					}
 					result.gl_push_constants[i].uniform_arr_size = member_type.array[0];
 				}
 			}
@@ -3353,29 +5390,41 @@ static void compile_gl(VICompileResult& result, EShLanguage stage, const char* v
 		for (size_t i = 0; i < resources.uniform_buffers.size(); i++)
 		{
 			spirv_cross::ID id = resources.uniform_buffers[i].id;
-			bool found_remap = perform_remap(id, compiler, remap_count, remaps);
-			VI_ASSERT(found_remap && "failed to remap OpenGL uniform buffer binding");
+			if (!perform_remap(id, compiler, remap_count, remaps))
+			{
+				result.error = "failed to remap OpenGL uniform buffer binding";
+				return;
+			}
 		}
 
 		for (size_t i = 0; i < resources.storage_buffers.size(); i++)
 		{
 			spirv_cross::ID id = resources.storage_buffers[i].id;
-			bool found_remap = perform_remap(id, compiler, remap_count, remaps);
-			VI_ASSERT(found_remap && "failed to remap OpenGL shader storage buffer binding");
+			if (!perform_remap(id, compiler, remap_count, remaps))
+			{
+				result.error = "failed to remap OpenGL shader storage buffer binding";
+				return;
+			}
 		}
 
 		for (size_t i = 0; i < resources.sampled_images.size(); i++)
 		{
 			spirv_cross::ID id = resources.sampled_images[i].id;
-			bool found_remap = perform_remap(id, compiler, remap_count, remaps);
-			VI_ASSERT(found_remap && "failed to remap OpenGL sampler binding");
+			if (!perform_remap(id, compiler, remap_count, remaps))
+			{
+				result.error = "failed to remap OpenGL sampler binding";
+				return;
+			}
 		}
 
 		for (size_t i = 0; i < resources.storage_images.size(); i++)
 		{
 			spirv_cross::ID id = resources.storage_images[i].id;
-			bool found_remap = perform_remap(id, compiler, remap_count, remaps);
-			VI_ASSERT(found_remap && "failed to remap OpenGL storage image binding");
+			if (!perform_remap(id, compiler, remap_count, remaps))
+			{
+				result.error = "failed to remap OpenGL storage image binding";
+				return;
+			}
 		}
 		
 		// TODO: confirm that with subpassLoad and subpassInput, this is still the desired behaviour
@@ -3388,7 +5437,8 @@ static void compile_gl(VICompileResult& result, EShLanguage stage, const char* v
 	}
 	catch (spirv_cross::CompilerError error)
 	{
-		std::cout << "spirv_cross::CompilerError " << error.what() << std::endl;
+		result.error = "spirv_cross::CompilerError ";
+		result.error += error.what();
 		return;
 	};
 
@@ -3421,6 +5471,16 @@ static void flip_image_data(uint8_t* data, uint32_t image_width, uint32_t image_
 	}
 }
 
+static void add_frame_counters(VIFrameCounters* dst, const VIFrameCounters& src)
+{
+	dst->draws += src.draws;
+	dst->dispatches += src.dispatches;
+	dst->binds += src.binds;
+	dst->state_changes += src.state_changes;
+	dst->passes += src.passes;
+	dst->submits += src.submits;
+}
+
 static void debug_print_compilation(const spirv_cross::CompilerGLSL& compiler, EShLanguage stage)
 {
 	if (stage == EShLangCompute)
@@ -3484,6 +5544,43 @@ static void cast_index_type(VkIndexType in_type, GLenum* out_type, size_t* out_s
 	}
 }
 
+static void cast_query_type_vk(VIQueryType in_type, VkQueryType* out_type)
+{
+	switch (in_type)
+	{
+	case VI_QUERY_TYPE_TIMESTAMP:
+		*out_type = VK_QUERY_TYPE_TIMESTAMP;
+		break;
+	case VI_QUERY_TYPE_OCCLUSION:
+	case VI_QUERY_TYPE_OCCLUSION_ANY:
+		*out_type = VK_QUERY_TYPE_OCCLUSION;
+		break;
+	case VI_QUERY_TYPE_PIPELINE_STATISTICS:
+		*out_type = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		break;
+	default:
+		VI_UNREACHABLE;
+	}
+}
+
+static void cast_query_type_gl(VIQueryType in_type, GLenum* out_target)
+{
+	switch (in_type)
+	{
+	case VI_QUERY_TYPE_TIMESTAMP:
+		*out_target = GL_TIMESTAMP;
+		break;
+	case VI_QUERY_TYPE_OCCLUSION:
+		*out_target = GL_SAMPLES_PASSED;
+		break;
+	case VI_QUERY_TYPE_OCCLUSION_ANY:
+		*out_target = GL_ANY_SAMPLES_PASSED;
+		break;
+	default: // pipeline statistics map to one target per statistic
+		VI_UNREACHABLE;
+	}
+}
+
 static void cast_buffer_usages(VIBufferType in_type, VIBufferUsageFlags in_usages, VkBufferUsageFlags* out_usages)
 {
 	VkBufferUsageFlags usages = 0;
@@ -3514,6 +5611,9 @@ static void cast_buffer_usages(VIBufferType in_type, VIBufferUsageFlags in_usage
 	if (in_usages & VI_BUFFER_USAGE_TRANSFER_DST_BIT)
 		usages |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
+	if (in_usages & VI_BUFFER_USAGE_CONDITIONAL_BIT)
+		usages |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
 	*out_usages = usages;
 }
 
@@ -3709,6 +5809,16 @@ static void cast_format_gl(VIFormat in_format, GLenum* out_internal_format, GLen
 	*out_texel_size = entry->texel_block_size;
 }
 
+static inline bool is_binding_type_dynamic(VIBindingType type)
+{
+	return type == VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC;
+}
+
+static bool is_format_compressed(VIFormat format)
+{
+	return vi_format_table[(int)format].texel_block_extent > 1;
+}
+
 static void cast_format_attachment_gl(VIFormat in_format, GLenum* out_attachment)
 {
 	VIImageAspectFlags aspect = (VIImageAspectFlags)vi_format_table[(int)in_format].vk_aspect;
@@ -3765,6 +5875,12 @@ static void cast_binding_type(VIBindingType in_type, VkDescriptorType* out_type)
 	case VI_BINDING_TYPE_STORAGE_IMAGE:
 		*out_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
 		break;
+	case VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		*out_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		break;
+	case VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC:
+		*out_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		break;
 	default:
 		VI_UNREACHABLE;
 	}
@@ -3847,6 +5963,26 @@ static void cast_glsl_type_spirv(const spirv_cross::SPIRType& in_type, VIGLSLTyp
 	VI_UNREACHABLE;
 }
 
+static void cast_specialization_info_vk(const VISpecializationInfo& in_info, std::vector<VkSpecializationMapEntry>* out_entries, VkSpecializationInfo* out_info)
+{
+	out_entries->resize(in_info.constant_count);
+
+	for (uint32_t i = 0; i < in_info.constant_count; i++)
+	{
+		const VISpecializationConstant& constant = in_info.constants[i];
+		VI_ASSERT(constant.offset + 4 <= in_info.data_size);
+
+		(*out_entries)[i].constantID = constant.constant_id;
+		(*out_entries)[i].offset = constant.offset;
+		(*out_entries)[i].size = 4; // bool constants are VkBool32
+	}
+
+	out_info->mapEntryCount = in_info.constant_count;
+	out_info->pMapEntries = out_entries->data();
+	out_info->dataSize = in_info.data_size;
+	out_info->pData = in_info.data;
+}
+
 static void cast_pipeline_vertex_input(uint32_t attr_count, VIVertexAttribute* attrs,
 	uint32_t binding_count, VIVertexBinding* bindings,
 	std::vector<VkVertexInputAttributeDescription>& out_attrs,
@@ -3970,9 +6106,10 @@ static void cast_pass_depth_stencil_attachment(const VIPassDepthStencilAttachmen
 
 VIDevice vi_create_device_vk(const VIDeviceInfo* info, VIDeviceLimits* limits)
 {
-	VI_ASSERT(info->desired_swapchain_framebuffer_count > 0);
+	VI_TRACE_FUNC;
 
-	VIObject::id_counter = 0;
+	VI_ASSERT(info->compute_only || info->desired_swapchain_framebuffer_count > 0);
+	VI_ASSERT(info->max_frames_in_flight >= 0);
 
 	uint32_t loader_version;
 	vkEnumerateInstanceVersion(&loader_version);
@@ -3992,6 +6129,9 @@ VIDevice vi_create_device_vk(const VIDeviceInfo* info, VIDeviceLimits* limits)
 	VIDevice device = (VIDevice)vi_malloc(sizeof(VIDeviceObj));
 	new (device)VIDeviceObj();
 	device->backend = VI_BACKEND_VULKAN;
+	device->headless = info->headless || info->compute_only;
+	device->compute_only = info->compute_only;
+	device->deferred_destruction = info->deferred_destruction;
 	device->queue_graphics.device = device;
 	device->queue_transfer.device = device;
 	device->queue_present.device = device;
@@ -4002,15 +6142,45 @@ VIDevice vi_create_device_vk(const VIDeviceInfo* info, VIDeviceLimits* limits)
 
 	// create Instance, Surface, and a Device
 	{
-		vk_create_instance(vk, info->vulkan.enable_validation_layers);
+		vk_create_instance(vk, info->vulkan.enable_validation_layers, device->headless);
 
-		vi_proc.vkCmdSetFrontFaceEXT = (PFN_vkCmdSetFrontFaceEXT)vkGetInstanceProcAddr(vk->instance, "vkCmdSetFrontFaceEXT");
+		vk->proc.vkCmdSetFrontFaceEXT = (PFN_vkCmdSetFrontFaceEXT)vkGetInstanceProcAddr(vk->instance, "vkCmdSetFrontFaceEXT");
 
-		vk_create_surface(vk);
+		if (!device->headless)
+			vk_create_surface(vk, info->window);
 		vk_create_device(vk, device, info);
+
+		if (vk->supports_push_descriptor)
+			vk->proc.vkCmdPushDescriptorSetKHR = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(vk->device, "vkCmdPushDescriptorSetKHR");
+
+		if (vk->supports_conditional_rendering)
+		{
+			vk->proc.vkCmdBeginConditionalRenderingEXT = (PFN_vkCmdBeginConditionalRenderingEXT)vkGetDeviceProcAddr(vk->device, "vkCmdBeginConditionalRenderingEXT");
+			vk->proc.vkCmdEndConditionalRenderingEXT = (PFN_vkCmdEndConditionalRenderingEXT)vkGetDeviceProcAddr(vk->device, "vkCmdEndConditionalRenderingEXT");
+		}
 	}
 
-	// create Swapchain, Swapchain-Pass and Swapchain-Framebuffer
+	// frame slots are independent of the swapchain images, an image still in use by
+	// another frame slot is waited for in next_frame
+	vk->max_frames_in_flight = (uint32_t)info->max_frames_in_flight;
+	if (vk->max_frames_in_flight == 0)
+		vk->max_frames_in_flight = (uint32_t)info->desired_swapchain_framebuffer_count;
+
+	if (device->headless)
+	{
+		// offscreen frames only cycle the per-frame synchronization primitives, compute-only devices have none
+		if (info->compute_only)
+			vk->max_frames_in_flight = 0;
+		vk->frames = vk->max_frames_in_flight > 0 ? (VIFrame*)vi_device_malloc(device, sizeof(VIFrame) * vk->max_frames_in_flight) : nullptr;
+		vk->frames_in_flight = vk->max_frames_in_flight;
+		vk->frame_idx = 0;
+		vk->completed_frame_count = 0;
+
+		limits->swapchain_framebuffer_count = vk->max_frames_in_flight;
+		device->swapchain_pass = VI_NULL;
+		device->swapchain_framebuffers = VI_NULL;
+	}
+	else // create Swapchain, Swapchain-Pass and Swapchain-Framebuffer
 	{
 		VISwapchainInfo swapchainI;
 		vk->configure_swapchain = info->vulkan.configure_swapchain;
@@ -4024,14 +6194,15 @@ VIDevice vi_create_device_vk(const VIDeviceInfo* info, VIDeviceLimits* limits)
 		if (min_image_count > surface_max_image_count)
 			min_image_count = surface_max_image_count;
 
-		vk_create_swapchain(vk, &swapchainI, min_image_count);
+		vk_create_swapchain(vk, &swapchainI, min_image_count, VK_NULL_HANDLE);
 
 		uint32_t swapchain_image_count = vk->swapchain.images.size();
 
 		limits->swapchain_framebuffer_count = swapchain_image_count;
-		vk->frames_in_flight = swapchain_image_count;
-		vk->frames = (VIFrame*)vi_malloc(sizeof(VIFrame) * swapchain_image_count);
+		vk->frames_in_flight = vk->max_frames_in_flight;
+		vk->frames = (VIFrame*)vi_device_malloc(device, sizeof(VIFrame) * vk->max_frames_in_flight);
 		vk->frame_idx = 0;
+		vk->completed_frame_count = 0;
 
 		VIFormat vi_color_format;
 		cast_format_vk(vk->swapchain.info.image_format, &vi_color_format);
@@ -4110,27 +6281,12 @@ VIDevice vi_create_device_vk(const VIDeviceInfo* info, VIDeviceLimits* limits)
 		cmdPoolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 		VK_CHECK(vkCreateCommandPool(device->vk.device, &cmdPoolCI, nullptr, &vk->cmd_pool_graphics.vk_handle));
 
-		for (uint32_t i = 0; i < vk->frames_in_flight; i++)
-		{
-			VIFrame* frame = vk->frames + i;
-
-			VkFenceCreateInfo fenceCI;
-			fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-			fenceCI.pNext = NULL;
-			fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-			VK_CHECK(vkCreateFence(vk->device, &fenceCI, NULL, &frame->fence.frame_complete.vk_handle));
-
-			VkSemaphoreCreateInfo semCI;
-			semCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-			semCI.pNext = NULL;
-			semCI.flags = 0;
-			VK_CHECK(vkCreateSemaphore(vk->device, &semCI, NULL, &frame->semaphore.image_acquired.vk_handle));
-			VK_CHECK(vkCreateSemaphore(vk->device, &semCI, NULL, &frame->semaphore.present_ready.vk_handle));
-		}
+		vk_create_frame_sync(vk);
 	}
 
 	const VkPhysicalDeviceLimits* vk_limits = &vk->pdevice_chosen->device_props.limits;
 
+	limits->max_frames_in_flight = vk->max_frames_in_flight;
 	limits->max_push_constant_size = vk_limits->maxPushConstantsSize;
 	limits->max_compute_workgroup_size[0] = vk_limits->maxComputeWorkGroupSize[0];
 	limits->max_compute_workgroup_size[1] = vk_limits->maxComputeWorkGroupSize[1];
@@ -4139,6 +6295,29 @@ VIDevice vi_create_device_vk(const VIDeviceInfo* info, VIDeviceLimits* limits)
 	limits->max_compute_workgroup_count[1] = vk_limits->maxComputeWorkGroupCount[1];
 	limits->max_compute_workgroup_count[2] = vk_limits->maxComputeWorkGroupCount[2];
 	limits->max_compute_workgroup_invocations = vk_limits->maxComputeWorkGroupInvocations;
+	limits->min_uniform_buffer_offset_alignment = (uint32_t)vk_limits->minUniformBufferOffsetAlignment;
+	limits->min_storage_buffer_offset_alignment = (uint32_t)vk_limits->minStorageBufferOffsetAlignment;
+	limits->max_bindless_image_count = 0;
+	limits->timestamp_queries = vk->pdevice_chosen->family_props[vk->family_idx_graphics].timestampValidBits > 0;
+	limits->occlusion_query_precise = vk->pdevice_chosen->features.features.occlusionQueryPrecise;
+	limits->pipeline_statistics_queries = vk->pdevice_chosen->features.features.pipelineStatisticsQuery;
+
+	// bindless set layouts rely on Vulkan 1.2 descriptor indexing
+	const VkPhysicalDeviceVulkan12Features* features_vk12 = &vk->pdevice_chosen->features_vk12;
+	limits->conditional_rendering = vk->supports_conditional_rendering || features_vk12->drawIndirectCount;
+
+	if (features_vk12->descriptorBindingPartiallyBound &&
+		features_vk12->descriptorBindingSampledImageUpdateAfterBind)
+	{
+		VkPhysicalDeviceVulkan12Properties props_vk12{};
+		props_vk12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+		VkPhysicalDeviceProperties2 props{};
+		props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props.pNext = &props_vk12;
+		vkGetPhysicalDeviceProperties2(vk->pdevice, &props);
+
+		limits->max_bindless_image_count = props_vk12.maxPerStageDescriptorUpdateAfterBindSampledImages;
+	}
 
 	device->limits = *limits;
 	return device;
@@ -4146,7 +6325,7 @@ VIDevice vi_create_device_vk(const VIDeviceInfo* info, VIDeviceLimits* limits)
 
 VIDevice vi_create_device_gl(const VIDeviceInfo* info, VIDeviceLimits* limits)
 {
-	VIObject::id_counter = 0;
+	VI_TRACE_FUNC;
 
 	VIDevice device = (VIDevice)vi_malloc(sizeof(VIDeviceObj));
 	device->backend = VI_BACKEND_OPENGL;
@@ -4161,15 +6340,55 @@ VIDevice vi_create_device_gl(const VIDeviceInfo* info, VIDeviceLimits* limits)
 	gl->frame.fence.frame_complete.device = device;
 	gl->frame.semaphore.image_acquired.device = device;
 	gl->frame.semaphore.present_ready.device = device;
+	device->headless = info->headless || info->compute_only;
+	device->compute_only = info->compute_only;
+	device->deferred_destruction = false; // OpenGL drivers defer the deletion of objects in use
 
-	int success = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
-	VI_ASSERT(success);
+	GLADloadproc load_proc = (GLADloadproc)glfwGetProcAddress;
+
+	// the device keeps the context of its window, headless devices adopt the current context
+	gl->window = device->headless ? glfwGetCurrentContext() : (GLFWwindow*)info->window;
+	gl->owns_window = false;
+	gl->indirect_buffer = 0;
+	if (gl->window)
+		glfwMakeContextCurrent(gl->window);
+
+#ifdef VI_PLATFORM_LINUX
+	gl->egl_display = EGL_NO_DISPLAY;
+	gl->egl_context = EGL_NO_CONTEXT;
+
+	if (device->headless && gl->window == nullptr)
+	{
+		gl_create_headless_context(gl);
+		load_proc = (GLADloadproc)eglGetProcAddress;
+	}
+#else
+	if (device->headless && gl->window == nullptr)
+		gl_create_hidden_context(gl);
+#endif
+	VI_ASSERT(gl->window || device->headless);
 
-	// Swapchain-Pass and Swapchain-Framebuffer
-	device->swapchain_framebuffers = (VIFramebuffer)vi_malloc(sizeof(VIFramebufferObj));
+	// GLAD entry points are process-wide, the first OpenGL device loads them for all later devices.
+	// reloading would swap pointers under devices used on other threads
+	std::call_once(glad_load_flag, [load_proc]() {
+		glad_load_proc = load_proc;
+		glad_load_result = gladLoadGLLoader(load_proc);
+	});
+	VI_ASSERT(glad_load_result);
+	VI_ASSERT(glad_load_proc == load_proc && "OpenGL devices of a process must all use EGL or all use GLFW contexts");
+
+	if (device->headless)
+	{
+		device->swapchain_pass = VI_NULL;
+		device->swapchain_framebuffers = VI_NULL;
+	}
+	else // Swapchain-Pass and Swapchain-Framebuffer
+	{
+		device->swapchain_framebuffers = (VIFramebuffer)vi_device_malloc(device, sizeof(VIFramebufferObj));
 
-	// TODO: gl_create_swapchain_pass(gl, device->swapchain_pass);
-	gl_create_swapchain_framebuffer(gl, device->swapchain_framebuffers);
+		// TODO: gl_create_swapchain_pass(gl, device->swapchain_pass);
+		gl_create_swapchain_framebuffer(gl, device->swapchain_framebuffers);
+	}
 
 	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 	glFrontFace(GL_CCW);
@@ -4191,7 +6410,17 @@ VIDevice vi_create_device_gl(const VIDeviceInfo* info, VIDeviceLimits* limits)
 	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &gl_max_compute_workgroup_size_y);
 	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 2, &gl_max_compute_workgroup_size_z);
 
-	limits->swapchain_framebuffer_count = 1;
+	// bindless image arrays are emulated by binding each element to consecutive texture units
+	GLint gl_max_texture_image_units;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &gl_max_texture_image_units);
+
+	GLint gl_uniform_buffer_offset_alignment;
+	GLint gl_storage_buffer_offset_alignment;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &gl_uniform_buffer_offset_alignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &gl_storage_buffer_offset_alignment);
+
+	limits->swapchain_framebuffer_count = info->compute_only ? 0 : 1;
+	limits->max_frames_in_flight = info->compute_only ? 0 : 1; // a single implicit frame
 	limits->max_push_constant_size = 128;
 	limits->max_compute_workgroup_count[0] = gl_max_compute_workgroup_count_x;
 	limits->max_compute_workgroup_count[1] = gl_max_compute_workgroup_count_y;
@@ -4200,6 +6429,13 @@ VIDevice vi_create_device_gl(const VIDeviceInfo* info, VIDeviceLimits* limits)
 	limits->max_compute_workgroup_size[1] = gl_max_compute_workgroup_size_y;
 	limits->max_compute_workgroup_size[2] = gl_max_compute_workgroup_size_z;
 	limits->max_compute_workgroup_invocations = gl_max_compute_workgroup_invocations;
+	limits->max_bindless_image_count = gl_max_texture_image_units;
+	limits->min_uniform_buffer_offset_alignment = gl_uniform_buffer_offset_alignment;
+	limits->min_storage_buffer_offset_alignment = gl_storage_buffer_offset_alignment;
+	limits->timestamp_queries = true;
+	limits->occlusion_query_precise = true;
+	limits->pipeline_statistics_queries = GLAD_GL_VERSION_4_6 != 0; // ARB_pipeline_statistics_query is core in 4.6
+	limits->conditional_rendering = GLAD_GL_VERSION_4_6 != 0;       // ARB_indirect_parameters is core in 4.6
 	
 	device->limits = *limits;
 	return device;
@@ -4208,28 +6444,35 @@ VIDevice vi_create_device_gl(const VIDeviceInfo* info, VIDeviceLimits* limits)
 
 void vi_destroy_device(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_VULKAN)
 	{
 		VIVulkan* vk = &device->vk;
 
-		for (uint32_t i = 0; i < vk->frames_in_flight; i++)
-		{
-			VIFrame* frame = vk->frames + i;
-			vkDestroySemaphore(vk->device, frame->semaphore.present_ready.vk_handle, nullptr);
-			vkDestroySemaphore(vk->device, frame->semaphore.image_acquired.vk_handle, nullptr);
-			vkDestroyFence(vk->device, frame->fence.frame_complete.vk_handle, nullptr);
-		}
+		if (vk->push_set_pool)
+			vi_destroy_set_pool(device, vk->push_set_pool);
+
+		vk_release_garbage(device, UINT64_MAX);
+		vk_destroy_frame_sync(vk);
 		vkDestroyCommandPool(vk->device, vk->cmd_pool_graphics.vk_handle, nullptr);
 		
-		vk_destroy_swapchain_framebuffer(vk);
-		vi_destroy_pass(device, device->swapchain_pass);
-		vk_destroy_swapchain(vk);
+		if (!device->headless)
+		{
+			vk_retire_swapchain(vk);
+			vi_destroy_pass(device, device->swapchain_pass);
+		}
+
+		for (VIRetiredSwapchain& retired : vk->retired_swapchains)
+			vk_destroy_retired_swapchain(vk, &retired);
+		vk->retired_swapchains.clear();
 
 		vk_destroy_device(vk);
 		vk_destroy_surface(vk);
 		vk_destroy_instance(vk);
 
-		vi_free(vk->frames);
+		if (vk->frames)
+			vi_free(vk->frames);
 
 		vk->~VIVulkan();
 	}
@@ -4237,21 +6480,35 @@ void vi_destroy_device(VIDevice device)
 	{
 		VIOpenGL* gl = &device->gl;
 
-		vi_free(device->swapchain_framebuffers);
+		if (!device->headless)
+			vi_free(device->swapchain_framebuffers);
+
+		if (gl->indirect_buffer)
+			glDeleteBuffers(1, &gl->indirect_buffer);
+
+#ifdef VI_PLATFORM_LINUX
+		if (gl->egl_display != EGL_NO_DISPLAY)
+			gl_destroy_headless_context(gl);
+#endif
+
+		if (gl->owns_window)
+			glfwDestroyWindow(gl->window);
 
 		gl->~VIOpenGL();
 	}
 
+	// TODO: send notification via user debug callback
+	VI_ASSERT(device->host_malloc_usage == 0);
+
 	device->~VIDeviceObj();
 	vi_free(device);
-
-	// TODO: send notification via user debug callback
-	VI_ASSERT(host_malloc_usage == 0);
 }
 
 VIFence vi_create_fence(VIDevice device, VkFenceCreateFlags flags)
 {
-	VIFence fence = (VIFence)vi_malloc(sizeof(VIFenceObj));
+	VI_TRACE_FUNC;
+
+	VIFence fence = (VIFence)vi_device_malloc(device, sizeof(VIFenceObj));
 	fence->device = device;
 	
 	if (device->backend == VI_BACKEND_OPENGL)
@@ -4271,6 +6528,8 @@ VIFence vi_create_fence(VIDevice device, VkFenceCreateFlags flags)
 
 void vi_destroy_fence(VIDevice device, VIFence fence)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_VULKAN)
 		vkDestroyFence(device->vk.device, fence->vk_handle, nullptr);
 
@@ -4279,6 +6538,8 @@ void vi_destroy_fence(VIDevice device, VIFence fence)
 
 void vi_wait_for_fences(VIDevice device, uint32_t fence_count, VIFence* fences, bool wait_all, uint64_t timeout)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
 		for (uint32_t i = 0; i < fence_count; i++)
@@ -4295,6 +6556,11 @@ void vi_wait_for_fences(VIDevice device, uint32_t fence_count, VIFence* fences,
 
 void vi_queue_wait_idle(VIQueue queue)
 {
+	VI_TRACE_FUNC;
+
+	// compute-only devices have a single queue
+	idle_transient_sets(queue->device);
+
 	if (queue->device->backend == VI_BACKEND_OPENGL)
 		return;
 
@@ -4303,8 +6569,19 @@ void vi_queue_wait_idle(VIQueue queue)
 
 void vi_queue_submit(VIQueue queue, uint32_t submit_count, VISubmitInfo* submits, VIFence fence)
 {
+	VI_TRACE_FUNC;
+
 	VIDevice device = queue->device;
 
+	{
+		std::lock_guard<std::mutex> lock(device->frame_counters_mutex);
+		device->frame_counters.submits += submit_count;
+
+		for (uint32_t i = 0; i < submit_count; i++)
+			for (uint32_t j = 0; j < submits[i].cmd_count; j++)
+				add_frame_counters(&device->frame_counters, submits[i].cmds[j]->counters);
+	}
+
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
 		for (uint32_t i = 0; i < submit_count; i++)
@@ -4362,6 +6639,12 @@ void vi_queue_submit(VIQueue queue, uint32_t submit_count, VISubmitInfo* submits
 
 void vi_set_update(VISet set, uint32_t update_count, const VISetUpdateInfo* updates)
 {
+	VI_TRACE_FUNC;
+
+	// the whole buffer is not a valid range once a dynamic offset is added
+	for (uint32_t i = 0; i < update_count; i++)
+		VI_ASSERT(!is_binding_type_dynamic(set->layout->bindings[updates[i].binding_index].type) || updates[i].buffer_range != 0);
+
 	if (set->device->backend == VI_BACKEND_OPENGL)
 	{
 		gl_set_update(set, update_count, updates);
@@ -4373,84 +6656,90 @@ void vi_set_update(VISet set, uint32_t update_count, const VISetUpdateInfo* upda
 	std::vector<VkDescriptorImageInfo> write_images;
 	std::vector<VkDescriptorBufferInfo> write_buffers;
 	std::vector<VkWriteDescriptorSet> writes;
+	vk_set_update_writes(set->layout, set->vk.handle, update_count, updates, writes, write_buffers, write_images);
 
-	for (uint32_t i = 0; i < update_count; i++)
-	{
-		uint32_t binding_idx = updates[i].binding_index;
-		uint32_t descriptor_count = 1;
-		VIBindingType binding_type = set->layout->bindings[binding_idx].type;
-		VkDescriptorType descriptor_type;
-		cast_binding_type(binding_type, &descriptor_type);
-
-		VkWriteDescriptorSet write;
-		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		write.pNext = nullptr;
-		write.dstSet = set->vk.handle;
-		write.dstBinding = binding_idx;
-		write.dstArrayElement = 0;
-		write.descriptorType = descriptor_type;
-		write.descriptorCount = 1;
-		write.pImageInfo = nullptr;
-		write.pBufferInfo = nullptr;
-		write.pTexelBufferView = nullptr;
+	vkUpdateDescriptorSets(vk->device, writes.size(), writes.data(), 0, nullptr);
+}
 
-		if (descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
-			descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
-		{
-			VI_ASSERT(updates[i].buffer != VI_NULL);
+uint32_t vi_set_layout_get_descriptor_count(VISetLayout layout)
+{
+	VI_TRACE_FUNC;
 
-			VkDescriptorBufferInfo bufferI;
-			bufferI.buffer = updates[i].buffer->vk.handle;
-			bufferI.range = updates[i].buffer->size;
-			bufferI.offset = 0;
-			write_buffers.push_back(bufferI);
-		}
-		else if (descriptor_type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
-			descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
-		{
-			VI_ASSERT(updates[i].image != VI_NULL);
+	return layout->descriptor_count;
+}
 
-			VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			if (updates[i].image->info.usage & VI_IMAGE_USAGE_STORAGE_BIT)
-				layout = VK_IMAGE_LAYOUT_GENERAL;
+void vi_set_update_batch(VIDevice device, uint32_t set_count, const VISet* sets, const VISetResource* resources)
+{
+	VI_TRACE_FUNC;
 
-			VkDescriptorImageInfo imageI;
-			imageI.imageLayout = layout; // TODO: deprecate updates[i].image->vk.image_layout;
-			imageI.imageView = updates[i].image->vk.view_handle;
-			imageI.sampler = updates[i].image->vk.sampler_handle;
-			write_images.push_back(imageI);
+	// the whole buffer is not a valid range once a dynamic offset is added
+	const VISetResource* resource = resources;
+	for (uint32_t i = 0; i < set_count; i++)
+	{
+		for (const VIBinding& binding : sets[i]->layout->bindings)
+		{
+			for (uint32_t j = 0; j < binding.array_count; j++, resource++)
+				VI_ASSERT(!is_binding_type_dynamic(binding.type) || resource->buffer_range != 0);
 		}
+	}
 
-		writes.push_back(write);
+	if (device->backend == VI_BACKEND_OPENGL)
+	{
+		gl_set_update_batch(set_count, sets, resources);
+		return;
 	}
 
-	uint32_t write_buffer_idx = 0;
-	uint32_t write_image_idx = 0;
+	VIVulkan* vk = &device->vk;
+	std::vector<VKDescriptorInfo> infos;
 
-	// only store pointers after vector sizes are determined
-	for (uint32_t i = 0; i < update_count; i++)
+	for (uint32_t i = 0; i < set_count; i++)
 	{
-		uint32_t binding_idx = updates[i].binding_index;
-		VIBindingType binding_type = set->layout->bindings[binding_idx].type;
+		VISetLayout layout = sets[i]->layout;
+		if (layout->descriptor_count == 0)
+			continue;
 
-		if (binding_type == VI_BINDING_TYPE_UNIFORM_BUFFER ||
-			binding_type == VI_BINDING_TYPE_STORAGE_BUFFER)
-		{
-			writes[i].pBufferInfo = write_buffers.data() + write_buffer_idx++;
-		}
-		else if (binding_type == VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER ||
-			binding_type == VI_BINDING_TYPE_STORAGE_IMAGE)
+		if (infos.size() < layout->descriptor_count)
+			infos.resize(layout->descriptor_count);
+
+		VKDescriptorInfo* info = infos.data();
+
+		for (const VIBinding& binding : layout->bindings)
 		{
-			writes[i].pImageInfo = write_images.data() + write_image_idx++;
+			for (uint32_t j = 0; j < binding.array_count; j++, info++, resources++)
+			{
+				switch (binding.type)
+				{
+				case VI_BINDING_TYPE_UNIFORM_BUFFER:
+				case VI_BINDING_TYPE_STORAGE_BUFFER:
+				case VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC:
+				case VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC:
+					VI_ASSERT(resources->buffer);
+					info->buffer.buffer = resources->buffer->vk.handle;
+					info->buffer.offset = 0;
+					info->buffer.range = resources->buffer_range ? resources->buffer_range : resources->buffer->size;
+					break;
+				case VI_BINDING_TYPE_STORAGE_IMAGE:
+				case VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER:
+					VI_ASSERT(resources->image);
+					info->image.imageLayout = (resources->image->info.usage & VI_IMAGE_USAGE_STORAGE_BIT) ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+					info->image.imageView = vk_image_sampled_view(resources->image);
+					info->image.sampler = (resources->sampler ? resources->sampler : resources->image->sampler)->vk.handle;
+					break;
+				default:
+					VI_UNREACHABLE;
+				}
+			}
 		}
-	}
 
-	vkUpdateDescriptorSets(vk->device, writes.size(), writes.data(), 0, nullptr);
+		vkUpdateDescriptorSetWithTemplate(vk->device, sets[i]->vk.handle, layout->vk.update_template, infos.data());
+	}
 }
 
 VIPass vi_create_pass(VIDevice device, const VIPassInfo* info)
 {
-	VIPass pass = (VIPass)vi_malloc(sizeof(VIPassObj));
+	VI_TRACE_FUNC;
+
+	VIPass pass = (VIPass)vi_device_malloc(device, sizeof(VIPassObj));
 	new (pass)VIPassObj();
 	pass->device = device;
 
@@ -4520,6 +6809,8 @@ VIPass vi_create_pass(VIDevice device, const VIPassInfo* info)
 
 void vi_destroy_pass(VIDevice device, VIPass pass)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_VULKAN)
 	{
 		VIVulkan* vk = &pass->device->vk;
@@ -4532,14 +6823,19 @@ void vi_destroy_pass(VIDevice device, VIPass pass)
 
 VIModule vi_create_module(VIDevice device, const VIModuleInfo* info)
 {
-	VIModule module = (VIModule)vi_malloc(sizeof(VIModuleObj));
+	VI_TRACE_FUNC;
+
+	VIModule module = (VIModule)vi_device_malloc(device, sizeof(VIModuleObj));
 	module->device = device;
 	module->type = info->type;
 
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
-		gl_create_module(device, module, info);
-		return module;
+		if (gl_create_module(device, module, info))
+			return module;
+
+		vi_free(module);
+		return VI_NULL;
 	}
 
 	std::vector<char> byte_code;
@@ -4553,21 +6849,32 @@ VIModule vi_create_module(VIDevice device, const VIModuleInfo* info)
 
 	if (info->vise_binary)
 	{
-		VIBinaryHeader* header = (VIBinaryHeader*)info->vise_binary;
-		uint32_t header_size = header->header_size;
-		uint32_t payload_size = header->payload_size;
-		uint8_t* now = ((uint8_t*)header) + header_size;
+		VIBinaryHeader header;
+		if (!check_module_binary(VI_BACKEND_VULKAN, info, &header))
+		{
+			vi_free(module);
+			return VI_NULL;
+		}
 
-		spirv_words.resize(payload_size / 4);
-		for (size_t i = 0; i < spirv_words.size(); i++)
-			spirv_words[i] = sread32(&now);
+		// SPIRV is consumed in place, only misaligned binaries are copied
+		const uint8_t* spirv = (const uint8_t*)info->vise_binary + header.spirv_offset;
+		code_size = (size_t)header.spirv_size;
 
-		code_size = (size_t)payload_size;
-		code = spirv_words.data();
+		if (((uintptr_t)spirv & 3) == 0)
+			code = (const uint32_t*)spirv;
+		else
+		{
+			spirv_words.resize(code_size / 4);
+			memcpy(spirv_words.data(), spirv, code_size);
+			code = spirv_words.data();
+		}
 	}
 	else if (info->vise_glsl)
 	{
-		compile_vk(result, stage, info->vise_glsl);
+		compile_vk(result, stage, info->vise_glsl, info->include_resolver);
+		if (!result.success)
+			std::cout << "vise compile_vk failed\n" << result.error << std::endl;
+		VI_ASSERT(result.success && "vi_create_module: compilation failed");
 		code_size = result.vk_spirv.size() * 4;
 		code = result.vk_spirv.data();
 	}
@@ -4587,6 +6894,8 @@ VIModule vi_create_module(VIDevice device, const VIModuleInfo* info)
 
 void vi_destroy_module(VIDevice device, VIModule module)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 		gl_destroy_module(device, module);
 	else
@@ -4598,43 +6907,207 @@ void vi_destroy_module(VIDevice device, VIModule module)
 	vi_free(module);
 }
 
-VIBuffer vi_create_buffer(VIDevice device, const VIBufferInfo* info)
+VIPermutation vi_create_permutation(VIDevice device, const VIPermutationInfo* info)
 {
-	VI_ASSERT(info->properties != 0);
+	VI_TRACE_FUNC;
 
-	VIBuffer buffer = (VIBuffer)vi_malloc(sizeof(VIBufferObj));
-	new (buffer) VIBufferObj();
-	buffer->device = device;
-	buffer->type = info->type;
-	buffer->size = info->size;
-	buffer->usage = info->usage;
-	buffer->properties = info->properties;
-	buffer->is_mapped = false;
+	VI_ASSERT(info->keyword_count <= 64);
 
-	if (device->backend == VI_BACKEND_OPENGL)
-	{
-		gl_create_buffer(device, buffer, info);
-		return buffer;
-	}
+	VIPermutation permutation = (VIPermutation)vi_device_malloc(device, sizeof(VIPermutationObj));
+	new (permutation) VIPermutationObj();
+	permutation->device = device;
+	permutation->type = info->type;
+	permutation->pipeline_layout = info->pipeline_layout;
+	permutation->include_resolver = info->include_resolver;
+	permutation->vise_glsl = info->vise_glsl;
+	permutation->keywords.assign(info->keywords, info->keywords + info->keyword_count);
 
-	VIVulkan* vk = &device->vk;
+	return permutation;
+}
 
-	VkBufferUsageFlags usage;
-	cast_buffer_usages(info->type, info->usage, &usage);
+void vi_destroy_permutation(VIDevice device, VIPermutation permutation)
+{
+	VI_TRACE_FUNC;
 
-	VkBufferCreateInfo bufferCI{};
-	bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	bufferCI.size = (VkDeviceSize)info->size;
-	bufferCI.usage = usage;
-	vk_create_buffer(vk, buffer, &bufferCI, info->properties);
+	for (auto& it : permutation->variants)
+		vi_destroy_module(device, it.second.module);
 
-	return buffer;
+	permutation->~VIPermutationObj();
+	vi_free(permutation);
 }
 
-void vi_destroy_buffer(VIDevice device, VIBuffer buffer)
+VIModule vi_permutation_get_module(VIPermutation permutation, uint64_t key)
 {
-	if (device->backend == VI_BACKEND_OPENGL)
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(permutation->keywords.size() == 64 || (key >> permutation->keywords.size()) == 0);
+
+	auto it = permutation->variants.find(key);
+
+	if (it == permutation->variants.end())
+	{
+		std::string source = get_permutation_source(permutation->vise_glsl.c_str(), (uint32_t)permutation->keywords.size(), permutation->keywords.data(), key);
+
+		VIModuleInfo moduleI;
+		moduleI.type = permutation->type;
+		moduleI.pipeline_layout = permutation->pipeline_layout;
+		moduleI.vise_glsl = source.c_str();
+		moduleI.include_resolver = permutation->include_resolver;
+
+		VIPermutationObj::Variant variant;
+		variant.module = vi_create_module(permutation->device, &moduleI);
+		variant.is_used = false;
+		it = permutation->variants.insert({ key, variant }).first;
+	}
+
+	if (!it->second.is_used)
+	{
+		it->second.is_used = true;
+		permutation->used_keys.push_back(key);
+	}
+
+	return it->second.module;
+}
+
+void vi_permutation_prewarm(VIPermutation permutation, uint32_t key_count, const uint64_t* keys, uint32_t thread_count)
+{
+	VI_TRACE_FUNC;
+
+	VIDevice device = permutation->device;
+	uint32_t keyword_count = (uint32_t)permutation->keywords.size();
+
+	std::vector<uint64_t> missing_keys;
+	for (uint32_t i = 0; i < key_count; i++)
+	{
+		if (permutation->variants.find(keys[i]) == permutation->variants.end() &&
+			std::find(missing_keys.begin(), missing_keys.end(), keys[i]) == missing_keys.end())
+			missing_keys.push_back(keys[i]);
+	}
+
+	if (missing_keys.empty())
+		return;
+
+	std::vector<VISetLayoutInfo> set_layouts;
+	std::vector<VIBinding> set_bindings;
+	VIPipelineLayoutData layout_data;
+	get_pipeline_layout_data(permutation->pipeline_layout, set_layouts, set_bindings, &layout_data);
+
+	// GLSL compilation happens on worker threads, module creation on the calling thread
+	uint32_t job_count = (uint32_t)missing_keys.size();
+	std::vector<std::string> sources(job_count);
+	std::vector<VICompileJob> jobs(job_count);
+	std::vector<VICompileJobResult> results(job_count);
+
+	for (uint32_t i = 0; i < job_count; i++)
+	{
+		sources[i] = get_permutation_source(permutation->vise_glsl.c_str(), keyword_count, permutation->keywords.data(), missing_keys[i]);
+		jobs[i].backend = device->backend;
+		jobs[i].type = permutation->type;
+		jobs[i].pipeline_layout = &layout_data;
+		jobs[i].vise_glsl = sources[i].c_str();
+		jobs[i].include_resolver = permutation->include_resolver;
+	}
+
+	vi_compile_binaries(job_count, jobs.data(), results.data(), thread_count);
+
+	for (uint32_t i = 0; i < job_count; i++)
+	{
+		if (results[i].dependencies)
+			vi_free(results[i].dependencies);
+
+		if (!results[i].binary)
+		{
+			std::cout << "vi_permutation_prewarm: variant " << missing_keys[i] << " failed\n" << results[i].error << std::endl;
+			vi_free(results[i].error);
+			continue;
+		}
+
+		vi_permutation_load_binary(permutation, missing_keys[i], results[i].binary, results[i].binary_size);
+		vi_free(results[i].binary);
+	}
+}
+
+void vi_permutation_load_binary(VIPermutation permutation, uint64_t key, const char* vise_binary, uint32_t binary_size)
+{
+	VI_TRACE_FUNC;
+
+	if (permutation->variants.find(key) != permutation->variants.end())
+		return;
+
+	VIModuleInfo moduleI;
+	moduleI.type = permutation->type;
+	moduleI.pipeline_layout = permutation->pipeline_layout;
+	moduleI.vise_binary = vise_binary;
+	moduleI.vise_binary_size = binary_size;
+
+	VIPermutationObj::Variant variant;
+	variant.module = vi_create_module(permutation->device, &moduleI);
+	variant.is_used = false;
+
+	// rejected binaries are left to be compiled lazily by vi_permutation_get_module
+	if (variant.module)
+		permutation->variants.insert({ key, variant });
+}
+
+uint32_t vi_permutation_get_used_keys(VIPermutation permutation, uint64_t* keys)
+{
+	VI_TRACE_FUNC;
+
+	uint32_t key_count = (uint32_t)permutation->used_keys.size();
+
+	if (keys)
+		std::copy(permutation->used_keys.begin(), permutation->used_keys.end(), keys);
+
+	return key_count;
+}
+
+VIBuffer vi_create_buffer(VIDevice device, const VIBufferInfo* info)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(info->properties != 0);
+
+	VIBuffer buffer = (VIBuffer)vi_device_malloc(device, sizeof(VIBufferObj));
+	new (buffer) VIBufferObj();
+	buffer->device = device;
+	buffer->type = info->type;
+	buffer->size = info->size;
+	buffer->usage = info->usage;
+	buffer->properties = info->properties;
+	buffer->is_mapped = false;
+
+	if (device->backend == VI_BACKEND_OPENGL)
+	{
+		gl_create_buffer(device, buffer, info);
+		return buffer;
+	}
+
+	VIVulkan* vk = &device->vk;
+
+	VkBufferUsageFlags usage;
+	cast_buffer_usages(info->type, info->usage, &usage);
+
+	if ((info->usage & VI_BUFFER_USAGE_CONDITIONAL_BIT) && vk->supports_conditional_rendering)
+		usage |= VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT;
+
+	VkBufferCreateInfo bufferCI{};
+	bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	bufferCI.size = (VkDeviceSize)info->size;
+	bufferCI.usage = usage;
+	vk_create_buffer(vk, buffer, &bufferCI, info->properties);
+
+	return buffer;
+}
+
+void vi_destroy_buffer(VIDevice device, VIBuffer buffer)
+{
+	VI_TRACE_FUNC;
+
+	if (vk_defer_destroy(device, VI_GARBAGE_TYPE_BUFFER, buffer))
+		return;
+
+	if (device->backend == VI_BACKEND_OPENGL)
 		gl_destroy_buffer(device, buffer);
 	else
 		vk_destroy_buffer(&device->vk, buffer);
@@ -4645,15 +7118,19 @@ void vi_destroy_buffer(VIDevice device, VIBuffer buffer)
 
 VIImage vi_create_image(VIDevice device, const VIImageInfo* info)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(!(info->type == VI_IMAGE_TYPE_2D && info->layers != 1));
 	VI_ASSERT(!(info->type == VI_IMAGE_TYPE_2D_ARRAY && info->layers <= 1));
 	VI_ASSERT(!(info->type == VI_IMAGE_TYPE_CUBE && info->layers != 6));
+	VI_ASSERT(!(is_format_compressed(info->format) && (info->usage & (VI_IMAGE_USAGE_STORAGE_BIT | VI_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VI_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))));
 
-	VIImage image = (VIImage)vi_malloc(sizeof(VIImageObj));
+	VIImage image = (VIImage)vi_device_malloc(device, sizeof(VIImageObj));
 	new (image) VIImageObj();
 	image->device = device;
 	image->info = *info;
 	image->flags = 0;
+	image->sampler = vi_create_sampler(device, &info->sampler);
 
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
@@ -4704,44 +7181,88 @@ VIImage vi_create_image(VIDevice device, const VIImageInfo* info)
 	viewCI.subresourceRange.layerCount = info->layers;
 	viewCI.subresourceRange.levelCount = info->levels;
 	vk_create_image_view(vk, image, &viewCI);
-	
-	VkSamplerAddressMode address_mode;
-	cast_sampler_address_mode_vk(image->info.sampler.address_mode, &address_mode);
 
-	VkFilter filter;
-	VkSamplerMipmapMode mipmap_mode;
-	cast_filter_vk(image->info.sampler, &filter, &mipmap_mode);
+	return image;
+}
 
-	VkSamplerCreateInfo samplerCI{};
-	samplerCI.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	samplerCI.addressModeU = address_mode;
-	samplerCI.addressModeV = address_mode;
-	samplerCI.addressModeW = address_mode;
-	samplerCI.minFilter = filter;
-	samplerCI.magFilter = filter;
-	samplerCI.anisotropyEnable = VK_FALSE; // TODO:
-	samplerCI.maxAnisotropy = vk->pdevice_chosen->device_props.limits.maxSamplerAnisotropy;
-	samplerCI.borderColor;// TODO:
-	samplerCI.unnormalizedCoordinates = VK_FALSE;
-	samplerCI.compareEnable = VK_FALSE;
-	samplerCI.mipmapMode = mipmap_mode;
-	samplerCI.mipLodBias = 0.0f;
-	samplerCI.minLod = info->sampler.min_lod;
-	samplerCI.maxLod = info->sampler.max_lod;
-	vk_create_sampler(vk, image, &samplerCI);
+VISampler vi_create_sampler(VIDevice device, const VISamplerInfo* info)
+{
+	VI_TRACE_FUNC;
 
-	return image;
+	// the cache holds a handful of distinct sampler states, a linear search is sufficient
+	for (VISampler sampler : device->samplers)
+	{
+		if (sampler->info.filter == info->filter &&
+			sampler->info.mipmap_filter == info->mipmap_filter &&
+			sampler->info.address_mode == info->address_mode &&
+			sampler->info.min_lod == info->min_lod &&
+			sampler->info.max_lod == info->max_lod)
+		{
+			sampler->ref_count++;
+			return sampler;
+		}
+	}
+
+	VISampler sampler = (VISampler)vi_device_malloc(device, sizeof(VISamplerObj));
+	new (sampler) VISamplerObj();
+	sampler->device = device;
+	sampler->info = *info;
+	sampler->ref_count = 1;
+	device->samplers.push_back(sampler);
+
+	if (device->backend == VI_BACKEND_OPENGL)
+		gl_create_sampler(&device->gl, sampler);
+	else
+		vk_create_sampler(&device->vk, sampler);
+
+	return sampler;
+}
+
+void vi_destroy_sampler(VIDevice device, VISampler sampler)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(sampler->ref_count > 0);
+
+	if (--sampler->ref_count > 0)
+		return;
+
+	auto ite = std::find(device->samplers.begin(), device->samplers.end(), sampler);
+	VI_ASSERT(ite != device->samplers.end());
+	device->samplers.erase(ite);
+
+	if (device->backend == VI_BACKEND_OPENGL)
+		gl_destroy_sampler(&device->gl, sampler);
+	else
+		vk_destroy_sampler(&device->vk, sampler);
+
+	sampler->~VISamplerObj();
+	vi_free(sampler);
+}
+
+uint32_t vi_format_get_data_size(VIFormat format, uint32_t width, uint32_t height)
+{
+	VI_TRACE_FUNC;
+
+	const VIFormatEntry* entry = vi_format_table + (int)format;
+	uint32_t extent = entry->texel_block_extent;
+	uint32_t block_count_x = (width + extent - 1) / extent;
+	uint32_t block_count_y = (height + extent - 1) / extent;
+
+	return block_count_x * block_count_y * entry->texel_block_size;
 }
 
 void vi_destroy_image(VIDevice device, VIImage image)
 {
+	VI_TRACE_FUNC;
+
+	if (vk_defer_destroy(device, VI_GARBAGE_TYPE_IMAGE, image))
+		return;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 		gl_destroy_image(&device->gl, image);
 	else
 	{
-		if (image->flags & VI_IMAGE_FLAG_CREATED_SAMPLER_BIT)
-			vk_destroy_sampler(&device->vk, image);
-
 		if (image->flags & VI_IMAGE_FLAG_CREATED_IMAGE_VIEW_BIT)
 			vk_destroy_image_view(&device->vk, image);
 
@@ -4749,20 +7270,109 @@ void vi_destroy_image(VIDevice device, VIImage image)
 			vk_destroy_image(&device->vk, image);
 	}
 
+	vi_destroy_sampler(device, image->sampler);
+
 	image->~VIImageObj();
 	vi_free(image);
 }
 
+void vi_image_set_base_level(VIImage image, uint32_t base_level)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(base_level < image->info.levels);
+
+	VIDevice device = image->device;
+	image->base_level = base_level;
+
+	if (device->backend == VI_BACKEND_OPENGL)
+	{
+		glTextureParameteri(image->gl.handle, GL_TEXTURE_BASE_LEVEL, (GLint)base_level);
+		GL_CHECK();
+		return;
+	}
+
+	if (base_level == 0)
+		return;
+
+	// views are kept until the image is destroyed, sets written before this call keep using their view
+	if (!image->vk_level_views)
+	{
+		image->vk_level_views = (VkImageView*)vi_device_malloc(image->device, sizeof(VkImageView) * image->info.levels);
+		for (uint32_t level = 0; level < image->info.levels; level++)
+			image->vk_level_views[level] = VK_NULL_HANDLE;
+	}
+
+	if (image->vk_level_views[base_level] != VK_NULL_HANDLE)
+		return;
+
+	VkFormat format;
+	VkImageAspectFlags aspect;
+	VkImageType type;
+	VkImageViewType view_type;
+	cast_format_vk(image->info.format, &format, &aspect);
+	cast_image_type(image->info.type, &type, &view_type);
+
+	VkImageViewCreateInfo viewCI{};
+	viewCI.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCI.image = image->vk.handle;
+	viewCI.viewType = view_type;
+	viewCI.format = format;
+	viewCI.subresourceRange.aspectMask = aspect;
+	viewCI.subresourceRange.baseArrayLayer = 0;
+	viewCI.subresourceRange.baseMipLevel = base_level;
+	viewCI.subresourceRange.layerCount = image->info.layers;
+	viewCI.subresourceRange.levelCount = image->info.levels - base_level;
+	VK_CHECK(vkCreateImageView(device->vk.device, &viewCI, NULL, image->vk_level_views + base_level));
+}
+
 VISetLayout vi_create_set_layout(VIDevice device, const VISetLayoutInfo* info)
 {
-	VISetLayout layout = (VISetLayout)vi_malloc(sizeof(VISetLayoutObj));
+	VI_TRACE_FUNC;
+
+	VISetLayout layout = (VISetLayout)vi_device_malloc(device, sizeof(VISetLayoutObj));
 	new (layout) VISetLayoutObj();
 
 	layout->device = device;
+	layout->flags = info->flags;
 	layout->bindings.resize(info->binding_count);
+	layout->descriptor_offsets.resize(info->binding_count);
+	layout->descriptor_count = 0;
 
 	for (size_t i = 0; i < info->binding_count; i++)
+	{
 		layout->bindings[i] = info->bindings[i];
+		layout->descriptor_offsets[i] = layout->descriptor_count;
+		layout->descriptor_count += info->bindings[i].array_count;
+
+		if ((info->flags & VI_SET_LAYOUT_BINDLESS_BIT) && info->bindings[i].type == VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER)
+			VI_ASSERT(info->bindings[i].array_count <= device->limits.max_bindless_image_count);
+
+		// push descriptors do not support dynamic offsets
+		if (info->flags & VI_SET_LAYOUT_PUSH_BIT)
+			VI_ASSERT(info->bindings[i].type != VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC && info->bindings[i].type != VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC);
+	}
+
+	VI_ASSERT(!((info->flags & VI_SET_LAYOUT_PUSH_BIT) && (info->flags & VI_SET_LAYOUT_BINDLESS_BIT)));
+
+	// dynamic offsets are supplied in binding_index order, not in declaration order
+	std::vector<uint32_t> dynamic_bindings;
+	for (uint32_t i = 0; i < info->binding_count; i++)
+	{
+		if (is_binding_type_dynamic(info->bindings[i].type))
+			dynamic_bindings.push_back(i);
+	}
+	std::sort(dynamic_bindings.begin(), dynamic_bindings.end(), [info](uint32_t lhs, uint32_t rhs) {
+		return info->bindings[lhs].binding_index < info->bindings[rhs].binding_index;
+	});
+
+	uint32_t dynamic_offset_count = 0;
+	layout->dynamic_offset_indices.resize(info->binding_count, 0);
+	for (uint32_t i : dynamic_bindings)
+	{
+		layout->dynamic_offset_indices[i] = dynamic_offset_count;
+		dynamic_offset_count += info->bindings[i].array_count;
+	}
 
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
@@ -4772,29 +7382,81 @@ VISetLayout vi_create_set_layout(VIDevice device, const VISetLayoutInfo* info)
 	VIVulkan* vk = &device->vk;
 
 	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	std::vector<VkDescriptorBindingFlags> binding_flags;
 	bindings.resize(info->binding_count);
+	binding_flags.resize(info->binding_count);
 
 	for (uint32_t i = 0; i < info->binding_count; i++)
 	{
 		cast_binding(info->bindings + i, bindings.data() + i);
+
+		// only the image arrays are bindless, other bindings of the layout stay regular descriptors
+		binding_flags[i] = 0;
+		if (info->bindings[i].type == VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER)
+			binding_flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
 	}
 
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCI{};
+	bindingFlagsCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsCI.bindingCount = (uint32_t)binding_flags.size();
+	bindingFlagsCI.pBindingFlags = binding_flags.data();
+
 	VkDescriptorSetLayoutCreateInfo layoutCI;
 	layoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	layoutCI.pNext = nullptr;
 	layoutCI.flags = 0;
 	layoutCI.bindingCount = bindings.size();
 	layoutCI.pBindings = bindings.data();
+
+	if (info->flags & VI_SET_LAYOUT_BINDLESS_BIT)
+	{
+		VI_ASSERT(device->limits.max_bindless_image_count > 0 && "bindless set layouts require descriptor indexing");
+		layoutCI.pNext = &bindingFlagsCI;
+		layoutCI.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	}
+
+	// without VK_KHR_push_descriptor the layout stays a regular one, pushes allocate transient sets instead
+	bool is_push_layout = (info->flags & VI_SET_LAYOUT_PUSH_BIT) && vk->supports_push_descriptor;
+	if (is_push_layout)
+		layoutCI.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
 	VK_CHECK(vkCreateDescriptorSetLayout(vk->device, &layoutCI, nullptr, &layout->vk.handle));
 
+	// one template entry per binding, array elements are consecutive VKDescriptorInfo
+	layout->vk.update_template = VK_NULL_HANDLE;
+	if (layout->descriptor_count > 0 && !is_push_layout)
+	{
+		std::vector<VkDescriptorUpdateTemplateEntry> entries(info->binding_count);
+		for (uint32_t i = 0; i < info->binding_count; i++)
+		{
+			entries[i].dstBinding = bindings[i].binding;
+			entries[i].dstArrayElement = 0;
+			entries[i].descriptorCount = bindings[i].descriptorCount;
+			entries[i].descriptorType = bindings[i].descriptorType;
+			entries[i].offset = sizeof(VKDescriptorInfo) * layout->descriptor_offsets[i];
+			entries[i].stride = sizeof(VKDescriptorInfo);
+		}
+
+		VkDescriptorUpdateTemplateCreateInfo templateCI{};
+		templateCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		templateCI.descriptorUpdateEntryCount = (uint32_t)entries.size();
+		templateCI.pDescriptorUpdateEntries = entries.data();
+		templateCI.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		templateCI.descriptorSetLayout = layout->vk.handle;
+		VK_CHECK(vkCreateDescriptorUpdateTemplate(vk->device, &templateCI, nullptr, &layout->vk.update_template));
+	}
+
 	return layout;
 }
 
 void vi_destroy_set_layout(VIDevice device, VISetLayout layout)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_VULKAN)
 	{
 		VIVulkan* vk = &device->vk;
+		if (layout->vk.update_template != VK_NULL_HANDLE)
+			vkDestroyDescriptorUpdateTemplate(vk->device, layout->vk.update_template, nullptr);
 		vkDestroyDescriptorSetLayout(vk->device, layout->vk.handle, nullptr);
 	}
 
@@ -4804,37 +7466,66 @@ void vi_destroy_set_layout(VIDevice device, VISetLayout layout)
 
 VISetPool vi_create_set_pool(VIDevice device, const VISetPoolInfo* info)
 {
-	VISetPool pool = (VISetPool)vi_malloc(sizeof(VISetPoolObj));
+	VI_TRACE_FUNC;
+
+	VISetPool pool = (VISetPool)vi_device_malloc(device, sizeof(VISetPoolObj));
 	new (pool) VISetPoolObj();
 	pool->device = device;
+	pool->flags = info->flags;
+	pool->max_set_count = std::max(info->max_set_count, 1u);
+	pool->observed_set_count = 0;
+	pool->resources.assign(info->resources, info->resources + info->resource_count);
+	std::fill(pool->observed_resources, pool->observed_resources + VI_BINDING_TYPE_ENUM_COUNT, 0);
 
-	if (device->backend == VI_BACKEND_OPENGL)
-		return pool;
-
-	VIVulkan* vk = &device->vk;
-
-	std::vector<VkDescriptorPoolSize> poolSizes;
-	cast_set_pool_resources(info->resource_count, info->resources, poolSizes);
+	// transient pools keep one frame of sets per frame in flight, compute-only devices have no frames
+	// and recycle their single frame whenever the device is idle, see idle_transient_sets
+	uint32_t frame_count = 1;
+	if ((info->flags & VI_SET_POOL_TRANSIENT_BIT) && device->backend == VI_BACKEND_VULKAN)
+		frame_count = std::max(1u, device->vk.max_frames_in_flight);
 
-	VkDescriptorPoolCreateInfo poolCI{};
-	poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolCI.pNext = nullptr;
-	poolCI.flags = 0;
-	poolCI.maxSets = info->max_set_count;
-	poolCI.poolSizeCount = poolSizes.size();
-	poolCI.pPoolSizes = poolSizes.data();
+	pool->frames.resize(frame_count);
+	for (VISetPoolFrame& frame : pool->frames)
+	{
+		frame.frame_count = device->frame_count;
+		frame.set_count = 0;
+		frame.pool_idx = 0;
+	}
 
-	pool->vk.flags = poolCI.flags;
+	if (device->backend == VI_BACKEND_OPENGL)
+		return pool;
 
-	VK_CHECK(vkCreateDescriptorPool(vk->device, &poolCI, nullptr, &pool->vk.handle));
+	// first descriptor pools are sized exactly by VISetPoolInfo, chained pools follow observed usage
+	for (VISetPoolFrame& frame : pool->frames)
+	{
+		vk_create_set_pool(&device->vk, pool, &frame);
+		pool->max_set_count = std::max(info->max_set_count, 1u);
+	}
 
 	return pool;
 }
 
 void vi_destroy_set_pool(VIDevice device, VISetPool pool)
 {
-	if (device->backend == VI_BACKEND_VULKAN)
-		vkDestroyDescriptorPool(device->vk.device, pool->vk.handle, nullptr);
+	VI_TRACE_FUNC;
+
+	// sets freed from the pool earlier are enqueued before it and released first
+	if (vk_defer_destroy(device, VI_GARBAGE_TYPE_SET_POOL, pool))
+		return;
+
+	for (VISetPoolFrame& frame : pool->frames)
+	{
+		for (size_t i = 0; i < frame.sets.size(); i++)
+		{
+			if (device->backend == VI_BACKEND_OPENGL && i < frame.set_count)
+				gl_free_set(device, frame.sets[i]);
+
+			frame.sets[i]->~VISetObj();
+			vi_free(frame.sets[i]);
+		}
+
+		for (VkDescriptorPool handle : frame.vk_pools)
+			vkDestroyDescriptorPool(device->vk.device, handle, nullptr);
+	}
 
 	pool->~VISetPoolObj();
 	vi_free(pool);
@@ -4842,8 +7533,25 @@ void vi_destroy_set_pool(VIDevice device, VISetPool pool)
 
 VISet vi_allocate_set(VIDevice device, VISetPool pool, VISetLayout layout)
 {
-	VISet set = (VISet)vi_malloc(sizeof(VISetObj));
-	new (set) VISetObj();
+	VI_TRACE_FUNC;
+
+	VISetPoolFrame* frame = get_set_pool_frame(device, pool);
+	VISet set;
+
+	if (!(pool->flags & VI_SET_POOL_TRANSIENT_BIT))
+	{
+		set = (VISet)vi_device_malloc(device, sizeof(VISetObj));
+		new (set) VISetObj();
+	}
+	else if (frame->set_count < frame->sets.size())
+		set = frame->sets[frame->set_count++];
+	else
+	{
+		set = (VISet)vi_device_malloc(device, sizeof(VISetObj));
+		new (set) VISetObj();
+		frame->sets.push_back(set);
+		frame->set_count++;
+	}
 
 	set->device = device;
 	set->pool = pool;
@@ -4855,30 +7563,32 @@ VISet vi_allocate_set(VIDevice device, VISetPool pool, VISetLayout layout)
 		return set;
 	}
 
-	VkDescriptorSetAllocateInfo allocI;
-	allocI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocI.pNext = nullptr;
-	allocI.descriptorPool = pool->vk.handle;
-	allocI.descriptorSetCount = 1;
-	allocI.pSetLayouts = &layout->vk.handle;
+	// NOTE: push descriptor set layouts can not be allocated from descriptor pools
+	VI_ASSERT(!((layout->flags & VI_SET_LAYOUT_PUSH_BIT) && device->vk.supports_push_descriptor));
 
-	VK_CHECK(vkAllocateDescriptorSets(device->vk.device, &allocI, &set->vk.handle));
+	vk_alloc_set(&device->vk, pool, frame, set);
 
 	return set;
 }
 
 void vi_free_set(VIDevice device, VISet set)
 {
+	VI_TRACE_FUNC;
+
+	// NOTE: sets from a transient pool are recycled in bulk and must not be freed individually
+	VI_ASSERT(!(set->pool->flags & VI_SET_POOL_TRANSIENT_BIT));
+
+	if (vk_defer_destroy(device, VI_GARBAGE_TYPE_SET, set))
+		return;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 		gl_free_set(device, set);
 	else
 	{
 		// NOTE: different from Vulkan usage, vi_free_set must be called to prevent leaks,
-		//       vi_alloc_set can be called at most VISetPoolInfo::max_set_count times
-		if (set->pool->vk.flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
-		{
-			VK_CHECK(vkFreeDescriptorSets(device->vk.device, set->pool->vk.handle, 1, &set->vk.handle));
-		}
+		//       the descriptor set is cached for the next allocation with the same layout,
+		//       or returned to its descriptor pool once an allocation of another layout runs out of space
+		set->pool->vk_free_sets[set->layout->id].push_back({ set->vk.handle, set->vk.pool_handle });
 	}
 
 	set->~VISetObj();
@@ -4887,9 +7597,11 @@ void vi_free_set(VIDevice device, VISet set)
 
 VIPipelineLayout vi_create_pipeline_layout(VIDevice device, const VIPipelineLayoutInfo* info)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(info->push_constant_size <= device->limits.max_push_constant_size);
 
-	VIPipelineLayout layout = (VIPipelineLayout)vi_malloc(sizeof(VIPipelineLayoutObj));
+	VIPipelineLayout layout = (VIPipelineLayout)vi_device_malloc(device, sizeof(VIPipelineLayoutObj));
 	new (layout) VIPipelineLayoutObj();
 	layout->push_constant_size = info->push_constant_size;
 	layout->set_layouts.resize(info->set_layout_count);
@@ -4926,6 +7638,8 @@ VIPipelineLayout vi_create_pipeline_layout(VIDevice device, const VIPipelineLayo
 
 void vi_destroy_pipeline_layout(VIDevice device, VIPipelineLayout layout)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 		gl_destroy_pipeline_layout(device, layout);
 	else
@@ -4940,10 +7654,13 @@ void vi_destroy_pipeline_layout(VIDevice device, VIPipelineLayout layout)
 
 VIPipeline vi_create_pipeline(VIDevice device, const VIPipelineInfo* info)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(info->pass);
 	VI_ASSERT(info->layout);
+	VI_ASSERT(!device->compute_only && "compute-only devices have no graphics queue");
 
-	VIPipeline pipeline = (VIPipeline)vi_malloc(sizeof(VIPipelineObj));
+	VIPipeline pipeline = (VIPipeline)vi_device_malloc(device, sizeof(VIPipelineObj));
 	new (pipeline) VIPipelineObj();
 	pipeline->device = device;
 	pipeline->blend_state = info->blend_state;
@@ -4965,7 +7682,7 @@ VIPipeline vi_create_pipeline(VIDevice device, const VIPipelineInfo* info)
 
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
-		gl_create_pipeline(device, pipeline, info->module_count, info->modules);
+		gl_create_pipeline(device, pipeline, info->module_count, info->modules, info->specialization);
 		cast_primitive_topology_gl(info->primitive_topology, &pipeline->gl.primitive);
 		return pipeline;
 	}
@@ -4998,6 +7715,13 @@ VIPipeline vi_create_pipeline(VIDevice device, const VIPipelineInfo* info)
 	blendStateCI.pAttachments = blendAttachments.data();
 	blendStateCI.blendConstants;  // Optional
 
+	// the same specialization constants are provided to every stage,
+	// map entries for constant IDs absent from a module have no effect
+	std::vector<VkSpecializationMapEntry> specializationEntries;
+	VkSpecializationInfo specializationI{};
+	if (info->specialization)
+		cast_specialization_info_vk(*info->specialization, &specializationEntries, &specializationI);
+
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStageCI(info->module_count);
 	for (size_t i = 0; i < info->module_count; i++)
 	{
@@ -5008,6 +7732,7 @@ VIPipeline vi_create_pipeline(VIDevice device, const VIPipelineInfo* info)
 		shaderStageCI[i].stage = stage;
 		shaderStageCI[i].module = info->modules[i]->vk.handle;
 		shaderStageCI[i].pName = VI_SHADER_ENTRY_POINT;
+		shaderStageCI[i].pSpecializationInfo = info->specialization ? &specializationI : nullptr;
 	}
 
 	std::array<VkDynamicState, 3> dynamicStates = {
@@ -5134,6 +7859,8 @@ VIPipeline vi_create_pipeline(VIDevice device, const VIPipelineInfo* info)
 
 void vi_destroy_pipeline(VIDevice device, VIPipeline pipeline)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 		gl_destroy_pipeline(device, pipeline);
 	else
@@ -5148,7 +7875,9 @@ void vi_destroy_pipeline(VIDevice device, VIPipeline pipeline)
 
 VIComputePipeline vi_create_compute_pipeline(VIDevice device, const VIComputePipelineInfo* info)
 {
-	VIComputePipeline pipeline = (VIComputePipeline)vi_malloc(sizeof(VIComputePipelineObj));
+	VI_TRACE_FUNC;
+
+	VIComputePipeline pipeline = (VIComputePipeline)vi_device_malloc(device, sizeof(VIComputePipelineObj));
 	new (pipeline) VIComputePipelineObj();
 	pipeline->device = device;
 	pipeline->layout = info->layout;
@@ -5156,17 +7885,23 @@ VIComputePipeline vi_create_compute_pipeline(VIDevice device, const VIComputePip
 
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
-		gl_create_compute_pipeline(device, pipeline, info->compute_module);
+		gl_create_compute_pipeline(device, pipeline, info->compute_module, info->specialization);
 		return pipeline;
 	}
 
 	VIVulkan* vk = &device->vk;
 
+	std::vector<VkSpecializationMapEntry> specializationEntries;
+	VkSpecializationInfo specializationI{};
+	if (info->specialization)
+		cast_specialization_info_vk(*info->specialization, &specializationEntries, &specializationI);
+
 	VkPipelineShaderStageCreateInfo stageCI{};
 	stageCI.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	stageCI.stage = VK_SHADER_STAGE_COMPUTE_BIT;
 	stageCI.pName = VI_SHADER_ENTRY_POINT;
 	stageCI.module = info->compute_module->vk.handle;
+	stageCI.pSpecializationInfo = info->specialization ? &specializationI : nullptr;
 
 	VkComputePipelineCreateInfo pipelineCI{};
 	pipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
@@ -5181,6 +7916,8 @@ VIComputePipeline vi_create_compute_pipeline(VIDevice device, const VIComputePip
 
 void vi_destroy_compute_pipeline(VIDevice device, VIComputePipeline pipeline)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 		gl_destroy_compute_pipeline(device, pipeline);
 	else
@@ -5196,7 +7933,9 @@ void vi_destroy_compute_pipeline(VIDevice device, VIComputePipeline pipeline)
 
 VIFramebuffer vi_create_framebuffer(VIDevice device, const VIFramebufferInfo* info)
 {
-	VIFramebuffer framebuffer = (VIFramebuffer)vi_malloc(sizeof(VIFramebufferObj));
+	VI_TRACE_FUNC;
+
+	VIFramebuffer framebuffer = (VIFramebuffer)vi_device_malloc(device, sizeof(VIFramebufferObj));
 	new (framebuffer) VIFramebufferObj();
 	framebuffer->device = device;
 	framebuffer->extent.width = info->width;
@@ -5238,6 +7977,11 @@ VIFramebuffer vi_create_framebuffer(VIDevice device, const VIFramebufferInfo* in
 
 void vi_destroy_framebuffer(VIDevice device, VIFramebuffer framebuffer)
 {
+	VI_TRACE_FUNC;
+
+	if (vk_defer_destroy(device, VI_GARBAGE_TYPE_FRAMEBUFFER, framebuffer))
+		return;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
 		VIOpenGL* gl = &device->gl;
@@ -5255,7 +7999,9 @@ void vi_destroy_framebuffer(VIDevice device, VIFramebuffer framebuffer)
 
 VICommandPool vi_create_command_pool(VIDevice device, uint32_t family_idx, VkCommandPoolCreateFlags flags)
 {
-	VICommandPool pool = (VICommandPool)vi_malloc(sizeof(VICommandPoolObj));
+	VI_TRACE_FUNC;
+
+	VICommandPool pool = (VICommandPool)vi_device_malloc(device, sizeof(VICommandPoolObj));
 	new (pool)VICommandPoolObj();
 	pool->device = device;
 
@@ -5274,6 +8020,8 @@ VICommandPool vi_create_command_pool(VIDevice device, uint32_t family_idx, VkCom
 
 void vi_destroy_command_pool(VIDevice device, VICommandPool pool)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_VULKAN)
 		vkDestroyCommandPool(device->vk.device, pool->vk_handle, nullptr);
 
@@ -5283,11 +8031,14 @@ void vi_destroy_command_pool(VIDevice device, VICommandPool pool)
 
 VICommand vi_allocate_primary_command(VIDevice device, VICommandPool pool)
 {
-	VICommand cmd = (VICommand)vi_malloc(sizeof(VICommandObj));
+	VI_TRACE_FUNC;
+
+	VICommand cmd = (VICommand)vi_device_malloc(device, sizeof(VICommandObj));
 	new (cmd)VICommandObj();
 	cmd->device = device;
 	cmd->pool = pool;
 	cmd->is_primary = true;
+	cmd->conditional_buffer = VI_NULL;
 
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
@@ -5303,11 +8054,14 @@ VICommand vi_allocate_primary_command(VIDevice device, VICommandPool pool)
 
 VICommand vi_allocate_secondary_command(VIDevice device, VICommandPool pool)
 {
-	VICommand cmd = (VICommand)vi_malloc(sizeof(VICommandObj));
+	VI_TRACE_FUNC;
+
+	VICommand cmd = (VICommand)vi_device_malloc(device, sizeof(VICommandObj));
 	new (cmd)VICommandObj();
 	cmd->device = device;
 	cmd->pool = pool;
 	cmd->is_primary = false;
+	cmd->conditional_buffer = VI_NULL;
 
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
@@ -5323,12 +8077,15 @@ VICommand vi_allocate_secondary_command(VIDevice device, VICommandPool pool)
 
 void vi_free_command(VIDevice device, VICommand cmd)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 		gl_free_command(device, cmd);
 	else
 	{
 		VIVulkan* vk = &device->vk;
 		vkFreeCommandBuffers(vk->device, cmd->pool->vk_handle, 1, &cmd->vk.handle);
+		vk_free_cmd_scratch(cmd);
 	}
 
 	cmd->~VICommandObj();
@@ -5337,14 +8094,23 @@ void vi_free_command(VIDevice device, VICommand cmd)
 
 void vi_device_wait_idle(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
+	idle_transient_sets(device);
+
 	if (device->backend == VI_BACKEND_OPENGL)
 		return;
 
 	VK_CHECK(vkDeviceWaitIdle(device->vk.device));
+
+	// garbage of the current frame may be released too, any later use is not submitted yet
+	vk_release_garbage(device, UINT64_MAX);
 }
 
 void vi_device_set_allocator_vk(VIDevice device, const VIAllocatorVK* allocator)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(device && device->backend == VI_BACKEND_VULKAN);
 
 	device->vk.allocator = *allocator;
@@ -5352,6 +8118,8 @@ void vi_device_set_allocator_vk(VIDevice device, const VIAllocatorVK* allocator)
 
 const VIDeviceProfileVK* vi_device_get_profile_vk(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(device && device->backend == VI_BACKEND_VULKAN);
 
 	return &device->vk.profile;
@@ -5359,6 +8127,8 @@ const VIDeviceProfileVK* vi_device_get_profile_vk(VIDevice device)
 
 const VIDeviceProfileGL* vi_device_get_profile_gl(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(device && device->backend == VI_BACKEND_OPENGL);
 
 	return &device->gl.profile;
@@ -5366,23 +8136,53 @@ const VIDeviceProfileGL* vi_device_get_profile_gl(VIDevice device)
 
 const VIPhysicalDevice* vi_device_get_physical_device(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(device->backend == VI_BACKEND_VULKAN);
 
 	return device->vk.pdevice_chosen;
 }
 
+const VIDeviceLimits* vi_device_get_limits(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
+	return &device->limits;
+}
+
 uint32_t vi_device_get_graphics_family_index(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	return device->vk.family_idx_graphics;
 }
 
 VIQueue vi_device_get_graphics_queue(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
+	return &device->queue_graphics;
+}
+
+uint32_t vi_device_get_compute_family_index(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
+	// the graphics family of Vise devices always supports compute
+	return device->vk.family_idx_graphics;
+}
+
+VIQueue vi_device_get_compute_queue(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
 	return &device->queue_graphics;
 }
 
 bool vi_device_has_depth_stencil_format(VIDevice device, VIFormat format, VkImageTiling tiling)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
 		// TODO:
@@ -5396,8 +8196,118 @@ bool vi_device_has_depth_stencil_format(VIDevice device, VIFormat format, VkImag
 	return vk_has_format_features(&device->vk, vk_format, tiling, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 }
 
+bool vi_device_has_compressed_format(VIDevice device, VIFormat format)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(is_format_compressed(format));
+
+	if (device->backend == VI_BACKEND_OPENGL)
+	{
+		GLenum internal_format, data_format, data_type;
+		uint32_t texel_size;
+		cast_format_gl(format, &internal_format, &data_format, &data_type, &texel_size);
+
+		GLint supported = GL_FALSE;
+		glGetInternalformativ(GL_TEXTURE_2D, internal_format, GL_INTERNALFORMAT_SUPPORTED, 1, &supported);
+		return supported == GL_TRUE;
+	}
+
+	VkFormat vk_format;
+	VkImageAspectFlags vk_aspect;
+	cast_format_vk(format, &vk_format, &vk_aspect);
+
+	return vk_has_format_features(&device->vk, vk_format, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT);
+}
+
+bool vi_device_can_generate_mipmaps(VIDevice device, VIFormat format)
+{
+	VI_TRACE_FUNC;
+
+	if (is_format_compressed(format))
+		return false;
+
+	if (device->backend == VI_BACKEND_OPENGL)
+		return true;
+
+	VkFormat vk_format;
+	VkImageAspectFlags vk_aspect;
+	cast_format_vk(format, &vk_format, &vk_aspect);
+
+	// blit support is optional for three channel formats
+	return vk_has_format_features(&device->vk, vk_format, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT);
+}
+
+void vi_device_make_current(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
+	if (device->backend == VI_BACKEND_VULKAN)
+		return;
+
+	VIOpenGL* gl = &device->gl;
+
+#ifdef VI_PLATFORM_LINUX
+	if (gl->egl_context != EGL_NO_CONTEXT)
+	{
+		EGLBoolean success = eglMakeCurrent(gl->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, gl->egl_context);
+		VI_ASSERT(success && "context is current on another thread");
+		return;
+	}
+#endif
+
+	glfwMakeContextCurrent(gl->window);
+}
+
+void vi_device_release_current(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
+	if (device->backend == VI_BACKEND_VULKAN)
+		return;
+
+#ifdef VI_PLATFORM_LINUX
+	if (device->gl.egl_context != EGL_NO_CONTEXT)
+	{
+		eglMakeCurrent(device->gl.egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		return;
+	}
+#endif
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+void vi_device_get_host_memory(VIDevice device, size_t* usage, size_t* peak)
+{
+	VI_TRACE_FUNC;
+
+	if (usage)
+		*usage = device->host_malloc_usage.load();
+
+	if (peak)
+		*peak = device->host_malloc_peak.load();
+}
+
+bool vi_device_is_headless(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
+	return device->headless;
+}
+
+bool vi_device_is_compute_only(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
+	return device->compute_only;
+}
+
 VIPass vi_device_get_swapchain_pass(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(!device->headless && "headless devices have no swapchain");
+
 	if (device->backend == VI_BACKEND_OPENGL)
 		return device->swapchain_pass;
 
@@ -5405,14 +8315,39 @@ VIPass vi_device_get_swapchain_pass(VIDevice device)
 	return device->swapchain_pass;
 }
 
+uint32_t vi_device_get_swapchain_framebuffer_count(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(!device->headless && "headless devices have no swapchain");
+
+	return device->limits.swapchain_framebuffer_count;
+}
+
 VIFramebuffer vi_device_get_swapchain_framebuffer(VIDevice device, uint32_t index)
 {
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(!device->headless && "headless devices have no swapchain");
+	VI_ASSERT(index < device->limits.swapchain_framebuffer_count);
+
 	return device->swapchain_framebuffers + index;
 }
 
 uint32_t vi_device_next_frame(VIDevice device, VISemaphore* image_acquired, VISemaphore* present_ready, VIFence* frame_complete)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(image_acquired && present_ready && frame_complete);
+	VI_ASSERT(!device->compute_only && "compute-only devices have no frames");
+
+	device->frame_count++;
+
+	{
+		std::lock_guard<std::mutex> lock(device->frame_counters_mutex);
+		device->last_frame_counters = device->frame_counters;
+		device->frame_counters = {};
+	}
 
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
@@ -5434,6 +8369,34 @@ uint32_t vi_device_next_frame(VIDevice device, VISemaphore* image_acquired, VISe
 	VIFrame* frame = vk->frames + vk->frame_idx;
 	VK_CHECK(vkWaitForFences(vk->device, 1, &frame->fence.frame_complete.vk_handle, VK_TRUE, UINT64_MAX));
 
+	// frames are submitted in order, the fence also covers every earlier frame
+	vk->completed_frame_count = std::max(vk->completed_frame_count, frame->frame_count);
+	frame->frame_count = device->frame_count;
+	vk_release_garbage(device, vk->completed_frame_count);
+
+	if (device->headless)
+	{
+		// nothing to acquire, the frame slot is free once its fence is signaled.
+		// image_acquired is still signaled so frame submissions look the same as with a swapchain
+		VkSubmitInfo submitI{};
+		submitI.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitI.signalSemaphoreCount = 1;
+		submitI.pSignalSemaphores = &frame->semaphore.image_acquired.vk_handle;
+		VK_CHECK(vkQueueSubmit(device->queue_graphics.vk_handle, 1, &submitI, VK_NULL_HANDLE));
+		VK_CHECK(vkResetFences(vk->device, 1, &frame->fence.frame_complete.vk_handle));
+
+		*image_acquired = &frame->semaphore.image_acquired;
+		*present_ready = &frame->semaphore.present_ready;
+		*frame_complete = &frame->fence.frame_complete;
+
+		return vk->frame_idx;
+	}
+
+	vk_release_retired_swapchains(vk);
+
+	if (vk->swapchain.is_outdated)
+		vk_recreate_swapchain(vk);
+
 	VkResult result = vkAcquireNextImageKHR(
 		vk->device,
 		vk->swapchain.handle,
@@ -5443,7 +8406,7 @@ uint32_t vi_device_next_frame(VIDevice device, VISemaphore* image_acquired, VISe
 		&vk->swapchain.image_idx
 	);
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
 	{
 		vk_recreate_swapchain(vk);
 
@@ -5457,20 +8420,36 @@ uint32_t vi_device_next_frame(VIDevice device, VISemaphore* image_acquired, VISe
 		);
 	}
 
+	// image_acquired will be signaled, a suboptimal image is still rendered and presented
+	if (result == VK_SUBOPTIMAL_KHR)
+	{
+		vk->swapchain.is_outdated = true;
+		result = VK_SUCCESS;
+	}
+
 	if (result != VK_SUCCESS)
 		VI_UNREACHABLE; // unable to recover
 
+	// the acquired image may still be rendered to by another frame slot
+	uint32_t image_idx = vk->swapchain.image_idx;
+	VkFence image_fence = vk->swapchain.image_fences[image_idx];
+	if (image_fence != VK_NULL_HANDLE && image_fence != frame->fence.frame_complete.vk_handle)
+		VK_CHECK(vkWaitForFences(vk->device, 1, &image_fence, VK_TRUE, UINT64_MAX));
+	vk->swapchain.image_fences[image_idx] = frame->fence.frame_complete.vk_handle;
+
 	VK_CHECK(vkResetFences(vk->device, 1, &frame->fence.frame_complete.vk_handle));
 
 	*image_acquired = &frame->semaphore.image_acquired;
-	*present_ready = &frame->semaphore.present_ready;
+	*present_ready = vk->swapchain.present_ready.data() + image_idx;
 	*frame_complete = &frame->fence.frame_complete;
 
-	return device->vk.swapchain.image_idx;
+	return image_idx;
 }
 
 void vi_device_present_frame(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	if (device->backend == VI_BACKEND_OPENGL)
 	{
 		VI_ASSERT(device->gl.frame.semaphore.present_ready.gl_signal);
@@ -5481,21 +8460,82 @@ void vi_device_present_frame(VIDevice device)
 	VIVulkan* vk = &device->vk;
 	VIFrame* frame = vk->frames + vk->frame_idx;
 
+	if (device->headless)
+	{
+		// consume present_ready so the next use of this frame slot may signal it again
+		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSubmitInfo submitI{};
+		submitI.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitI.waitSemaphoreCount = 1;
+		submitI.pWaitSemaphores = &frame->semaphore.present_ready.vk_handle;
+		submitI.pWaitDstStageMask = &wait_stage;
+		VK_CHECK(vkQueueSubmit(device->queue_graphics.vk_handle, 1, &submitI, VK_NULL_HANDLE));
+		return;
+	}
+
 	VkPresentInfoKHR presentI;
 	presentI.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentI.pNext = NULL;
 	presentI.pResults = NULL;
 	presentI.waitSemaphoreCount = 1;
-	presentI.pWaitSemaphores = &frame->semaphore.present_ready.vk_handle;
+	presentI.pWaitSemaphores = &vk->swapchain.present_ready[vk->swapchain.image_idx].vk_handle;
 	presentI.swapchainCount = 1;
 	presentI.pSwapchains = &vk->swapchain.handle;
 	presentI.pImageIndices = &vk->swapchain.image_idx;
 
-	VK_CHECK(vkQueuePresentKHR(device->queue_present.vk_handle, &presentI));
+	// resizes are picked up by the next acquire without waiting for the device
+	VkResult result = vkQueuePresentKHR(device->queue_present.vk_handle, &presentI);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		vk->swapchain.is_outdated = true;
+	else
+		VK_CHECK(result);
+}
+
+uint32_t vi_device_get_frame_index(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
+	if (device->backend == VI_BACKEND_OPENGL)
+		return 0;
+
+	return device->vk.frame_idx;
+}
+
+void vi_device_set_frames_in_flight(VIDevice device, uint32_t count)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(count >= 1 && count <= device->limits.max_frames_in_flight);
+
+	if (device->backend == VI_BACKEND_OPENGL)
+		return;
+
+	// slots beyond count keep their last fence, they are waited for again once reactivated
+	device->vk.frames_in_flight = count;
+}
+
+uint32_t vi_device_get_frames_in_flight(VIDevice device)
+{
+	VI_TRACE_FUNC;
+
+	if (device->backend == VI_BACKEND_OPENGL)
+		return device->limits.max_frames_in_flight;
+
+	return device->vk.frames_in_flight;
+}
+
+void vi_device_get_frame_counters(VIDevice device, VIFrameCounters* counters)
+{
+	VI_TRACE_FUNC;
+
+	std::lock_guard<std::mutex> lock(device->frame_counters_mutex);
+	*counters = device->last_frame_counters;
 }
 
 void vi_buffer_map(VIBuffer buffer)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(!buffer->is_mapped);
 
 	buffer->is_mapped = true;
@@ -5507,7 +8547,7 @@ void vi_buffer_map(VIBuffer buffer)
 		// memory barriers and fence syncs. We use glBufferSubData and glGetBufferSubData
 		// to emulate persistant mapping with memory coherency.
 		if (!buffer->map)
-			buffer->map = (uint8_t*)vi_malloc((size_t)buffer->size);
+			buffer->map = (uint8_t*)vi_device_malloc(device, (size_t)buffer->size);
 		return;
 	}
 
@@ -5522,6 +8562,8 @@ void vi_buffer_map(VIBuffer buffer)
 
 void* vi_buffer_map_read(VIBuffer buffer, uint32_t offset, uint32_t size)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(buffer->is_mapped);
 	VI_ASSERT(offset + size <= buffer->size);
 	
@@ -5544,6 +8586,8 @@ void* vi_buffer_map_read(VIBuffer buffer, uint32_t offset, uint32_t size)
 
 void vi_buffer_map_write(VIBuffer buffer, uint32_t offset, uint32_t size, const void* write)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(buffer->is_mapped);
 	VI_ASSERT(offset + size <= buffer->size);
 
@@ -5568,6 +8612,8 @@ void vi_buffer_map_write(VIBuffer buffer, uint32_t offset, uint32_t size, const
 
 void vi_buffer_map_flush(VIBuffer buffer, uint32_t offset, uint32_t size)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(buffer->is_mapped);
 
 	VIDevice device = buffer->device;
@@ -5591,6 +8637,8 @@ void vi_buffer_map_flush(VIBuffer buffer, uint32_t offset, uint32_t size)
 
 void vi_buffer_map_invalidate(VIBuffer buffer, uint32_t offset, uint32_t size)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(buffer->is_mapped);
 
 	VIDevice device = buffer->device;
@@ -5614,6 +8662,8 @@ void vi_buffer_map_invalidate(VIBuffer buffer, uint32_t offset, uint32_t size)
 
 void vi_buffer_unmap(VIBuffer buffer)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(buffer->is_mapped);
 
 	buffer->is_mapped = false;
@@ -5633,6 +8683,8 @@ void vi_buffer_unmap(VIBuffer buffer)
 
 void vi_command_reset(VICommand cmd)
 {
+	VI_TRACE_FUNC;
+
 	VIDevice device = cmd->device;
 
 	if (device->backend == VI_BACKEND_OPENGL)
@@ -5648,12 +8700,23 @@ void vi_command_reset(VICommand cmd)
 
 void vi_command_begin(VICommand cmd, VkCommandBufferUsageFlags flags, const VICommandInheritanceInfo* inheritance)
 {
+	VI_TRACE_FUNC;
+
+	cmd->conditional_buffer = VI_NULL;
+	cmd->counters = {};
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		gl_reset_command(cmd->device, cmd);
 		return;
 	}
 
+	if (cmd->vk.scratch)
+	{
+		cmd->vk.scratch->chunk_idx = 0;
+		cmd->vk.scratch->chunk_offset = 0;
+	}
+
 	VkCommandBufferInheritanceInfo inheritanceI{};
 
 	if (inheritance)
@@ -5675,6 +8738,10 @@ void vi_command_begin(VICommand cmd, VkCommandBufferUsageFlags flags, const VICo
 
 void vi_command_end(VICommand cmd)
 {
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(cmd->conditional_buffer == VI_NULL && "conditional region not ended");
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 		return;
 
@@ -5683,6 +8750,8 @@ void vi_command_end(VICommand cmd)
 
 void vi_cmd_opengl_callback(VICommand cmd, void (*callback)(void* data), void* data)
 {
+	VI_TRACE_FUNC;
+
 	if (cmd->device->backend == VI_BACKEND_VULKAN)
 		return;
 
@@ -5693,6 +8762,8 @@ void vi_cmd_opengl_callback(VICommand cmd, void (*callback)(void* data), void* d
 
 void vi_cmd_copy_buffer(VICommand cmd, VIBuffer src, VIBuffer dst, uint32_t region_count, const VkBufferCopy* regions)
 {
+	VI_TRACE_FUNC;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_COPY_BUFFER);
@@ -5709,6 +8780,22 @@ void vi_cmd_copy_buffer(VICommand cmd, VIBuffer src, VIBuffer dst, uint32_t regi
 
 void vi_cmd_copy_buffer_to_image(VICommand cmd, VIBuffer buffer, VIImage image, VkImageLayout layout, uint32_t region_count, const VkBufferImageCopy* regions)
 {
+	VI_TRACE_FUNC;
+
+	// block-compressed regions must start on a block boundary and cover whole blocks unless they touch the level edge
+	uint32_t block_extent = vi_format_table[(int)image->info.format].texel_block_extent;
+	for (uint32_t i = 0; block_extent > 1 && i < region_count; i++)
+	{
+		const VkBufferImageCopy& region = regions[i];
+		uint32_t level_width = std::max(image->info.width >> region.imageSubresource.mipLevel, 1u);
+		uint32_t level_height = std::max(image->info.height >> region.imageSubresource.mipLevel, 1u);
+		VI_ASSERT(region.imageOffset.x % block_extent == 0 && region.imageOffset.y % block_extent == 0);
+		VI_ASSERT(region.imageExtent.width % block_extent == 0 || region.imageOffset.x + region.imageExtent.width == level_width);
+		VI_ASSERT(region.imageExtent.height % block_extent == 0 || region.imageOffset.y + region.imageExtent.height == level_height);
+		VI_ASSERT(region.bufferRowLength % block_extent == 0 && region.bufferImageHeight % block_extent == 0);
+		VI_ASSERT(region.bufferOffset % vi_format_table[(int)image->info.format].texel_block_size == 0);
+	}
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_COPY_BUFFER_TO_IMAGE);
@@ -5725,6 +8812,8 @@ void vi_cmd_copy_buffer_to_image(VICommand cmd, VIBuffer buffer, VIImage image,
 
 void vi_cmd_copy_image(VICommand cmd, VIImage src, VkImageLayout src_layout, VIImage dst, VkImageLayout dst_layout, uint32_t region_count, const VkImageCopy* regions)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(src->info.usage & VI_IMAGE_USAGE_TRANSFER_SRC_BIT);
 	VI_ASSERT(dst->info.usage & VI_IMAGE_USAGE_TRANSFER_DST_BIT);
 
@@ -5742,8 +8831,95 @@ void vi_cmd_copy_image(VICommand cmd, VIImage src, VkImageLayout src_layout, VII
 	vkCmdCopyImage(cmd->vk.handle, src->vk.handle, src_layout, dst->vk.handle, dst_layout, region_count, regions);
 }
 
+void vi_cmd_generate_mipmaps(VICommand cmd, VIImage image, VkImageLayout layout)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(image->info.usage & VI_IMAGE_USAGE_TRANSFER_SRC_BIT);
+	VI_ASSERT(image->info.usage & VI_IMAGE_USAGE_TRANSFER_DST_BIT);
+	VI_ASSERT(vi_device_can_generate_mipmaps(cmd->device, image->info.format) && "mip chains of this format must be uploaded");
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_GENERATE_MIPMAPS);
+		glcmd->generate_mipmaps = image;
+		return;
+	}
+
+	VIVulkan* vk = &cmd->device->vk;
+
+	VkFormat format;
+	VkImageAspectFlags aspect;
+	cast_format_vk(image->info.format, &format, &aspect);
+
+	// prefer linear downsampling, fall back to nearest if the format can not be filtered
+	VkFormatProperties format_props;
+	vkGetPhysicalDeviceFormatProperties(vk->pdevice, format, &format_props);
+	VkFormatFeatureFlags features = format_props.optimalTilingFeatures;
+	VkFilter filter = (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image->vk.handle;
+	barrier.subresourceRange.aspectMask = aspect;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = image->info.layers;
+	barrier.subresourceRange.levelCount = 1;
+
+	int32_t level_width = (int32_t)image->info.width;
+	int32_t level_height = (int32_t)image->info.height;
+
+	// level i - 1 is the blit source of level i, then moves to the final layout
+	for (uint32_t level = 1; level < image->info.levels; level++)
+	{
+		std::array<VkImageMemoryBarrier, 2> barriers = { barrier, barrier };
+		barriers[0].subresourceRange.baseMipLevel = level - 1;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barriers[1].subresourceRange.baseMipLevel = level;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[1].srcAccessMask = 0;
+		barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmd->vk.handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+
+		VkImageBlit blit{};
+		blit.srcSubresource.aspectMask = aspect;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = image->info.layers;
+		blit.srcOffsets[1] = { level_width, level_height, 1 };
+		level_width = std::max(level_width / 2, 1);
+		level_height = std::max(level_height / 2, 1);
+		blit.dstSubresource = blit.srcSubresource;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstOffsets[1] = { level_width, level_height, 1 };
+		vkCmdBlitImage(cmd->vk.handle, image->vk.handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->vk.handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[0].newLayout = layout;
+		barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(cmd->vk.handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, barriers.data());
+	}
+
+	// the last level was only written to
+	barrier.subresourceRange.baseMipLevel = image->info.levels - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = layout;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	vkCmdPipelineBarrier(cmd->vk.handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
 void vi_cmd_copy_image_to_buffer(VICommand cmd, VIImage image, VkImageLayout layout, VIBuffer buffer, uint32_t region_count, const VkBufferImageCopy* regions)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(image->info.usage & VI_IMAGE_USAGE_TRANSFER_SRC_BIT);
 
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
@@ -5792,6 +8968,10 @@ void vi_cmd_copy_depth_stencil_attachment_to_buffer(VICommand cmd, VIFramebuffer
 
 void vi_cmd_begin_pass(VICommand cmd, const VIPassBeginInfo* info)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.passes++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_BEGIN_PASS);
@@ -5863,6 +9043,8 @@ void vi_cmd_begin_pass(VICommand cmd, const VIPassBeginInfo* info)
 
 void vi_cmd_end_pass(VICommand cmd)
 {
+	VI_TRACE_FUNC;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		gl_append_command(cmd, GL_COMMAND_TYPE_END_PASS);
@@ -5874,6 +9056,11 @@ void vi_cmd_end_pass(VICommand cmd)
 
 void vi_cmd_execute_commands(VICommand cmd, uint32_t secondary_command_count, const VICommand* secondary_commands)
 {
+	VI_TRACE_FUNC;
+
+	for (uint32_t i = 0; i < secondary_command_count; i++)
+		add_frame_counters(&cmd->counters, secondary_commands[i]->counters);
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_EXECUTE_COMMANDS);
@@ -5893,6 +9080,10 @@ void vi_cmd_execute_commands(VICommand cmd, uint32_t secondary_command_count, co
 
 void vi_cmd_bind_graphics_pipeline(VICommand cmd, VIPipeline pipeline)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.binds++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		cmd->gl.active_pipeline = pipeline;
@@ -5911,11 +9102,15 @@ void vi_cmd_bind_graphics_pipeline(VICommand cmd, VIPipeline pipeline)
 	if (flip_vk_front_face)
 		front_face = (front_face == VK_FRONT_FACE_CLOCKWISE) ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE;
 
-	vi_proc.vkCmdSetFrontFaceEXT(cmd->vk.handle, front_face);
+	cmd->device->vk.proc.vkCmdSetFrontFaceEXT(cmd->vk.handle, front_face);
 }
 
 void vi_cmd_bind_compute_pipeline(VICommand cmd, VIComputePipeline pipeline)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.binds++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_BIND_COMPUTE_PIPELINE);
@@ -5928,9 +9123,14 @@ void vi_cmd_bind_compute_pipeline(VICommand cmd, VIComputePipeline pipeline)
 
 void vi_cmd_dispatch(VICommand cmd, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.dispatches++;
+
 	VI_ASSERT(group_count_x <= cmd->device->limits.max_compute_workgroup_count[0]);
 	VI_ASSERT(group_count_y <= cmd->device->limits.max_compute_workgroup_count[1]);
 	VI_ASSERT(group_count_z <= cmd->device->limits.max_compute_workgroup_count[2]);
+	VI_ASSERT(cmd->conditional_buffer == VI_NULL && "dispatches are not predicated");
 
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
@@ -5946,6 +9146,10 @@ void vi_cmd_dispatch(VICommand cmd, uint32_t group_count_x, uint32_t group_count
 
 void vi_cmd_bind_vertex_buffers(VICommand cmd, uint32_t first_binding, uint32_t binding_count, VIBuffer* buffers)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.binds++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		VI_ASSERT(cmd->gl.active_pipeline != VI_NULL);
@@ -5974,6 +9178,10 @@ void vi_cmd_bind_vertex_buffers(VICommand cmd, uint32_t first_binding, uint32_t
 
 void vi_cmd_bind_index_buffer(VICommand cmd, VIBuffer buffer, VkIndexType index_type)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.binds++;
+
 	VI_ASSERT(buffer->type == VI_BUFFER_TYPE_INDEX);
 
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
@@ -5987,36 +9195,82 @@ void vi_cmd_bind_index_buffer(VICommand cmd, VIBuffer buffer, VkIndexType index_
 	vkCmdBindIndexBuffer(cmd->vk.handle, buffer->vk.handle, 0, index_type);
 }
 
-void vi_cmd_bind_graphics_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_idx, VISet set)
+void vi_cmd_bind_graphics_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_idx, VISet set, uint32_t dynamic_offset_count, const uint32_t* dynamic_offsets)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.binds++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_BIND_SET);
+		new (&glcmd->bind_set) GLCommandBindSet();
 		glcmd->bind_set.set = set;
 		glcmd->bind_set.set_index = set_idx;
 		glcmd->bind_set.pipeline_layout = layout;
+		glcmd->bind_set.dynamic_offsets.assign(dynamic_offsets, dynamic_offsets + dynamic_offset_count);
 		return;
 	}
 
-	vkCmdBindDescriptorSets(cmd->vk.handle, VK_PIPELINE_BIND_POINT_GRAPHICS, layout->vk.handle, set_idx, 1, &set->vk.handle, 0, nullptr);
+	vkCmdBindDescriptorSets(cmd->vk.handle, VK_PIPELINE_BIND_POINT_GRAPHICS, layout->vk.handle, set_idx, 1, &set->vk.handle, dynamic_offset_count, dynamic_offsets);
 }
 
-void vi_cmd_bind_compute_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_idx, VISet set)
+void vi_cmd_bind_compute_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_idx, VISet set, uint32_t dynamic_offset_count, const uint32_t* dynamic_offsets)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.binds++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_BIND_SET);
+		new (&glcmd->bind_set) GLCommandBindSet();
 		glcmd->bind_set.set = set;
 		glcmd->bind_set.set_index = set_idx;
 		glcmd->bind_set.pipeline_layout = layout;
+		glcmd->bind_set.dynamic_offsets.assign(dynamic_offsets, dynamic_offsets + dynamic_offset_count);
+		return;
+	}
+
+	vkCmdBindDescriptorSets(cmd->vk.handle, VK_PIPELINE_BIND_POINT_COMPUTE, layout->vk.handle, set_idx, 1, &set->vk.handle, dynamic_offset_count, dynamic_offsets);
+}
+
+void vi_cmd_push_graphics_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_idx, uint32_t update_count, const VISetUpdateInfo* updates)
+{
+	VI_TRACE_FUNC;
+
+	cmd->counters.binds++;
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		gl_cmd_push_set(cmd, layout, set_idx, update_count, updates);
+		return;
+	}
+
+	vk_cmd_push_set(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, set_idx, update_count, updates);
+}
+
+void vi_cmd_push_compute_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_idx, uint32_t update_count, const VISetUpdateInfo* updates)
+{
+	VI_TRACE_FUNC;
+
+	cmd->counters.binds++;
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		gl_cmd_push_set(cmd, layout, set_idx, update_count, updates);
 		return;
 	}
 
-	vkCmdBindDescriptorSets(cmd->vk.handle, VK_PIPELINE_BIND_POINT_COMPUTE, layout->vk.handle, set_idx, 1, &set->vk.handle, 0, nullptr);
+	vk_cmd_push_set(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout, set_idx, update_count, updates);
 }
 
 void vi_cmd_push_constants(VICommand cmd, VIPipelineLayout layout, uint32_t offset, uint32_t size, const void* value)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.state_changes++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_PUSH_CONSTANTS);
@@ -6030,6 +9284,10 @@ void vi_cmd_push_constants(VICommand cmd, VIPipelineLayout layout, uint32_t offs
 
 void vi_cmd_set_viewport(VICommand cmd, VkViewport viewport)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.state_changes++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_SET_VIEWPORT);
@@ -6057,6 +9315,10 @@ void vi_cmd_set_viewport(VICommand cmd, VkViewport viewport)
 
 void vi_cmd_set_scissor(VICommand cmd, VkRect2D scissor)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.state_changes++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_SET_SCISSOR);
@@ -6069,6 +9331,10 @@ void vi_cmd_set_scissor(VICommand cmd, VkRect2D scissor)
 
 void vi_cmd_draw(VICommand cmd, const VIDrawInfo* info)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.draws++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_DRAW);
@@ -6076,11 +9342,29 @@ void vi_cmd_draw(VICommand cmd, const VIDrawInfo* info)
 		return;
 	}
 
+	if (cmd->conditional_buffer && !cmd->device->vk.supports_conditional_rendering)
+	{
+		VkDrawIndirectCommand args;
+		args.vertexCount = info->vertex_count;
+		args.instanceCount = info->instance_count;
+		args.firstVertex = info->vertex_start;
+		args.firstInstance = info->instance_start;
+
+		VkDeviceSize args_offset;
+		VkBuffer args_buffer = vk_cmd_write_scratch(cmd, &args, sizeof(args), &args_offset);
+		vkCmdDrawIndirectCount(cmd->vk.handle, args_buffer, args_offset, cmd->conditional_buffer->vk.handle, cmd->conditional_offset, 1, sizeof(args));
+		return;
+	}
+
 	vkCmdDraw(cmd->vk.handle, info->vertex_count, info->instance_count, info->vertex_start, info->instance_start);
 }
 
 void vi_cmd_draw_indexed(VICommand cmd, const VIDrawIndexedInfo* info)
 {
+	VI_TRACE_FUNC;
+
+	cmd->counters.draws++;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 	{
 		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_DRAW_INDEXED);
@@ -6088,61 +9372,417 @@ void vi_cmd_draw_indexed(VICommand cmd, const VIDrawIndexedInfo* info)
 		return;
 	}
 
-	vkCmdDrawIndexed(cmd->vk.handle, info->index_count, info->instance_count, info->index_start, 0, info->instance_start);
-}
+	if (cmd->conditional_buffer && !cmd->device->vk.supports_conditional_rendering)
+	{
+		VkDrawIndexedIndirectCommand args;
+		args.indexCount = info->index_count;
+		args.instanceCount = info->instance_count;
+		args.firstIndex = info->index_start;
+		args.vertexOffset = 0;
+		args.firstInstance = info->instance_start;
 
-void vi_cmd_pipeline_barrier_memory(VICommand cmd, VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages,
+		VkDeviceSize args_offset;
+		VkBuffer args_buffer = vk_cmd_write_scratch(cmd, &args, sizeof(args), &args_offset);
+		vkCmdDrawIndexedIndirectCount(cmd->vk.handle, args_buffer, args_offset, cmd->conditional_buffer->vk.handle, cmd->conditional_offset, 1, sizeof(args));
+		return;
+	}
+
+	vkCmdDrawIndexed(cmd->vk.handle, info->index_count, info->instance_count, info->index_start, 0, info->instance_start);
+}
+
+void vi_cmd_pipeline_barrier_memory(VICommand cmd, VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages,
 	VkDependencyFlags deps, uint32_t barrier_count, const VIMemoryBarrier* barriers)
 {
+	VI_TRACE_FUNC;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 		return;
 
 	std::vector<VkMemoryBarrier> vk_barriers(barrier_count);
 
+	VIVulkan* vk = &cmd->device->vk;
+
 	for (uint32_t i = 0; i < barrier_count; i++)
+	{
 		cast_memory_barrier(barriers[i], vk_barriers.data() + i);
+		vk_barriers[i].srcAccessMask = vk_conditional_access(vk, vk_barriers[i].srcAccessMask);
+		vk_barriers[i].dstAccessMask = vk_conditional_access(vk, vk_barriers[i].dstAccessMask);
+	}
 
+	src_stages = vk_conditional_stages(vk, src_stages);
+	dst_stages = vk_conditional_stages(vk, dst_stages);
 	vkCmdPipelineBarrier(cmd->vk.handle, src_stages, dst_stages, deps, vk_barriers.size(), vk_barriers.data(), 0, nullptr, 0, nullptr);
 }
 
 void vi_cmd_pipeline_barrier_image_memory(VICommand cmd, VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages,
 	VkDependencyFlags deps, uint32_t barrier_count, const VIImageMemoryBarrier* barriers)
 {
+	VI_TRACE_FUNC;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 		return;
 
 	std::vector<VkImageMemoryBarrier> vk_barriers(barrier_count);
 
+	VIVulkan* vk = &cmd->device->vk;
+
 	for (uint32_t i = 0; i < barrier_count; i++)
+	{
 		cast_image_memory_barrier(barriers[i], vk_barriers.data() + i);
+		vk_barriers[i].srcAccessMask = vk_conditional_access(vk, vk_barriers[i].srcAccessMask);
+		vk_barriers[i].dstAccessMask = vk_conditional_access(vk, vk_barriers[i].dstAccessMask);
+	}
 
+	src_stages = vk_conditional_stages(vk, src_stages);
+	dst_stages = vk_conditional_stages(vk, dst_stages);
 	vkCmdPipelineBarrier(cmd->vk.handle, src_stages, dst_stages, deps, 0, nullptr, 0, nullptr, vk_barriers.size(), vk_barriers.data());
 }
 
 void vi_cmd_pipeline_barrier_buffer_memory(VICommand cmd, VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages,
 	VkDependencyFlags deps, uint32_t barrier_count, const VIBufferMemoryBarrier* barriers)
 {
+	VI_TRACE_FUNC;
+
 	if (cmd->device->backend == VI_BACKEND_OPENGL)
 		return;
 
 	std::vector<VkBufferMemoryBarrier> vk_barriers(barrier_count);
 
+	VIVulkan* vk = &cmd->device->vk;
+
 	for (uint32_t i = 0; i < barrier_count; i++)
+	{
 		cast_buffer_memory_barrier(barriers[i], vk_barriers.data() + i);
+		vk_barriers[i].srcAccessMask = vk_conditional_access(vk, vk_barriers[i].srcAccessMask);
+		vk_barriers[i].dstAccessMask = vk_conditional_access(vk, vk_barriers[i].dstAccessMask);
+	}
 
+	src_stages = vk_conditional_stages(vk, src_stages);
+	dst_stages = vk_conditional_stages(vk, dst_stages);
 	vkCmdPipelineBarrier(cmd->vk.handle, src_stages, dst_stages, deps, 0, nullptr, vk_barriers.size(), vk_barriers.data(), 0, nullptr);
 }
 
-char* vi_compile_binary(VIDevice device, VIModuleType type, VIPipelineLayout layout, const char* vise_glsl, uint32_t* binary_size)
+VIQueryPool vi_create_query_pool(VIDevice device, const VIQueryPoolInfo* info)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(info->query_count > 0);
+	VI_ASSERT(info->type != VI_QUERY_TYPE_TIMESTAMP || device->limits.timestamp_queries);
+	VI_ASSERT(info->type != VI_QUERY_TYPE_PIPELINE_STATISTICS || device->limits.pipeline_statistics_queries);
+	VI_ASSERT(info->type != VI_QUERY_TYPE_PIPELINE_STATISTICS || info->pipeline_statistics != 0);
+
+	VIQueryPool pool = (VIQueryPool)vi_device_malloc(device, sizeof(VIQueryPoolObj));
+	new (pool) VIQueryPoolObj();
+	pool->device = device;
+	pool->type = info->type;
+	pool->query_count = info->query_count;
+	pool->result_count = 1;
+
+	if (info->type == VI_QUERY_TYPE_PIPELINE_STATISTICS)
+	{
+		pool->result_count = 0;
+		for (const VIPipelineStatisticEntry& entry : vi_pipeline_statistic_table)
+		{
+			if (info->pipeline_statistics & entry.vi_bit)
+				pool->result_count++;
+		}
+	}
+
+	if (device->backend == VI_BACKEND_OPENGL)
+	{
+		if (info->type == VI_QUERY_TYPE_PIPELINE_STATISTICS)
+		{
+			uint32_t result_idx = 0;
+			for (const VIPipelineStatisticEntry& entry : vi_pipeline_statistic_table)
+			{
+				if (info->pipeline_statistics & entry.vi_bit)
+					pool->gl.targets[result_idx++] = entry.gl_target;
+			}
+		}
+		else
+			cast_query_type_gl(info->type, pool->gl.targets);
+
+		uint32_t handle_count = info->query_count * pool->result_count;
+		pool->gl.handles = (GLuint*)vi_device_malloc(device, sizeof(GLuint) * handle_count);
+		pool->gl.issued = (bool*)vi_device_malloc(device, sizeof(bool) * info->query_count);
+
+		for (uint32_t i = 0; i < pool->result_count; i++)
+		{
+			for (uint32_t j = 0; j < info->query_count; j++)
+				GL_CHECK(glCreateQueries(pool->gl.targets[i], 1, pool->gl.handles + j * pool->result_count + i));
+		}
+
+		for (uint32_t i = 0; i < info->query_count; i++)
+			pool->gl.issued[i] = false;
+
+		return pool;
+	}
+
+	VkQueryPoolCreateInfo poolCI{};
+	poolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolCI.queryCount = info->query_count;
+	cast_query_type_vk(info->type, &poolCI.queryType);
+
+	if (info->type == VI_QUERY_TYPE_PIPELINE_STATISTICS)
+	{
+		for (const VIPipelineStatisticEntry& entry : vi_pipeline_statistic_table)
+		{
+			if (info->pipeline_statistics & entry.vi_bit)
+				poolCI.pipelineStatistics |= entry.vk_bit;
+		}
+	}
+
+	VK_CHECK(vkCreateQueryPool(device->vk.device, &poolCI, nullptr, &pool->vk.handle));
+
+	return pool;
+}
+
+void vi_destroy_query_pool(VIDevice device, VIQueryPool pool)
+{
+	VI_TRACE_FUNC;
+
+	if (device->backend == VI_BACKEND_OPENGL)
+	{
+		GL_CHECK(glDeleteQueries((GLsizei)(pool->query_count * pool->result_count), pool->gl.handles));
+		vi_free(pool->gl.issued);
+		vi_free(pool->gl.handles);
+	}
+	else
+		vkDestroyQueryPool(device->vk.device, pool->vk.handle, nullptr);
+
+	pool->~VIQueryPoolObj();
+	vi_free(pool);
+}
+
+uint32_t vi_query_pool_get_result_count(VIQueryPool pool)
+{
+	VI_TRACE_FUNC;
+
+	return pool->result_count;
+}
+
+void vi_cmd_reset_queries(VICommand cmd, VIQueryPool pool, uint32_t first_query, uint32_t query_count)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(first_query + query_count <= pool->query_count);
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_RESET_QUERIES);
+		glcmd->reset_queries.pool = pool;
+		glcmd->reset_queries.first_query = first_query;
+		glcmd->reset_queries.query_count = query_count;
+		return;
+	}
+
+	vkCmdResetQueryPool(cmd->vk.handle, pool->vk.handle, first_query, query_count);
+}
+
+void vi_cmd_write_timestamp(VICommand cmd, VIQueryPool pool, uint32_t query, VkPipelineStageFlagBits stage)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(pool->type == VI_QUERY_TYPE_TIMESTAMP);
+	VI_ASSERT(query < pool->query_count);
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_WRITE_TIMESTAMP);
+		glcmd->write_timestamp.pool = pool;
+		glcmd->write_timestamp.query = query;
+		return;
+	}
+
+	vkCmdWriteTimestamp(cmd->vk.handle, stage, pool->vk.handle, query);
+}
+
+void vi_cmd_begin_query(VICommand cmd, VIQueryPool pool, uint32_t query)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(pool->type != VI_QUERY_TYPE_TIMESTAMP);
+	VI_ASSERT(query < pool->query_count);
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_BEGIN_QUERY);
+		glcmd->begin_query.pool = pool;
+		glcmd->begin_query.query = query;
+		return;
+	}
+
+	VkQueryControlFlags flags = 0;
+	if (pool->type == VI_QUERY_TYPE_OCCLUSION && cmd->device->limits.occlusion_query_precise)
+		flags = VK_QUERY_CONTROL_PRECISE_BIT;
+
+	vkCmdBeginQuery(cmd->vk.handle, pool->vk.handle, query, flags);
+}
+
+void vi_cmd_end_query(VICommand cmd, VIQueryPool pool, uint32_t query)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(pool->type != VI_QUERY_TYPE_TIMESTAMP);
+	VI_ASSERT(query < pool->query_count);
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_END_QUERY);
+		glcmd->end_query.pool = pool;
+		glcmd->end_query.query = query;
+		return;
+	}
+
+	vkCmdEndQuery(cmd->vk.handle, pool->vk.handle, query);
+}
+
+bool vi_get_query_results(VIDevice device, VIQueryPool pool, uint32_t first_query, uint32_t query_count, uint64_t* results)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(first_query + query_count <= pool->query_count);
+
+	uint32_t result_count = pool->result_count;
+
+	if (device->backend == VI_BACKEND_OPENGL)
+	{
+		GLuint* handles = pool->gl.handles + first_query * result_count;
+
+		for (uint32_t i = 0; i < query_count; i++)
+		{
+			if (!pool->gl.issued[first_query + i])
+				return false;
+		}
+
+		for (uint32_t i = 0; i < query_count * result_count; i++)
+		{
+			GLuint available = GL_FALSE;
+			GL_CHECK(glGetQueryObjectuiv(handles[i], GL_QUERY_RESULT_AVAILABLE, &available));
+			if (available == GL_FALSE)
+				return false;
+		}
+
+		// GL timestamps are already in nanoseconds
+		for (uint32_t i = 0; i < query_count * result_count; i++)
+			GL_CHECK(glGetQueryObjectui64v(handles[i], GL_QUERY_RESULT, results + i));
+
+		return true;
+	}
+
+	VIVulkan* vk = &device->vk;
+	size_t stride = sizeof(uint64_t) * result_count;
+	VkResult result = vkGetQueryPoolResults(vk->device, pool->vk.handle, first_query, query_count,
+		stride * query_count, results, stride, VK_QUERY_RESULT_64_BIT);
+
+	if (result == VK_NOT_READY)
+		return false;
+
+	VK_CHECK(result);
+
+	if (pool->type != VI_QUERY_TYPE_TIMESTAMP)
+		return true;
+
+	// timestamps count ticks of timestampPeriod nanoseconds, bits above timestampValidBits are undefined
+	uint32_t valid_bits = vk->pdevice_chosen->family_props[vk->family_idx_graphics].timestampValidBits;
+	uint64_t valid_mask = valid_bits >= 64 ? UINT64_MAX : (1ull << valid_bits) - 1;
+	double period = (double)vk->pdevice_chosen->device_props.limits.timestampPeriod;
+
+	for (uint32_t i = 0; i < query_count; i++)
+		results[i] = (uint64_t)((double)(results[i] & valid_mask) * period);
+
+	return true;
+}
+
+void vi_cmd_copy_query_results(VICommand cmd, VIQueryPool pool, uint32_t first_query, uint32_t query_count, VIBuffer buffer, uint32_t offset)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(first_query + query_count <= pool->query_count);
+	VI_ASSERT(offset % sizeof(uint32_t) == 0);
+	VI_ASSERT(offset + query_count * pool->result_count * sizeof(uint32_t) <= buffer->size);
+	VI_ASSERT(buffer->usage & VI_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_COPY_QUERY_RESULTS);
+		glcmd->copy_query_results.pool = pool;
+		glcmd->copy_query_results.first_query = first_query;
+		glcmd->copy_query_results.query_count = query_count;
+		glcmd->copy_query_results.buffer = buffer;
+		glcmd->copy_query_results.offset = offset;
+		return;
+	}
+
+	VkDeviceSize stride = sizeof(uint32_t) * pool->result_count;
+	vkCmdCopyQueryPoolResults(cmd->vk.handle, pool->vk.handle, first_query, query_count, buffer->vk.handle, offset, stride, VK_QUERY_RESULT_WAIT_BIT);
+}
+
+void vi_cmd_begin_conditional(VICommand cmd, VIBuffer buffer, uint32_t offset)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(cmd->device->limits.conditional_rendering);
+	VI_ASSERT(cmd->conditional_buffer == VI_NULL && "conditional regions may not nest");
+	VI_ASSERT(buffer->usage & VI_BUFFER_USAGE_CONDITIONAL_BIT);
+	VI_ASSERT(buffer->type != VI_BUFFER_TYPE_TRANSFER);
+	VI_ASSERT(offset % sizeof(uint32_t) == 0 && offset + sizeof(uint32_t) <= buffer->size);
+
+	cmd->conditional_buffer = buffer;
+	cmd->conditional_offset = offset;
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		GLCommand* glcmd = gl_append_command(cmd, GL_COMMAND_TYPE_BEGIN_CONDITIONAL);
+		glcmd->begin_conditional.buffer = buffer;
+		glcmd->begin_conditional.offset = offset;
+		return;
+	}
+
+	VIVulkan* vk = &cmd->device->vk;
+
+	// otherwise draws in the region are recorded as indirect draws counted by the predicate
+	if (!vk->supports_conditional_rendering)
+		return;
+
+	VkConditionalRenderingBeginInfoEXT conditionalBI{};
+	conditionalBI.sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT;
+	conditionalBI.buffer = buffer->vk.handle;
+	conditionalBI.offset = (VkDeviceSize)offset;
+	conditionalBI.flags = 0;
+	vk->proc.vkCmdBeginConditionalRenderingEXT(cmd->vk.handle, &conditionalBI);
+}
+
+void vi_cmd_end_conditional(VICommand cmd)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(cmd->conditional_buffer != VI_NULL);
+
+	cmd->conditional_buffer = VI_NULL;
+
+	if (cmd->device->backend == VI_BACKEND_OPENGL)
+	{
+		gl_append_command(cmd, GL_COMMAND_TYPE_END_CONDITIONAL);
+		return;
+	}
+
+	VIVulkan* vk = &cmd->device->vk;
+
+	if (vk->supports_conditional_rendering)
+		vk->proc.vkCmdEndConditionalRenderingEXT(cmd->vk.handle);
+}
+
+static void get_pipeline_layout_data(VIPipelineLayout layout, std::vector<VISetLayoutInfo>& set_layouts, std::vector<VIBinding>& set_bindings, VIPipelineLayoutData* out_data)
 {
 	uint32_t set_layout_count = (uint32_t)layout->set_layouts.size();
-	std::vector<VISetLayoutInfo> set_layouts(set_layout_count);
+	set_layouts.resize(set_layout_count);
 
 	uint32_t binding_ctr = 0;
 	for (size_t i = 0; i < set_layout_count; i++)
 		binding_ctr += (uint32_t)layout->set_layouts[i]->bindings.size();
 
-	std::vector<VIBinding> set_bindings(binding_ctr);
+	set_bindings.resize(binding_ctr);
 	binding_ctr = 0;
 
 	for (uint32_t i = 0; i < set_layout_count; i++)
@@ -6157,26 +9797,256 @@ char* vi_compile_binary(VIDevice device, VIModuleType type, VIPipelineLayout lay
 			set_bindings[binding_ctr++] = bindings[j];
 	}
 
+	out_data->push_constant_size = layout->push_constant_size;
+	out_data->set_layout_count = set_layout_count;
+	out_data->set_layouts = set_layouts.data();
+}
+
+static bool check_module_binary(VIBackend backend, const VIModuleInfo* info, VIBinaryHeader* out_header)
+{
+	std::string error;
+
+	if (read_binary(info->vise_binary, info->vise_binary_size, out_header, &error))
+	{
+		if (!(out_header->backend_mask & VI_BINARY_BACKEND_BIT(backend)))
+			error = "vise binary has no section for this backend";
+		else if (out_header->module_type != (uint32_t)info->type)
+			error = "vise binary module type mismatch";
+		else if (info->pipeline_layout)
+		{
+			std::vector<VISetLayoutInfo> set_layouts;
+			std::vector<VIBinding> set_bindings;
+			VIPipelineLayoutData layout_data;
+			get_pipeline_layout_data(info->pipeline_layout, set_layouts, set_bindings, &layout_data);
+
+			if (out_header->layout_hash != hash_pipeline_layout(layout_data))
+				error = "vise binary was compiled against a different pipeline layout";
+		}
+	}
+
+	if (!error.empty())
+	{
+		std::cout << "vi_create_module rejected binary: " << error << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// compute-only devices never call vi_device_next_frame, once the device is idle the next
+// frame count makes get_set_pool_frame recycle the sets of transient pools
+static void idle_transient_sets(VIDevice device)
+{
+	if (device->compute_only)
+		device->frame_count++;
+}
+
+static VISetPoolFrame* get_set_pool_frame(VIDevice device, VISetPool pool)
+{
+	if (!(pool->flags & VI_SET_POOL_TRANSIENT_BIT))
+		return pool->frames.data();
+
+	uint32_t frame_idx = device->backend == VI_BACKEND_VULKAN ? device->vk.frame_idx : 0;
+	VISetPoolFrame* frame = pool->frames.data() + frame_idx;
+
+	if (frame->frame_count == device->frame_count)
+		return frame;
+
+	// vi_device_next_frame has waited for the fence of this frame,
+	// sets allocated the last time this frame was in flight are no longer in use
+	frame->frame_count = device->frame_count;
+
+	if (device->backend == VI_BACKEND_OPENGL)
+	{
+		for (uint32_t i = 0; i < frame->set_count; i++)
+			gl_free_set(device, frame->sets[i]);
+	}
+	else
+	{
+		for (VkDescriptorPool handle : frame->vk_pools)
+			VK_CHECK(vkResetDescriptorPool(device->vk.device, handle, 0));
+	}
+
+	frame->set_count = 0;
+	frame->pool_idx = 0;
+
+	return frame;
+}
+
+static std::string get_permutation_source(const char* vise_glsl, uint32_t keyword_count, const std::string* keywords, uint64_t key)
+{
+	std::string defines;
+	for (uint32_t i = 0; i < keyword_count; i++)
+	{
+		if (key & (1ull << i))
+			defines += "#define " + keywords[i] + " 1\n";
+	}
+
+	// defines go right after the #version directive, #line keeps diagnostics pointing at the original source
+	std::string source(vise_glsl);
+	size_t version_pos = source.find("#version");
+	size_t insert_pos = 0;
+	uint32_t line = 1;
+
+	if (version_pos != std::string::npos)
+	{
+		size_t newline_pos = source.find('\n', version_pos);
+		insert_pos = newline_pos == std::string::npos ? source.size() : newline_pos + 1;
+		line = (uint32_t)std::count(source.begin(), source.begin() + insert_pos, '\n') + 1;
+	}
+
+	defines += "#line " + std::to_string(line) + "\n";
+	source.insert(insert_pos, defines);
+
+	return source;
+}
+
+char* vi_compile_binary(VIDevice device, VIModuleType type, VIPipelineLayout layout, const char* vise_glsl, uint32_t* binary_size, const VIIncludeResolver* include_resolver)
+{
+	VI_TRACE_FUNC;
+
+	std::vector<VISetLayoutInfo> set_layouts;
+	std::vector<VIBinding> set_bindings;
 	VIPipelineLayoutData layout_data;
-	layout_data.push_constant_size = layout->push_constant_size;
-	layout_data.set_layout_count = set_layout_count;
-	layout_data.set_layouts = set_layouts.data();
-	return vi_compile_binary_offline(device->backend, type, &layout_data, vise_glsl, binary_size);
+	get_pipeline_layout_data(layout, set_layouts, set_bindings, &layout_data);
+
+	return vi_compile_binary_offline(device->backend, type, &layout_data, vise_glsl, binary_size, include_resolver);
+}
+
+char* vi_make_permutation_source(const char* vise_glsl, uint32_t keyword_count, const char* const* keywords, uint64_t key)
+{
+	VI_TRACE_FUNC;
+
+	VI_ASSERT(keyword_count <= 64);
+
+	std::vector<std::string> keyword_strs(keywords, keywords + keyword_count);
+	std::string source = get_permutation_source(vise_glsl, keyword_count, keyword_strs.data(), key);
+
+	char* result = (char*)vi_malloc(source.size() + 1);
+	memcpy(result, source.c_str(), source.size() + 1);
+	return result;
 }
 
-char* vi_compile_binary_offline(VIBackend backend, VIModuleType type, const VIPipelineLayoutData* layout_data, const char* vise_glsl, uint32_t* out_binary_size)
+char* vi_compile_binary_offline(VIBackend backend, VIModuleType type, const VIPipelineLayoutData* layout_data, const char* vise_glsl, uint32_t* out_binary_size, const VIIncludeResolver* include_resolver, char** out_dependencies)
 {
-	char* payload_data;
-	size_t payload_size;
+	VI_TRACE_FUNC;
+
 	VICompileResult result;
+	char* binary = compile_binary(result, VI_BINARY_BACKEND_BIT(backend), type, layout_data, vise_glsl, include_resolver, out_binary_size);
+
+	if (!binary)
+		std::cout << "vi_compile_binary_offline failed\n" << result.error << std::endl;
+
+	if (out_dependencies)
+		*out_dependencies = join_dependencies(result.dependencies);
+
+	return binary;
+}
+
+char* vi_compile_fat_binary_offline(VIModuleType type, const VIPipelineLayoutData* layout_data, const char* vise_glsl, uint32_t* out_binary_size, const VIIncludeResolver* include_resolver, char** out_dependencies)
+{
+	VI_TRACE_FUNC;
+
+	VICompileResult result;
+	uint32_t backend_mask = VI_BINARY_BACKEND_BIT(VI_BACKEND_VULKAN) | VI_BINARY_BACKEND_BIT(VI_BACKEND_OPENGL);
+	char* binary = compile_binary(result, backend_mask, type, layout_data, vise_glsl, include_resolver, out_binary_size);
+
+	if (!binary)
+		std::cout << "vi_compile_fat_binary_offline failed\n" << result.error << std::endl;
+
+	if (out_dependencies)
+		*out_dependencies = join_dependencies(result.dependencies);
+
+	return binary;
+}
+
+bool vi_binary_check(const char* vise_binary, uint32_t binary_size, const char* vise_glsl, const VIIncludeResolver* include_resolver)
+{
+	VI_TRACE_FUNC;
+
+	VIBinaryHeader header;
+	std::string error;
+
+	if (!read_binary(vise_binary, binary_size, &header, &error) || header.binary_size != binary_size)
+		return false;
+
+	if (!vise_glsl)
+		return true;
+
+	if (!include_resolver)
+		return header.source_hash == hash_fnv1a(VI_FNV1A_OFFSET_BASIS, vise_glsl, strlen(vise_glsl));
+
+	// the included headers are only known after preprocessing
+	EShLanguage stage;
+	std::string preprocessed_glsl;
+	cast_module_type_glslang((VIModuleType)header.module_type, &stage);
+
+	if (!preprocess_glsl(stage, vise_glsl, include_resolver, nullptr, &preprocessed_glsl, &error))
+		return false;
+
+	return header.source_hash == hash_fnv1a(VI_FNV1A_OFFSET_BASIS, preprocessed_glsl.data(), preprocessed_glsl.size());
+}
+
+void vi_compile_binaries(uint32_t job_count, const VICompileJob* jobs, VICompileJobResult* results, uint32_t thread_count)
+{
+	VI_TRACE_FUNC;
+
+	if (thread_count == 0)
+		thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	thread_count = std::min(thread_count, job_count);
+
+	// each worker claims the next unprocessed job, results are written to disjoint slots
+	std::atomic<uint32_t> next_job = 0;
+	auto worker = [&]() {
+		for (uint32_t i = next_job++; i < job_count; i = next_job++)
+		{
+			const VICompileJob& job = jobs[i];
+			VICompileJobResult& job_result = results[i];
+			VICompileResult result;
+
+			uint32_t backend_mask = VI_BINARY_BACKEND_BIT(job.backend);
+			if (job.fat_binary)
+				backend_mask = VI_BINARY_BACKEND_BIT(VI_BACKEND_VULKAN) | VI_BINARY_BACKEND_BIT(VI_BACKEND_OPENGL);
+
+			job_result.binary = compile_binary(result, backend_mask, job.type, job.pipeline_layout, job.vise_glsl, job.include_resolver, &job_result.binary_size);
+			job_result.error = nullptr;
+
+			if (!job_result.binary)
+			{
+				job_result.binary_size = 0;
+				job_result.error = (char*)vi_malloc(result.error.size() + 1);
+				memcpy(job_result.error, result.error.c_str(), result.error.size() + 1);
+			}
+
+			job_result.dependencies = join_dependencies(result.dependencies);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < thread_count; i++)
+		threads.emplace_back(worker);
+
+	// calling thread participates as well
+	worker();
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+static char* compile_binary(VICompileResult& result, uint32_t backend_mask, VIModuleType type, const VIPipelineLayoutData* layout_data, const char* vise_glsl, const VIIncludeResolver* resolver, uint32_t* out_binary_size)
+{
 	EShLanguage stage;
 	cast_module_type_glslang(type, &stage);
 
-	std::vector<char> spirv_bytes;
-	uint32_t glpc_count = 0;
-	uint32_t header_size = sizeof(VIBinaryHeader);
+	// a single glslang pass, the OpenGL section is cross compiled from the same SPIRV
+	compile_vk(result, stage, vise_glsl, resolver);
+	if (!result.success)
+		return nullptr;
 
-	if (backend == VI_BACKEND_OPENGL)
+	bool has_vk = backend_mask & VI_BINARY_BACKEND_BIT(VI_BACKEND_VULKAN);
+	bool has_gl = backend_mask & VI_BINARY_BACKEND_BIT(VI_BACKEND_OPENGL);
+
+	if (has_gl)
 	{
 		uint32_t set_count = layout_data->set_layout_count;
 		std::vector<uint32_t> binding_counts(set_count);
@@ -6184,72 +10054,316 @@ char* vi_compile_binary_offline(VIBackend backend, VIModuleType type, const VIPi
 
 		for (uint32_t i = 0; i < set_count; i++)
 		{
-			const VISetLayoutInfo& set_layout = layout_data->set_layouts[i];
-			binding_counts[i] = set_layout.binding_count;
-
-			for (uint32_t j = 0; j < binding_counts[i]; j++)
-				set_bindings[i] = set_layout.bindings;
+			binding_counts[i] = layout_data->set_layouts[i].binding_count;
+			set_bindings[i] = layout_data->set_layouts[i].bindings;
 		}
 
 		std::vector<GLRemap> remaps;
 		gl_remap(remaps, set_count, binding_counts.data(), set_bindings.data());
-		compile_gl(result, stage, vise_glsl, (uint32_t)remaps.size(), remaps.data());
-
-		glpc_count = (uint32_t)result.gl_push_constants.size();
-		for (uint32_t i = 0; i < glpc_count; i++)
-			header_size += (uint32_t)result.gl_push_constants[i].GetSerialSize();
-
-		payload_size = result.gl_patched.size();
-		payload_data = (char*)result.gl_patched.data();
+		compile_gl_spirv(result, stage, (uint32_t)remaps.size(), remaps.data());
+		if (!result.success)
+			return nullptr;
 	}
-	else
-	{
-		compile_vk(result, stage, vise_glsl);
-		spirv_bytes.resize(result.vk_spirv.size() * 4);
-		uint8_t* now = (uint8_t*)spirv_bytes.data();
-		for (const uint32_t& word : result.vk_spirv)
-			swrite32(&now, word);
 
-		payload_size = spirv_bytes.size();
-		payload_data = spirv_bytes.data();
-	}
+	uint32_t glpc_size = 0;
+	for (const GLPushConstant& pc : result.gl_push_constants)
+		glpc_size += (uint32_t)pc.GetSerialSize();
 
-	// serializtaion
-	// - header consists of VIBinaryHeader fields and GLPushConstant entries
-	// - binary payload is SPIRV for Vulkan or patched GLSL for OpenGL
+	// serialization
+	// - header consists of VIBinaryHeader fields
+	// - SPIRV section follows the header to keep word alignment
+	// - GLPushConstant entries and patched GLSL follow the SPIRV section
 
 	VIBinaryHeader header;
-	header.backend_type = backend;
+	header.magic = VI_BINARY_MAGIC;
+	header.version = VI_BINARY_VERSION;
+	header.source_hash = result.source_hash;
+	header.layout_hash = hash_pipeline_layout(*layout_data);
 	header.module_type = type;
-	header.glpc_count = glpc_count;
-	header.header_size = header_size;
-	header.payload_size = payload_size;
-
-	uint32_t binary_size = header_size + payload_size;
+	header.backend_mask = backend_mask;
+	header.spirv_offset = sizeof(VIBinaryHeader);
+	header.spirv_size = has_vk ? (uint32_t)result.vk_spirv.size() * 4 : 0;
+	header.glpc_offset = header.spirv_offset + header.spirv_size;
+	header.glpc_count = has_gl ? (uint32_t)result.gl_push_constants.size() : 0;
+	header.glsl_offset = header.glpc_offset + (has_gl ? glpc_size : 0);
+	header.glsl_size = has_gl ? (uint32_t)result.gl_patched.size() : 0;
+	header.binary_size = header.glsl_offset + header.glsl_size;
+	header.checksum = 0;
+
+	uint32_t binary_size = header.binary_size;
 	uint8_t* binary = (uint8_t*)vi_malloc(binary_size);
-	uint8_t* now = binary;
-	swrite_header(&now, header);
+	uint8_t* now = binary + sizeof(VIBinaryHeader);
 
-	for (const GLPushConstant& pc : result.gl_push_constants)
-		swrite_glpc(&now, pc);
+	if (has_vk)
+	{
+		for (const uint32_t& word : result.vk_spirv)
+			swrite32(&now, word);
+	}
+
+	if (has_gl)
+	{
+		for (const GLPushConstant& pc : result.gl_push_constants)
+			swrite_glpc(&now, pc);
 
-	swrite_bytes(&now, payload_size, payload_data);
+		swrite_bytes(&now, header.glsl_size, result.gl_patched.data());
+	}
 
 	VI_ASSERT(now - binary == binary_size);
 
+	header.checksum = hash_fnv1a(VI_FNV1A_OFFSET_BASIS, binary + sizeof(VIBinaryHeader), binary_size - sizeof(VIBinaryHeader));
+	now = binary;
+	swrite_header(&now, header);
+
 	if (out_binary_size)
 		*out_binary_size = binary_size;
 
 	return (char*)binary;
 }
 
+// newline separated dependency names allocated with vi_malloc, null if there are none
+static char* join_dependencies(const std::vector<std::string>& dependencies)
+{
+	if (dependencies.empty())
+		return nullptr;
+
+	std::string joined;
+	for (const std::string& dependency : dependencies)
+	{
+		joined += dependency;
+		joined.push_back('\n');
+	}
+
+	char* result = (char*)vi_malloc(joined.size() + 1);
+	memcpy(result, joined.c_str(), joined.size() + 1);
+	return result;
+}
+
 void vi_offline_free(void* data)
 {
 	vi_free(data);
 }
 
+char* vi_pack_shader_archive(uint32_t entry_count, const VIShaderArchiveEntry* entries, uint32_t* out_archive_size)
+{
+	VI_TRACE_FUNC;
+
+	// layout
+	// - VIArchiveHeader
+	// - VIArchiveEntry index
+	// - entry names
+	// - vise binaries, each aligned to 4 bytes so SPIRV words may be read in place
+
+	uint32_t names_offset = sizeof(VIArchiveHeader) + sizeof(VIArchiveEntry) * entry_count;
+	uint32_t names_size = 0;
+	for (uint32_t i = 0; i < entry_count; i++)
+		names_size += (uint32_t)strlen(entries[i].name);
+
+	uint32_t binary_offset = (names_offset + names_size + 3) & ~3u;
+	uint32_t archive_size = binary_offset;
+	for (uint32_t i = 0; i < entry_count; i++)
+		archive_size += (entries[i].binary_size + 3) & ~3u;
+
+	uint8_t* archive = (uint8_t*)vi_malloc(archive_size);
+	memset(archive, 0, archive_size);
+
+	VIArchiveHeader header;
+	header.magic = VI_ARCHIVE_MAGIC;
+	header.version = VI_ARCHIVE_VERSION;
+	header.entry_count = entry_count;
+	header.archive_size = archive_size;
+
+	uint8_t* now = archive;
+	swrite_archive_header(&now, header);
+
+	uint32_t name_offset = names_offset;
+	for (uint32_t i = 0; i < entry_count; i++)
+	{
+		VIBinaryHeader binary_header;
+		uint8_t* binary = (uint8_t*)entries[i].binary;
+		VI_ASSERT(entries[i].binary_size >= sizeof(VIBinaryHeader));
+		sread_header(&binary, &binary_header);
+		VI_ASSERT(binary_header.magic == VI_BINARY_MAGIC && binary_header.version == VI_BINARY_VERSION);
+		VI_ASSERT(binary_header.binary_size <= entries[i].binary_size);
+
+		VIArchiveEntry entry;
+		entry.name_offset = name_offset;
+		entry.name_size = (uint32_t)strlen(entries[i].name);
+		entry.backend_mask = binary_header.backend_mask;
+		entry.module_type = binary_header.module_type;
+		entry.binary_offset = binary_offset;
+		entry.binary_size = entries[i].binary_size;
+		swrite_archive_entry(&now, entry);
+
+		memcpy(archive + name_offset, entries[i].name, entry.name_size);
+		memcpy(archive + binary_offset, entries[i].binary, entry.binary_size);
+		name_offset += entry.name_size;
+		binary_offset += (entry.binary_size + 3) & ~3u;
+	}
+
+	VI_ASSERT(binary_offset == archive_size);
+
+	if (out_archive_size)
+		*out_archive_size = archive_size;
+
+	return (char*)archive;
+}
+
+VIShaderArchive vi_load_shader_archive(const char* path)
+{
+	VI_TRACE_FUNC;
+
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+
+#ifdef VI_PLATFORM_WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "vi_load_shader_archive: failed to open " << path << std::endl;
+		return VI_NULL;
+	}
+
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file, &file_size);
+	size = (size_t)file_size.QuadPart;
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+		data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		std::cout << "vi_load_shader_archive: failed to open " << path << std::endl;
+		return VI_NULL;
+	}
+
+	struct stat file_stat;
+	fstat(fd, &file_stat);
+	size = (size_t)file_stat.st_size;
+
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped != MAP_FAILED)
+		data = (const uint8_t*)mapped;
+#endif
+
+	VIShaderArchive archive = (VIShaderArchive)vi_malloc(sizeof(VIShaderArchiveObj));
+	new (archive) VIShaderArchiveObj();
+	archive->data = data;
+	archive->size = size;
+#ifdef VI_PLATFORM_WIN32
+	archive->file = file;
+	archive->mapping = mapping;
+#endif
+
+	bool is_valid = data != nullptr && size >= sizeof(VIArchiveHeader);
+	VIArchiveHeader header;
+
+	if (is_valid)
+	{
+		uint8_t* now = (uint8_t*)data;
+		sread_archive_header(&now, &header);
+		is_valid = header.magic == VI_ARCHIVE_MAGIC && header.version == VI_ARCHIVE_VERSION && header.archive_size == size &&
+			sizeof(VIArchiveHeader) + (size_t)header.entry_count * sizeof(VIArchiveEntry) <= size;
+
+		for (uint32_t i = 0; is_valid && i < header.entry_count; i++)
+		{
+			VIArchiveEntry entry;
+			sread_archive_entry(&now, &entry);
+			is_valid = (size_t)entry.name_offset + entry.name_size <= size &&
+				(size_t)entry.binary_offset + entry.binary_size <= size && (entry.binary_offset & 3) == 0;
+			archive->entries.push_back(entry);
+		}
+	}
+
+	if (!is_valid)
+	{
+		std::cout << "vi_load_shader_archive: invalid archive " << path << std::endl;
+		vi_unload_shader_archive(archive);
+		return VI_NULL;
+	}
+
+	return archive;
+}
+
+void vi_unload_shader_archive(VIShaderArchive archive)
+{
+	VI_TRACE_FUNC;
+
+#ifdef VI_PLATFORM_WIN32
+	if (archive->data)
+		UnmapViewOfFile(archive->data);
+	if (archive->mapping)
+		CloseHandle(archive->mapping);
+	CloseHandle(archive->file);
+#else
+	if (archive->data)
+		munmap((void*)archive->data, archive->size);
+#endif
+
+	archive->~VIShaderArchiveObj();
+	vi_free(archive);
+}
+
+const char* vi_shader_archive_find(VIShaderArchive archive, VIBackend backend, const char* name, uint32_t* binary_size)
+{
+	VI_TRACE_FUNC;
+
+	size_t name_size = strlen(name);
+
+	for (const VIArchiveEntry& entry : archive->entries)
+	{
+		if (!(entry.backend_mask & VI_BINARY_BACKEND_BIT(backend)) || entry.name_size != name_size)
+			continue;
+
+		if (memcmp(archive->data + entry.name_offset, name, name_size) != 0)
+			continue;
+
+		if (binary_size)
+			*binary_size = entry.binary_size;
+
+		return (const char*)(archive->data + entry.binary_offset);
+	}
+
+	return nullptr;
+}
+
+VIModule vi_create_module_from_archive(VIDevice device, VIShaderArchive archive, VIPipelineLayout pipeline_layout, const char* name)
+{
+	VI_TRACE_FUNC;
+
+	uint32_t binary_size;
+	const char* binary = vi_shader_archive_find(archive, device->backend, name, &binary_size);
+	if (!binary)
+	{
+		std::cout << "vi_create_module_from_archive: module not found " << name << std::endl;
+		return VI_NULL;
+	}
+
+	// the module type is read ahead of validation, the remaining sections are checked by vi_create_module
+	if (binary_size < sizeof(VIBinaryHeader))
+	{
+		std::cout << "vi_create_module_from_archive: truncated binary " << name << std::endl;
+		return VI_NULL;
+	}
+
+	VIBinaryHeader header;
+	uint8_t* now = (uint8_t*)binary;
+	sread_header(&now, &header);
+
+	VIModuleInfo moduleI;
+	moduleI.type = (VIModuleType)header.module_type;
+	moduleI.pipeline_layout = pipeline_layout;
+	moduleI.vise_binary = binary;
+	moduleI.vise_binary_size = binary_size;
+	return vi_create_module(device, &moduleI);
+}
+
 VkInstance vi_device_unwrap_instance(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(device && device->backend == VI_BACKEND_VULKAN);
 
 	return device->vk.instance;
@@ -6257,6 +10371,8 @@ VkInstance vi_device_unwrap_instance(VIDevice device)
 
 VkDevice vi_device_unwrap(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(device && device->backend == VI_BACKEND_VULKAN);
 
 	return device->vk.device;
@@ -6264,6 +10380,8 @@ VkDevice vi_device_unwrap(VIDevice device)
 
 VkPhysicalDevice vi_device_unwrap_physical(VIDevice device)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(device && device->backend == VI_BACKEND_VULKAN);
 
 	return device->vk.pdevice;
@@ -6271,6 +10389,8 @@ VkPhysicalDevice vi_device_unwrap_physical(VIDevice device)
 
 VkRenderPass vi_pass_unwrap(VIPass pass)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(pass && pass->device->backend == VI_BACKEND_VULKAN);
 
 	return pass->vk.handle;
@@ -6278,6 +10398,8 @@ VkRenderPass vi_pass_unwrap(VIPass pass)
 
 VkSemaphore vi_semaphore_unwrap(VISemaphore semaphore)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(semaphore && semaphore->device->backend == VI_BACKEND_VULKAN);
 
 	return semaphore->vk_handle;
@@ -6285,6 +10407,8 @@ VkSemaphore vi_semaphore_unwrap(VISemaphore semaphore)
 
 VkQueue vi_queue_unwrap(VIQueue queue)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(queue && queue->device->backend == VI_BACKEND_VULKAN);
 
 	return queue->vk_handle;
@@ -6292,6 +10416,8 @@ VkQueue vi_queue_unwrap(VIQueue queue)
 
 VkCommandBuffer vi_command_unwrap(VICommand command)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(command && command->device->backend == VI_BACKEND_VULKAN);
 
 	return command->vk.handle;
@@ -6299,6 +10425,8 @@ VkCommandBuffer vi_command_unwrap(VICommand command)
 
 VkBuffer vi_buffer_unwrap(VIBuffer buffer)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(buffer && buffer->device->backend == VI_BACKEND_VULKAN);
 
 	return buffer->vk.handle;
@@ -6306,6 +10434,8 @@ VkBuffer vi_buffer_unwrap(VIBuffer buffer)
 
 VkImage vi_image_unwrap(VIImage image)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(image && image->device->backend == VI_BACKEND_VULKAN);
 
 	return image->vk.handle;
@@ -6313,6 +10443,8 @@ VkImage vi_image_unwrap(VIImage image)
 
 VkImageView vi_image_unwrap_view(VIImage image)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(image && image->device->backend == VI_BACKEND_VULKAN);
 
 	return image->vk.view_handle;
@@ -6320,13 +10452,17 @@ VkImageView vi_image_unwrap_view(VIImage image)
 
 VkSampler vi_image_unwrap_sampler(VIImage image)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(image && image->device->backend == VI_BACKEND_VULKAN);
 
-	return image->vk.sampler_handle;
+	return image->sampler->vk.handle;
 }
 
 uint32_t vi_image_unwrap_gl(VIImage image)
 {
+	VI_TRACE_FUNC;
+
 	VI_ASSERT(image && image->device->backend == VI_BACKEND_OPENGL);
 
 	return (uint32_t)image->gl.handle;
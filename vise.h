@@ -4,6 +4,8 @@
 #ifdef WIN32
 # define VI_PLATFORM_WIN32
 # define VK_USE_PLATFORM_WIN32_KHR
+#elif defined(__linux__)
+# define VI_PLATFORM_LINUX
 #else
 # error "vise unsupported platform"
 #endif
@@ -35,6 +37,7 @@
 VI_DECLARE_HANDLE(VIDevice);
 VI_DECLARE_HANDLE(VIBuffer);
 VI_DECLARE_HANDLE(VIImage);
+VI_DECLARE_HANDLE(VISampler);
 VI_DECLARE_HANDLE(VIPass);
 VI_DECLARE_HANDLE(VIModule);
 VI_DECLARE_HANDLE(VISetLayout);
@@ -49,6 +52,9 @@ VI_DECLARE_HANDLE(VICommandPool);
 VI_DECLARE_HANDLE(VIFence);
 VI_DECLARE_HANDLE(VISemaphore);
 VI_DECLARE_HANDLE(VIQueue);
+VI_DECLARE_HANDLE(VIQueryPool);
+VI_DECLARE_HANDLE(VIShaderArchive);
+VI_DECLARE_HANDLE(VIPermutation);
 
 struct VISwapchainInfo;
 struct VISubmitInfo;
@@ -59,6 +65,7 @@ struct VICommandInheritanceInfo;
 struct VISetPoolInfo;
 struct VISetLayoutInfo;
 struct VISetUpdateInfo;
+struct VISetResource;
 struct VIPipelineInfo;
 struct VIPipelineLayoutInfo;
 struct VIComputePipelineInfo;
@@ -67,6 +74,7 @@ struct VIBufferInfo;
 struct VIImageInfo;
 struct VIDrawInfo;
 struct VIDrawIndexedInfo;
+struct VIQueryPoolInfo;
 struct VIPhysicalDevice;
 
 enum VIBackend
@@ -88,6 +96,9 @@ enum VIBindingType
 	VI_BINDING_TYPE_STORAGE_BUFFER,
 	VI_BINDING_TYPE_STORAGE_IMAGE,
 	VI_BINDING_TYPE_COMBINED_IMAGE_SAMPLER,
+	VI_BINDING_TYPE_UNIFORM_BUFFER_DYNAMIC, // offset supplied when the set is bound
+	VI_BINDING_TYPE_STORAGE_BUFFER_DYNAMIC, // offset supplied when the set is bound
+	VI_BINDING_TYPE_ENUM_COUNT,
 };
 
 enum VIGLSLType
@@ -148,12 +159,18 @@ enum VIFormat
 	VI_FORMAT_D32F_S8U,
 	VI_FORMAT_D24_S8U,
 	VI_FORMAT_D32F,
+	VI_FORMAT_BC1_RGBA,  // 4x4 blocks of 8 bytes, 1-bit alpha
+	VI_FORMAT_BC3_RGBA,  // 4x4 blocks of 16 bytes
+	VI_FORMAT_BC4_R,     // 4x4 blocks of 8 bytes, single channel
+	VI_FORMAT_BC5_RG,    // 4x4 blocks of 16 bytes, two channels, suited for normal maps
+	VI_FORMAT_BC7_RGBA,  // 4x4 blocks of 16 bytes
 };
 
 enum VIBufferUsageBit : uint32_t
 {
 	VI_BUFFER_USAGE_TRANSFER_SRC_BIT = 1,
 	VI_BUFFER_USAGE_TRANSFER_DST_BIT = 2,
+	VI_BUFFER_USAGE_CONDITIONAL_BIT = 4, // predicate of vi_cmd_begin_conditional
 };
 using VIBufferUsageFlags = uint32_t;
 
@@ -168,6 +185,23 @@ enum VIImageUsageBit : uint32_t
 };
 using VIImageUsageFlags = uint32_t;
 
+enum VISetPoolFlagBit : uint32_t
+{
+	VI_SET_POOL_GROWABLE_BIT = 1,  // chain new descriptor pools sized by observed layout usage instead of failing when exhausted
+	VI_SET_POOL_TRANSIENT_BIT = 2, // sets are only valid for the current frame and are recycled in bulk once the frame completes,
+	                               // compute-only devices recycle them once vi_queue_wait_idle or vi_device_wait_idle returns
+	VI_SET_POOL_BINDLESS_BIT = 4,  // required to allocate sets with a VI_SET_LAYOUT_BINDLESS_BIT layout
+};
+using VISetPoolFlags = uint32_t;
+
+enum VISetLayoutFlagBit : uint32_t
+{
+	VI_SET_LAYOUT_BINDLESS_BIT = 1, // combined image sampler bindings may be partially bound and updated after the set is bound,
+	                                // other bindings follow regular update rules
+	VI_SET_LAYOUT_PUSH_BIT = 2,     // bindings are written with vi_cmd_push_graphics_set or vi_cmd_push_compute_set instead of allocating sets
+};
+using VISetLayoutFlags = uint32_t;
+
 enum VISamplerAddressMode
 {
 	VI_SAMPLER_ADDRESS_MODE_REPEAT,
@@ -181,12 +215,51 @@ enum VIFilter
 	VI_FILTER_NEAREST,
 };
 
+enum VIQueryType
+{
+	VI_QUERY_TYPE_TIMESTAMP,           // vi_cmd_write_timestamp, results in nanoseconds
+	VI_QUERY_TYPE_OCCLUSION,           // number of samples passing depth and stencil tests, GL_SAMPLES_PASSED on OpenGL
+	VI_QUERY_TYPE_OCCLUSION_ANY,       // non-zero if any sample passed, GL_ANY_SAMPLES_PASSED on OpenGL
+	VI_QUERY_TYPE_PIPELINE_STATISTICS, // one result per enabled VIPipelineStatisticBit
+};
+
+// results of a pipeline statistics query are ordered by ascending bit
+enum VIPipelineStatisticBit : uint32_t
+{
+	VI_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT     = 1,  // GL_VERTICES_SUBMITTED on OpenGL
+	VI_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT   = 2,  // GL_PRIMITIVES_SUBMITTED on OpenGL
+	VI_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT   = 4,
+	VI_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT        = 8,  // GL_CLIPPING_INPUT_PRIMITIVES on OpenGL
+	VI_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT         = 16, // GL_CLIPPING_OUTPUT_PRIMITIVES on OpenGL
+	VI_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT = 32,
+	VI_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT  = 64,
+};
+using VIPipelineStatisticFlags = uint32_t;
+
 struct VIDeviceInfo
 {
-	void* window; // GLFWwindow* handle
+	void* window; // GLFWwindow* handle, ignored by headless devices
 
 	int desired_swapchain_framebuffer_count;
 
+	// frame slots the CPU may record ahead of the GPU, independent of the swapchain image count.
+	// zero follows desired_swapchain_framebuffer_count, the active count can be lowered at runtime
+	int max_frames_in_flight = 0;
+
+	// no window, surface or swapchain, for offscreen rendering and compute on servers.
+	// if no OpenGL context is current, OpenGL creates a surfaceless EGL context on Linux and
+	// a hidden GLFW window elsewhere, the latter must be created on the main thread
+	bool headless = false;
+
+	// headless device for GPGPU workers, a single queue on a compute capable family and no frames.
+	// only compute pipelines, storage resources and transfers are supported
+	bool compute_only = false;
+
+	// Vulkan buffers, images, sets, set pools and framebuffers destroyed during a frame are kept until
+	// the frame is complete, so resources may be replaced without vi_device_wait_idle. only frames
+	// submitted with their frame_complete fence are tracked, vi_device_wait_idle releases everything
+	bool deferred_destruction = false;
+
 	struct
 	{
 		bool enable_validation_layers = true;
@@ -202,10 +275,19 @@ struct VIDeviceInfo
 struct VIDeviceLimits
 {
 	uint32_t swapchain_framebuffer_count;
+	uint32_t max_frames_in_flight;               // frame slots, index per-frame resources with vi_device_get_frame_index
 	uint32_t max_push_constant_size;
 	uint32_t max_compute_workgroup_count[3];     // vi_cmd_dispatch dimension limits
 	uint32_t max_compute_workgroup_size[3];      // vise GLSL workgroup local size limits
 	uint32_t max_compute_workgroup_invocations;  // vise GLSL workgroup local size product limit
+	uint32_t max_bindless_image_count;           // combined image sampler array_count limit in bindless set layouts, 0 if unsupported.
+	                                             // OpenGL emulates bindless arrays with consecutive texture units, GL_MAX_TEXTURE_IMAGE_UNITS
+	uint32_t min_uniform_buffer_offset_alignment; // dynamic offsets of uniform buffers must be a multiple of this
+	uint32_t min_storage_buffer_offset_alignment; // dynamic offsets of storage buffers must be a multiple of this
+	bool timestamp_queries;                      // vi_cmd_write_timestamp is supported on the graphics queue
+	bool occlusion_query_precise;                // VI_QUERY_TYPE_OCCLUSION counts samples, otherwise it only reports non-zero
+	bool pipeline_statistics_queries;            // VI_QUERY_TYPE_PIPELINE_STATISTICS is supported
+	bool conditional_rendering;                  // vi_cmd_begin_conditional is supported
 };
 
 struct VIDeviceProfileVK
@@ -242,7 +324,10 @@ struct VIPhysicalDevice
 	VkPhysicalDeviceMemoryProperties device_memory_props;
 	VkSurfaceKHR surface;
 	VkSurfaceCapabilitiesKHR surface_caps;
-	VkPhysicalDeviceFeatures2 features;
+	VkPhysicalDeviceFeatures2 features;          // supported features, the device only enables those vise uses
+	VkPhysicalDeviceVulkan12Features features_vk12;
+	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT features_extended_dynamic_state;
+	VkPhysicalDeviceConditionalRenderingFeaturesEXT features_conditional_rendering;
 	std::vector<VkFormat> depth_stencil_formats; // supported depth stencil formats with VK_IMAGE_TILING_OPTIMAL
 	std::vector<VkQueueFamilyProperties> family_props;
 	std::vector<VkExtensionProperties> ext_props;
@@ -286,12 +371,40 @@ struct VISwapchainInfo
 	VkColorSpaceKHR image_color_space;
 };
 
+// resolves #include directives in vise GLSL
+// - resolve returns the header source and writes its byte size, or returns null if the header is not found
+// - header names are relative to the directory of the including header. includer_name is the resolved name of the
+//   including header relative to the top level source, for example "lib/common.glsl" for #include "common.glsl"
+//   from "lib/lighting.glsl", and empty for the top level source. resolved names are reported as dependencies
+// - release is optional and called once glslang no longer references the header source
+// - callbacks may be invoked concurrently from vi_compile_binaries worker threads
+struct VIIncludeResolver
+{
+	void* user;
+	const char* (*resolve)(void* user, const char* header_name, const char* includer_name, size_t* header_size);
+	void (*release)(void* user, const char* header_source);
+};
+
 struct VIModuleInfo
 {
 	VIModuleType type;
 	VIPipelineLayout pipeline_layout = VI_NULL;
 	const char* vise_glsl = nullptr;
 	const char* vise_binary = nullptr;
+	uint32_t vise_binary_size = 0;   // byte size of the vise_binary buffer, binaries claiming more are rejected
+	const VIIncludeResolver* include_resolver = nullptr;
+};
+
+// a permutation creates module variants from a single vise GLSL source,
+// bit i of a variant key enables "#define keywords[i] 1" for that variant
+struct VIPermutationInfo
+{
+	VIModuleType type;
+	VIPipelineLayout pipeline_layout;
+	const char* vise_glsl;
+	uint32_t keyword_count;   // at most 64 keywords
+	const char* const* keywords;
+	const VIIncludeResolver* include_resolver = nullptr;
 };
 
 struct VISamplerInfo
@@ -313,7 +426,7 @@ struct VIImageInfo
 	uint32_t height;
 	uint32_t layers = 1;
 	uint32_t levels = 1;
-	VISamplerInfo sampler;
+	VISamplerInfo sampler; // default sampler of the image, shared through the device sampler cache
 };
 
 struct VIBufferInfo
@@ -342,12 +455,14 @@ struct VISetPoolInfo
 	uint32_t max_set_count;
 	uint32_t resource_count;
 	const VISetPoolResource* resources;
+	VISetPoolFlags flags = 0;
 };
 
 struct VISetLayoutInfo
 {
 	uint32_t binding_count;
 	const VIBinding* bindings;
+	VISetLayoutFlags flags = 0;
 };
 
 struct VISetUpdateInfo
@@ -355,6 +470,18 @@ struct VISetUpdateInfo
 	uint32_t binding_index;
 	VIBuffer buffer = VI_NULL;
 	VIImage image = VI_NULL;
+	uint32_t array_index = 0;
+	uint32_t buffer_range = 0; // bytes of the buffer visible to shaders, 0 for the whole buffer. required for dynamic bindings
+	VISampler sampler = VI_NULL; // combined image sampler override, VI_NULL for the image's own sampler
+};
+
+// one resource per descriptor, see vi_set_update_batch
+struct VISetResource
+{
+	VIBuffer buffer = VI_NULL;
+	VIImage image = VI_NULL;
+	uint32_t buffer_range = 0; // bytes of the buffer visible to shaders, 0 for the whole buffer. required for dynamic bindings
+	VISampler sampler = VI_NULL; // combined image sampler override, VI_NULL for the image's own sampler
 };
 
 struct VICommandInheritanceInfo
@@ -391,6 +518,47 @@ struct VIPipelineLayoutData
 	const VISetLayoutInfo* set_layouts;
 };
 
+struct VICompileJob
+{
+	VIBackend backend;
+	VIModuleType type;
+	const VIPipelineLayoutData* pipeline_layout;
+	const char* vise_glsl;
+	const VIIncludeResolver* include_resolver = nullptr;
+	bool fat_binary = false;   // compile a single binary loadable by both backends, backend is ignored
+};
+
+struct VICompileJobResult
+{
+	char* binary;          // compiled vise binary, null on failure. free with vi_free
+	uint32_t binary_size;
+	char* error;           // null terminated error message on failure, null on success. free with vi_free
+	char* dependencies;    // newline separated resolved names of headers included through #include, null if none. free with vi_free
+};
+
+struct VIShaderArchiveEntry
+{
+	const char* name;      // lookup name, unique per backend within an archive
+	const char* binary;    // vise binary from offline compilation
+	uint32_t binary_size;
+};
+
+struct VISpecializationConstant
+{
+	uint32_t constant_id;  // layout (constant_id = N) in vise GLSL
+	VIGLSLType type;       // VI_GLSL_TYPE_BOOL, VI_GLSL_TYPE_INT, VI_GLSL_TYPE_UINT or VI_GLSL_TYPE_FLOAT
+	uint32_t offset;       // byte offset of the 4 byte value in VISpecializationInfo::data
+};
+
+// specialization constants are applied to every module in a pipeline
+struct VISpecializationInfo
+{
+	uint32_t constant_count;
+	const VISpecializationConstant* constants;
+	uint32_t data_size;
+	const void* data;
+};
+
 enum VIBlendFactor
 {
 	VI_BLEND_FACTOR_ZERO,
@@ -502,12 +670,14 @@ struct VIPipelineInfo
 	VIPipelineDepthStencilStateInfo depth_stencil_state;
 	VIPipelineRasterizationStateInfo rasterization_state;
 	VIPass pass;
+	const VISpecializationInfo* specialization = nullptr;
 };
 
 struct VIComputePipelineInfo
 {
 	VIPipelineLayout layout;
 	VIModule compute_module;
+	const VISpecializationInfo* specialization = nullptr;
 };
 
 struct VISubpassColorAttachment
@@ -599,6 +769,23 @@ struct VIBufferMemoryBarrier
 	uint32_t size;
 };
 
+struct VIQueryPoolInfo
+{
+	VIQueryType type;
+	uint32_t query_count;
+	VIPipelineStatisticFlags pipeline_statistics = 0; // VI_QUERY_TYPE_PIPELINE_STATISTICS only
+};
+
+struct VIFrameCounters
+{
+	uint32_t draws;          // vi_cmd_draw and vi_cmd_draw_indexed
+	uint32_t dispatches;
+	uint32_t binds;          // pipelines, sets, pushed sets, vertex and index buffers
+	uint32_t state_changes;  // viewports, scissors and push constants
+	uint32_t passes;
+	uint32_t submits;        // VISubmitInfo entries of vi_queue_submit
+};
+
 struct VIDrawInfo
 {
 	uint32_t vertex_count;
@@ -617,6 +804,10 @@ struct VIDrawIndexedInfo
 
 // Device and Synchronization
 
+// devices are independent of each other, several may live in one process and each may be driven
+// by its own thread. objects of a device must only be used by one thread at a time.
+// OpenGL entry points are loaded once by the first OpenGL device, every later OpenGL device must use
+// the same kind of context: all headless without a current context (EGL on Linux) or all GLFW contexts
 VI_API VIDevice vi_create_device_vk(const VIDeviceInfo* info, VIDeviceLimits* limits);
 VI_API VIDevice vi_create_device_gl(const VIDeviceInfo* info, VIDeviceLimits* limits);
 VI_API void vi_destroy_device(VIDevice device);
@@ -625,14 +816,51 @@ VI_API void vi_device_set_allocator_vk(VIDevice device, const VIAllocatorVK* all
 VI_API const VIDeviceProfileVK* vi_device_get_profile_vk(VIDevice device);
 VI_API const VIDeviceProfileGL* vi_device_get_profile_gl(VIDevice device);
 VI_API const VIPhysicalDevice* vi_device_get_physical_device(VIDevice device);
+VI_API const VIDeviceLimits* vi_device_get_limits(VIDevice device);
 VI_API uint32_t vi_device_get_graphics_family_index(VIDevice device);
 VI_API VIQueue vi_device_get_graphics_queue(VIDevice device);
+VI_API uint32_t vi_device_get_compute_family_index(VIDevice device);
+VI_API VIQueue vi_device_get_compute_queue(VIDevice device);
 VI_API bool vi_device_has_depth_stencil_format(VIDevice device, VIFormat format, VkImageTiling tiling);
+VI_API bool vi_device_has_compressed_format(VIDevice device, VIFormat format);
+// vi_cmd_generate_mipmaps requires blit support for the format on Vulkan, compressed formats are never supported
+VI_API bool vi_device_can_generate_mipmaps(VIDevice device, VIFormat format);
+// OpenGL devices own a context that is current on the creating thread, make it current before
+// using the device on another thread or after using another OpenGL device. no-op on Vulkan
+VI_API void vi_device_make_current(VIDevice device);
+VI_API void vi_device_release_current(VIDevice device);
+
+// host memory allocated for objects of this device, peak since device creation
+VI_API void vi_device_get_host_memory(VIDevice device, size_t* usage, size_t* peak);
+
+VI_API bool vi_device_is_headless(VIDevice device);
+VI_API bool vi_device_is_compute_only(VIDevice device);
 VI_API VIPass vi_device_get_swapchain_pass(VIDevice device);
 VI_API VIFramebuffer vi_device_get_swapchain_framebuffer(VIDevice device, uint32_t index);
+
+// swapchain recreation may change the framebuffer count and framebuffers, query them every frame
+VI_API uint32_t vi_device_get_swapchain_framebuffer_count(VIDevice device);
+
+// waits until the next frame slot is free and acquires a swapchain image, the returned index is the
+// swapchain framebuffer index. image_acquired and frame_complete belong to the frame slot, present_ready
+// belongs to the swapchain image. headless devices cycle through offscreen frames, image_acquired is
+// signaled once the frame slot is free and present_frame only waits for present_ready, the returned
+// index is the frame slot
 VI_API uint32_t vi_device_next_frame(VIDevice device, VISemaphore* image_acquired, VISemaphore* present_ready, VIFence* frame_complete);
 VI_API void vi_device_present_frame(VIDevice device);
 
+// frame slot of the current frame, in [0, max_frames_in_flight)
+VI_API uint32_t vi_device_get_frame_index(VIDevice device);
+
+// number of frame slots cycled by next_frame, between 1 and max_frames_in_flight.
+// fewer frames in flight trade throughput for lower input latency
+VI_API void vi_device_set_frames_in_flight(VIDevice device, uint32_t count);
+VI_API uint32_t vi_device_get_frames_in_flight(VIDevice device);
+
+// commands submitted between the last two vi_device_next_frame calls. commands are counted each time
+// they are submitted, secondary commands with the primary command executing them
+VI_API void vi_device_get_frame_counters(VIDevice device, VIFrameCounters* counters);
+
 VI_API void vi_queue_wait_idle(VIQueue queue);
 VI_API void vi_queue_submit(VIQueue queue, uint32_t submit_count, VISubmitInfo* submits, VIFence fence);
 
@@ -663,6 +891,15 @@ VI_API void vi_buffer_unmap(VIBuffer buffer);
 
 VI_API VIImage vi_create_image(VIDevice device, const VIImageInfo* info);
 VI_API void vi_destroy_image(VIDevice device, VIImage image);
+// restricts sampling to mip levels [base_level, levels), for example while finer levels are still being streamed in.
+// on Vulkan only sets updated after this call see the new range, on OpenGL the range applies to all later submissions
+VI_API void vi_image_set_base_level(VIImage image, uint32_t base_level);
+// samplers are cached per device, creating a sampler with an existing VISamplerInfo returns the
+// same reference counted handle, every vi_create_sampler must be paired with a vi_destroy_sampler
+VI_API VISampler vi_create_sampler(VIDevice device, const VISamplerInfo* info);
+VI_API void vi_destroy_sampler(VIDevice device, VISampler sampler);
+// byte size of a tightly packed width x height region, block-compressed formats are rounded up to whole blocks
+VI_API uint32_t vi_format_get_data_size(VIFormat format, uint32_t width, uint32_t height);
 
 // Set Resources
 
@@ -673,6 +910,11 @@ VI_API void vi_destroy_set_pool(VIDevice device, VISetPool pool);
 VI_API VISet vi_allocate_set(VIDevice device, VISetPool pool, VISetLayout layout);
 VI_API void vi_free_set(VIDevice device, VISet set);
 VI_API void vi_set_update(VISet set, uint32_t update_count, const VISetUpdateInfo* updates);
+VI_API uint32_t vi_set_layout_get_descriptor_count(VISetLayout layout);
+
+// writes every descriptor of each set from a tightly packed resource array, set i consumes
+// vi_set_layout_get_descriptor_count of its layout entries ordered by binding then array element
+VI_API void vi_set_update_batch(VIDevice device, uint32_t set_count, const VISet* sets, const VISetResource* resources);
 
 // Modules and Pipelines
 
@@ -680,6 +922,12 @@ VI_API VIPipelineLayout vi_create_pipeline_layout(VIDevice device, const VIPipel
 VI_API void vi_destroy_pipeline_layout(VIDevice device, VIPipelineLayout layout);
 VI_API VIModule vi_create_module(VIDevice device, const VIModuleInfo* info);
 VI_API void vi_destroy_module(VIDevice device, VIModule module);
+VI_API VIPermutation vi_create_permutation(VIDevice device, const VIPermutationInfo* info);
+VI_API void vi_destroy_permutation(VIDevice device, VIPermutation permutation);
+VI_API VIModule vi_permutation_get_module(VIPermutation permutation, uint64_t key);
+VI_API void vi_permutation_prewarm(VIPermutation permutation, uint32_t key_count, const uint64_t* keys, uint32_t thread_count = 0);
+VI_API void vi_permutation_load_binary(VIPermutation permutation, uint64_t key, const char* vise_binary, uint32_t binary_size);
+VI_API uint32_t vi_permutation_get_used_keys(VIPermutation permutation, uint64_t* keys);
 VI_API VIPipeline vi_create_pipeline(VIDevice device, const VIPipelineInfo* info);
 VI_API void vi_destroy_pipeline(VIDevice device, VIPipeline pipeline);
 VI_API VIComputePipeline vi_create_compute_pipeline(VIDevice device, const VIComputePipelineInfo* info);
@@ -700,6 +948,9 @@ VI_API void vi_cmd_copy_buffer(VICommand cmd, VIBuffer src, VIBuffer dst, uint32
 VI_API void vi_cmd_copy_buffer_to_image(VICommand cmd, VIBuffer buffer, VIImage image, VkImageLayout layout, uint32_t region_count, const VkBufferImageCopy* regions);
 VI_API void vi_cmd_copy_image(VICommand cmd, VIImage src, VkImageLayout src_layout, VIImage dst, VkImageLayout dst_layout, uint32_t region_count, const VkImageCopy* regions);
 VI_API void vi_cmd_copy_image_to_buffer(VICommand cmd, VIImage image, VkImageLayout layout, VIBuffer buffer, uint32_t region_count, const VkBufferImageCopy* regions);
+// fills mip levels 1 and above by successive downsampling from level 0, level 0 of every layer must be in
+// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, all levels are left in layout. check vi_device_can_generate_mipmaps first
+VI_API void vi_cmd_generate_mipmaps(VICommand cmd, VIImage image, VkImageLayout layout);
 VI_API void vi_cmd_begin_pass(VICommand cmd, const VIPassBeginInfo* info);
 VI_API void vi_cmd_end_pass(VICommand cmd);
 VI_API void vi_cmd_execute_commands(VICommand cmd, uint32_t secondary_command_count, const VICommand* secondary_commands);
@@ -708,23 +959,85 @@ VI_API void vi_cmd_bind_compute_pipeline(VICommand cmd, VIComputePipeline pipeli
 VI_API void vi_cmd_dispatch(VICommand cmd, uint32_t workgroup_x, uint32_t workgroup_y, uint32_t workgroup_z);
 VI_API void vi_cmd_bind_vertex_buffers(VICommand cmd, uint32_t first_binding, uint32_t binding_count, VIBuffer* buffers);
 VI_API void vi_cmd_bind_index_buffer(VICommand cmd, VIBuffer buffer, VkIndexType index_type);
-VI_API void vi_cmd_bind_graphics_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_index, VISet set);
-VI_API void vi_cmd_bind_compute_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_index, VISet set);
+// one dynamic offset per array element of each dynamic binding, ordered by VIBinding::binding_index
+VI_API void vi_cmd_bind_graphics_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_index, VISet set, uint32_t dynamic_offset_count = 0, const uint32_t* dynamic_offsets = nullptr);
+VI_API void vi_cmd_bind_compute_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_index, VISet set, uint32_t dynamic_offset_count = 0, const uint32_t* dynamic_offsets = nullptr);
+// the set layout at set_index must be created with VI_SET_LAYOUT_PUSH_BIT, pushed bindings are only valid for the current frame
+VI_API void vi_cmd_push_graphics_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_index, uint32_t update_count, const VISetUpdateInfo* updates);
+VI_API void vi_cmd_push_compute_set(VICommand cmd, VIPipelineLayout layout, uint32_t set_index, uint32_t update_count, const VISetUpdateInfo* updates);
 VI_API void vi_cmd_push_constants(VICommand cmd, VIPipelineLayout layout, uint32_t offset, uint32_t size, const void* value);
 VI_API void vi_cmd_set_viewport(VICommand cmd, VkViewport viewport);
 VI_API void vi_cmd_set_scissor(VICommand cmd, VkRect2D scissor);
 VI_API void vi_cmd_draw(VICommand cmd, const VIDrawInfo* info);
 VI_API void vi_cmd_draw_indexed(VICommand cmd, const VIDrawIndexedInfo* info);
+// on Vulkan devices with VK_EXT_conditional_rendering, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT implies
+// VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT and VK_ACCESS_INDIRECT_COMMAND_READ_BIT implies
+// VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT, so the same barrier covers predicates on every device
 VI_API void vi_cmd_pipeline_barrier_memory(VICommand cmd, VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages, VkDependencyFlags deps, uint32_t barrier_count, const VIMemoryBarrier* barriers);
 VI_API void vi_cmd_pipeline_barrier_image_memory(VICommand cmd, VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages, VkDependencyFlags deps, uint32_t barrier_count, const VIImageMemoryBarrier* barriers);
 VI_API void vi_cmd_pipeline_barrier_buffer_memory(VICommand cmd, VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages, VkDependencyFlags deps, uint32_t barrier_count, const VIBufferMemoryBarrier* barriers);
 
+// Queries
+
+// queries must be reset before they are written, vi_cmd_reset_queries is recorded outside of render passes.
+// vi_get_query_results never blocks and returns false until every query in the range is available,
+// read results a few frames after submission. timestamps are only meaningful relative to each other.
+// a query begun inside a render pass must end in the same pass, only one query of each type may be
+// active at a time. results holds vi_query_pool_get_result_count values per query
+VI_API VIQueryPool vi_create_query_pool(VIDevice device, const VIQueryPoolInfo* info);
+VI_API void vi_destroy_query_pool(VIDevice device, VIQueryPool pool);
+VI_API void vi_cmd_reset_queries(VICommand cmd, VIQueryPool pool, uint32_t first_query, uint32_t query_count);
+VI_API void vi_cmd_write_timestamp(VICommand cmd, VIQueryPool pool, uint32_t query, VkPipelineStageFlagBits stage);
+VI_API void vi_cmd_begin_query(VICommand cmd, VIQueryPool pool, uint32_t query);
+VI_API void vi_cmd_end_query(VICommand cmd, VIQueryPool pool, uint32_t query);
+VI_API uint32_t vi_query_pool_get_result_count(VIQueryPool pool);
+VI_API bool vi_get_query_results(VIDevice device, VIQueryPool pool, uint32_t first_query, uint32_t query_count, uint64_t* results);
+
+// vi_cmd_copy_query_results waits on the GPU for the queries and writes 32-bit results to a buffer with
+// VI_BUFFER_USAGE_TRANSFER_DST_BIT, recorded outside of render passes. every query in the range must have ended.
+VI_API void vi_cmd_copy_query_results(VICommand cmd, VIQueryPool pool, uint32_t first_query, uint32_t query_count, VIBuffer buffer, uint32_t offset);
+
+// Conditional Rendering
+
+// draws between begin and end are discarded by the GPU if the uint32_t at offset in buffer is zero,
+// the buffer requires VI_BUFFER_USAGE_CONDITIONAL_BIT and offset must be a multiple of 4.
+// regions may not nest and may not contain dispatches. writes to the predicate are made visible with
+// a barrier to VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT and VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+VI_API void vi_cmd_begin_conditional(VICommand cmd, VIBuffer buffer, uint32_t offset);
+VI_API void vi_cmd_end_conditional(VICommand cmd);
+
+// CPU Tracing
+
+// when vise is built with VI_ENABLE_TRACE, vi_* entry points and internal hot paths such as OpenGL
+// command replay and shader compilation record CPU scopes into a ring buffer per thread that keeps
+// the latest events. otherwise the tracing functions do nothing and vi_trace_dump returns false.
+// user scopes nest with vise scopes of the same thread, names must outlive the dump
+VI_API void vi_trace_begin(const char* name);
+VI_API void vi_trace_end();
+// writes the events of every thread as Chrome trace event JSON, viewable in chrome://tracing or Perfetto
+VI_API bool vi_trace_dump(const char* path);
+
 // Offline Compilation
 
-VI_API char* vi_compile_binary_offline(VIBackend backend, VIModuleType type, const VIPipelineLayoutData* pipeline_layout, const char* vise_glsl, uint32_t* binary_size);
-VI_API char* vi_compile_binary(VIDevice device, VIModuleType type, VIPipelineLayout pipeline_layout, const char* vise_glsl, uint32_t* binary_size);
+// dependencies receives the same list as VICompileJobResult::dependencies if not null, free with vi_free
+VI_API char* vi_compile_binary_offline(VIBackend backend, VIModuleType type, const VIPipelineLayoutData* pipeline_layout, const char* vise_glsl, uint32_t* binary_size, const VIIncludeResolver* include_resolver = nullptr, char** dependencies = nullptr);
+VI_API char* vi_compile_binary(VIDevice device, VIModuleType type, VIPipelineLayout pipeline_layout, const char* vise_glsl, uint32_t* binary_size, const VIIncludeResolver* include_resolver = nullptr);
+VI_API char* vi_compile_fat_binary_offline(VIModuleType type, const VIPipelineLayoutData* pipeline_layout, const char* vise_glsl, uint32_t* binary_size, const VIIncludeResolver* include_resolver = nullptr, char** dependencies = nullptr);
+// validates a binary and, if vise_glsl is not null, checks it was compiled from that source.
+// binaries compiled with an include resolver must be checked with one, the included headers are part of the source
+VI_API bool vi_binary_check(const char* vise_binary, uint32_t binary_size, const char* vise_glsl, const VIIncludeResolver* include_resolver = nullptr);
+VI_API char* vi_make_permutation_source(const char* vise_glsl, uint32_t keyword_count, const char* const* keywords, uint64_t key);
+VI_API void vi_compile_binaries(uint32_t job_count, const VICompileJob* jobs, VICompileJobResult* results, uint32_t thread_count = 0);
 VI_API void vi_free(void* data);
 
+// Shader Archives
+
+VI_API char* vi_pack_shader_archive(uint32_t entry_count, const VIShaderArchiveEntry* entries, uint32_t* archive_size);
+VI_API VIShaderArchive vi_load_shader_archive(const char* path);
+VI_API void vi_unload_shader_archive(VIShaderArchive archive);
+VI_API const char* vi_shader_archive_find(VIShaderArchive archive, VIBackend backend, const char* name, uint32_t* binary_size);
+VI_API VIModule vi_create_module_from_archive(VIDevice device, VIShaderArchive archive, VIPipelineLayout pipeline_layout, const char* name);
+
 // Unwrap Native Handles
 
 VI_API VkInstance vi_device_unwrap_instance(VIDevice device);